@@ -0,0 +1,102 @@
+/* Autoslot - packs pending tasks into free calendar time
+ *
+ * Finding a gap probes [t, t + duration) against the busy tree; on a hit, t
+ * jumps past the furthest-reaching overlap and probes again. Each probe is
+ * O(log n + k) and every jump clears at least one busy interval, so a task
+ * never rescans time it has already ruled out.
+ *
+ * Busy time only grows during a run, so once a day has no room for some
+ * length it never will; each day remembers the shortest length that failed
+ * and is skipped for anything at least that long.
+ */
+
+#include <stdlib.h>
+#include <limits.h>
+#include "autoslot.h"
+
+#define SECONDS_PER_DAY 86400LL
+
+static long long align_up(long long t) {
+    long long rem = t % AUTOSLOT_ALIGN_SEC;
+    if (rem < 0) rem += AUTOSLOT_ALIGN_SEC;
+    return rem ? t + (AUTOSLOT_ALIGN_SEC - rem) : t;
+}
+
+static long long floor_day(long long local) {
+    long long day = local / SECONDS_PER_DAY;
+    if (local % SECONDS_PER_DAY < 0) day--;
+    return day;
+}
+
+// Earliest deadline first (none last), then higher priority, then longer
+// tasks while large gaps are still open, then id for a stable plan
+static int compare_requests(const void *a, const void *b) {
+    const SlotRequest *x = a, *y = b;
+    long long dx = x->deadline > 0 ? x->deadline : LLONG_MAX;
+    long long dy = y->deadline > 0 ? y->deadline : LLONG_MAX;
+    if (dx != dy) return dx < dy ? -1 : 1;
+    if (x->priority != y->priority) return x->priority > y->priority ? -1 : 1;
+    if (x->duration_sec != y->duration_sec) return x->duration_sec > y->duration_sec ? -1 : 1;
+    return (x->task_id > y->task_id) - (x->task_id < y->task_id);
+}
+
+// Earliest aligned t in [from, limit - duration] with [t, t + duration) free, or -1
+static long long find_gap(const IntervalTree *busy, long long from, long long limit, long long duration) {
+    long long t = align_up(from);
+    while (t + duration <= limit) {
+        long long blocked_until = interval_tree_overlap_end(busy, t, t + duration);
+        if (blocked_until == t) return t;
+        t = align_up(blocked_until);
+    }
+    return -1;
+}
+
+int autoslot_plan(IntervalTree *busy, SlotRequest *requests, int count,
+                  const SlotWindow *window, SlotPlacement *placements) {
+    qsort(requests, (size_t)count, sizeof(SlotRequest), compare_requests);
+
+    long long offset = (long long)window->utc_offset_minutes * 60;
+    long long first_day = floor_day(window->from + offset);
+    int placed = 0;
+
+    long long *no_room = malloc((size_t)(window->days > 0 ? window->days : 1) * sizeof(long long));
+    if (!no_room) return -1;
+    for (int d = 0; d < window->days; d++) no_room[d] = LLONG_MAX;
+
+    for (int i = 0; i < count; i++) {
+        SlotRequest *request = &requests[i];
+        SlotPlacement *placement = &placements[i];
+        placement->task_id = request->task_id;
+        placement->start = placement->end = 0;
+        placement->late = 0;
+
+        long long duration = request->duration_sec > 0 ? request->duration_sec : AUTOSLOT_ALIGN_SEC;
+
+        for (int d = 0; d < window->days; d++) {
+            if (duration >= no_room[d]) continue;
+
+            // Working hours of local day d, in UTC
+            long long day_start = (first_day + d) * SECONDS_PER_DAY - offset;
+            long long open = day_start + (long long)window->day_start_minute * 60;
+            long long close = day_start + (long long)window->day_end_minute * 60;
+            if (close <= window->from) continue;
+            if (open < window->from) open = window->from;
+
+            long long start = find_gap(busy, open, close, duration);
+            if (start < 0) {
+                no_room[d] = duration;
+                continue;
+            }
+
+            placement->start = start;
+            placement->end = start + duration;
+            placement->late = request->deadline > 0 && placement->end > request->deadline;
+            interval_tree_insert(busy, placement->start, placement->end, request->task_id);
+            placed++;
+            break;
+        }
+    }
+
+    free(no_room);
+    return placed;
+}
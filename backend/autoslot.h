@@ -0,0 +1,45 @@
+/* Autoslot - packs pending tasks into free calendar time
+ *
+ * Busy time is an IntervalTree. Tasks are taken earliest deadline first, then
+ * by priority, and each one goes into the first free gap of its length inside
+ * the working hours of the horizon: a greedy first-fit that keeps urgent work
+ * early and lets short tasks fill holes that longer ones skipped. Every
+ * placement is added to the busy tree, so later tasks see it.
+ */
+
+#ifndef AUTOSLOT_H
+#define AUTOSLOT_H
+
+#include "interval_tree.h"
+
+#define AUTOSLOT_ALIGN_SEC 300   // Slots start on 5-minute boundaries
+
+typedef struct {
+    int task_id;
+    int priority;                // Higher is more important
+    int duration_sec;
+    long long deadline;          // 0 = none
+} SlotRequest;
+
+typedef struct {
+    int task_id;
+    long long start;             // 0 = no room in the horizon
+    long long end;
+    int late;                    // Placed, but ends after its deadline
+} SlotPlacement;
+
+typedef struct {
+    long long from;              // Nothing is placed before this
+    int days;                    // Horizon, counted in local days from `from`
+    int day_start_minute;        // Working hours, local minutes after midnight
+    int day_end_minute;
+    int utc_offset_minutes;
+} SlotWindow;
+
+// Fills placements[i] for requests[i] after sorting requests into placement
+// order in place; returns how many were placed, or -1 on allocation failure,
+// when placements is left unfilled. The placed intervals are left in busy.
+int autoslot_plan(IntervalTree *busy, SlotRequest *requests, int count,
+                  const SlotWindow *window, SlotPlacement *placements);
+
+#endif
@@ -35,7 +35,7 @@ REM Compile with optimizations and security flags
 echo 🔨 Compiling production server...
 echo.
 
-gcc -O3 -Wall -Wextra -std=c99 -D_WIN32_WINNT=0x0601 -DNDEBUG production_server.c -o build\production_server.exe -lws2_32
+gcc -O3 -Wall -Wextra -std=c99 -D_WIN32_WINNT=0x0601 -DNDEBUG production_server.c lock_stats.c http_parser.c http_response.c router.c json_body.c -o build\production_server.exe -lws2_32
 
 if %ERRORLEVEL% equ 0 (
     echo.
@@ -65,6 +65,7 @@ if %ERRORLEVEL% equ 0 (
     echo    POST /api/auth/login/step3
     echo    POST /api/auth/resend-otp
     echo    GET  /api/health
+    echo    GET  /api/stats/locks
     echo.
     echo 🔧 Production features:
     echo    • Enhanced input validation
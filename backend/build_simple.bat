@@ -16,7 +16,7 @@ if not exist "build" mkdir build
 
 REM Compile the simple server
 echo Compiling simple_server.c...
-gcc -Wall -Wextra -std=c99 -D_WIN32_WINNT=0x0601 simple_server.c -o build/scheduler_server.exe -lws2_32
+gcc -Wall -Wextra -std=c99 -D_WIN32_WINNT=0x0601 simple_server.c json_body.c -o build/scheduler_server.exe -lws2_32
 
 if %ERRORLEVEL% eq 0 (
     echo.
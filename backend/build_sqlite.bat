@@ -58,9 +58,9 @@ gcc -O3 -Wall -Wextra -std=c99 ^
     -DSQLITE_THREADSAFE=1 ^
     -DSQLITE_ENABLE_FTS5 ^
     -DSQLITE_ENABLE_JSON1 ^
-    production_server_v3.c sqlite3.c ^
+    production_server_v3.c query_stats.c lock_stats.c task_graph.c interval_tree.c autoslot.c recurrence.c event_loop.c http_parser.c http_response.c router.c rate_limiter.c session_cache.c json_body.c http_compress.c static_files.c sqlite3.c ^
     -o build\production_server_v3.exe ^
-    -lws2_32
+    -lws2_32 -lz
 
 if %ERRORLEVEL% equ 0 (
     echo.
@@ -88,12 +88,20 @@ if %ERRORLEVEL% equ 0 (
     echo    POST /api/auth/register
     echo    POST /api/auth/login/step1
     echo    POST /api/auth/login/step2  
-    echo    POST /api/auth/login/step3
     echo    POST /api/tasks
     echo    GET  /api/tasks
     echo    PUT  /api/tasks/{id}
     echo    DELETE /api/tasks/{id}
+    echo    GET  /api/tasks/ready
+    echo    POST /api/tasks/dependencies
+    echo    POST /api/tasks/start
+    echo    POST /api/tasks/complete
+    echo    POST /api/tasks/autoslot
+    echo    GET  /api/tasks/conflicts
+    echo    GET  /api/calendar?from=^&to=
     echo    GET  /api/health
+    echo    GET  /api/stats/queries
+    echo    GET  /api/stats/locks
     echo.
     echo 🔧 Production features:
     echo    • Persistent SQLite database
@@ -70,7 +70,7 @@ CREATE TABLE IF NOT EXISTS tasks (
     updated_at INTEGER DEFAULT (strftime('%s', 'now')),
     completed_at INTEGER,
     is_recurring INTEGER DEFAULT 0,
-    recurrence_pattern TEXT, -- JSON with recurrence rules
+    recurrence_pattern TEXT, -- JSON rule or cron expression (format in recurrence.h)
     parent_task_id INTEGER, -- for subtasks
     attachment_path TEXT,
     location TEXT,
@@ -156,6 +156,27 @@ CREATE TABLE IF NOT EXISTS notifications (
     FOREIGN KEY (user_id) REFERENCES users (user_id) ON DELETE CASCADE
 );
 
+-- Durable job queue (reminders, cleanup, analytics, backups). Workers claim
+-- batches by stamping lease_owner/lease_expires in one UPDATE; jobs of a
+-- crashed worker become runnable again once the lease expires.
+CREATE TABLE IF NOT EXISTS jobs (
+    id INTEGER PRIMARY KEY AUTOINCREMENT,
+    kind TEXT NOT NULL,
+    dedupe_key TEXT UNIQUE, -- one row per periodic job / task reminder
+    user_id INTEGER,
+    task_id INTEGER,
+    run_at INTEGER NOT NULL,
+    lease_owner TEXT,
+    lease_expires INTEGER DEFAULT 0,
+    attempts INTEGER DEFAULT 0,
+    status INTEGER DEFAULT 0, -- 0=queued, 1=done, 2=failed
+    last_error TEXT,
+    created_at INTEGER DEFAULT (strftime('%s', 'now')),
+    finished_at INTEGER DEFAULT 0,
+    FOREIGN KEY (user_id) REFERENCES users (user_id) ON DELETE CASCADE,
+    FOREIGN KEY (task_id) REFERENCES tasks (task_id) ON DELETE CASCADE
+);
+
 -- User preferences and settings
 CREATE TABLE IF NOT EXISTS user_settings (
     user_id INTEGER PRIMARY KEY,
@@ -216,6 +237,9 @@ CREATE INDEX IF NOT EXISTS idx_notifications_send_at ON notifications(send_at);
 CREATE INDEX IF NOT EXISTS idx_notifications_type ON notifications(type);
 CREATE INDEX IF NOT EXISTS idx_notifications_read ON notifications(is_read);
 
+-- Only queued jobs are scanned by claims
+CREATE INDEX IF NOT EXISTS idx_jobs_runnable ON jobs(run_at, lease_expires) WHERE status = 0;
+
 -- Triggers for maintaining data integrity and automatic updates
 
 -- Update timestamp trigger for users
@@ -252,6 +276,25 @@ BEGIN
     );
 END;
 
+-- Queue a reminder job whenever a task gets (or changes) its reminder time
+CREATE TRIGGER IF NOT EXISTS queue_reminder_on_insert
+    AFTER INSERT ON tasks
+    FOR EACH ROW
+    WHEN NEW.reminder_time > 0 AND NEW.reminder_sent = 0
+BEGIN
+    INSERT OR REPLACE INTO jobs (kind, dedupe_key, user_id, task_id, run_at)
+    VALUES ('reminder', 'reminder:' || NEW.task_id, NEW.user_id, NEW.task_id, NEW.reminder_time);
+END;
+
+CREATE TRIGGER IF NOT EXISTS queue_reminder_on_update
+    AFTER UPDATE OF reminder_time ON tasks
+    FOR EACH ROW
+    WHEN NEW.reminder_time > 0 AND NEW.reminder_sent = 0
+BEGIN
+    INSERT OR REPLACE INTO jobs (kind, dedupe_key, user_id, task_id, run_at)
+    VALUES ('reminder', 'reminder:' || NEW.task_id, NEW.user_id, NEW.task_id, NEW.reminder_time);
+END;
+
 -- Log user activity
 CREATE TRIGGER IF NOT EXISTS log_user_login
     AFTER INSERT ON sessions
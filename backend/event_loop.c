@@ -0,0 +1,576 @@
+/* Event Loop - epoll reactors feeding a fixed worker pool
+ *
+ * A connection is owned by exactly one thread at a time: its reactor while
+ * a request is being read (the fd is armed EPOLLONESHOT, so only one event
+ * is ever in flight), then the worker that handles it. The worker answers
+ * every complete request already buffered, in order, and hands a persistent
+ * connection back to its reactor to wait for the next one. Reactors keep
+ * their reading connections on a list that is swept once a second for idle
+ * ones; the list has a lock only because workers return connections to it.
+ */
+
+#ifndef _WIN32
+    #define _GNU_SOURCE  // accept4
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "event_loop.h"
+
+#ifdef _WIN32
+    #include <winsock2.h>
+    #include <windows.h>
+    #include <process.h>
+    #define close closesocket
+    typedef HANDLE loop_thread_t;
+    typedef CRITICAL_SECTION loop_mutex_t;
+    typedef CONDITION_VARIABLE loop_cond_t;
+    #define LOOP_THREAD_FUNC(name) unsigned int __stdcall name(void *arg)
+    #define LOOP_THREAD_CREATE(thread, func, arg) \
+        ((thread = (HANDLE)_beginthreadex(NULL, 0, func, arg, 0, NULL)) != 0)
+    #define LOOP_MUTEX_INIT(mutex) InitializeCriticalSection(&mutex)
+    #define LOOP_MUTEX_LOCK(mutex) EnterCriticalSection(&mutex)
+    #define LOOP_MUTEX_UNLOCK(mutex) LeaveCriticalSection(&mutex)
+    #define LOOP_COND_INIT(cond) InitializeConditionVariable(&cond)
+    #define LOOP_COND_WAIT(cond, mutex) SleepConditionVariableCS(&cond, &mutex, INFINITE)
+    #define LOOP_COND_SIGNAL(cond) WakeConditionVariable(&cond)
+    #define LOOP_THREAD_LOCAL __declspec(thread)
+#else
+    #include <sys/socket.h>
+    #include <sys/time.h>
+    #include <netinet/in.h>
+    #include <netinet/tcp.h>
+    #include <unistd.h>
+    #include <fcntl.h>
+    #include <errno.h>
+    #include <signal.h>
+    #include <pthread.h>
+    typedef pthread_t loop_thread_t;
+    typedef pthread_mutex_t loop_mutex_t;
+    typedef pthread_cond_t loop_cond_t;
+    #define LOOP_THREAD_FUNC(name) void *name(void *arg)
+    #define LOOP_THREAD_CREATE(thread, func, arg) (pthread_create(&thread, NULL, func, arg) == 0)
+    #define LOOP_MUTEX_INIT(mutex) pthread_mutex_init(&mutex, NULL)
+    #define LOOP_MUTEX_LOCK(mutex) pthread_mutex_lock(&mutex)
+    #define LOOP_MUTEX_UNLOCK(mutex) pthread_mutex_unlock(&mutex)
+    #define LOOP_COND_INIT(cond) pthread_cond_init(&cond, NULL)
+    #define LOOP_COND_WAIT(cond, mutex) pthread_cond_wait(&cond, &mutex)
+    #define LOOP_COND_SIGNAL(cond) pthread_cond_signal(&cond)
+    #define LOOP_THREAD_LOCAL __thread
+#endif
+
+#ifdef __linux__
+    #include <sys/epoll.h>
+    #ifndef EPOLLEXCLUSIVE
+        #define EPOLLEXCLUSIVE (1u << 28)
+    #endif
+    #define REACTOR_MAX_EVENTS 64
+#endif
+
+typedef struct Reactor Reactor;
+
+// Room for the largest request the parser accepts, its chunk framing, and the
+// start of a pipelined one
+#define MAX_BUFFER_SIZE (HTTP_MAX_HEADER_BYTES + HTTP_MAX_BODY_BYTES + EVENT_LOOP_BUFFER_SIZE)
+
+typedef struct Connection {
+    int socket;
+    int length;                  // Bytes buffered, possibly several pipelined requests
+    int capacity;
+    char *buffer;
+    HttpRequest request;         // Parse state of the first buffered request
+    time_t last_active;
+    Reactor *reactor;
+    struct Connection *prev;     // Reactor's list of connections still reading
+    struct Connection *next;
+} Connection;
+
+struct Reactor {
+    int epoll_fd;
+    int index;
+    loop_mutex_t lock;           // Guards reading
+    Connection *reading;
+};
+
+static EventLoopConfig loop_config;
+static int listen_fd = -1;
+static volatile int open_connections = 0;
+
+// Complete requests waiting for a worker; never holds more than max_connections
+static Connection **queue;
+static int queue_capacity, queue_head, queue_count;
+static loop_mutex_t queue_mutex;
+static loop_cond_t queue_ready;
+
+// Whether the response being written on this worker keeps the connection open
+static LOOP_THREAD_LOCAL int keep_alive_response;
+
+static const char overloaded_response[] =
+    "HTTP/1.1 503 Service Unavailable\r\n"
+    "Content-Type: application/json\r\n"
+    "Retry-After: 1\r\n"
+    "Content-Length: 54\r\n"
+    "Connection: close\r\n"
+    "\r\n"
+    "{\"success\":false,\"error\":\"Server at connection limit\"}";
+
+static int cpu_count(void) {
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors > 0 ? (int)info.dwNumberOfProcessors : 1;
+#else
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (int)count : 1;
+#endif
+}
+
+// Reserves a slot for a new connection; 0 once max_connections are open
+static int connection_open(void) {
+    if (__sync_add_and_fetch(&open_connections, 1) <= loop_config.max_connections) return 1;
+    __sync_sub_and_fetch(&open_connections, 1);
+    return 0;
+}
+
+static Connection *connection_new(int socket) {
+    Connection *connection = malloc(sizeof(Connection));
+    char *buffer = malloc(EVENT_LOOP_BUFFER_SIZE);
+    if (!connection || !buffer) {
+        free(connection);
+        free(buffer);
+        return NULL;
+    }
+    connection->socket = socket;
+    connection->length = 0;
+    connection->capacity = EVENT_LOOP_BUFFER_SIZE;
+    connection->buffer = buffer;
+    http_request_init(&connection->request);
+    connection->last_active = time(NULL);
+    connection->reactor = NULL;
+    return connection;
+}
+
+static void connection_close(Connection *connection) {
+    close(connection->socket);
+    free(connection->buffer);
+    free(connection);
+    __sync_sub_and_fetch(&open_connections, 1);
+}
+
+// Free bytes after what is buffered, one kept for the body's terminator. A
+// full buffer grows while the request in it is still incomplete; 0 means
+// nothing more should be read.
+static int buffer_space(Connection *connection) {
+    int space = connection->capacity - 1 - connection->length;
+    if (space > 0 || connection->capacity >= MAX_BUFFER_SIZE) return space;
+    if (http_parse(&connection->request, connection->buffer, connection->length) != HTTP_PARSE_INCOMPLETE) return 0;
+
+    int capacity = connection->capacity * 2 < MAX_BUFFER_SIZE ? connection->capacity * 2 : MAX_BUFFER_SIZE;
+    char *grown = realloc(connection->buffer, capacity);
+    if (!grown) return 0;
+    connection->buffer = grown;
+    connection->capacity = capacity;
+    return capacity - 1 - connection->length;
+}
+
+// A buffer grown for one large request goes back to the usual size once the
+// connection only holds small ones
+static void buffer_shrink(Connection *connection) {
+    if (connection->capacity == EVENT_LOOP_BUFFER_SIZE || connection->length >= EVENT_LOOP_BUFFER_SIZE) return;
+    char *shrunk = realloc(connection->buffer, EVENT_LOOP_BUFFER_SIZE);
+    if (!shrunk) return;
+    connection->buffer = shrunk;
+    connection->capacity = EVENT_LOOP_BUFFER_SIZE;
+}
+
+static void send_parse_error(int socket, int status) {
+    const char *reason = status == 413 ? "Payload Too Large" :
+                         status == 431 ? "Request Header Fields Too Large" :
+                         status == 501 ? "Not Implemented" :
+                         status == 505 ? "HTTP Version Not Supported" : "Bad Request";
+    char body[128];
+    int body_length = snprintf(body, sizeof(body), "{\"success\":false,\"error\":\"%s\"}", reason);
+
+    char response[512];
+    int length = snprintf(response, sizeof(response),
+        "HTTP/1.1 %d %s\r\n"
+        "Content-Type: application/json\r\n"
+        "Content-Length: %d\r\n"
+        "Connection: close\r\n"
+        "\r\n"
+        "%s", status, reason, body_length, body);
+    send(socket, response, length, 0);
+}
+
+static void queue_push(Connection *connection) {
+    LOOP_MUTEX_LOCK(queue_mutex);
+    queue[(queue_head + queue_count) % queue_capacity] = connection;
+    queue_count++;
+    LOOP_COND_SIGNAL(queue_ready);
+    LOOP_MUTEX_UNLOCK(queue_mutex);
+}
+
+static Connection *queue_pop(void) {
+    LOOP_MUTEX_LOCK(queue_mutex);
+    while (queue_count == 0) LOOP_COND_WAIT(queue_ready, queue_mutex);
+    Connection *connection = queue[queue_head];
+    queue_head = (queue_head + 1) % queue_capacity;
+    queue_count--;
+    LOOP_MUTEX_UNLOCK(queue_mutex);
+    return connection;
+}
+
+static void set_timeouts(int socket, int seconds) {
+#ifdef _WIN32
+    DWORD timeout = (DWORD)seconds * 1000;
+#else
+    struct timeval timeout = { seconds, 0 };
+#endif
+    setsockopt(socket, SOL_SOCKET, SO_RCVTIMEO, (const char*)&timeout, sizeof(timeout));
+    setsockopt(socket, SOL_SOCKET, SO_SNDTIMEO, (const char*)&timeout, sizeof(timeout));
+}
+
+static void set_blocking(int socket, int blocking) {
+#ifdef _WIN32
+    u_long mode = blocking ? 0 : 1;
+    ioctlsocket(socket, FIONBIO, &mode);
+#else
+    int flags = fcntl(socket, F_GETFL, 0);
+    fcntl(socket, F_SETFL, blocking ? flags & ~O_NONBLOCK : flags | O_NONBLOCK);
+#endif
+}
+
+#ifdef __linux__
+static void return_to_reactor(Connection *connection);
+#endif
+
+// Answers every complete request buffered, in order. Returns 1 when the
+// connection stays open for more, 0 when it should be closed.
+static int serve_requests(Connection *connection) {
+    HttpRequest *request = &connection->request;
+    for (;;) {
+        HttpParseResult result = http_parse(request, connection->buffer, connection->length);
+
+        if (result == HTTP_PARSE_INCOMPLETE) {
+            int space = buffer_space(connection);
+            if (space == 0) {
+                send_parse_error(connection->socket, 413);
+                return 0;
+            }
+#ifdef __linux__
+            return 1; // The reactor reads the rest
+#else
+            // No reactor: wait here, bounded by the receive timeout
+            int received = recv(connection->socket, connection->buffer + connection->length, space, 0);
+            if (received <= 0) return 0;
+            connection->length += received;
+            continue;
+#endif
+        }
+        if (result == HTTP_PARSE_ERROR) {
+            send_parse_error(connection->socket, request->error_status);
+            return 0;
+        }
+
+        // The byte after the body may start the next request; lend it for the terminator
+        int body_end = request->body.offset + request->body.length;
+        char next = connection->buffer[body_end];
+        connection->buffer[body_end] = '\0';
+        keep_alive_response = request->keep_alive;
+        loop_config.handle_request(connection->socket, request);
+        connection->buffer[body_end] = next;
+
+        connection->length -= request->consumed;
+        memmove(connection->buffer, connection->buffer + request->consumed, connection->length);
+        http_request_init(request);
+        buffer_shrink(connection);
+        if (!keep_alive_response) return 0;
+    }
+}
+
+static LOOP_THREAD_FUNC(worker_main) {
+    (void)arg;
+    for (;;) {
+        Connection *connection = queue_pop();
+
+        // A client that stops reading cannot hold the worker past the idle timeout
+        set_blocking(connection->socket, 1);
+        set_timeouts(connection->socket, loop_config.idle_timeout_sec);
+
+        if (!serve_requests(connection)) {
+            connection_close(connection);
+            continue;
+        }
+#ifdef __linux__
+        return_to_reactor(connection);
+#endif
+    }
+    return 0;
+}
+
+#ifdef __linux__
+
+static void reading_add(Reactor *reactor, Connection *connection) {
+    connection->prev = NULL;
+    connection->next = reactor->reading;
+    if (reactor->reading) reactor->reading->prev = connection;
+    reactor->reading = connection;
+}
+
+static void reading_remove(Reactor *reactor, Connection *connection) {
+    if (connection->prev) connection->prev->next = connection->next;
+    else reactor->reading = connection->next;
+    if (connection->next) connection->next->prev = connection->prev;
+}
+
+static void arm(Reactor *reactor, Connection *connection, int op) {
+    struct epoll_event event;
+    event.events = EPOLLIN | EPOLLRDHUP | EPOLLONESHOT;
+    event.data.ptr = connection;
+    epoll_ctl(reactor->epoll_fd, op, connection->socket, &event);
+}
+
+// A persistent connection goes back to its reactor to wait for the next request
+static void return_to_reactor(Connection *connection) {
+    Reactor *reactor = connection->reactor;
+    set_blocking(connection->socket, 0);
+    connection->last_active = time(NULL);
+
+    LOOP_MUTEX_LOCK(reactor->lock);
+    reading_add(reactor, connection);
+    LOOP_MUTEX_UNLOCK(reactor->lock);
+    arm(reactor, connection, EPOLL_CTL_MOD);
+}
+
+static void accept_connections(Reactor *reactor) {
+    for (;;) {
+        int socket = accept4(listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (socket < 0) return; // EAGAIN: another reactor took it, or the backlog is empty
+
+        if (!connection_open()) {
+            send(socket, overloaded_response, sizeof(overloaded_response) - 1, MSG_NOSIGNAL);
+            close(socket);
+            continue;
+        }
+
+        Connection *connection = connection_new(socket);
+        if (!connection) {
+            close(socket);
+            __sync_sub_and_fetch(&open_connections, 1);
+            continue;
+        }
+
+        int nodelay = 1;
+        setsockopt(socket, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay));
+        connection->reactor = reactor;
+        LOOP_MUTEX_LOCK(reactor->lock);
+        reading_add(reactor, connection);
+        LOOP_MUTEX_UNLOCK(reactor->lock);
+        arm(reactor, connection, EPOLL_CTL_ADD);
+    }
+}
+
+static void read_connection(Reactor *reactor, Connection *connection) {
+    for (;;) {
+        int space = buffer_space(connection);
+        if (space == 0) break; // A complete request, or one too large to buffer
+        int received = recv(connection->socket, connection->buffer + connection->length, space, 0);
+        if (received > 0) {
+            connection->length += received;
+            continue;
+        }
+        if (received == 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) {
+            LOOP_MUTEX_LOCK(reactor->lock);
+            reading_remove(reactor, connection);
+            LOOP_MUTEX_UNLOCK(reactor->lock);
+            connection_close(connection);
+            return;
+        }
+        break;
+    }
+
+    // Only the worker reports a request that is bad or too large
+    connection->last_active = time(NULL);
+    if (http_parse(&connection->request, connection->buffer, connection->length) != HTTP_PARSE_INCOMPLETE ||
+        buffer_space(connection) == 0) {
+        LOOP_MUTEX_LOCK(reactor->lock);
+        reading_remove(reactor, connection);
+        LOOP_MUTEX_UNLOCK(reactor->lock);
+        queue_push(connection);
+    } else {
+        arm(reactor, connection, EPOLL_CTL_MOD);
+    }
+}
+
+// Covers both a request that stalls halfway and a persistent connection
+// with nothing more to send
+static void close_idle(Reactor *reactor, time_t now) {
+    LOOP_MUTEX_LOCK(reactor->lock);
+    Connection *connection = reactor->reading;
+    while (connection) {
+        Connection *next = connection->next;
+        if (now - connection->last_active >= loop_config.idle_timeout_sec) {
+            reading_remove(reactor, connection);
+            connection_close(connection);
+        }
+        connection = next;
+    }
+    LOOP_MUTEX_UNLOCK(reactor->lock);
+}
+
+static LOOP_THREAD_FUNC(reactor_main) {
+    Reactor *reactor = arg;
+    struct epoll_event events[REACTOR_MAX_EVENTS];
+    time_t last_second = time(NULL);
+
+    for (;;) {
+        int count = epoll_wait(reactor->epoll_fd, events, REACTOR_MAX_EVENTS, 1000);
+        for (int i = 0; i < count; i++) {
+            if (events[i].data.ptr == NULL) {
+                accept_connections(reactor);
+            } else {
+                read_connection(reactor, events[i].data.ptr);
+            }
+        }
+
+        time_t now = time(NULL);
+        if (now != last_second) {
+            last_second = now;
+            close_idle(reactor, now);
+            if (reactor->index == 0 && loop_config.on_tick) loop_config.on_tick();
+        }
+    }
+    return 0;
+}
+
+static int run_reactors(void) {
+    int count = loop_config.reactors;
+    Reactor *reactors = calloc(count, sizeof(Reactor));
+    if (!reactors) return 0;
+
+    int flags = fcntl(listen_fd, F_GETFL, 0);
+    fcntl(listen_fd, F_SETFL, flags | O_NONBLOCK);
+
+    for (int i = 0; i < count; i++) {
+        reactors[i].index = i;
+        LOOP_MUTEX_INIT(reactors[i].lock);
+        reactors[i].epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+        if (reactors[i].epoll_fd < 0) return 0;
+
+        // Exclusive: a new connection wakes one reactor, not all of them
+        struct epoll_event event;
+        event.events = EPOLLIN | EPOLLEXCLUSIVE;
+        event.data.ptr = NULL;
+        if (epoll_ctl(reactors[i].epoll_fd, EPOLL_CTL_ADD, listen_fd, &event) < 0) return 0;
+    }
+
+    // The calling thread becomes reactor 0
+    for (int i = 1; i < count; i++) {
+        loop_thread_t thread;
+        if (!LOOP_THREAD_CREATE(thread, reactor_main, &reactors[i])) return 0;
+        pthread_detach(thread);
+    }
+    reactor_main(&reactors[0]);
+    return 1;
+}
+
+#else
+
+// No epoll: accept here and let the workers read; select() bounds the wait so
+// on_tick still runs while no one connects
+static int run_reactors(void) {
+    time_t last_second = time(NULL);
+
+    for (;;) {
+        fd_set readable;
+        FD_ZERO(&readable);
+        FD_SET(listen_fd, &readable);
+        struct timeval wait = { 1, 0 };
+
+        if (select(listen_fd + 1, &readable, NULL, NULL, &wait) > 0) {
+            int socket = accept(listen_fd, NULL, NULL);
+            if (socket >= 0) {
+                Connection *connection = NULL;
+                if (connection_open()) {
+                    connection = connection_new(socket);
+                    if (!connection) __sync_sub_and_fetch(&open_connections, 1);
+                }
+                if (connection) {
+                    queue_push(connection);
+                } else {
+                    send(socket, overloaded_response, sizeof(overloaded_response) - 1, 0);
+                    close(socket);
+                }
+            }
+        }
+
+        time_t now = time(NULL);
+        if (now != last_second) {
+            last_second = now;
+            if (loop_config.on_tick) loop_config.on_tick();
+        }
+    }
+    return 1;
+}
+
+#endif
+
+// ============================================
+// PUBLIC API
+// ============================================
+
+void event_loop_config_defaults(EventLoopConfig *config) {
+    config->max_connections = EVENT_LOOP_DEFAULT_MAX_CONNECTIONS;
+    config->reactors = 0;
+    config->workers = 0;
+    config->idle_timeout_sec = EVENT_LOOP_DEFAULT_IDLE_TIMEOUT;
+    config->handle_request = NULL;
+    config->on_tick = NULL;
+}
+
+int event_loop_run(int listen_socket, const EventLoopConfig *config) {
+    loop_config = *config;
+    listen_fd = listen_socket;
+    if (loop_config.reactors <= 0) loop_config.reactors = cpu_count();
+    if (loop_config.workers <= 0) loop_config.workers = cpu_count() * EVENT_LOOP_WORKERS_PER_CORE;
+    if (loop_config.max_connections <= 0) loop_config.max_connections = EVENT_LOOP_DEFAULT_MAX_CONNECTIONS;
+    if (loop_config.idle_timeout_sec <= 0) loop_config.idle_timeout_sec = EVENT_LOOP_DEFAULT_IDLE_TIMEOUT;
+
+#ifndef _WIN32
+    // A client that disconnects mid-response must not kill the process
+    signal(SIGPIPE, SIG_IGN);
+#endif
+
+    queue_capacity = loop_config.max_connections;
+    queue = malloc(queue_capacity * sizeof(Connection*));
+    if (!queue) return 0;
+    queue_head = queue_count = 0;
+    LOOP_MUTEX_INIT(queue_mutex);
+    LOOP_COND_INIT(queue_ready);
+
+    for (int i = 0; i < loop_config.workers; i++) {
+        loop_thread_t thread;
+        if (!LOOP_THREAD_CREATE(thread, worker_main, NULL)) return 0;
+#ifdef _WIN32
+        CloseHandle(thread);
+#else
+        pthread_detach(thread);
+#endif
+    }
+
+    return run_reactors();
+}
+
+const char *event_loop_connection_header(void) {
+    return keep_alive_response ? "keep-alive" : "close";
+}
+
+void event_loop_response_failed(void) {
+    keep_alive_response = 0;
+}
+
+int event_loop_connections(void) {
+    return open_connections;
+}
@@ -0,0 +1,66 @@
+/* Event Loop - epoll reactors feeding a fixed worker pool
+ *
+ * One reactor thread per core shares the non-blocking listening socket
+ * (EPOLLEXCLUSIVE, so a new connection wakes one reactor), accepts, and feeds
+ * each read to an incremental parser (http_parser.h) until a request, framed
+ * by Content-Length or chunked, is complete; a connection's buffer grows as
+ * far as the parser's limits for large bodies. Only a complete request is
+ * queued for the worker pool, so a slow or idle client
+ * never ties up a worker; workers run the handler on a blocking socket, so
+ * handlers keep using plain send(). Connections beyond max_connections get a
+ * 503 and are closed, and connections that sit idle mid-request are closed
+ * after idle_timeout_sec.
+ *
+ * Connections are persistent per HTTP/1.1: after a response the worker
+ * answers any pipelined requests already buffered, in order, then returns the
+ * connection to its reactor, which closes it if it stays idle. "Connection:
+ * close" (or HTTP/1.0 without keep-alive) closes it after the response.
+ *
+ * Without epoll (Windows) the calling thread accepts with blocking sockets and
+ * the worker pool reads and handles each connection; concurrency is still
+ * bounded by the pool rather than one thread per connection.
+ */
+
+#ifndef EVENT_LOOP_H
+#define EVENT_LOOP_H
+
+#include "http_parser.h"
+
+#define EVENT_LOOP_BUFFER_SIZE 8192      // Initial per-connection buffer
+#define EVENT_LOOP_DEFAULT_BACKLOG 511
+#define EVENT_LOOP_DEFAULT_MAX_CONNECTIONS 100
+#define EVENT_LOOP_DEFAULT_IDLE_TIMEOUT 30   // Seconds, mid-request or between keep-alive requests
+#define EVENT_LOOP_WORKERS_PER_CORE 4   // Handlers mostly wait on db_mutex or the network
+
+// Handles one parsed request, whose body is NUL-terminated; its spans are only
+// valid during the call. The loop decides whether the socket stays open
+// afterwards, so responses must be length-delimited (Content-Length or chunked).
+typedef void (*EventRequestHandler)(int client_socket, HttpRequest *request);
+
+typedef struct {
+    int max_connections;
+    int reactors;                // 0 = one per core
+    int workers;                 // 0 = EVENT_LOOP_WORKERS_PER_CORE per core
+    int idle_timeout_sec;
+    EventRequestHandler handle_request;
+    void (*on_tick)(void);       // Optional, called about once a second
+} EventLoopConfig;
+
+void event_loop_config_defaults(EventLoopConfig *config);
+
+// Serves the listening socket until the process exits; returns 0 if the
+// threads or the epoll instances could not be created
+int event_loop_run(int listen_socket, const EventLoopConfig *config);
+
+// "keep-alive" or "close": the Connection header for the response the calling
+// worker is writing
+const char *event_loop_connection_header(void);
+
+// The response the calling worker was writing did not go out whole; the
+// connection is closed afterwards instead of reading another request from it
+void event_loop_response_failed(void);
+
+// Connections currently open, for health reporting
+int event_loop_connections(void);
+
+#endif
@@ -0,0 +1,371 @@
+/* HTTP Compress - gzip/deflate response bodies with a cache of results
+ *
+ * The cache is keyed by the body itself: a body hashes (64-bit FNV-1a) to
+ * one of HTTP_COMPRESS_SHARDS shards, each with its own lock, a fixed chained
+ * hash table and a recency list. An entry holds the uncompressed body next to
+ * its compressed form and a hit compares the whole body, so two responses
+ * that merely share a hash never share output. Hashing and comparing cost a
+ * small fraction of what compressing the body again would.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include "http_compress.h"
+
+#ifdef _WIN32
+    #include <windows.h>
+    typedef CRITICAL_SECTION mutex_t;
+    #define MUTEX_INIT(mutex) InitializeCriticalSection(&mutex)
+    #define MUTEX_LOCK(mutex) EnterCriticalSection(&mutex)
+    #define MUTEX_UNLOCK(mutex) LeaveCriticalSection(&mutex)
+#else
+    #include <pthread.h>
+    typedef pthread_mutex_t mutex_t;
+    #define MUTEX_INIT(mutex) pthread_mutex_init(&mutex, NULL)
+    #define MUTEX_LOCK(mutex) pthread_mutex_lock(&mutex)
+    #define MUTEX_UNLOCK(mutex) pthread_mutex_unlock(&mutex)
+#endif
+
+#define HTTP_COMPRESS_SHARDS 8           // Power of two
+#define GZIP_WINDOW_BITS (15 + 16)       // zlib's way of asking for a gzip wrapper
+#define ZLIB_WINDOW_BITS 15
+#define DEFLATE_MEM_LEVEL 8
+
+typedef struct CompressedEntry {
+    struct CompressedEntry *chain;       // Next in the hash bucket
+    struct CompressedEntry *newer;
+    struct CompressedEntry *older;
+    unsigned long long hash;
+    HttpEncoding encoding;
+    size_t body_length;
+    size_t compressed_length;
+    char data[];                         // Body, then its compressed form
+} CompressedEntry;
+
+typedef struct {
+    mutex_t mutex;
+    CompressedEntry **buckets;
+    unsigned int mask;
+    CompressedEntry *newest;
+    CompressedEntry *oldest;
+    int count;
+    size_t bytes;
+    unsigned long long hits;
+    unsigned long long misses;
+    char padding[64];                    // Keeps neighbouring shard locks off one cache line
+} CompressShard;
+
+static CompressShard shards[HTTP_COMPRESS_SHARDS];
+static HttpCompressConfig compress_config = { 0, 0, 0, 0 };
+static int shard_entries;
+static size_t shard_bytes;
+static int cache_ready = 0;
+
+static unsigned long long body_hash(const char *body, size_t length, HttpEncoding encoding) {
+    unsigned long long hash = 14695981039346656037ULL ^ (unsigned long long)encoding;
+    for (size_t i = 0; i < length; i++) {
+        hash ^= (unsigned char)body[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+static CompressShard *shard_for(unsigned long long hash) {
+    return &shards[hash & (HTTP_COMPRESS_SHARDS - 1)];
+}
+
+static CompressedEntry **bucket_for(CompressShard *shard, unsigned long long hash) {
+    return &shard->buckets[(hash / HTTP_COMPRESS_SHARDS) & shard->mask];
+}
+
+static CompressedEntry *shard_find(CompressShard *shard, unsigned long long hash, const char *body,
+                                   size_t length, HttpEncoding encoding) {
+    CompressedEntry *entry = *bucket_for(shard, hash);
+    while (entry && (entry->hash != hash || entry->encoding != encoding || entry->body_length != length ||
+                     memcmp(entry->data, body, length) != 0)) {
+        entry = entry->chain;
+    }
+    return entry;
+}
+
+static void list_unlink(CompressShard *shard, CompressedEntry *entry) {
+    if (entry->newer) entry->newer->older = entry->older;
+    else shard->newest = entry->older;
+    if (entry->older) entry->older->newer = entry->newer;
+    else shard->oldest = entry->newer;
+    entry->newer = entry->older = NULL;
+}
+
+static void list_push_newest(CompressShard *shard, CompressedEntry *entry) {
+    entry->older = shard->newest;
+    entry->newer = NULL;
+    if (shard->newest) shard->newest->newer = entry;
+    shard->newest = entry;
+    if (!shard->oldest) shard->oldest = entry;
+}
+
+static void shard_remove(CompressShard *shard, CompressedEntry *entry) {
+    CompressedEntry **link = bucket_for(shard, entry->hash);
+    while (*link != entry) link = &(*link)->chain;
+    *link = entry->chain;
+    list_unlink(shard, entry);
+    shard->count--;
+    shard->bytes -= entry->body_length + entry->compressed_length;
+    free(entry);
+}
+
+// Copies out the compressed form of a cached body, or returns NULL
+static char *cache_get(const char *body, size_t length, HttpEncoding encoding, unsigned long long hash,
+                       size_t *compressed_length) {
+    CompressShard *shard = shard_for(hash);
+    char *copy = NULL;
+
+    MUTEX_LOCK(shard->mutex);
+    CompressedEntry *entry = shard_find(shard, hash, body, length, encoding);
+    if (entry) {
+        copy = malloc(entry->compressed_length);
+        if (copy) {
+            memcpy(copy, entry->data + entry->body_length, entry->compressed_length);
+            *compressed_length = entry->compressed_length;
+        }
+        list_unlink(shard, entry);
+        list_push_newest(shard, entry);
+        shard->hits++;
+    } else {
+        shard->misses++;
+    }
+    MUTEX_UNLOCK(shard->mutex);
+
+    return copy;
+}
+
+static void cache_put(const char *body, size_t length, HttpEncoding encoding, unsigned long long hash,
+                      const char *compressed, size_t compressed_length) {
+    size_t size = length + compressed_length;
+    if (size > shard_bytes) return; // Would flush the shard for one body
+
+    CompressedEntry *entry = malloc(sizeof(CompressedEntry) + size);
+    if (!entry) return;
+    entry->hash = hash;
+    entry->encoding = encoding;
+    entry->body_length = length;
+    entry->compressed_length = compressed_length;
+    memcpy(entry->data, body, length);
+    memcpy(entry->data + length, compressed, compressed_length);
+
+    CompressShard *shard = shard_for(hash);
+    MUTEX_LOCK(shard->mutex);
+    if (shard_find(shard, hash, body, length, encoding)) {
+        // Another worker compressed the same body meanwhile
+        MUTEX_UNLOCK(shard->mutex);
+        free(entry);
+        return;
+    }
+    while (shard->oldest && (shard->count >= shard_entries || shard->bytes + size > shard_bytes)) {
+        shard_remove(shard, shard->oldest);
+    }
+    CompressedEntry **bucket = bucket_for(shard, hash);
+    entry->chain = *bucket;
+    *bucket = entry;
+    list_push_newest(shard, entry);
+    shard->count++;
+    shard->bytes += size;
+    MUTEX_UNLOCK(shard->mutex);
+}
+
+static int deflate_init(z_stream *stream, HttpEncoding encoding) {
+    memset(stream, 0, sizeof(*stream));
+    int window_bits = encoding == HTTP_ENCODING_GZIP ? GZIP_WINDOW_BITS : ZLIB_WINDOW_BITS;
+    return deflateInit2(stream, compress_config.level, Z_DEFLATED, window_bits,
+                        DEFLATE_MEM_LEVEL, Z_DEFAULT_STRATEGY) == Z_OK;
+}
+
+// q value of one Accept-Encoding element's parameters, 1 if absent
+static double element_quality(const char *p, const char *end) {
+    while (p < end) {
+        while (p < end && (*p == ';' || *p == ' ' || *p == '\t')) p++;
+        if (end - p >= 2 && (p[0] == 'q' || p[0] == 'Q') && p[1] == '=') {
+            p += 2;
+            double quality = 0;
+            while (p < end && isdigit((unsigned char)*p)) quality = quality * 10 + (*p++ - '0');
+            if (p < end && *p == '.') {
+                double scale = 0.1;
+                for (p++; p < end && isdigit((unsigned char)*p); p++, scale /= 10) quality += (*p - '0') * scale;
+            }
+            return quality > 1 ? 1 : quality;
+        }
+        while (p < end && *p != ';') p++;
+    }
+    return 1;
+}
+
+static int token_is(const char *token, size_t length, const char *name) {
+    if (strlen(name) != length) return 0;
+    for (size_t i = 0; i < length; i++) {
+        if (tolower((unsigned char)token[i]) != name[i]) return 0;
+    }
+    return 1;
+}
+
+// ============================================
+// PUBLIC API
+// ============================================
+
+void http_compress_config_defaults(HttpCompressConfig *config) {
+    config->level = 6;
+    config->min_length = 1024;
+    config->cache_entries = 128;
+    config->cache_bytes = 8 * 1024 * 1024;
+}
+
+int http_compress_init(const HttpCompressConfig *config) {
+    compress_config = *config;
+    if (compress_config.level > 9) compress_config.level = 9;
+    if (compress_config.min_length < 0) compress_config.min_length = 0;
+    if (compress_config.level <= 0 || compress_config.cache_entries <= 0) return 1;
+
+    shard_entries = compress_config.cache_entries / HTTP_COMPRESS_SHARDS;
+    if (shard_entries < 1) shard_entries = 1;
+    shard_bytes = compress_config.cache_bytes / HTTP_COMPRESS_SHARDS;
+    unsigned int buckets = 1;
+    while (buckets < (unsigned int)shard_entries) buckets *= 2;
+
+    for (int i = 0; i < HTTP_COMPRESS_SHARDS; i++) {
+        MUTEX_INIT(shards[i].mutex);
+        shards[i].buckets = calloc(buckets, sizeof(CompressedEntry*));
+        if (!shards[i].buckets) return 0;
+        shards[i].mask = buckets - 1;
+    }
+    cache_ready = 1;
+    return 1;
+}
+
+int http_compress_wanted(size_t length) {
+    return compress_config.level > 0 && length >= (size_t)compress_config.min_length;
+}
+
+// q of gzip and of deflate in an Accept-Encoding value, 0 if not acceptable
+static void accepted_qualities(const char *accept, size_t length, double *gzip_quality, double *deflate_quality) {
+    double gzip = -1, deflate = -1, any = -1;
+    const char *end = accept + length;
+    const char *p = accept;
+    while (p < end) {
+        while (p < end && (*p == ',' || *p == ' ' || *p == '\t')) p++;
+        const char *token = p;
+        while (p < end && *p != ',' && *p != ';' && *p != ' ' && *p != '\t') p++;
+        size_t token_length = (size_t)(p - token);
+        const char *element_end = p;
+        while (element_end < end && *element_end != ',') element_end++;
+        double quality = element_quality(p, element_end);
+        p = element_end;
+
+        if (token_is(token, token_length, "gzip") || token_is(token, token_length, "x-gzip")) gzip = quality;
+        else if (token_is(token, token_length, "deflate")) deflate = quality;
+        else if (token_is(token, token_length, "*")) any = quality;
+    }
+
+    // An encoding not named is covered by "*" if present
+    *gzip_quality = gzip < 0 ? (any < 0 ? 0 : any) : gzip;
+    *deflate_quality = deflate < 0 ? (any < 0 ? 0 : any) : deflate;
+}
+
+HttpEncoding http_choose_encoding(const char *accept, size_t length) {
+    if (!accept || compress_config.level <= 0) return HTTP_ENCODING_IDENTITY;
+
+    double gzip, deflate;
+    accepted_qualities(accept, length, &gzip, &deflate);
+    if (gzip <= 0 && deflate <= 0) return HTTP_ENCODING_IDENTITY;
+    return gzip >= deflate ? HTTP_ENCODING_GZIP : HTTP_ENCODING_DEFLATE;
+}
+
+int http_accepts_gzip(const char *accept, size_t length) {
+    if (!accept) return 0;
+    double gzip, deflate;
+    accepted_qualities(accept, length, &gzip, &deflate);
+    return gzip > 0;
+}
+
+const char *http_encoding_header(HttpEncoding encoding) {
+    switch (encoding) {
+        case HTTP_ENCODING_GZIP: return "Content-Encoding: gzip\r\n";
+        case HTTP_ENCODING_DEFLATE: return "Content-Encoding: deflate\r\n";
+        default: return "";
+    }
+}
+
+char *http_compress_body(const char *body, size_t length, HttpEncoding encoding, size_t *compressed_length) {
+    if (encoding == HTTP_ENCODING_IDENTITY || compress_config.level <= 0) return NULL;
+
+    unsigned long long hash = 0;
+    if (cache_ready) {
+        hash = body_hash(body, length, encoding);
+        char *cached = cache_get(body, length, encoding, hash, compressed_length);
+        if (cached) return cached;
+    }
+
+    z_stream stream;
+    if (!deflate_init(&stream, encoding)) return NULL;
+    uLong bound = deflateBound(&stream, (uLong)length);
+    char *compressed = malloc(bound);
+    if (!compressed) {
+        deflateEnd(&stream);
+        return NULL;
+    }
+    stream.next_in = (Bytef*)body;
+    stream.avail_in = (uInt)length;
+    stream.next_out = (Bytef*)compressed;
+    stream.avail_out = (uInt)bound;
+    int rc = deflate(&stream, Z_FINISH);
+    size_t produced = stream.total_out;
+    deflateEnd(&stream);
+
+    if (rc != Z_STREAM_END || produced >= length) {
+        free(compressed);
+        return NULL;
+    }
+    if (cache_ready) cache_put(body, length, encoding, hash, compressed, produced);
+    *compressed_length = produced;
+    return compressed;
+}
+
+int http_deflate_begin(HttpDeflater *deflater, HttpEncoding encoding) {
+    deflater->active = encoding != HTTP_ENCODING_IDENTITY && compress_config.level > 0 &&
+                       deflate_init(&deflater->stream, encoding);
+    return deflater->active;
+}
+
+int http_deflate_write(HttpDeflater *deflater, const char *input, size_t length, int finish,
+                       HttpDeflateSink sink, void *context) {
+    if (!deflater->active) return 0;
+
+    z_stream *stream = &deflater->stream;
+    stream->next_in = (Bytef*)input;
+    stream->avail_in = (uInt)length;
+    for (;;) {
+        stream->next_out = deflater->output;
+        stream->avail_out = HTTP_DEFLATE_OUTPUT;
+        int rc = deflate(stream, finish ? Z_FINISH : Z_NO_FLUSH);
+        if (rc == Z_STREAM_ERROR) return 0;
+
+        size_t produced = HTTP_DEFLATE_OUTPUT - stream->avail_out;
+        if (produced > 0 && !sink(context, (const char*)deflater->output, produced)) return 0;
+
+        if (finish ? rc == Z_STREAM_END : stream->avail_out > 0) return 1;
+    }
+}
+
+void http_deflate_end(HttpDeflater *deflater) {
+    if (deflater->active) deflateEnd(&deflater->stream);
+    deflater->active = 0;
+}
+
+void http_compress_counts(unsigned long long *hits, unsigned long long *misses) {
+    *hits = *misses = 0;
+    for (int i = 0; i < HTTP_COMPRESS_SHARDS && cache_ready; i++) {
+        MUTEX_LOCK(shards[i].mutex);
+        *hits += shards[i].hits;
+        *misses += shards[i].misses;
+        MUTEX_UNLOCK(shards[i].mutex);
+    }
+}
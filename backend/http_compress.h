@@ -0,0 +1,82 @@
+/* HTTP Compress - gzip/deflate response bodies with a cache of results
+ *
+ * http_choose_encoding() picks the encoding a request's Accept-Encoding
+ * allows. Bodies known in full go through http_compress_body(), which keeps
+ * the most recently compressed bodies, so a response rebuilt with the same
+ * content (the same task list fetched again) is compressed once. Bodies
+ * produced a piece at a time go through an HttpDeflater, which hands each
+ * block of compressed output to a sink as it fills.
+ *
+ * "deflate" is the zlib format (RFC 1950), which is what HTTP means by it.
+ */
+
+#ifndef HTTP_COMPRESS_H
+#define HTTP_COMPRESS_H
+
+#include <stddef.h>
+#include <zlib.h>
+
+#define HTTP_DEFLATE_OUTPUT 8192         // Compressed bytes handed to a sink at once
+
+typedef enum {
+    HTTP_ENCODING_IDENTITY,
+    HTTP_ENCODING_GZIP,
+    HTTP_ENCODING_DEFLATE
+} HttpEncoding;
+
+typedef struct {
+    int level;                   // zlib level 1-9; 0 turns compression off
+    int min_length;              // Smaller bodies are sent as they are
+    int cache_entries;           // Compressed bodies kept; 0 = no cache
+    size_t cache_bytes;          // Bound on bodies plus their compressed forms
+} HttpCompressConfig;
+
+void http_compress_config_defaults(HttpCompressConfig *config);
+
+// Returns 0 if the cache could not be allocated; bodies are then compressed
+// every time
+int http_compress_init(const HttpCompressConfig *config);
+
+// Whether a body of this length should be compressed at all
+int http_compress_wanted(size_t length);
+
+// The encoding to use for a request with this Accept-Encoding value (which
+// may be NULL): the one with the highest q, gzip on a tie, identity if
+// neither is acceptable or compression is off
+HttpEncoding http_choose_encoding(const char *accept, size_t length);
+
+// Whether gzip is acceptable at all, whatever the compression settings;
+// for bodies that were compressed ahead of time
+int http_accepts_gzip(const char *accept, size_t length);
+
+// "Content-Encoding: gzip\r\n" and the like, "" for identity
+const char *http_encoding_header(HttpEncoding encoding);
+
+// Compressed copy of body in a buffer the caller frees, from the cache when
+// the same body was compressed recently. NULL if compression failed or did
+// not make the body smaller; the body is then sent as it is.
+char *http_compress_body(const char *body, size_t length, HttpEncoding encoding, size_t *compressed_length);
+
+// Returns 0 to stop the stream, e.g. when the client has gone
+typedef int (*HttpDeflateSink)(void *context, const char *data, size_t length);
+
+typedef struct {
+    z_stream stream;
+    int active;
+    unsigned char output[HTTP_DEFLATE_OUTPUT];
+} HttpDeflater;
+
+int http_deflate_begin(HttpDeflater *deflater, HttpEncoding encoding);
+
+// Compresses input, passing each full output block to sink. With finish set
+// this is the last input and everything left is flushed. Returns 0 if zlib
+// or the sink failed.
+int http_deflate_write(HttpDeflater *deflater, const char *input, size_t length, int finish,
+                       HttpDeflateSink sink, void *context);
+
+void http_deflate_end(HttpDeflater *deflater);
+
+// Cache lookups since start, for reporting
+void http_compress_counts(unsigned long long *hits, unsigned long long *misses);
+
+#endif
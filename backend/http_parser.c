@@ -0,0 +1,351 @@
+/* HTTP Parser - incremental request parser over a caller-owned buffer
+ *
+ * A byte-at-a-time state machine for the request line, headers, chunk sizes
+ * and trailers, and bulk steps for body bytes. Each state only needs the
+ * current byte plus what is already recorded in the request, which is what
+ * lets a parse stop at any byte and resume when more data arrives.
+ */
+
+#include <string.h>
+#include <ctype.h>
+#include "http_parser.h"
+
+enum {
+    STATE_METHOD,
+    STATE_TARGET,
+    STATE_VERSION,
+    STATE_HEADER_START,
+    STATE_HEADER_NAME,
+    STATE_HEADER_VALUE,
+    STATE_HEADERS_END,           // Saw the '\r' of the blank line
+    STATE_BODY,
+    STATE_CHUNK_SIZE,
+    STATE_CHUNK_EXTENSION,
+    STATE_CHUNK_DATA,
+    STATE_CHUNK_DATA_END,
+    STATE_TRAILER_START,
+    STATE_TRAILER_LINE,
+    STATE_TRAILER_END,
+    STATE_DONE,
+    STATE_ERROR
+};
+
+static HttpParseResult fail(HttpRequest *request, int status) {
+    request->state = STATE_ERROR;
+    request->error_status = status;
+    return HTTP_PARSE_ERROR;
+}
+
+static int span_equals_nocase(const HttpRequest *request, HttpSpan span, const char *text) {
+    const char *data = request->data + span.offset;
+    for (int i = 0; i < span.length; i++) {
+        if (!text[i] || tolower((unsigned char)data[i]) != tolower((unsigned char)text[i])) return 0;
+    }
+    return text[span.length] == '\0';
+}
+
+static int hex_value(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+static HttpSpan trimmed(const char *data, int start, int end) {
+    while (start < end && (data[start] == ' ' || data[start] == '\t')) start++;
+    while (end > start && (data[end - 1] == ' ' || data[end - 1] == '\t' || data[end - 1] == '\r')) end--;
+    HttpSpan span = { start, end - start };
+    return span;
+}
+
+static void split_target(HttpRequest *request) {
+    const char *target = request->data + request->target.offset;
+    const char *question = memchr(target, '?', request->target.length);
+
+    request->path = request->target;
+    request->query.offset = request->target.offset + request->target.length;
+    request->query.length = 0;
+    if (question) {
+        request->path.length = (int)(question - target);
+        request->query.offset = request->path.offset + request->path.length + 1;
+        request->query.length = request->target.length - request->path.length - 1;
+    }
+}
+
+// The blank line ended the headers: settle the framing and persistence
+static HttpParseResult headers_complete(HttpRequest *request) {
+    int connection_close = 0, connection_keep_alive = 0;
+
+    for (int i = 0; i < request->header_count; i++) {
+        const HttpHeader *header = &request->headers[i];
+
+        if (span_equals_nocase(request, header->name, "Content-Length")) {
+            const char *digits = request->data + header->value.offset;
+            long long length = 0;
+            if (header->value.length == 0) return fail(request, 400);
+            for (int d = 0; d < header->value.length; d++) {
+                if (!isdigit((unsigned char)digits[d])) return fail(request, 400);
+                length = length * 10 + (digits[d] - '0');
+                if (length > HTTP_MAX_BODY_BYTES) return fail(request, 413);
+            }
+            // Conflicting lengths are how requests get smuggled past a proxy
+            if (request->content_length >= 0 && request->content_length != length) return fail(request, 400);
+            request->content_length = length;
+        } else if (span_equals_nocase(request, header->name, "Transfer-Encoding")) {
+            if (!span_equals_nocase(request, header->value, "chunked")) return fail(request, 501);
+            request->chunked = 1;
+        } else if (span_equals_nocase(request, header->name, "Connection")) {
+            if (http_span_has_token(request, header->value, "close")) connection_close = 1;
+            if (http_span_has_token(request, header->value, "keep-alive")) connection_keep_alive = 1;
+        }
+    }
+    if (request->chunked && request->content_length >= 0) return fail(request, 400);
+
+    // HTTP/1.1 persists unless told to close; HTTP/1.0 only when asked to
+    request->keep_alive = !connection_close && (request->minor_version >= 1 || connection_keep_alive);
+
+    request->body.offset = request->position;
+    request->body.length = 0;
+    if (request->chunked) {
+        request->state = STATE_CHUNK_SIZE;
+        request->mark = request->position;
+    } else if (request->content_length > 0) {
+        request->state = STATE_BODY;
+        request->remaining = request->content_length;
+    } else {
+        request->state = STATE_DONE;
+    }
+    return HTTP_PARSE_INCOMPLETE;
+}
+
+// The size line of a chunk ended
+static HttpParseResult chunk_size_complete(HttpRequest *request) {
+    if (request->body.length + request->remaining > HTTP_MAX_BODY_BYTES) return fail(request, 413);
+    request->state = request->remaining > 0 ? STATE_CHUNK_DATA : STATE_TRAILER_START;
+    return HTTP_PARSE_INCOMPLETE;
+}
+
+// ============================================
+// PUBLIC API
+// ============================================
+
+void http_request_init(HttpRequest *request) {
+    memset(request, 0, sizeof(HttpRequest));
+    request->content_length = -1;
+    request->state = STATE_METHOD;
+}
+
+HttpParseResult http_parse(HttpRequest *request, char *data, int length) {
+    request->data = data;
+
+    while (request->state != STATE_DONE && request->state != STATE_ERROR && request->position < length) {
+        if (request->state < STATE_BODY && request->position >= HTTP_MAX_HEADER_BYTES) return fail(request, 431);
+
+        char c = data[request->position];
+        switch (request->state) {
+        case STATE_METHOD:
+            if (c == ' ') {
+                if (request->position == request->mark) return fail(request, 400);
+                request->method.offset = request->mark;
+                request->method.length = request->position - request->mark;
+                request->mark = request->position + 1;
+                request->state = STATE_TARGET;
+            } else if ((c == '\r' || c == '\n') && request->position == request->mark) {
+                request->mark++; // Blank lines between pipelined requests
+            } else if (!isupper((unsigned char)c)) {
+                return fail(request, 400);
+            }
+            break;
+
+        case STATE_TARGET:
+            if (c == ' ') {
+                if (request->position == request->mark) return fail(request, 400);
+                request->target.offset = request->mark;
+                request->target.length = request->position - request->mark;
+                split_target(request);
+                request->mark = request->position + 1;
+                request->state = STATE_VERSION;
+            } else if ((unsigned char)c <= ' ' || c == 0x7f) {
+                return fail(request, 400);
+            }
+            break;
+
+        case STATE_VERSION:
+            if (c == '\n') {
+                HttpSpan version = trimmed(data, request->mark, request->position);
+                const char *text = data + version.offset;
+                if (version.length != 8 || strncmp(text, "HTTP/", 5) != 0 || text[6] != '.' ||
+                    !isdigit((unsigned char)text[5]) || !isdigit((unsigned char)text[7])) {
+                    return fail(request, 400);
+                }
+                if (text[5] != '1') return fail(request, 505);
+                request->minor_version = text[7] - '0';
+                request->state = STATE_HEADER_START;
+            }
+            break;
+
+        case STATE_HEADER_START:
+            if (c == '\r') {
+                request->state = STATE_HEADERS_END;
+            } else if (c == '\n') {
+                request->position++;
+                if (headers_complete(request) == HTTP_PARSE_ERROR) return HTTP_PARSE_ERROR;
+                continue;
+            } else if (c == ' ' || c == '\t' || c == ':') {
+                return fail(request, 400); // Folded lines are obsolete, empty names invalid
+            } else {
+                if (request->header_count == HTTP_MAX_HEADERS) return fail(request, 431);
+                request->mark = request->position;
+                request->state = STATE_HEADER_NAME;
+            }
+            break;
+
+        case STATE_HEADER_NAME:
+            if (c == ':') {
+                HttpHeader *header = &request->headers[request->header_count];
+                header->name.offset = request->mark;
+                header->name.length = request->position - request->mark;
+                request->mark = request->position + 1;
+                request->state = STATE_HEADER_VALUE;
+            } else if (c == ' ' || c == '\t' || c == '\r' || c == '\n') {
+                return fail(request, 400);
+            }
+            break;
+
+        case STATE_HEADER_VALUE:
+            if (c == '\n') {
+                request->headers[request->header_count++].value = trimmed(data, request->mark, request->position);
+                request->state = STATE_HEADER_START;
+            }
+            break;
+
+        case STATE_HEADERS_END:
+            if (c != '\n') return fail(request, 400);
+            request->position++;
+            if (headers_complete(request) == HTTP_PARSE_ERROR) return HTTP_PARSE_ERROR;
+            continue;
+
+        case STATE_BODY: {
+            // Zero-copy: the body stays where it arrived
+            int available = length - request->position;
+            if (available >= request->remaining) {
+                request->position += (int)request->remaining;
+                request->body.length = (int)request->content_length;
+                request->remaining = 0;
+                request->state = STATE_DONE;
+            } else {
+                request->position = length;
+                request->remaining -= available;
+            }
+            continue;
+        }
+
+        case STATE_CHUNK_SIZE: {
+            int digit = hex_value(c);
+            if (digit >= 0) {
+                request->remaining = request->remaining * 16 + digit;
+                if (request->remaining > HTTP_MAX_BODY_BYTES) return fail(request, 413);
+                break;
+            }
+            if (request->position == request->mark) return fail(request, 400);
+            if (c == '\n') {
+                request->position++;
+                if (chunk_size_complete(request) == HTTP_PARSE_ERROR) return HTTP_PARSE_ERROR;
+                continue;
+            }
+            if (c != ';' && c != ' ' && c != '\t' && c != '\r') return fail(request, 400);
+            request->state = STATE_CHUNK_EXTENSION;
+            break;
+        }
+
+        case STATE_CHUNK_EXTENSION:
+            if (c == '\n') {
+                request->position++;
+                if (chunk_size_complete(request) == HTTP_PARSE_ERROR) return HTTP_PARSE_ERROR;
+                continue;
+            }
+            break;
+
+        case STATE_CHUNK_DATA: {
+            // Decode in place: slide the chunk down against the body so far
+            int count = length - request->position;
+            if (count > request->remaining) count = (int)request->remaining;
+            memmove(data + request->body.offset + request->body.length, data + request->position, count);
+            request->body.length += count;
+            request->position += count;
+            request->remaining -= count;
+            if (request->remaining == 0) request->state = STATE_CHUNK_DATA_END;
+            continue;
+        }
+
+        case STATE_CHUNK_DATA_END:
+            if (c == '\n') {
+                request->mark = request->position + 1;
+                request->state = STATE_CHUNK_SIZE;
+            } else if (c != '\r') {
+                return fail(request, 400);
+            }
+            break;
+
+        case STATE_TRAILER_START:
+            // Trailer fields are accepted and ignored
+            if (c == '\r') request->state = STATE_TRAILER_END;
+            else if (c == '\n') request->state = STATE_DONE;
+            else request->state = STATE_TRAILER_LINE;
+            break;
+
+        case STATE_TRAILER_LINE:
+            if (c == '\n') request->state = STATE_TRAILER_START;
+            break;
+
+        case STATE_TRAILER_END:
+            if (c != '\n') return fail(request, 400);
+            request->state = STATE_DONE;
+            break;
+        }
+        request->position++;
+    }
+
+    if (request->state == STATE_ERROR) return HTTP_PARSE_ERROR;
+    if (request->state != STATE_DONE) {
+        if (request->state < STATE_BODY && request->position >= HTTP_MAX_HEADER_BYTES) return fail(request, 431);
+        return HTTP_PARSE_INCOMPLETE;
+    }
+    request->consumed = request->position;
+    return HTTP_PARSE_COMPLETE;
+}
+
+const HttpSpan *http_header(const HttpRequest *request, const char *name) {
+    for (int i = 0; i < request->header_count; i++) {
+        if (span_equals_nocase(request, request->headers[i].name, name)) return &request->headers[i].value;
+    }
+    return NULL;
+}
+
+const char *http_span_data(const HttpRequest *request, HttpSpan span) {
+    return request->data + span.offset;
+}
+
+int http_span_equals(const HttpRequest *request, HttpSpan span, const char *text) {
+    return (int)strlen(text) == span.length && memcmp(request->data + span.offset, text, span.length) == 0;
+}
+
+int http_span_has_token(const HttpRequest *request, HttpSpan span, const char *token) {
+    const char *data = request->data;
+    int end = span.offset + span.length;
+
+    for (int start = span.offset; start <= end; ) {
+        int comma = start;
+        while (comma < end && data[comma] != ',') comma++;
+        if (span_equals_nocase(request, trimmed(data, start, comma), token)) return 1;
+        start = comma + 1;
+    }
+    return 0;
+}
+
+int http_span_copy(const HttpRequest *request, HttpSpan span, char *out, int size) {
+    int length = span.length < size - 1 ? span.length : size - 1;
+    memcpy(out, request->data + span.offset, length);
+    out[length] = '\0';
+    return length == span.length;
+}
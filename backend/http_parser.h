@@ -0,0 +1,81 @@
+/* HTTP Parser - incremental request parser over a caller-owned buffer
+ *
+ * http_parse() is called again each time more bytes arrive and resumes where
+ * it stopped, so a request may come in any number of reads. The request line
+ * and headers are recorded as spans (offset and length into the buffer), not
+ * copies; offsets stay valid when the caller grows or moves its buffer. The
+ * body is framed by Content-Length or chunked transfer encoding, and chunked
+ * bodies are decoded in place so a handler always sees one contiguous body.
+ * Bytes after the request (a pipelined next one) are never touched.
+ */
+
+#ifndef HTTP_PARSER_H
+#define HTTP_PARSER_H
+
+#define HTTP_MAX_HEADERS 32
+#define HTTP_MAX_HEADER_BYTES 8192             // Request line and headers
+#define HTTP_MAX_BODY_BYTES (1024 * 1024)      // Decoded body
+
+typedef struct {
+    int offset;
+    int length;
+} HttpSpan;
+
+typedef struct {
+    HttpSpan name;
+    HttpSpan value;              // Surrounding whitespace trimmed
+} HttpHeader;
+
+typedef enum {
+    HTTP_PARSE_INCOMPLETE,
+    HTTP_PARSE_COMPLETE,
+    HTTP_PARSE_ERROR             // error_status says why; the connection must close
+} HttpParseResult;
+
+typedef struct {
+    char *data;                  // Buffer given to the last http_parse call
+
+    HttpSpan method;
+    HttpSpan target;             // Path and query as sent
+    HttpSpan path;
+    HttpSpan query;              // After '?', empty if none
+    int minor_version;           // HTTP/1.x
+    HttpHeader headers[HTTP_MAX_HEADERS];
+    int header_count;
+
+    HttpSpan body;
+    long long content_length;    // -1 when the request has none
+    int chunked;
+    int keep_alive;
+    int consumed;                // Raw bytes of the request, chunk framing included
+    int error_status;            // 400, 413, 431, 501 or 505
+
+    // Parser position
+    int state;
+    int position;                // Next byte to examine
+    int mark;                    // Start of the token being scanned
+    long long remaining;         // Body or chunk bytes still to come
+} HttpRequest;
+
+void http_request_init(HttpRequest *request);
+
+// Parses data[0, length), resuming from the previous call on the same request.
+// Once complete, the request occupies data[0, consumed).
+HttpParseResult http_parse(HttpRequest *request, char *data, int length);
+
+// First header with this name, compared case-insensitively, or NULL
+const HttpSpan *http_header(const HttpRequest *request, const char *name);
+
+// Start of a span in the request's buffer; not NUL-terminated
+const char *http_span_data(const HttpRequest *request, HttpSpan span);
+
+// Exact match of a span against text
+int http_span_equals(const HttpRequest *request, HttpSpan span, const char *text);
+
+// Whether a comma-separated header value lists token, case-insensitively
+int http_span_has_token(const HttpRequest *request, HttpSpan span, const char *token);
+
+// NUL-terminated copy into out; returns 0 if it had to be truncated
+int http_span_copy(const HttpRequest *request, HttpSpan span, char *out, int size);
+
+#endif
@@ -0,0 +1,138 @@
+/* HTTP Response - gathered writes of pre-rendered response pieces
+ *
+ * Status lines are rendered into a fixed table indexed by code, so looking
+ * one up is an array access and the table is read-only once initialised.
+ * Slices go out through sendmsg() (WSASend() on Windows); a short write
+ * advances through the slice list and sends the rest, so the caller sees
+ * either the whole response sent or a failure.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "http_response.h"
+
+#ifdef _WIN32
+    #include <winsock2.h>
+#else
+    #include <sys/types.h>
+    #include <sys/socket.h>
+    #include <sys/uio.h>
+    #include <errno.h>
+    #ifndef MSG_NOSIGNAL
+        #define MSG_NOSIGNAL 0  // No per-call flag; the process ignores SIGPIPE instead
+    #endif
+#endif
+
+#define STATUS_MIN 100
+#define STATUS_MAX 599
+#define STATUS_LINE_SIZE 48
+
+static char status_lines[STATUS_MAX - STATUS_MIN + 1][STATUS_LINE_SIZE];
+static size_t status_line_lengths[STATUS_MAX - STATUS_MIN + 1];
+
+const char *http_status_text(int status_code) {
+    switch (status_code) {
+        case 200: return "OK";
+        case 201: return "Created";
+        case 204: return "No Content";
+        case 206: return "Partial Content";
+        case 304: return "Not Modified";
+        case 400: return "Bad Request";
+        case 401: return "Unauthorized";
+        case 403: return "Forbidden";
+        case 404: return "Not Found";
+        case 405: return "Method Not Allowed";
+        case 409: return "Conflict";
+        case 412: return "Precondition Failed";
+        case 413: return "Payload Too Large";
+        case 414: return "URI Too Long";
+        case 416: return "Range Not Satisfiable";
+        case 429: return "Too Many Requests";
+        case 431: return "Request Header Fields Too Large";
+        case 500: return "Internal Server Error";
+        case 501: return "Not Implemented";
+        case 503: return "Service Unavailable";
+        case 505: return "HTTP Version Not Supported";
+        default: return "Unknown";
+    }
+}
+
+void http_response_init(void) {
+    for (int code = STATUS_MIN; code <= STATUS_MAX; code++) {
+        int length = snprintf(status_lines[code - STATUS_MIN], STATUS_LINE_SIZE,
+                              "HTTP/1.1 %d %s\r\n", code, http_status_text(code));
+        status_line_lengths[code - STATUS_MIN] = (size_t)length;
+    }
+}
+
+HttpSlice http_status_line(int status_code) {
+    if (status_code < STATUS_MIN || status_code > STATUS_MAX) status_code = 500;
+    HttpSlice slice = { status_lines[status_code - STATUS_MIN], status_line_lengths[status_code - STATUS_MIN] };
+    return slice;
+}
+
+HttpSlice http_content_length(char *out, long long length) {
+    // Digits right to left, then the fixed prefix in front of them
+    static const char prefix[] = "Content-Length: ";
+    char digits[24];
+    int count = 0;
+    if (length < 0) length = 0;
+    do {
+        digits[count++] = (char)('0' + length % 10);
+        length /= 10;
+    } while (length > 0);
+
+    size_t used = sizeof(prefix) - 1;
+    memcpy(out, prefix, used);
+    while (count > 0) out[used++] = digits[--count];
+    out[used++] = '\r';
+    out[used++] = '\n';
+
+    HttpSlice slice = { out, used };
+    return slice;
+}
+
+int http_send_slices(int socket, const HttpSlice *slices, int count) {
+    if (count <= 0) return 1;
+    if (count > HTTP_RESPONSE_MAX_SLICES) return 0;
+
+#ifdef _WIN32
+    WSABUF buffers[HTTP_RESPONSE_MAX_SLICES];
+    for (int i = 0; i < count; i++) {
+        buffers[i].buf = (CHAR*)slices[i].data;
+        buffers[i].len = (ULONG)slices[i].length;
+    }
+    // A blocking WSASend completes the whole list or fails
+    DWORD sent = 0;
+    return WSASend((SOCKET)socket, buffers, (DWORD)count, &sent, 0, NULL, NULL) == 0;
+#else
+    struct iovec vectors[HTTP_RESPONSE_MAX_SLICES];
+    int first = 0;
+    for (int i = 0; i < count; i++) {
+        vectors[i].iov_base = (void*)slices[i].data;
+        vectors[i].iov_len = slices[i].length;
+    }
+
+    while (first < count) {
+        struct msghdr message;
+        memset(&message, 0, sizeof(message));
+        message.msg_iov = vectors + first;
+        message.msg_iovlen = count - first;
+
+        ssize_t sent = sendmsg(socket, &message, MSG_NOSIGNAL);
+        if (sent < 0 && errno == EINTR) continue;
+        if (sent <= 0) return 0;
+
+        // Skip what went out, leaving first on a partly sent slice if any
+        while (first < count && (size_t)sent >= vectors[first].iov_len) {
+            sent -= vectors[first].iov_len;
+            first++;
+        }
+        if (first < count) {
+            vectors[first].iov_base = (char*)vectors[first].iov_base + sent;
+            vectors[first].iov_len -= sent;
+        }
+    }
+    return 1;
+#endif
+}
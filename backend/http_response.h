@@ -0,0 +1,41 @@
+/* HTTP Response - gathered writes of pre-rendered response pieces
+ *
+ * A response is sent as a list of slices (status line, constant header
+ * block, the few per-response headers, body) in one writev-style call, so
+ * neither the headers nor the body are copied into an assembly buffer. The
+ * status lines are rendered once by http_response_init() and servers build
+ * their constant header blocks once at startup, leaving only Content-Length
+ * and the like to format per response.
+ */
+
+#ifndef HTTP_RESPONSE_H
+#define HTTP_RESPONSE_H
+
+#include <stddef.h>
+
+#define HTTP_RESPONSE_MAX_SLICES 8
+
+typedef struct {
+    const char *data;
+    size_t length;
+} HttpSlice;
+
+// Renders the status line table; call once before serving
+void http_response_init(void);
+
+// Reason phrase, "Unknown" for a code without one
+const char *http_status_text(int status_code);
+
+// "HTTP/1.1 <code> <reason>\r\n"; codes outside 100-599 get the 500 line
+HttpSlice http_status_line(int status_code);
+
+// "Content-Length: <length>\r\n" written into out, which must hold 40 bytes;
+// returns the slice over it
+HttpSlice http_content_length(char *out, long long length);
+
+// Sends the slices in order with as few system calls as the platform allows,
+// resuming after short writes. At most HTTP_RESPONSE_MAX_SLICES; returns 0
+// if the connection failed or timed out partway.
+int http_send_slices(int socket, const HttpSlice *slices, int count);
+
+#endif
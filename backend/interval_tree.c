@@ -0,0 +1,283 @@
+/* Interval Tree - augmented balanced BST of half-open time intervals
+ *
+ * Balance comes from treap rotations with a hash of (start, id) as the node
+ * priority, so the shape does not depend on insertion order and no random
+ * state is needed. Rotations and removals recompute max_end bottom-up along
+ * the path they touch.
+ */
+
+#include <stdlib.h>
+#include "interval_tree.h"
+
+static unsigned int node_priority(long long start, int id) {
+    unsigned long long h = (unsigned long long)start * 0x9E3779B97F4A7C15ULL ^ (unsigned int)id;
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDULL;
+    h ^= h >> 33;
+    return (unsigned int)h;
+}
+
+static int key_compare(long long start_a, int id_a, long long start_b, int id_b) {
+    if (start_a != start_b) return start_a < start_b ? -1 : 1;
+    if (id_a != id_b) return id_a < id_b ? -1 : 1;
+    return 0;
+}
+
+static void update_max(IntervalNode *node) {
+    long long max_end = node->interval.end;
+    if (node->left && node->left->max_end > max_end) max_end = node->left->max_end;
+    if (node->right && node->right->max_end > max_end) max_end = node->right->max_end;
+    node->max_end = max_end;
+}
+
+static IntervalNode *rotate_right(IntervalNode *node) {
+    IntervalNode *pivot = node->left;
+    node->left = pivot->right;
+    pivot->right = node;
+    update_max(node);
+    update_max(pivot);
+    return pivot;
+}
+
+static IntervalNode *rotate_left(IntervalNode *node) {
+    IntervalNode *pivot = node->right;
+    node->right = pivot->left;
+    pivot->left = node;
+    update_max(node);
+    update_max(pivot);
+    return pivot;
+}
+
+static IntervalNode *insert_node(IntervalNode *node, IntervalNode *fresh, int *inserted) {
+    if (!node) {
+        *inserted = 1;
+        return fresh;
+    }
+
+    int cmp = key_compare(fresh->interval.start, fresh->interval.id, node->interval.start, node->interval.id);
+    if (cmp == 0) return node;
+
+    if (cmp < 0) {
+        node->left = insert_node(node->left, fresh, inserted);
+        if (node->left->priority > node->priority) node = rotate_right(node);
+    } else {
+        node->right = insert_node(node->right, fresh, inserted);
+        if (node->right->priority > node->priority) node = rotate_left(node);
+    }
+    update_max(node);
+    return node;
+}
+
+// Joins two treaps where every key in left precedes every key in right
+static IntervalNode *merge(IntervalNode *left, IntervalNode *right) {
+    if (!left) return right;
+    if (!right) return left;
+
+    if (left->priority > right->priority) {
+        left->right = merge(left->right, right);
+        update_max(left);
+        return left;
+    }
+    right->left = merge(left, right->left);
+    update_max(right);
+    return right;
+}
+
+static IntervalNode *remove_node(IntervalNode *node, long long start, int id, int *removed) {
+    if (!node) return NULL;
+
+    int cmp = key_compare(start, id, node->interval.start, node->interval.id);
+    if (cmp == 0) {
+        IntervalNode *joined = merge(node->left, node->right);
+        free(node);
+        *removed = 1;
+        return joined;
+    }
+
+    if (cmp < 0) {
+        node->left = remove_node(node->left, start, id, removed);
+    } else {
+        node->right = remove_node(node->right, start, id, removed);
+    }
+    update_max(node);
+    return node;
+}
+
+static void free_nodes(IntervalNode *node) {
+    while (node) {
+        IntervalNode *right = node->right;
+        free_nodes(node->left);
+        free(node);
+        node = right;
+    }
+}
+
+// ============================================
+// PUBLIC API
+// ============================================
+
+void interval_tree_init(IntervalTree *tree) {
+    tree->root = NULL;
+    tree->count = 0;
+}
+
+void interval_tree_free(IntervalTree *tree) {
+    free_nodes(tree->root);
+    interval_tree_init(tree);
+}
+
+int interval_tree_insert(IntervalTree *tree, long long start, long long end, int id) {
+    if (end <= start) return 0;
+
+    IntervalNode *fresh = malloc(sizeof(IntervalNode));
+    if (!fresh) return 0;
+    fresh->interval.start = start;
+    fresh->interval.end = end;
+    fresh->interval.id = id;
+    fresh->max_end = end;
+    fresh->priority = node_priority(start, id);
+    fresh->left = fresh->right = NULL;
+
+    int inserted = 0;
+    tree->root = insert_node(tree->root, fresh, &inserted);
+    if (!inserted) {
+        free(fresh);
+        return 0;
+    }
+    tree->count++;
+    return 1;
+}
+
+int interval_tree_remove(IntervalTree *tree, long long start, int id) {
+    int removed = 0;
+    tree->root = remove_node(tree->root, start, id, &removed);
+    if (removed) tree->count--;
+    return removed;
+}
+
+// In-order so results come out sorted by start. A subtree is skipped when its
+// max end is at or before the query start; the right side is skipped once a
+// node starts at or after the query end, since everything to its right does too.
+static void collect(const IntervalNode *node, long long start, long long end,
+                    Interval *out, int max, int *total) {
+    while (node && node->max_end > start) {
+        collect(node->left, start, end, out, max, total);
+        if (node->interval.start >= end) return;
+        if (node->interval.end > start) {
+            if (*total < max) out[*total] = node->interval;
+            (*total)++;
+        }
+        node = node->right;
+    }
+}
+
+int interval_tree_overlaps(const IntervalTree *tree, long long start, long long end, Interval *out, int max) {
+    int total = 0;
+    if (end > start) collect(tree->root, start, end, out, max, &total);
+    return total;
+}
+
+static void overlap_end(const IntervalNode *node, long long start, long long end, long long *best) {
+    while (node && node->max_end > start) {
+        // Nothing below can extend past what is already known
+        if (node->max_end <= *best) return;
+        overlap_end(node->left, start, end, best);
+        if (node->interval.start >= end) return;
+        if (node->interval.end > start && node->interval.end > *best) *best = node->interval.end;
+        node = node->right;
+    }
+}
+
+long long interval_tree_overlap_end(const IntervalTree *tree, long long start, long long end) {
+    long long best = start;
+    if (end > start) overlap_end(tree->root, start, end, &best);
+    return best;
+}
+
+static int walk(const IntervalNode *node, IntervalVisitor visit, void *context) {
+    while (node) {
+        if (!walk(node->left, visit, context)) return 0;
+        if (!visit(&node->interval, context)) return 0;
+        node = node->right;
+    }
+    return 1;
+}
+
+void interval_tree_walk(const IntervalTree *tree, IntervalVisitor visit, void *context) {
+    walk(tree->root, visit, context);
+}
+
+// ============================================
+// CONFLICTS
+// ============================================
+
+typedef struct {
+    Interval *items;
+    int count;
+} IntervalList;
+
+static int append_interval(const Interval *interval, void *context) {
+    IntervalList *list = context;
+    list->items[list->count++] = *interval;
+    return 1;
+}
+
+static void active_push(Interval *heap, int *size, const Interval *interval) {
+    int at = (*size)++;
+    while (at > 0 && interval->end < heap[(at - 1) / 2].end) {
+        heap[at] = heap[(at - 1) / 2];
+        at = (at - 1) / 2;
+    }
+    heap[at] = *interval;
+}
+
+static void active_pop(Interval *heap, int *size) {
+    Interval last = heap[--(*size)];
+    int hole = 0;
+    for (;;) {
+        int child = 2 * hole + 1;
+        if (child >= *size) break;
+        if (child + 1 < *size && heap[child + 1].end < heap[child].end) child++;
+        if (heap[child].end >= last.end) break;
+        heap[hole] = heap[child];
+        hole = child;
+    }
+    if (*size > 0) heap[hole] = last;
+}
+
+int interval_tree_conflicts(const IntervalTree *tree, IntervalConflict *out, int max) {
+    if (tree->count == 0) return 0;
+
+    IntervalList sorted = { malloc((size_t)tree->count * sizeof(Interval)), 0 };
+    Interval *active = malloc((size_t)tree->count * sizeof(Interval));
+    if (!sorted.items || !active) {
+        free(sorted.items);
+        free(active);
+        return -1;
+    }
+    interval_tree_walk(tree, append_interval, &sorted);
+
+    int total = 0;
+    int size = 0;
+    for (int i = 0; i < sorted.count; i++) {
+        const Interval *current = &sorted.items[i];
+
+        // Whatever ended by now cannot overlap this or anything later
+        while (size > 0 && active[0].end <= current->start) active_pop(active, &size);
+
+        for (int j = 0; j < size; j++) {
+            if (total < max) {
+                out[total].first_id = active[j].id;
+                out[total].second_id = current->id;
+                out[total].start = current->start;
+                out[total].end = active[j].end < current->end ? active[j].end : current->end;
+            }
+            total++;
+        }
+        active_push(active, &size, current);
+    }
+
+    free(sorted.items);
+    free(active);
+    return total;
+}
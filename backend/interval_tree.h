@@ -0,0 +1,64 @@
+/* Interval Tree - augmented balanced BST of half-open time intervals
+ *
+ * Intervals [start, end) are ordered by (start, id) in a treap whose node
+ * priorities are derived from the key, and every node carries the largest
+ * end in its subtree. Subtrees whose max end is at or before a query's start
+ * cannot overlap it and are skipped, so an overlap query costs O(log n + k)
+ * for k results. Insert and remove are O(log n) expected.
+ */
+
+#ifndef INTERVAL_TREE_H
+#define INTERVAL_TREE_H
+
+typedef struct {
+    long long start;
+    long long end;               // Exclusive
+    int id;
+} Interval;
+
+typedef struct IntervalNode {
+    Interval interval;
+    long long max_end;           // Largest end in this subtree
+    unsigned int priority;       // Heap order of the treap
+    struct IntervalNode *left;
+    struct IntervalNode *right;
+} IntervalNode;
+
+typedef struct {
+    IntervalNode *root;
+    int count;
+} IntervalTree;
+
+void interval_tree_init(IntervalTree *tree);
+void interval_tree_free(IntervalTree *tree);
+
+// Returns 0 on allocation failure, an empty interval or a duplicate (start, id)
+int interval_tree_insert(IntervalTree *tree, long long start, long long end, int id);
+
+// Removes the interval with this start and id; returns 0 if there was none
+int interval_tree_remove(IntervalTree *tree, long long start, int id);
+
+// Intervals overlapping [start, end), up to max of them in out ordered by start;
+// returns the total number that overlap
+int interval_tree_overlaps(const IntervalTree *tree, long long start, long long end, Interval *out, int max);
+
+// Largest end among intervals overlapping [start, end), or start if none overlap
+long long interval_tree_overlap_end(const IntervalTree *tree, long long start, long long end);
+
+typedef struct {
+    int first_id;                // The interval that starts first
+    int second_id;
+    long long start;             // Overlapping part
+    long long end;
+} IntervalConflict;
+
+// Every overlapping pair, by start of the later interval: a sweep in start
+// order with a min-heap of active ends, O(n log n + k). Writes up to max pairs
+// and returns the total, or -1 on allocation failure.
+int interval_tree_conflicts(const IntervalTree *tree, IntervalConflict *out, int max);
+
+// Visits every interval in start order; the visitor returns 0 to stop early
+typedef int (*IntervalVisitor)(const Interval *interval, void *context);
+void interval_tree_walk(const IntervalTree *tree, IntervalVisitor visit, void *context);
+
+#endif
@@ -0,0 +1,362 @@
+/* JSON Body - single-pass tokenizer for flat JSON request bodies
+ *
+ * The scan is one forward walk over the text. The only inner loop that runs
+ * long is the one through string contents, which looks for the next quote or
+ * backslash; with SSE2 it tests 16 bytes per step and falls back to bytes for
+ * the tail. Keys are indexed by FNV-1a into an open-addressed table of field
+ * numbers that is never more than half full.
+ */
+
+#include <string.h>
+#include <limits.h>
+#include "json_body.h"
+
+#ifdef __SSE2__
+    #include <emmintrin.h>
+#endif
+
+static unsigned int span_hash(const char *text, size_t length) {
+    unsigned int hash = 2166136261u;
+    for (size_t i = 0; i < length; i++) {
+        hash ^= (unsigned char)text[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static const char *skip_space(const char *p, const char *end) {
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n')) p++;
+    return p;
+}
+
+// First quote or backslash at or after p, or end
+static const char *find_special(const char *p, const char *end) {
+#ifdef __SSE2__
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    while (end - p >= 16) {
+        __m128i chunk = _mm_loadu_si128((const __m128i*)p);
+        int mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(chunk, quote),
+                                                  _mm_cmpeq_epi8(chunk, backslash)));
+        if (mask) return p + __builtin_ctz((unsigned int)mask);
+        p += 16;
+    }
+#endif
+    while (p < end && *p != '"' && *p != '\\') p++;
+    return p;
+}
+
+// p is just past an opening quote. Returns the closing quote, or NULL if the
+// string is unterminated; sets *escaped if it saw a backslash.
+static const char *scan_string(const char *p, const char *end, int *escaped) {
+    for (;;) {
+        p = find_special(p, end);
+        if (p >= end) return NULL;
+        if (*p == '"') return p;
+        *escaped = 1;
+        p += 2; // The backslash and whatever it escapes
+    }
+}
+
+// p is on '{' or '['. Returns one past the matching close, or NULL.
+static const char *skip_nested(const char *p, const char *end) {
+    int depth = 0;
+    while (p < end) {
+        char c = *p++;
+        if (c == '"') {
+            int escaped = 0;
+            p = scan_string(p, end, &escaped);
+            if (!p) return NULL;
+            p++;
+        } else if (c == '{' || c == '[') {
+            depth++;
+        } else if (c == '}' || c == ']') {
+            if (--depth == 0) return p;
+        }
+    }
+    return NULL;
+}
+
+static void index_field(JsonBody *body, int field) {
+    const JsonField *entry = &body->fields[field];
+    unsigned int slot = span_hash(entry->key, entry->key_length) & (JSON_BODY_INDEX_SIZE - 1);
+    for (;;) {
+        int existing = body->index[slot];
+        if (existing < 0) break;
+        const JsonField *other = &body->fields[existing];
+        if (other->key_length == entry->key_length &&
+            memcmp(other->key, entry->key, entry->key_length) == 0) {
+            break; // Repeated key: the later value wins
+        }
+        slot = (slot + 1) & (JSON_BODY_INDEX_SIZE - 1);
+    }
+    body->index[slot] = (signed char)field;
+}
+
+// Whole span as a decimal integer, with an optional sign
+static int span_integer(const char *text, size_t length, long long *out) {
+    size_t i = 0;
+    int negative = 0;
+    if (i < length && (text[i] == '-' || text[i] == '+')) negative = text[i++] == '-';
+    if (i == length) return 0;
+
+    long long value = 0;
+    for (; i < length && text[i] >= '0' && text[i] <= '9'; i++) {
+        int digit = text[i] - '0';
+        if (value > (LLONG_MAX - digit) / 10) return 0;
+        value = value * 10 + digit;
+    }
+    // A fraction or exponent is allowed and dropped
+    if (i < length && text[i] != '.' && text[i] != 'e' && text[i] != 'E') return 0;
+    *out = negative ? -value : value;
+    return 1;
+}
+
+static int hex_value(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+static long read_hex4(const char *p, const char *end) {
+    if (end - p < 4) return -1;
+    long value = 0;
+    for (int i = 0; i < 4; i++) {
+        int digit = hex_value(p[i]);
+        if (digit < 0) return -1;
+        value = value * 16 + digit;
+    }
+    return value;
+}
+
+// Writes code point as UTF-8; returns bytes written, or 0 if out of room
+static size_t put_utf8(char *out, size_t room, unsigned long code) {
+    if (code < 0x80) {
+        if (room < 1) return 0;
+        out[0] = (char)code;
+        return 1;
+    }
+    if (code < 0x800) {
+        if (room < 2) return 0;
+        out[0] = (char)(0xC0 | (code >> 6));
+        out[1] = (char)(0x80 | (code & 0x3F));
+        return 2;
+    }
+    if (code < 0x10000) {
+        if (room < 3) return 0;
+        out[0] = (char)(0xE0 | (code >> 12));
+        out[1] = (char)(0x80 | ((code >> 6) & 0x3F));
+        out[2] = (char)(0x80 | (code & 0x3F));
+        return 3;
+    }
+    if (room < 4) return 0;
+    out[0] = (char)(0xF0 | (code >> 18));
+    out[1] = (char)(0x80 | ((code >> 12) & 0x3F));
+    out[2] = (char)(0x80 | ((code >> 6) & 0x3F));
+    out[3] = (char)(0x80 | (code & 0x3F));
+    return 4;
+}
+
+// Unescapes text into out with room for a terminator; 0 if it does not fit
+// or an escape is malformed. \u0000 is refused, as callers use C strings.
+static int unescape(const char *p, const char *end, char *out, size_t size) {
+    size_t used = 0;
+    while (p < end) {
+        const char *special = find_special(p, end);
+        size_t plain = (size_t)(special - p);
+        if (used + plain >= size) return 0;
+        memcpy(out + used, p, plain);
+        used += plain;
+        p = special;
+        if (p >= end) break;
+
+        // Only backslashes remain inside a scanned string
+        if (end - p < 2) return 0;
+        char c = p[1];
+        p += 2;
+        char simple = 0;
+        switch (c) {
+            case '"': simple = '"'; break;
+            case '\\': simple = '\\'; break;
+            case '/': simple = '/'; break;
+            case 'b': simple = '\b'; break;
+            case 'f': simple = '\f'; break;
+            case 'n': simple = '\n'; break;
+            case 'r': simple = '\r'; break;
+            case 't': simple = '\t'; break;
+            case 'u': {
+                long code = read_hex4(p, end);
+                if (code <= 0) return 0;
+                p += 4;
+                if (code >= 0xD800 && code <= 0xDBFF) {
+                    // A high surrogate needs its low half
+                    long low = end - p >= 6 && p[0] == '\\' && p[1] == 'u' ? read_hex4(p + 2, end) : -1;
+                    if (low < 0xDC00 || low > 0xDFFF) return 0;
+                    code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+                    p += 6;
+                } else if (code >= 0xDC00 && code <= 0xDFFF) {
+                    return 0;
+                }
+                size_t written = put_utf8(out + used, size - used - 1, (unsigned long)code);
+                if (!written) return 0;
+                used += written;
+                continue;
+            }
+            default:
+                return 0;
+        }
+        if (used + 1 >= size) return 0;
+        out[used++] = simple;
+    }
+    out[used] = '\0';
+    return 1;
+}
+
+// ============================================
+// PUBLIC API
+// ============================================
+
+int json_body_parse(JsonBody *body, const char *json, size_t length) {
+    body->count = 0;
+    memset(body->index, -1, sizeof(body->index));
+    if (!json) return 0;
+
+    const char *end = json + length;
+    const char *p = skip_space(json, end);
+    if (p >= end || *p != '{') return 0;
+    p = skip_space(p + 1, end);
+    if (p < end && *p == '}') return 1;
+
+    for (;;) {
+        JsonField field;
+        field.escaped = 0;
+
+        if (p >= end || *p != '"') goto malformed;
+        field.key = p + 1;
+        int key_escaped = 0;
+        p = scan_string(field.key, end, &key_escaped);
+        if (!p) goto malformed;
+        field.key_length = (size_t)(p - field.key);
+
+        p = skip_space(p + 1, end);
+        if (p >= end || *p != ':') goto malformed;
+        p = skip_space(p + 1, end);
+        if (p >= end) goto malformed;
+
+        if (*p == '"') {
+            field.type = JSON_STRING;
+            field.value = p + 1;
+            p = scan_string(field.value, end, &field.escaped);
+            if (!p) goto malformed;
+            field.value_length = (size_t)(p - field.value);
+            p++;
+        } else if (*p == '{' || *p == '[') {
+            field.type = *p == '{' ? JSON_OBJECT : JSON_ARRAY;
+            field.value = p;
+            p = skip_nested(p, end);
+            if (!p) goto malformed;
+            field.value_length = (size_t)(p - field.value);
+        } else {
+            field.value = p;
+            while (p < end && *p != ',' && *p != '}' && *p != ' ' && *p != '\t' && *p != '\r' && *p != '\n') p++;
+            field.value_length = (size_t)(p - field.value);
+            if (field.value_length == 4 && memcmp(field.value, "true", 4) == 0) field.type = JSON_TRUE;
+            else if (field.value_length == 5 && memcmp(field.value, "false", 5) == 0) field.type = JSON_FALSE;
+            else if (field.value_length == 4 && memcmp(field.value, "null", 4) == 0) field.type = JSON_NULL;
+            else if (field.value_length > 0 && (*field.value == '-' || (*field.value >= '0' && *field.value <= '9'))) {
+                field.type = JSON_NUMBER;
+            } else {
+                goto malformed;
+            }
+        }
+
+        if (body->count < JSON_BODY_MAX_FIELDS) {
+            body->fields[body->count] = field;
+            index_field(body, body->count);
+            body->count++;
+        }
+
+        p = skip_space(p, end);
+        if (p >= end) goto malformed;
+        if (*p == '}') return 1;
+        if (*p != ',') goto malformed;
+        p = skip_space(p + 1, end);
+    }
+
+malformed:
+    body->count = 0;
+    memset(body->index, -1, sizeof(body->index));
+    return 0;
+}
+
+const JsonField *json_body_field(const JsonBody *body, const char *key) {
+    size_t key_length = strlen(key);
+    unsigned int slot = span_hash(key, key_length) & (JSON_BODY_INDEX_SIZE - 1);
+    for (;;) {
+        int field = body->index[slot];
+        if (field < 0) return NULL;
+        const JsonField *entry = &body->fields[field];
+        if (entry->key_length == key_length && memcmp(entry->key, key, key_length) == 0) return entry;
+        slot = (slot + 1) & (JSON_BODY_INDEX_SIZE - 1);
+    }
+}
+
+int json_body_has(const JsonBody *body, const char *key) {
+    return json_body_field(body, key) != NULL;
+}
+
+int json_body_string(const JsonBody *body, const char *key, char *out, size_t size) {
+    const JsonField *field = json_body_field(body, key);
+    if (!field || field->type != JSON_STRING || size == 0) return 0;
+
+    if (!field->escaped) {
+        if (field->value_length >= size) {
+            out[0] = '\0';
+            return -1;
+        }
+        memcpy(out, field->value, field->value_length);
+        out[field->value_length] = '\0';
+        return 1;
+    }
+    if (!unescape(field->value, field->value + field->value_length, out, size)) {
+        out[0] = '\0';
+        return -1;
+    }
+    return 1;
+}
+
+long long json_body_int64(const JsonBody *body, const char *key, long long fallback) {
+    const JsonField *field = json_body_field(body, key);
+    long long value;
+    if (!field || (field->type != JSON_NUMBER && field->type != JSON_STRING) ||
+        !span_integer(field->value, field->value_length, &value)) {
+        return fallback;
+    }
+    return value;
+}
+
+int json_body_int(const JsonBody *body, const char *key, int fallback) {
+    long long value = json_body_int64(body, key, fallback);
+    return value < INT_MIN || value > INT_MAX ? fallback : (int)value;
+}
+
+int json_body_bool(const JsonBody *body, const char *key, int fallback) {
+    const JsonField *field = json_body_field(body, key);
+    if (!field) return fallback;
+
+    long long number;
+    switch (field->type) {
+        case JSON_TRUE: return 1;
+        case JSON_FALSE: return 0;
+        case JSON_NUMBER: return span_integer(field->value, field->value_length, &number) ? number != 0 : fallback;
+        case JSON_STRING:
+            if (field->value_length == 4 && memcmp(field->value, "true", 4) == 0) return 1;
+            if (field->value_length == 1 && field->value[0] == '1') return 1;
+            if (field->value_length == 5 && memcmp(field->value, "false", 5) == 0) return 0;
+            if (field->value_length == 1 && field->value[0] == '0') return 0;
+            return fallback;
+        default:
+            return fallback;
+    }
+}
@@ -0,0 +1,69 @@
+/* JSON Body - single-pass tokenizer for flat JSON request bodies
+ *
+ * json_body_parse() walks a body once and records each top-level member as
+ * a pair of spans into the caller's buffer, with a small hash index over the
+ * keys, so every later lookup is O(1) and nothing is allocated. Nested
+ * objects and arrays are kept whole as one span. String values stay escaped
+ * in place; json_body_string() unescapes into the caller's buffer, so a
+ * quote or backslash inside a value no longer ends it early.
+ *
+ * A JsonBody only points into the text it was parsed from, which must
+ * outlive it. Keys are matched byte for byte as written, escapes included.
+ */
+
+#ifndef JSON_BODY_H
+#define JSON_BODY_H
+
+#include <stddef.h>
+
+#define JSON_BODY_MAX_FIELDS 32          // Members beyond this are skipped
+#define JSON_BODY_INDEX_SIZE 64          // Power of two, twice the fields
+
+typedef enum {
+    JSON_STRING,
+    JSON_NUMBER,
+    JSON_TRUE,
+    JSON_FALSE,
+    JSON_NULL,
+    JSON_OBJECT,
+    JSON_ARRAY
+} JsonType;
+
+typedef struct {
+    const char *key;             // Between the quotes
+    size_t key_length;
+    const char *value;           // Strings: between the quotes, still escaped;
+    size_t value_length;         // objects and arrays: brackets included
+    JsonType type;
+    int escaped;                 // String value contains a backslash
+} JsonField;
+
+typedef struct {
+    JsonField fields[JSON_BODY_MAX_FIELDS];
+    int count;
+    signed char index[JSON_BODY_INDEX_SIZE];     // Key hash -> field, -1 if empty
+} JsonBody;
+
+// Parses one object. Returns 0 if the text is not a well-formed object, in
+// which case body is left empty and every lookup misses. A repeated key
+// finds its last value.
+int json_body_parse(JsonBody *body, const char *json, size_t length);
+
+// The member named key, or NULL
+const JsonField *json_body_field(const JsonBody *body, const char *key);
+
+int json_body_has(const JsonBody *body, const char *key);
+
+// Unescapes a string member into out. Returns 1 on success, 0 if there is
+// no such string member (out is untouched), or -1 if it does not fit in size
+// bytes or has a bad escape (out is made empty).
+int json_body_string(const JsonBody *body, const char *key, char *out, size_t size);
+
+// Numbers, quoted or not; fallback if absent or not a number
+long long json_body_int64(const JsonBody *body, const char *key, long long fallback);
+int json_body_int(const JsonBody *body, const char *key, int fallback);
+
+// true/false, or a number or "true"/"1" string; fallback otherwise
+int json_body_bool(const JsonBody *body, const char *key, int fallback);
+
+#endif
@@ -0,0 +1,270 @@
+/* Lock Statistics - contention instrumentation for MUTEX_LOCK / MUTEX_UNLOCK
+ *
+ * Call sites register themselves on first use into a linked list that the
+ * reporting functions walk. Per-lock totals are summed from the sites at
+ * report time.
+ */
+
+#ifndef _WIN32
+    #define _POSIX_C_SOURCE 200809L  // clock_gettime
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "lock_stats.h"
+
+#ifdef _WIN32
+    #define RAW_LOCK(mutex) EnterCriticalSection(mutex)
+    #define RAW_TRYLOCK(mutex) (TryEnterCriticalSection(mutex) != 0)
+    #define RAW_UNLOCK(mutex) LeaveCriticalSection(mutex)
+#else
+    #define RAW_LOCK(mutex) pthread_mutex_lock(mutex)
+    #define RAW_TRYLOCK(mutex) (pthread_mutex_trylock(mutex) == 0)
+    #define RAW_UNLOCK(mutex) pthread_mutex_unlock(mutex)
+#endif
+
+#define MAX_HELD_LOCKS 8        // Locks held at once by one thread
+#define MAX_LOCK_NAMES 32
+
+typedef struct {
+    lock_stats_mutex_t *mutex;
+    LockSite *site;
+    long long acquired_ns;
+} HeldLock;
+
+typedef struct {
+    const char *name;
+    int sites;
+    unsigned long long acquisitions;
+    unsigned long long contended;
+    unsigned long long wait_ns_total;
+    unsigned long long wait_ns_max;
+    unsigned long long hold_ns_total;
+    unsigned long long hold_ns_max;
+} LockTotals;
+
+static __thread HeldLock held_locks[MAX_HELD_LOCKS];
+static __thread int held_count = 0;
+
+static LockSite *site_list = NULL;
+#ifdef _WIN32
+static INIT_ONCE registry_once = INIT_ONCE_STATIC_INIT;
+static CRITICAL_SECTION registry_mutex;
+#else
+static pthread_mutex_t registry_mutex = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+static long long monotonic_ns(void) {
+#ifdef _WIN32
+    LARGE_INTEGER counter, frequency;
+    QueryPerformanceCounter(&counter);
+    QueryPerformanceFrequency(&frequency);
+    return (long long)(counter.QuadPart * (1000000000.0 / frequency.QuadPart));
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+#endif
+}
+
+#ifdef _WIN32
+static BOOL CALLBACK init_registry(PINIT_ONCE once, PVOID param, PVOID *context) {
+    (void)once; (void)param; (void)context;
+    InitializeCriticalSection(&registry_mutex);
+    return TRUE;
+}
+#endif
+
+static void registry_lock(void) {
+#ifdef _WIN32
+    InitOnceExecuteOnce(&registry_once, init_registry, NULL, NULL);
+#endif
+    RAW_LOCK(&registry_mutex);
+}
+
+static void registry_unlock(void) {
+    RAW_UNLOCK(&registry_mutex);
+}
+
+// ============================================
+// ACQUIRE / RELEASE
+// ============================================
+
+void lock_stats_acquire(lock_stats_mutex_t *mutex, LockSite *site) {
+    unsigned long long wait_ns = 0;
+    int contended = 0;
+
+    if (!RAW_TRYLOCK(mutex)) {
+        long long wait_start = monotonic_ns();
+        RAW_LOCK(mutex);
+        wait_ns = (unsigned long long)(monotonic_ns() - wait_start);
+        contended = 1;
+    }
+
+    // First use of this call site; sites are never unregistered
+    if (!site->registered) {
+        registry_lock();
+        if (!site->registered) {
+            site->next = site_list;
+            site_list = site;
+            site->registered = 1;
+        }
+        registry_unlock();
+    }
+
+    // Safe without atomics: only the current holder of the lock writes here
+    site->acquisitions++;
+    if (contended) {
+        site->contended++;
+        site->wait_ns_total += wait_ns;
+        if (wait_ns > site->wait_ns_max) site->wait_ns_max = wait_ns;
+    }
+
+    if (held_count < MAX_HELD_LOCKS) {
+        held_locks[held_count].mutex = mutex;
+        held_locks[held_count].site = site;
+        held_locks[held_count].acquired_ns = monotonic_ns();
+        held_count++;
+    }
+}
+
+void lock_stats_release(lock_stats_mutex_t *mutex) {
+    // Locks are usually released in reverse order, so search from the top
+    for (int i = held_count - 1; i >= 0; i--) {
+        if (held_locks[i].mutex != mutex) continue;
+
+        LockSite *site = held_locks[i].site;
+        unsigned long long hold_ns = (unsigned long long)(monotonic_ns() - held_locks[i].acquired_ns);
+        site->hold_ns_total += hold_ns;
+        if (hold_ns > site->hold_ns_max) site->hold_ns_max = hold_ns;
+
+        held_locks[i] = held_locks[held_count - 1];
+        held_count--;
+        break;
+    }
+
+    RAW_UNLOCK(mutex);
+}
+
+// ============================================
+// REPORTING
+// ============================================
+
+static int collect_totals(LockTotals *totals) {
+    int count = 0;
+
+    for (LockSite *site = site_list; site; site = site->next) {
+        LockTotals *entry = NULL;
+        for (int i = 0; i < count; i++) {
+            if (strcmp(totals[i].name, site->lock_name) == 0) {
+                entry = &totals[i];
+                break;
+            }
+        }
+        if (!entry) {
+            if (count == MAX_LOCK_NAMES) continue;
+            entry = &totals[count++];
+            memset(entry, 0, sizeof(*entry));
+            entry->name = site->lock_name;
+        }
+
+        entry->sites++;
+        entry->acquisitions += site->acquisitions;
+        entry->contended += site->contended;
+        entry->wait_ns_total += site->wait_ns_total;
+        entry->hold_ns_total += site->hold_ns_total;
+        if (site->wait_ns_max > entry->wait_ns_max) entry->wait_ns_max = site->wait_ns_max;
+        if (site->hold_ns_max > entry->hold_ns_max) entry->hold_ns_max = site->hold_ns_max;
+    }
+
+    return count;
+}
+
+static const char *base_name(const char *path) {
+    const char *slash = strrchr(path, '/');
+    const char *backslash = strrchr(path, '\\');
+    if (backslash > slash) slash = backslash;
+    return slash ? slash + 1 : path;
+}
+
+void lock_stats_dump(FILE *out) {
+    LockTotals totals[MAX_LOCK_NAMES];
+
+    registry_lock();
+
+    int count = collect_totals(totals);
+    fprintf(out, "🔒 Lock contention (us): acquisitions / contended / wait total / wait max / hold total / hold max\n");
+    for (int i = 0; i < count; i++) {
+        fprintf(out, "   %-18s %10llu %10llu %12llu %10llu %12llu %10llu\n",
+                totals[i].name, totals[i].acquisitions, totals[i].contended,
+                totals[i].wait_ns_total / 1000, totals[i].wait_ns_max / 1000,
+                totals[i].hold_ns_total / 1000, totals[i].hold_ns_max / 1000);
+    }
+    for (LockSite *site = site_list; site; site = site->next) {
+        fprintf(out, "     %s:%d (%s) %llu / %llu / %llu / %llu / %llu / %llu\n",
+                base_name(site->file), site->line, site->lock_name,
+                site->acquisitions, site->contended,
+                site->wait_ns_total / 1000, site->wait_ns_max / 1000,
+                site->hold_ns_total / 1000, site->hold_ns_max / 1000);
+    }
+
+    registry_unlock();
+}
+
+int lock_stats_json(char *buffer, size_t size) {
+    if (size == 0) return 0;
+
+    LockTotals totals[MAX_LOCK_NAMES];
+    size_t offset = 0;
+
+// Once a write does not fit in the space left, offset stays at size
+#define JSON_APPEND(...) do { \
+        if (offset < size) { \
+            size_t space = size - offset; \
+            int written = snprintf(buffer + offset, space, __VA_ARGS__); \
+            offset = (written < 0 || (size_t)written >= space) ? size : offset + (size_t)written; \
+        } \
+    } while (0)
+
+    registry_lock();
+
+    int count = collect_totals(totals);
+    JSON_APPEND("{\"locks\":[");
+    for (int i = 0; i < count; i++) {
+        JSON_APPEND("%s{\"name\":\"%s\",\"sites\":%d,\"acquisitions\":%llu,\"contended\":%llu,"
+                    "\"wait_us_total\":%llu,\"wait_us_max\":%llu,\"hold_us_total\":%llu,\"hold_us_max\":%llu}",
+                    i ? "," : "", totals[i].name, totals[i].sites,
+                    totals[i].acquisitions, totals[i].contended,
+                    totals[i].wait_ns_total / 1000, totals[i].wait_ns_max / 1000,
+                    totals[i].hold_ns_total / 1000, totals[i].hold_ns_max / 1000);
+    }
+    JSON_APPEND("],\"sites\":[");
+    int first = 1;
+    for (LockSite *site = site_list; site; site = site->next) {
+        // Keep room for the closing brackets; drop sites that do not fit
+        size_t entry_start = offset;
+        JSON_APPEND("%s{\"lock\":\"%s\",\"site\":\"%s:%d\",\"acquisitions\":%llu,\"contended\":%llu,"
+                    "\"wait_us_total\":%llu,\"wait_us_max\":%llu,\"hold_us_total\":%llu,\"hold_us_max\":%llu}",
+                    first ? "" : ",", site->lock_name, base_name(site->file), site->line,
+                    site->acquisitions, site->contended,
+                    site->wait_ns_total / 1000, site->wait_ns_max / 1000,
+                    site->hold_ns_total / 1000, site->hold_ns_max / 1000);
+        if (offset + 3 > size) {
+            offset = entry_start;
+            break;
+        }
+        first = 0;
+    }
+    JSON_APPEND("]}");
+
+    registry_unlock();
+#undef JSON_APPEND
+
+    if (offset >= size) {
+        buffer[size - 1] = '\0';
+        return (int)(size - 1);
+    }
+    return (int)offset;
+}
@@ -0,0 +1,55 @@
+/* Lock Statistics - contention instrumentation for MUTEX_LOCK / MUTEX_UNLOCK
+ *
+ * Each MUTEX_LOCK call site gets a static LockSite record, so the hot path
+ * does no lookups. Acquisition first tries the lock; only a failed try counts
+ * as contended and is timed as wait. Hold time is charged to the site that
+ * acquired the lock. Site counters are only written while the lock itself is
+ * held, so they need no extra synchronization.
+ *
+ * Build with -DDISABLE_LOCK_STATS to compile the instrumentation out.
+ */
+
+#ifndef LOCK_STATS_H
+#define LOCK_STATS_H
+
+#include <stdio.h>
+#include <stddef.h>
+
+#ifdef _WIN32
+    #include <windows.h>
+    typedef CRITICAL_SECTION lock_stats_mutex_t;
+#else
+    #include <pthread.h>
+    typedef pthread_mutex_t lock_stats_mutex_t;
+#endif
+
+typedef struct LockSite {
+    const char *lock_name;
+    const char *file;
+    int line;
+    int registered;
+    struct LockSite *next;
+    unsigned long long acquisitions;
+    unsigned long long contended;
+    unsigned long long wait_ns_total;
+    unsigned long long wait_ns_max;
+    unsigned long long hold_ns_total;
+    unsigned long long hold_ns_max;
+} LockSite;
+
+void lock_stats_acquire(lock_stats_mutex_t *mutex, LockSite *site);
+void lock_stats_release(lock_stats_mutex_t *mutex);
+
+// Per named lock totals followed by the per call site breakdown
+void lock_stats_dump(FILE *out);
+int lock_stats_json(char *buffer, size_t size);
+
+#ifndef DISABLE_LOCK_STATS
+    #define LOCK_STATS_LOCK(mutex) do { \
+        static LockSite lock_site_ = { #mutex, __FILE__, __LINE__, 0, NULL, 0, 0, 0, 0, 0, 0 }; \
+        lock_stats_acquire(&(mutex), &lock_site_); \
+    } while (0)
+    #define LOCK_STATS_UNLOCK(mutex) lock_stats_release(&(mutex))
+#endif
+
+#endif
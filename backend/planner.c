@@ -0,0 +1,332 @@
+/* Planner - per-user ordering of pending work
+ *
+ * Entries live in an unordered array and the heap stores their indices; each
+ * entry remembers its heap position so updates and removals can sift it in
+ * place. Ids map to entries through a linear-probing table that deletes by
+ * shifting back, so there are no tombstones to clean up.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "planner.h"
+
+#define INITIAL_CAPACITY 64
+#define NO_DEADLINE_KEY 1e18
+
+static const char *policy_names[] = { "edf", "wsjf", "priority" };
+
+// ============================================
+// KEYS
+// ============================================
+
+static double plan_key(const Planner *planner, const PlanItem *item) {
+    switch (planner->policy) {
+        case PLAN_EDF:
+            return item->deadline > 0 ? (double)item->deadline : NO_DEADLINE_KEY;
+        case PLAN_WSJF:
+            return -(double)item->priority / (item->difficulty > 1 ? item->difficulty : 1);
+        default:
+            return planner->aging_per_hour * (double)item->arrival / 3600.0 - item->priority;
+    }
+}
+
+// Ties fall back to deadline, then priority, then id, so plans are deterministic
+static int item_before(double key_a, const PlanItem *a, double key_b, const PlanItem *b) {
+    if (key_a != key_b) return key_a < key_b;
+
+    double deadline_a = a->deadline > 0 ? (double)a->deadline : NO_DEADLINE_KEY;
+    double deadline_b = b->deadline > 0 ? (double)b->deadline : NO_DEADLINE_KEY;
+    if (deadline_a != deadline_b) return deadline_a < deadline_b;
+    if (a->priority != b->priority) return a->priority > b->priority;
+    return a->id < b->id;
+}
+
+static int entry_before(const Planner *planner, int a, int b) {
+    const PlanEntry *x = &planner->entries[a];
+    const PlanEntry *y = &planner->entries[b];
+    return item_before(x->key, &x->item, y->key, &y->item);
+}
+
+// ============================================
+// HEAP
+// ============================================
+
+static void heap_place(Planner *planner, int pos, int entry) {
+    planner->heap[pos] = entry;
+    planner->entries[entry].heap_pos = pos;
+}
+
+static void sift_up(Planner *planner, int pos) {
+    int entry = planner->heap[pos];
+    while (pos > 0) {
+        int parent = (pos - 1) / 2;
+        if (!entry_before(planner, entry, planner->heap[parent])) break;
+        heap_place(planner, pos, planner->heap[parent]);
+        pos = parent;
+    }
+    heap_place(planner, pos, entry);
+}
+
+static void sift_down(Planner *planner, int pos) {
+    int entry = planner->heap[pos];
+    for (;;) {
+        int child = 2 * pos + 1;
+        if (child >= planner->count) break;
+        if (child + 1 < planner->count && entry_before(planner, planner->heap[child + 1], planner->heap[child])) {
+            child++;
+        }
+        if (!entry_before(planner, planner->heap[child], entry)) break;
+        heap_place(planner, pos, planner->heap[child]);
+        pos = child;
+    }
+    heap_place(planner, pos, entry);
+}
+
+static void sift(Planner *planner, int pos) {
+    if (pos > 0 && entry_before(planner, planner->heap[pos], planner->heap[(pos - 1) / 2])) {
+        sift_up(planner, pos);
+    } else {
+        sift_down(planner, pos);
+    }
+}
+
+// ============================================
+// ID TABLE
+// ============================================
+
+static unsigned int slot_hash(int id, int slot_capacity) {
+    return ((unsigned int)id * 2654435761u) & (unsigned int)(slot_capacity - 1);
+}
+
+static int find_slot(const Planner *planner, int id) {
+    if (planner->slot_capacity == 0) return -1;
+
+    unsigned int mask = (unsigned int)planner->slot_capacity - 1;
+    for (unsigned int i = slot_hash(id, planner->slot_capacity); planner->slots[i]; i = (i + 1) & mask) {
+        if (planner->entries[planner->slots[i] - 1].item.id == id) return (int)i;
+    }
+    return -1;
+}
+
+static void insert_slot(Planner *planner, int id, int entry) {
+    unsigned int mask = (unsigned int)planner->slot_capacity - 1;
+    unsigned int i = slot_hash(id, planner->slot_capacity);
+    while (planner->slots[i]) i = (i + 1) & mask;
+    planner->slots[i] = entry + 1;
+}
+
+// Backward-shift deletion keeps every probe chain unbroken
+static void delete_slot(Planner *planner, int slot) {
+    unsigned int mask = (unsigned int)planner->slot_capacity - 1;
+    unsigned int hole = (unsigned int)slot;
+    unsigned int i = hole;
+
+    for (;;) {
+        i = (i + 1) & mask;
+        if (!planner->slots[i]) break;
+        unsigned int home = slot_hash(planner->entries[planner->slots[i] - 1].item.id, planner->slot_capacity);
+        // Move the entry back only if the hole lies between its home and its slot
+        if (((i - home) & mask) >= ((i - hole) & mask)) {
+            planner->slots[hole] = planner->slots[i];
+            hole = i;
+        }
+    }
+    planner->slots[hole] = 0;
+}
+
+static int grow(Planner *planner) {
+    int capacity = planner->capacity ? planner->capacity * 2 : INITIAL_CAPACITY;
+
+    PlanEntry *entries = realloc(planner->entries, (size_t)capacity * sizeof(PlanEntry));
+    if (!entries) return 0;
+    planner->entries = entries;
+
+    int *heap = realloc(planner->heap, (size_t)capacity * sizeof(int));
+    if (!heap) return 0;
+    planner->heap = heap;
+
+    int *scratch = realloc(planner->scratch, (size_t)capacity * sizeof(int));
+    if (!scratch) return 0;
+    planner->scratch = scratch;
+
+    // Table stays at most half full
+    int *slots = calloc((size_t)capacity * 2, sizeof(int));
+    if (!slots) return 0;
+    free(planner->slots);
+    planner->slots = slots;
+    planner->slot_capacity = capacity * 2;
+    for (int i = 0; i < planner->count; i++) {
+        insert_slot(planner, planner->entries[i].item.id, i);
+    }
+
+    planner->capacity = capacity;
+    return 1;
+}
+
+// ============================================
+// PUBLIC API
+// ============================================
+
+void planner_init(Planner *planner, int policy) {
+    memset(planner, 0, sizeof(*planner));
+    planner->policy = policy;
+    planner->aging_per_hour = PLAN_DEFAULT_AGING_PER_HOUR;
+}
+
+void planner_free(Planner *planner) {
+    free(planner->entries);
+    free(planner->heap);
+    free(planner->slots);
+    free(planner->scratch);
+    planner_init(planner, planner->policy);
+}
+
+void planner_set_policy(Planner *planner, int policy, double aging_per_hour) {
+    planner->policy = policy;
+    planner->aging_per_hour = aging_per_hour;
+
+    for (int i = 0; i < planner->count; i++) {
+        planner->entries[i].key = plan_key(planner, &planner->entries[i].item);
+    }
+    for (int pos = planner->count / 2 - 1; pos >= 0; pos--) {
+        sift_down(planner, pos);
+    }
+}
+
+int planner_upsert(Planner *planner, const PlanItem *item) {
+    int slot = find_slot(planner, item->id);
+
+    if (slot >= 0) {
+        PlanEntry *entry = &planner->entries[planner->slots[slot] - 1];
+        entry->seen = planner->generation;
+        if (entry->item.priority == item->priority && entry->item.difficulty == item->difficulty &&
+            entry->item.arrival == item->arrival && entry->item.deadline == item->deadline) {
+            return 1;
+        }
+
+        entry->item = *item;
+        entry->key = plan_key(planner, item);
+        sift(planner, entry->heap_pos);
+        return 1;
+    }
+
+    if (planner->count == planner->capacity && !grow(planner)) return 0;
+
+    int index = planner->count++;
+    PlanEntry *entry = &planner->entries[index];
+    entry->item = *item;
+    entry->key = plan_key(planner, item);
+    entry->seen = planner->generation;
+
+    insert_slot(planner, item->id, index);
+    heap_place(planner, index, index);
+    sift_up(planner, index);
+    return 1;
+}
+
+int planner_remove(Planner *planner, int id) {
+    int slot = find_slot(planner, id);
+    if (slot < 0) return 0;
+
+    int index = planner->slots[slot] - 1;
+    int pos = planner->entries[index].heap_pos;
+    delete_slot(planner, slot);
+
+    // Fill the heap hole with the last heap element
+    int last_pos = --planner->count;
+    if (pos != last_pos) {
+        heap_place(planner, pos, planner->heap[last_pos]);
+    }
+
+    // Keep storage dense: the last entry takes the freed index
+    if (index != planner->count) {
+        PlanEntry *moved = &planner->entries[planner->count];
+        int moved_slot = find_slot(planner, moved->item.id);
+        planner->entries[index] = *moved;
+        planner->slots[moved_slot] = index + 1;
+        planner->heap[planner->entries[index].heap_pos] = index;
+    }
+
+    if (pos < planner->count) sift(planner, pos);
+    return 1;
+}
+
+int planner_peek(const Planner *planner, PlanItem *item) {
+    if (planner->count == 0) return 0;
+    *item = planner->entries[planner->heap[0]].item;
+    return 1;
+}
+
+// Best-first walk of the heap: a small second heap of heap positions holds the
+// frontier, starting at the root and adding both children of each position taken
+int planner_order(Planner *planner, int *ids, int max) {
+    int *frontier = planner->scratch;
+    int size = 0;
+    int written = 0;
+
+    if (planner->count > 0) frontier[size++] = 0;
+
+    while (size > 0 && written < max) {
+        int pos = frontier[0];
+        ids[written++] = planner->entries[planner->heap[pos]].item.id;
+
+        // Pop the frontier root
+        int last = frontier[--size];
+        int hole = 0;
+        for (;;) {
+            int child = 2 * hole + 1;
+            if (child >= size) break;
+            if (child + 1 < size && entry_before(planner, planner->heap[frontier[child + 1]], planner->heap[frontier[child]])) {
+                child++;
+            }
+            if (!entry_before(planner, planner->heap[frontier[child]], planner->heap[last])) break;
+            frontier[hole] = frontier[child];
+            hole = child;
+        }
+        if (size > 0) frontier[hole] = last;
+
+        // Push the children of the position just emitted
+        for (int child = 2 * pos + 1; child <= 2 * pos + 2 && child < planner->count; child++) {
+            int at = size++;
+            while (at > 0 && entry_before(planner, planner->heap[child], planner->heap[frontier[(at - 1) / 2]])) {
+                frontier[at] = frontier[(at - 1) / 2];
+                at = (at - 1) / 2;
+            }
+            frontier[at] = child;
+        }
+    }
+    return written;
+}
+
+void planner_sync_begin(Planner *planner) {
+    planner->generation++;
+}
+
+int planner_sync_end(Planner *planner) {
+    int removed = 0;
+    for (int i = planner->count - 1; i >= 0; i--) {
+        // Removal only moves the last entry into i, which has already been checked
+        if (planner->entries[i].seen != planner->generation) {
+            planner_remove(planner, planner->entries[i].item.id);
+            removed++;
+        }
+    }
+    return removed;
+}
+
+int planner_compare(const Planner *planner, const PlanItem *a, const PlanItem *b) {
+    if (a->id == b->id) return 0;
+    return item_before(plan_key(planner, a), a, plan_key(planner, b), b) ? -1 : 1;
+}
+
+int planner_policy_from_name(const char *name) {
+    if (!name) return -1;
+    for (int i = 0; i < 3; i++) {
+        if (strcmp(name, policy_names[i]) == 0) return i;
+    }
+    return -1;
+}
+
+const char *planner_policy_name(int policy) {
+    return (policy >= 0 && policy < 3) ? policy_names[policy] : "edf";
+}
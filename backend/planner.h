@@ -0,0 +1,83 @@
+/* Planner - per-user ordering of pending work
+ *
+ * A Planner holds one user's pending tasks in an indexed binary heap, so a
+ * task can be added, changed or removed in O(log n) without rebuilding the
+ * plan. The head of the plan is O(1); the first k entries in order are read
+ * in O(k log k) without disturbing the heap.
+ *
+ * Policies (lower key = earlier in the plan):
+ *   PLAN_EDF              earliest deadline first; tasks without one go last
+ *   PLAN_WSJF             weighted shortest job first: priority / difficulty
+ *   PLAN_PRIORITY_AGING   priority plus aging_per_hour for every hour waited
+ * Aging grows at the same rate for every task, so the order only depends on
+ * priority - rate * arrival and keys never need to be refreshed as time passes.
+ */
+
+#ifndef PLANNER_H
+#define PLANNER_H
+
+#define PLAN_EDF 0
+#define PLAN_WSJF 1
+#define PLAN_PRIORITY_AGING 2
+
+#define PLAN_DEFAULT_AGING_PER_HOUR 0.1   // One priority level per 10 hours waited
+
+typedef struct {
+    int id;
+    int priority;                // Higher is more important
+    int difficulty;              // Job size for WSJF; values below 1 count as 1
+    long long arrival;           // When the task became available (aging)
+    long long deadline;          // 0 = none
+} PlanItem;
+
+typedef struct {
+    PlanItem item;
+    double key;
+    int heap_pos;
+    unsigned int seen;           // Sync generation that last touched the entry
+} PlanEntry;
+
+typedef struct {
+    int policy;
+    double aging_per_hour;
+    PlanEntry *entries;          // Unordered storage; the heap holds indices into it
+    int *heap;
+    int count;
+    int capacity;
+    int *slots;                  // Open addressing, id -> entry index + 1
+    int slot_capacity;           // Power of two
+    int *scratch;                // planner_order working heap
+    unsigned int generation;
+} Planner;
+
+void planner_init(Planner *planner, int policy);
+void planner_free(Planner *planner);
+
+// Switches policy and re-heapifies in O(n)
+void planner_set_policy(Planner *planner, int policy, double aging_per_hour);
+
+// Adds or updates a task; O(1) if nothing that affects its key changed. Returns 0 on allocation failure.
+int planner_upsert(Planner *planner, const PlanItem *item);
+
+// Returns 0 if the id was not planned
+int planner_remove(Planner *planner, int id);
+
+// Next task in the plan; returns 0 if the plan is empty
+int planner_peek(const Planner *planner, PlanItem *item);
+
+// Writes the first max ids in plan order; returns how many were written
+int planner_order(Planner *planner, int *ids, int max);
+
+// Plan order of two tasks under the planner's policy: <0 if a comes first
+int planner_compare(const Planner *planner, const PlanItem *a, const PlanItem *b);
+
+// Reconciling with a full task list: upserts between begin and end keep their
+// tasks, end removes every task that was not upserted since begin.
+void planner_sync_begin(Planner *planner);
+int planner_sync_end(Planner *planner);
+
+// "edf", "wsjf", "priority"; -1 if unrecognized
+int planner_policy_from_name(const char *name);
+const char *planner_policy_name(int policy);
+
+#endif
@@ -0,0 +1,148 @@
+/* Planner benchmark - builds, updates and reads plans for large task lists
+ * Compile: gcc -O2 backend/planner_bench.c backend/planner.c -o backend/planner_bench
+ * Run: ./backend/planner_bench [tasks] [updates]
+ *
+ * For each policy: bulk insert, full ordered read, top-20 reads, random
+ * updates/removals/inserts, and a full re-sort baseline of the same list
+ * (what a plan without incremental updates would pay per change).
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "planner.h"
+
+#define TOP_K 20
+
+static Planner *sort_planner;
+
+static double elapsed_ms(struct timespec start) {
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    return (end.tv_sec - start.tv_sec) * 1000.0 + (end.tv_nsec - start.tv_nsec) / 1e6;
+}
+
+static void random_item(PlanItem *item, int id, long long now) {
+    item->id = id;
+    item->priority = 1 + rand() % 5;
+    item->difficulty = 1 + rand() % 10;
+    item->arrival = now - rand() % (30 * 86400);
+    item->deadline = (rand() % 4) ? now + rand() % (14 * 86400) : 0;
+}
+
+static int compare_by_plan(const void *a, const void *b) {
+    return planner_compare(sort_planner, (const PlanItem*)a, (const PlanItem*)b);
+}
+
+// The full order must be what a sort of the live items produces. Returns the
+// sort time in ms, or -1 if the plan differs.
+static double check_order(Planner *planner, const PlanItem *items, const char *live, int count, int *order) {
+    PlanItem *sorted = malloc((size_t)count * sizeof(PlanItem));
+    if (!sorted) return -1;
+    int live_count = 0;
+    for (int i = 0; i < count; i++) {
+        if (live[i]) sorted[live_count++] = items[i];
+    }
+    
+    sort_planner = planner;
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    qsort(sorted, (size_t)live_count, sizeof(PlanItem), compare_by_plan);
+    double sort_ms = elapsed_ms(start);
+    
+    int ordered = planner_order(planner, order, count);
+    int mismatch = ordered != live_count ? (ordered < live_count ? ordered : live_count) : -1;
+    for (int i = 0; mismatch < 0 && i < ordered; i++) {
+        if (sorted[i].id != order[i]) mismatch = i;
+    }
+    free(sorted);
+    
+    if (mismatch >= 0) {
+        printf("❌ %s: plan differs from sorted order at %d\n", planner_policy_name(planner->policy), mismatch);
+        return -1;
+    }
+    return sort_ms;
+}
+
+int main(int argc, char **argv) {
+    int task_count = argc > 1 ? atoi(argv[1]) : 10000;
+    int update_count = argc > 2 ? atoi(argv[2]) : 100000;
+    long long now = (long long)time(NULL);
+    if (task_count < 1 || update_count < 0) {
+        printf("Usage: %s [tasks >= 1] [updates >= 0]\n", argv[0]);
+        return 1;
+    }
+
+    PlanItem *items = malloc((size_t)task_count * sizeof(PlanItem));
+    int *order = malloc((size_t)task_count * sizeof(int));
+    char *live = malloc((size_t)task_count);
+    if (!items || !order || !live) return 1;
+
+    printf("📐 Planner benchmark: %d pending tasks, %d incremental changes\n", task_count, update_count);
+    printf("   %-9s %10s %10s %12s %14s %12s\n", "policy", "build ms", "order ms", "top-20 us", "change us", "re-sort ms");
+
+    for (int policy = PLAN_EDF; policy <= PLAN_PRIORITY_AGING; policy++) {
+        srand(42);
+        for (int i = 0; i < task_count; i++) random_item(&items[i], i + 1, now);
+        memset(live, 1, (size_t)task_count);
+
+        Planner planner;
+        planner_init(&planner, policy);
+        struct timespec start;
+
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (int i = 0; i < task_count; i++) planner_upsert(&planner, &items[i]);
+        double build_ms = elapsed_ms(start);
+
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        planner_order(&planner, order, task_count);
+        double order_ms = elapsed_ms(start);
+
+        double sort_ms = check_order(&planner, items, live, task_count, order);
+        if (sort_ms < 0) return 1;
+
+        int top[TOP_K];
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (int i = 0; i < 1000; i++) planner_order(&planner, top, TOP_K);
+        double top_us = elapsed_ms(start);  // ms per 1000 reads = us per read
+
+        // Mixed changes: 80% field updates, 10% removals, 10% new tasks
+        int next_id = task_count + 1;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (int i = 0; i < update_count; i++) {
+            int r = rand() % 10;
+            int slot = rand() % task_count;
+            if (r == 0) {
+                planner_remove(&planner, items[slot].id);
+                live[slot] = 0;
+            } else if (r == 1) {
+                // The new task takes the slot, so the one it held leaves the plan
+                if (live[slot]) planner_remove(&planner, items[slot].id);
+                random_item(&items[slot], next_id++, now);
+                planner_upsert(&planner, &items[slot]);
+                live[slot] = 1;
+            } else {
+                items[slot].priority = 1 + rand() % 5;
+                items[slot].deadline = now + rand() % (14 * 86400);
+                planner_upsert(&planner, &items[slot]);
+                live[slot] = 1;
+            }
+        }
+        double change_us = elapsed_ms(start) * 1000.0 / (update_count ? update_count : 1);
+
+        // Incremental changes must leave the same order a fresh sort gives
+        if (check_order(&planner, items, live, task_count, order) < 0) return 1;
+
+        printf("   %-9s %10.2f %10.2f %12.2f %14.3f %12.2f\n", planner_policy_name(policy),
+               build_ms, order_ms, top_us, change_us, sort_ms);
+        planner_free(&planner);
+    }
+
+    free(items);
+    free(order);
+    free(live);
+    return 0;
+}
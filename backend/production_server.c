@@ -3,6 +3,10 @@
 #include <string.h>
 #include <time.h>
 #include <ctype.h>
+#include "http_parser.h"
+#include "http_response.h"
+#include "router.h"
+#include "json_body.h"
 
 #ifdef _WIN32
     #include <winsock2.h>
@@ -23,6 +27,7 @@
     #define MUTEX_DESTROY(mutex) DeleteCriticalSection(&mutex)
 #else
     #include <sys/socket.h>
+    #include <sys/time.h>
     #include <netinet/in.h>
     #include <arpa/inet.h>
     #include <unistd.h>
@@ -36,8 +41,20 @@
     #define MUTEX_DESTROY(mutex) pthread_mutex_destroy(&mutex)
 #endif
 
+// Route locking through the contention instrumentation unless compiled out
+#include "lock_stats.h"
+#ifndef DISABLE_LOCK_STATS
+    #undef MUTEX_LOCK
+    #undef MUTEX_UNLOCK
+    #define MUTEX_LOCK(mutex) LOCK_STATS_LOCK(mutex)
+    #define MUTEX_UNLOCK(mutex) LOCK_STATS_UNLOCK(mutex)
+#endif
+
 #define PORT 3000
 #define BUFFER_SIZE 8192
+#define KEEP_ALIVE_TIMEOUT 5         // Seconds a persistent connection may sit idle
+#define KEEP_ALIVE_MAX_REQUESTS 100  // Then it is closed so its thread is freed
+#define MAX_REQUEST_BUFFER (HTTP_MAX_HEADER_BYTES + HTTP_MAX_BODY_BYTES + BUFFER_SIZE)
 #define MAX_USERS 10000
 #define MAX_SESSIONS 1000
 #define MAX_TASKS 50000
@@ -47,6 +64,15 @@
 #define RATE_LIMIT_WINDOW 60 // seconds
 #define RATE_LIMIT_MAX_REQUESTS 100
 
+#ifdef _MSC_VER
+    #define THREAD_LOCAL __declspec(thread)
+#else
+    #define THREAD_LOCAL __thread
+#endif
+
+// Connection header of the response this thread is writing
+static THREAD_LOCAL const char *connection_header = "close";
+
 // Enhanced security structures
 typedef struct {
     int id;
@@ -175,42 +201,46 @@ int check_rate_limit(const char *ip_address) {
 }
 
 // Enhanced HTTP response functions
+
+// Security and CORS headers of every response. It begins by ending the
+// Content-Type line, whose value is the one part that varies.
+static const char security_headers[] =
+    "\r\n"
+    "Access-Control-Allow-Origin: http://localhost:8080\r\n"
+    "Access-Control-Allow-Methods: GET, POST, OPTIONS\r\n"
+    "Access-Control-Allow-Headers: Content-Type, Authorization\r\n"
+    "Access-Control-Allow-Credentials: true\r\n"
+    "X-Content-Type-Options: nosniff\r\n"
+    "X-Frame-Options: DENY\r\n"
+    "X-XSS-Protection: 1; mode=block\r\n"
+    "Strict-Transport-Security: max-age=31536000; includeSubDomains\r\n"
+    "Content-Security-Policy: default-src 'self'; script-src 'self' 'unsafe-inline'; style-src 'self' 'unsafe-inline'\r\n"
+    "Cache-Control: no-cache, no-store, must-revalidate\r\n"
+    "Pragma: no-cache\r\n"
+    "Expires: 0\r\n";
+
+// Sent as one gathered write; only Content-Length is formatted per response
 void send_response_with_security_headers(int client_socket, int status_code, const char *content_type, const char *body) {
-    char response[BUFFER_SIZE * 2];
-    char status_text[32];
-    
-    switch(status_code) {
-        case 200: strcpy(status_text, "OK"); break;
-        case 400: strcpy(status_text, "Bad Request"); break;
-        case 401: strcpy(status_text, "Unauthorized"); break;
-        case 403: strcpy(status_text, "Forbidden"); break;
-        case 429: strcpy(status_text, "Too Many Requests"); break;
-        case 500: strcpy(status_text, "Internal Server Error"); break;
-        default: strcpy(status_text, "Unknown"); break;
-    }
-    
-    snprintf(response, sizeof(response),
-        "HTTP/1.1 %d %s\r\n"
-        "Content-Type: %s\r\n"
-        "Content-Length: %u\r\n"
-        "Access-Control-Allow-Origin: http://localhost:8080\r\n"
-        "Access-Control-Allow-Methods: GET, POST, OPTIONS\r\n"
-        "Access-Control-Allow-Headers: Content-Type, Authorization\r\n"
-        "Access-Control-Allow-Credentials: true\r\n"
-        "X-Content-Type-Options: nosniff\r\n"
-        "X-Frame-Options: DENY\r\n"
-        "X-XSS-Protection: 1; mode=block\r\n"
-        "Strict-Transport-Security: max-age=31536000; includeSubDomains\r\n"
-        "Content-Security-Policy: default-src 'self'; script-src 'self' 'unsafe-inline'; style-src 'self' 'unsafe-inline'\r\n"
-        "Cache-Control: no-cache, no-store, must-revalidate\r\n"
-        "Pragma: no-cache\r\n"
-        "Expires: 0\r\n"
-        "\r\n"
-        "%s",
-        status_code, status_text, content_type, (unsigned int)strlen(body), body
-    );
-    
-    send(client_socket, response, strlen(response), 0);
+    static const char content_type_name[] = "Content-Type: ";
+    static const char keep_alive[] = "Connection: keep-alive\r\n\r\n";
+    static const char close_connection[] = "Connection: close\r\n\r\n";
+    int persistent = strcmp(connection_header, "keep-alive") == 0;
+    char content_length[40];
+    size_t body_length = strlen(body);
+    
+    HttpSlice slices[] = {
+        http_status_line(status_code),
+        { content_type_name, sizeof(content_type_name) - 1 },
+        { content_type, strlen(content_type) },
+        { security_headers, sizeof(security_headers) - 1 },
+        http_content_length(content_length, (long long)body_length),
+        { persistent ? keep_alive : close_connection,
+          persistent ? sizeof(keep_alive) - 1 : sizeof(close_connection) - 1 },
+        { body, body_length }
+    };
+    
+    // A response cut short leaves the stream out of step; do not reuse it
+    if (!http_send_slices(client_socket, slices, 7)) connection_header = "close";
 }
 
 void send_json_success(int client_socket, const char *message) {
@@ -349,45 +379,19 @@ int is_strong_password(const char *password) {
     return has_upper && has_lower && has_digit && has_special;
 }
 
-// Simple JSON parsing
-char* extract_json_value(const char *json, const char *key) {
-    static char value[512];
-    char search_key[128];
-    snprintf(search_key, sizeof(search_key), "\"%s\":", key);
-    
-    char *pos = strstr(json, search_key);
-    if(!pos) return NULL;
-    
-    pos += strlen(search_key);
-    while(*pos == ' ' || *pos == '\t') pos++;
-    
-    if(*pos == '"') {
-        pos++;
-        int i = 0;
-        while(*pos && *pos != '"' && i < 511) {
-            if (*pos == '\\' && *(pos + 1)) {
-                pos++; // Skip escape character
-            }
-            value[i++] = *pos++;
-        }
-        value[i] = '\0';
-        return value;
-    }
-    
-    return NULL;
-}
-
 // API handlers
 void handle_register(int client_socket, const char *body, const char *ip_address) {
     (void)ip_address; // Mark as intentionally unused for now
     
-    char *username = extract_json_value(body, "username");
-    char *email = extract_json_value(body, "email");
-    char *password = extract_json_value(body, "password");
-    char *mobile = extract_json_value(body, "mobile");
+    JsonBody fields;
+    json_body_parse(&fields, body, strlen(body));
+    char username[64], email[128], password[128], mobile[16];
     
     // Input validation
-    if (!username || !email || !password || !mobile) {
+    if (json_body_string(&fields, "username", username, sizeof(username)) <= 0 ||
+        json_body_string(&fields, "email", email, sizeof(email)) <= 0 ||
+        json_body_string(&fields, "password", password, sizeof(password)) <= 0 ||
+        json_body_string(&fields, "mobile", mobile, sizeof(mobile)) <= 0) {
         send_json_error(client_socket, 400, "Missing required fields");
         return;
     }
@@ -446,10 +450,12 @@ void handle_register(int client_socket, const char *body, const char *ip_address
 }
 
 void handle_login_step1(int client_socket, const char *body, const char *ip_address, const char *user_agent) {
-    char *username = extract_json_value(body, "username");
-    char *password = extract_json_value(body, "password");
+    JsonBody fields;
+    json_body_parse(&fields, body, strlen(body));
+    char username[64], password[128];
     
-    if (!username || !password) {
+    if (json_body_string(&fields, "username", username, sizeof(username)) <= 0 ||
+        json_body_string(&fields, "password", password, sizeof(password)) <= 0) {
         send_json_error(client_socket, 400, "Missing username or password");
         return;
     }
@@ -504,10 +510,12 @@ void handle_login_step1(int client_socket, const char *body, const char *ip_addr
 }
 
 void handle_login_step2(int client_socket, const char *body) {
-    char *session_id = extract_json_value(body, "session_id");
-    char *otp = extract_json_value(body, "otp");
+    JsonBody fields;
+    json_body_parse(&fields, body, strlen(body));
+    char session_id[37], otp[7];
     
-    if (!session_id || !otp) {
+    if (json_body_string(&fields, "session_id", session_id, sizeof(session_id)) <= 0 ||
+        json_body_string(&fields, "otp", otp, sizeof(otp)) <= 0) {
         send_json_error(client_socket, 400, "Missing session_id or otp");
         return;
     }
@@ -532,9 +540,11 @@ void handle_login_step2(int client_socket, const char *body) {
 }
 
 void handle_login_step3(int client_socket, const char *body) {
-    char *session_id = extract_json_value(body, "session_id");
+    JsonBody fields;
+    json_body_parse(&fields, body, strlen(body));
+    char session_id[37];
     
-    if (!session_id) {
+    if (json_body_string(&fields, "session_id", session_id, sizeof(session_id)) <= 0) {
         send_json_error(client_socket, 400, "Missing session_id");
         return;
     }
@@ -562,9 +572,11 @@ void handle_login_step3(int client_socket, const char *body) {
 }
 
 void handle_resend_otp(int client_socket, const char *body) {
-    char *session_id = extract_json_value(body, "session_id");
+    JsonBody fields;
+    json_body_parse(&fields, body, strlen(body));
+    char session_id[37];
     
-    if (!session_id) {
+    if (json_body_string(&fields, "session_id", session_id, sizeof(session_id)) <= 0) {
         send_json_error(client_socket, 400, "Missing session_id");
         return;
     }
@@ -622,38 +634,117 @@ void handle_get_tasks(int client_socket, const char *username) {
 }
 
 // Request parsing and routing
-char* extract_client_ip(const char *request) {
+char* extract_client_ip(const HttpRequest *request) {
     (void)request; // Mark as intentionally unused for now
     static char ip[46] = "127.0.0.1"; // Default to localhost
     // In a real implementation, extract from X-Forwarded-For or other headers
     return ip;
 }
 
-char* extract_user_agent(const char *request) {
+char* extract_user_agent(const HttpRequest *request) {
     static char user_agent[256] = "Unknown";
     
-    char *ua_start = strstr(request, "User-Agent: ");
-    if (ua_start) {
-        ua_start += 12; // Skip "User-Agent: "
-        char *ua_end = strstr(ua_start, "\r\n");
-        if (ua_end) {
-            int len = ua_end - ua_start;
-            if (len > 255) len = 255;
-            strncpy(user_agent, ua_start, len);
-            user_agent[len] = '\0';
-        }
+    const HttpSpan *value = http_header(request, "User-Agent");
+    if (value) {
+        http_span_copy(request, *value, user_agent, sizeof(user_agent));
     }
     
     return user_agent;
 }
 
-void handle_request(int client_socket, char *request) {
-    char method[16], path[256], version[16];
-    char *body = strstr(request, "\r\n\r\n");
-    if (body) body += 4;
+// Route table: built once in main before the server accepts, read-only after
+
+typedef struct {
+    const char *body;
+    const char *client_ip;
+    const char *user_agent;
+} RouteContext;
+
+static Router routes;
+
+static void route_register(int client_socket, const RouteParams *params, void *context) {
+    const RouteContext *route = context;
+    (void)params;
+    handle_register(client_socket, route->body, route->client_ip);
+}
+
+static void route_login_step1(int client_socket, const RouteParams *params, void *context) {
+    const RouteContext *route = context;
+    (void)params;
+    handle_login_step1(client_socket, route->body, route->client_ip, route->user_agent);
+}
+
+static void route_login_step2(int client_socket, const RouteParams *params, void *context) {
+    const RouteContext *route = context;
+    (void)params;
+    handle_login_step2(client_socket, route->body);
+}
+
+static void route_login_step3(int client_socket, const RouteParams *params, void *context) {
+    const RouteContext *route = context;
+    (void)params;
+    handle_login_step3(client_socket, route->body);
+}
+
+static void route_resend_otp(int client_socket, const RouteParams *params, void *context) {
+    const RouteContext *route = context;
+    (void)params;
+    handle_resend_otp(client_socket, route->body);
+}
+
+static void route_health(int client_socket, const RouteParams *params, void *context) {
+    (void)params;
+    (void)context;
+    char health_response[256];
+    snprintf(health_response, sizeof(health_response),
+        "{\"status\": \"healthy\", \"uptime\": %ld, \"users\": %d, \"sessions\": %d, \"version\": \"2.0.0\"}",
+        time(NULL), user_count, session_count);
+    send_response_with_security_headers(client_socket, 200, "application/json", health_response);
+}
+
+static void route_lock_stats(int client_socket, const RouteParams *params, void *context) {
+    (void)params;
+    (void)context;
+    char stats[BUFFER_SIZE];
+    lock_stats_json(stats, sizeof(stats));
+    send_response_with_security_headers(client_socket, 200, "application/json", stats);
+}
+
+void build_routes(void) {
+    static const struct {
+        const char *method;
+        const char *pattern;
+        RouteHandler handler;
+    } table[] = {
+        { "POST", "/api/auth/register",    route_register },
+        { "POST", "/api/auth/login/step1", route_login_step1 },
+        { "POST", "/api/auth/login/step2", route_login_step2 },
+        { "POST", "/api/auth/login/step3", route_login_step3 },
+        { "POST", "/api/auth/resend-otp",  route_resend_otp },
+        { "GET",  "/api/health",           route_health },
+        { "GET",  "/api/stats/locks",      route_lock_stats },
+    };
+    
+    router_init(&routes);
+    for (size_t i = 0; i < sizeof(table) / sizeof(table[0]); i++) {
+        if (!router_add(&routes, table[i].method, table[i].pattern, table[i].handler)) {
+            printf("⚠️  Route %s %s not added\n", table[i].method, table[i].pattern);
+        }
+    }
+    router_compile(&routes);
+}
+
+// One request framed by handle_client; its body is NUL-terminated
+void handle_request(int client_socket, const HttpRequest *request) {
+    char method[16], path[256];
+    const char *body = http_span_data(request, request->body);
     
-    if (sscanf(request, "%s %s %s", method, path, version) != 3) {
-        send_json_error(client_socket, 400, "Invalid request format");
+    if (!http_span_copy(request, request->method, method, sizeof(method))) {
+        send_json_error(client_socket, 501, "Method not implemented");
+        return;
+    }
+    if (!http_span_copy(request, request->target, path, sizeof(path))) {
+        send_json_error(client_socket, 414, "URI too long");
         return;
     }
     
@@ -675,39 +766,32 @@ void handle_request(int client_socket, char *request) {
         return;
     }
     
-    if (strcmp(method, "POST") != 0 && strcmp(method, "GET") != 0) {
-        send_json_error(client_socket, 405, "Method not allowed");
-        return;
-    }
-    
     // Route requests
-    if (strcmp(path, "/api/auth/register") == 0 && strcmp(method, "POST") == 0) {
-        handle_register(client_socket, body ? body : "", client_ip);
-    }
-    else if (strcmp(path, "/api/auth/login/step1") == 0 && strcmp(method, "POST") == 0) {
-        handle_login_step1(client_socket, body ? body : "", client_ip, user_agent);
-    }
-    else if (strcmp(path, "/api/auth/login/step2") == 0 && strcmp(method, "POST") == 0) {
-        handle_login_step2(client_socket, body ? body : "");
-    }
-    else if (strcmp(path, "/api/auth/login/step3") == 0 && strcmp(method, "POST") == 0) {
-        handle_login_step3(client_socket, body ? body : "");
-    }
-    else if (strcmp(path, "/api/auth/resend-otp") == 0 && strcmp(method, "POST") == 0) {
-        handle_resend_otp(client_socket, body ? body : "");
-    }
-    else if (strcmp(path, "/api/health") == 0 && strcmp(method, "GET") == 0) {
-        char health_response[256];
-        snprintf(health_response, sizeof(health_response),
-            "{\"status\": \"healthy\", \"uptime\": %ld, \"users\": %d, \"sessions\": %d, \"version\": \"2.0.0\"}",
-            time(NULL), user_count, session_count);
-        send_response_with_security_headers(client_socket, 200, "application/json", health_response);
-    }
-    else {
-        send_json_error(client_socket, 404, "Endpoint not found");
+    RouteContext context = { body, client_ip, user_agent };
+    RouteHandler handler;
+    RouteParams params;
+    switch (router_match(&routes, method, path, &handler, &params)) {
+        case ROUTE_FOUND:
+            handler(client_socket, &params, &context);
+            break;
+        case ROUTE_METHOD_NOT_ALLOWED:
+            send_json_error(client_socket, 405, "Method not allowed");
+            break;
+        default:
+            send_json_error(client_socket, 404, "Endpoint not found");
+            break;
     }
 }
 
+void set_receive_timeout(int client_socket, int seconds) {
+#ifdef _WIN32
+    DWORD timeout = (DWORD)seconds * 1000;
+#else
+    struct timeval timeout = { seconds, 0 };
+#endif
+    setsockopt(client_socket, SOL_SOCKET, SO_RCVTIMEO, (const char*)&timeout, sizeof(timeout));
+}
+
 #ifdef _WIN32
 unsigned __stdcall handle_client(void *client_socket_ptr) {
     int client_socket = *(int*)client_socket_ptr;
@@ -718,14 +802,61 @@ void* handle_client(void *client_socket_ptr) {
     free(client_socket_ptr);
 #endif
     
-    char buffer[BUFFER_SIZE];
-    int bytes_received = recv(client_socket, buffer, BUFFER_SIZE - 1, 0);
-    
-    if (bytes_received > 0) {
-        buffer[bytes_received] = '\0';
-        handle_request(client_socket, buffer);
+    // Persistent connection: answer each request in the order it arrived,
+    // including pipelined ones already buffered, until the client closes,
+    // asks to close, or stays idle past KEEP_ALIVE_TIMEOUT. Reads go to an
+    // incremental parser, and the buffer grows for bodies past BUFFER_SIZE.
+    int capacity = BUFFER_SIZE;
+    char *buffer = malloc(capacity);
+    int buffered = 0;
+    int served = 0;
+    HttpRequest request;
+    http_request_init(&request);
+    set_receive_timeout(client_socket, KEEP_ALIVE_TIMEOUT);
+    
+    while (buffer) {
+        HttpParseResult result = http_parse(&request, buffer, buffered);
+        if (result == HTTP_PARSE_ERROR) {
+            connection_header = "close";
+            send_json_error(client_socket, request.error_status, "Malformed or oversized request");
+            break;
+        }
+        
+        if (result == HTTP_PARSE_INCOMPLETE) {
+            // One byte is kept free for the body's terminator
+            if (buffered == capacity - 1) {
+                char *grown = capacity < MAX_REQUEST_BUFFER ? realloc(buffer, capacity * 2) : NULL;
+                if (!grown) {
+                    connection_header = "close";
+                    send_json_error(client_socket, 413, "Request too large");
+                    break;
+                }
+                buffer = grown;
+                capacity *= 2;
+            }
+            int bytes_received = recv(client_socket, buffer + buffered, capacity - 1 - buffered, 0);
+            if (bytes_received <= 0) break;
+            buffered += bytes_received;
+            continue;
+        }
+        
+        // The byte after the body may start the next request; lend it for the terminator
+        int body_end = request.body.offset + request.body.length;
+        char next = buffer[body_end];
+        buffer[body_end] = '\0';
+        int keep_alive = request.keep_alive && ++served < KEEP_ALIVE_MAX_REQUESTS;
+        connection_header = keep_alive ? "keep-alive" : "close";
+        handle_request(client_socket, &request);
+        buffer[body_end] = next;
+        
+        // A response that failed partway switched the connection to close
+        if (!keep_alive || strcmp(connection_header, "close") == 0) break;
+        buffered -= request.consumed;
+        memmove(buffer, buffer + request.consumed, buffered);
+        http_request_init(&request);
     }
     
+    free(buffer);
     close(client_socket);
     return 0;
 }
@@ -756,6 +887,8 @@ int main() {
     
     // Initialize mutex
     MUTEX_INIT(data_mutex);
+    build_routes();
+    http_response_init();
     
 #ifdef _WIN32
     WSADATA wsa_data;
@@ -799,6 +932,7 @@ int main() {
     printf("   POST /api/auth/login/step3\n");
     printf("   POST /api/auth/resend-otp\n");
     printf("   GET  /api/health\n");
+    printf("   GET  /api/stats/locks\n");
     printf("\n🔄 Ready for connections...\n\n");
     
     // Session cleanup thread will be implemented later
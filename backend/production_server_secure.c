@@ -14,16 +14,30 @@
 #include <ctype.h>
 #include <math.h>
 #include "sqlite3.h"
+#include "lock_stats.h"
+#include "rate_limiter.h"
+#include "session_cache.h"
 
 #pragma comment(lib, "ws2_32.lib")
 
+// Route locking through the contention instrumentation unless compiled out
+#ifdef DISABLE_LOCK_STATS
+    #define MUTEX_LOCK(mutex) EnterCriticalSection(&mutex)
+    #define MUTEX_UNLOCK(mutex) LeaveCriticalSection(&mutex)
+#else
+    #define MUTEX_LOCK(mutex) LOCK_STATS_LOCK(mutex)
+    #define MUTEX_UNLOCK(mutex) LOCK_STATS_UNLOCK(mutex)
+#endif
+
 // Security Configuration
 #define MAX_REQUEST_SIZE 8192
 #define MAX_HEADER_SIZE 4096
 #define MAX_CONNECTIONS 1000
 #define RATE_LIMIT_WINDOW 60
 #define RATE_LIMIT_REQUESTS 100
+#define RATE_LIMIT_BLOCK_SECONDS 300     // Times the address's violation count
 #define SESSION_TIMEOUT 3600
+#define SESSION_CACHE_CAPACITY 10000
 #define MAX_LOGIN_ATTEMPTS 5
 #define LOCKOUT_DURATION 1800
 #define CSRF_TOKEN_LENGTH 32
@@ -47,7 +61,6 @@ const char *SECURITY_HEADERS =
 // Global variables
 sqlite3 *db = NULL;
 CRITICAL_SECTION db_mutex;
-CRITICAL_SECTION rate_limit_mutex;
 CRITICAL_SECTION session_mutex;
 
 // Security structures
@@ -65,6 +78,7 @@ typedef struct {
     char csrf_token[33];
     time_t created_at;
     time_t last_accessed;
+    time_t expires_at;
     char ip_address[46];
     int is_active;
 } session_entry_t;
@@ -369,106 +383,15 @@ void generate_csrf_token(char *token, int length) {
     token[length - 1] = '\0';
 }
 
-// Enhanced rate limiting with progressive penalties
+// Enhanced rate limiting with progressive penalties, held in memory
+// (rate_limiter.c): each violation blocks the address for 5 more minutes
 int check_rate_limit(const char *ip_address) {
-    time_t now = time(NULL);
-    
-    const char *sql = 
-        "SELECT window_start, request_count, blocked_until, violation_count "
-        "FROM rate_limits WHERE ip_address = ?;";
-    
-    sqlite3_stmt *stmt;
-    EnterCriticalSection(&rate_limit_mutex);
-    
-    int allowed = 1;
-    if (sqlite3_prepare_v2(db, sql, -1, &stmt, NULL) == SQLITE_OK) {
-        sqlite3_bind_text(stmt, 1, ip_address, -1, SQLITE_STATIC);
-        
-        if (sqlite3_step(stmt) == SQLITE_ROW) {
-            time_t window_start = sqlite3_column_int64(stmt, 0);
-            int request_count = sqlite3_column_int(stmt, 1);
-            time_t blocked_until = sqlite3_column_int64(stmt, 2);
-            int violation_count = sqlite3_column_int(stmt, 3);
-            
-            // Check if still blocked
-            if (blocked_until > now) {
-                allowed = 0;
-                security_log(LOG_WARNING, "RATE_LIMIT_BLOCKED", 
-                           "Request from blocked IP address", ip_address);
-            }
-            // Check if window has expired
-            else if (now - window_start > RATE_LIMIT_WINDOW) {
-                // Reset window
-                const char *reset_sql = 
-                    "UPDATE rate_limits SET window_start = ?, request_count = 1, "
-                    "last_seen = ? WHERE ip_address = ?;";
-                sqlite3_stmt *reset_stmt;
-                if (sqlite3_prepare_v2(db, reset_sql, -1, &reset_stmt, NULL) == SQLITE_OK) {
-                    sqlite3_bind_int64(reset_stmt, 1, now);
-                    sqlite3_bind_int64(reset_stmt, 2, now);
-                    sqlite3_bind_text(reset_stmt, 3, ip_address, -1, SQLITE_STATIC);
-                    sqlite3_step(reset_stmt);
-                    sqlite3_finalize(reset_stmt);
-                }
-            }
-            // Check if limit exceeded
-            else if (request_count >= RATE_LIMIT_REQUESTS) {
-                allowed = 0;
-                
-                // Progressive blocking: longer blocks for repeat offenders
-                int block_duration = 300 * (violation_count + 1); // 5 min * violations
-                time_t block_until = now + block_duration;
-                
-                const char *block_sql = 
-                    "UPDATE rate_limits SET blocked_until = ?, violation_count = ?, "
-                    "last_seen = ? WHERE ip_address = ?;";
-                sqlite3_stmt *block_stmt;
-                if (sqlite3_prepare_v2(db, block_sql, -1, &block_stmt, NULL) == SQLITE_OK) {
-                    sqlite3_bind_int64(block_stmt, 1, block_until);
-                    sqlite3_bind_int(block_stmt, 2, violation_count + 1);
-                    sqlite3_bind_int64(block_stmt, 3, now);
-                    sqlite3_bind_text(block_stmt, 4, ip_address, -1, SQLITE_STATIC);
-                    sqlite3_step(block_stmt);
-                    sqlite3_finalize(block_stmt);
-                }
-                
-                security_log(LOG_SECURITY, "RATE_LIMIT_EXCEEDED", 
-                           "IP address exceeded rate limit", ip_address);
-            }
-            else {
-                // Increment counter
-                const char *inc_sql = 
-                    "UPDATE rate_limits SET request_count = request_count + 1, "
-                    "total_requests = total_requests + 1, last_seen = ? WHERE ip_address = ?;";
-                sqlite3_stmt *inc_stmt;
-                if (sqlite3_prepare_v2(db, inc_sql, -1, &inc_stmt, NULL) == SQLITE_OK) {
-                    sqlite3_bind_int64(inc_stmt, 1, now);
-                    sqlite3_bind_text(inc_stmt, 2, ip_address, -1, SQLITE_STATIC);
-                    sqlite3_step(inc_stmt);
-                    sqlite3_finalize(inc_stmt);
-                }
-            }
-        } else {
-            // First request from this IP
-            const char *insert_sql = 
-                "INSERT INTO rate_limits (ip_address, window_start, request_count, "
-                "total_requests, first_seen, last_seen) VALUES (?, ?, 1, 1, ?, ?);";
-            sqlite3_stmt *insert_stmt;
-            if (sqlite3_prepare_v2(db, insert_sql, -1, &insert_stmt, NULL) == SQLITE_OK) {
-                sqlite3_bind_text(insert_stmt, 1, ip_address, -1, SQLITE_STATIC);
-                sqlite3_bind_int64(insert_stmt, 2, now);
-                sqlite3_bind_int64(insert_stmt, 3, now);
-                sqlite3_bind_int64(insert_stmt, 4, now);
-                sqlite3_step(insert_stmt);
-                sqlite3_finalize(insert_stmt);
-            }
-        }
-    }
-    
-    sqlite3_finalize(stmt);
-    LeaveCriticalSection(&rate_limit_mutex);
+    int retry_after = 0;
+    if (rate_limiter_check(ip_address, &retry_after)) return 1;
     
-    return allowed;
+    security_log(LOG_SECURITY, "RATE_LIMIT_EXCEEDED", 
+               "IP address exceeded rate limit or is blocked", ip_address);
+    return 0;
 }
 
 // Enhanced security logging
@@ -496,7 +419,7 @@ void security_log(log_level_t level, const char *event, const char *details, con
         "VALUES (?, ?, ?, ?, ?);";
     
     sqlite3_stmt *stmt;
-    EnterCriticalSection(&db_mutex);
+    MUTEX_LOCK(db_mutex);
     
     if (sqlite3_prepare_v2(db, sql, -1, &stmt, NULL) == SQLITE_OK) {
         sqlite3_bind_text(stmt, 1, level_str, -1, SQLITE_STATIC);
@@ -508,7 +431,7 @@ void security_log(log_level_t level, const char *event, const char *details, con
     }
     
     sqlite3_finalize(stmt);
-    LeaveCriticalSection(&db_mutex);
+    MUTEX_UNLOCK(db_mutex);
     
     // Also log to file for backup
     FILE *log_file = fopen("security.log", "a");
@@ -542,7 +465,9 @@ void send_security_headers(int client_socket) {
     send(client_socket, SECURITY_HEADERS, strlen(SECURITY_HEADERS), 0);
 }
 
-// Enhanced session management with CSRF protection
+// Enhanced session management with CSRF protection. Sessions are served
+// from an in-memory LRU (session_cache.c); the table is written on create
+// and delete, and last_accessed is flushed in batches by cleanup.
 int create_secure_session(const char *user_id, const char *ip_address, char *session_id, char *csrf_token) {
     generate_session_id(session_id, 65);
     generate_csrf_token(csrf_token, 33);
@@ -555,7 +480,7 @@ int create_secure_session(const char *user_id, const char *ip_address, char *ses
         "VALUES (?, ?, ?, ?, ?);";
     
     sqlite3_stmt *stmt;
-    EnterCriticalSection(&session_mutex);
+    MUTEX_LOCK(session_mutex);
     
     int result = 0;
     if (sqlite3_prepare_v2(db, sql, -1, &stmt, NULL) == SQLITE_OK) {
@@ -567,87 +492,90 @@ int create_secure_session(const char *user_id, const char *ip_address, char *ses
         
         if (sqlite3_step(stmt) == SQLITE_DONE) {
             result = 1;
+            
+            // Write-through under session_mutex, which also orders it against a loading miss
+            session_entry_t entry = {0};
+            snprintf(entry.session_id, sizeof(entry.session_id), "%s", session_id);
+            snprintf(entry.user_id, sizeof(entry.user_id), "%s", user_id);
+            snprintf(entry.csrf_token, sizeof(entry.csrf_token), "%s", csrf_token);
+            snprintf(entry.ip_address, sizeof(entry.ip_address), "%s", ip_address);
+            entry.created_at = entry.last_accessed = now;
+            entry.expires_at = expires_at;
+            entry.is_active = 1;
+            session_cache_put(session_id, &entry, now, 0);
+            
             security_log(LOG_INFO, "SESSION_CREATED", "New secure session created", ip_address);
         }
     }
     
     sqlite3_finalize(stmt);
-    LeaveCriticalSection(&session_mutex);
+    MUTEX_UNLOCK(session_mutex);
     
     return result;
 }
 
-int validate_session(const char *session_id, const char *ip_address) {
-    if (!session_id || !ip_address) return 0;
-    
+// Active, unexpired session from the cache, or loaded into it from the table
+static int load_session(const char *session_id, session_entry_t *entry) {
     time_t now = time(NULL);
+    if (session_cache_get(session_id, entry, now)) return entry->is_active && entry->expires_at > now;
     
     const char *sql = 
-        "SELECT user_id, ip_address, expires_at, is_active FROM sessions "
+        "SELECT user_id, csrf_token, ip_address, created_at, expires_at, is_active FROM sessions "
         "WHERE session_id = ? AND expires_at > ?;";
     
     sqlite3_stmt *stmt;
-    EnterCriticalSection(&session_mutex);
+    MUTEX_LOCK(session_mutex);
     
-    int valid = 0;
+    int found = 0;
     if (sqlite3_prepare_v2(db, sql, -1, &stmt, NULL) == SQLITE_OK) {
         sqlite3_bind_text(stmt, 1, session_id, -1, SQLITE_STATIC);
         sqlite3_bind_int64(stmt, 2, now);
         
         if (sqlite3_step(stmt) == SQLITE_ROW) {
-            const char *stored_ip = (const char*)sqlite3_column_text(stmt, 1);
-            int is_active = sqlite3_column_int(stmt, 3);
+            const char *user_id = (const char*)sqlite3_column_text(stmt, 0);
+            const char *csrf_token = (const char*)sqlite3_column_text(stmt, 1);
+            const char *ip_address = (const char*)sqlite3_column_text(stmt, 2);
             
-            // Validate IP address and active status
-            if (strcmp(stored_ip, ip_address) == 0 && is_active) {
-                valid = 1;
-                
-                // Update last accessed time
-                const char *update_sql = 
-                    "UPDATE sessions SET last_accessed = ? WHERE session_id = ?;";
-                sqlite3_stmt *update_stmt;
-                if (sqlite3_prepare_v2(db, update_sql, -1, &update_stmt, NULL) == SQLITE_OK) {
-                    sqlite3_bind_int64(update_stmt, 1, now);
-                    sqlite3_bind_text(update_stmt, 2, session_id, -1, SQLITE_STATIC);
-                    sqlite3_step(update_stmt);
-                    sqlite3_finalize(update_stmt);
-                }
-            } else {
-                security_log(LOG_WARNING, "SESSION_IP_MISMATCH", 
-                           "Session used from different IP", ip_address);
-            }
+            memset(entry, 0, sizeof(*entry));
+            snprintf(entry->session_id, sizeof(entry->session_id), "%s", session_id);
+            snprintf(entry->user_id, sizeof(entry->user_id), "%s", user_id ? user_id : "");
+            snprintf(entry->csrf_token, sizeof(entry->csrf_token), "%s", csrf_token ? csrf_token : "");
+            snprintf(entry->ip_address, sizeof(entry->ip_address), "%s", ip_address ? ip_address : "");
+            entry->created_at = sqlite3_column_int64(stmt, 3);
+            entry->expires_at = sqlite3_column_int64(stmt, 4);
+            entry->is_active = sqlite3_column_int(stmt, 5);
+            entry->last_accessed = now;
+            session_cache_put(session_id, entry, now, 1);
+            found = entry->is_active;
         }
     }
     
     sqlite3_finalize(stmt);
-    LeaveCriticalSection(&session_mutex);
+    MUTEX_UNLOCK(session_mutex);
     
-    return valid;
+    return found;
 }
 
-int validate_csrf_token(const char *session_id, const char *provided_token) {
-    if (!session_id || !provided_token) return 0;
-    
-    const char *sql = 
-        "SELECT csrf_token FROM sessions WHERE session_id = ? AND is_active = 1;";
+int validate_session(const char *session_id, const char *ip_address) {
+    if (!session_id || !ip_address) return 0;
     
-    sqlite3_stmt *stmt;
-    EnterCriticalSection(&session_mutex);
+    session_entry_t entry;
+    if (!load_session(session_id, &entry)) return 0;
     
-    int valid = 0;
-    if (sqlite3_prepare_v2(db, sql, -1, &stmt, NULL) == SQLITE_OK) {
-        sqlite3_bind_text(stmt, 1, session_id, -1, SQLITE_STATIC);
-        
-        if (sqlite3_step(stmt) == SQLITE_ROW) {
-            const char *stored_token = (const char*)sqlite3_column_text(stmt, 0);
-            if (strcmp(stored_token, provided_token) == 0) {
-                valid = 1;
-            }
-        }
+    // Validate IP address; the access itself is recorded by the cache
+    if (strcmp(entry.ip_address, ip_address) != 0) {
+        security_log(LOG_WARNING, "SESSION_IP_MISMATCH", 
+                   "Session used from different IP", ip_address);
+        return 0;
     }
+    return 1;
+}
+
+int validate_csrf_token(const char *session_id, const char *provided_token) {
+    if (!session_id || !provided_token) return 0;
     
-    sqlite3_finalize(stmt);
-    LeaveCriticalSection(&session_mutex);
+    session_entry_t entry;
+    int valid = load_session(session_id, &entry) && strcmp(entry.csrf_token, provided_token) == 0;
     
     if (!valid) {
         security_log(LOG_SECURITY, "CSRF_TOKEN_INVALID", 
@@ -660,24 +588,41 @@ int validate_csrf_token(const char *session_id, const char *provided_token) {
 void cleanup_expired_sessions(void) {
     time_t now = time(NULL);
     
+    const char *update_sql = "UPDATE sessions SET last_accessed = ? WHERE session_id = ?;";
     const char *sql = "DELETE FROM sessions WHERE expires_at <= ?;";
     
     sqlite3_stmt *stmt;
-    EnterCriticalSection(&session_mutex);
+    MUTEX_LOCK(session_mutex);
+    
+    // Batched last_accessed writes for the sessions used since the last cleanup
+    SessionAccess *accesses;
+    int count = session_cache_take_accesses(&accesses);
+    sqlite3_exec(db, "BEGIN;", 0, 0, 0);
+    if (count > 0 && sqlite3_prepare_v2(db, update_sql, -1, &stmt, NULL) == SQLITE_OK) {
+        for (int i = 0; i < count; i++) {
+            sqlite3_bind_int64(stmt, 1, accesses[i].last_access);
+            sqlite3_bind_text(stmt, 2, accesses[i].session_id, -1, SQLITE_STATIC);
+            sqlite3_step(stmt);
+            sqlite3_reset(stmt);
+        }
+        sqlite3_finalize(stmt);
+    }
+    sqlite3_exec(db, "COMMIT;", 0, 0, 0);
+    free(accesses);
     
+    // Expired sessions also expire in the cache, which checks expires_at on every hit
     if (sqlite3_prepare_v2(db, sql, -1, &stmt, NULL) == SQLITE_OK) {
         sqlite3_bind_int64(stmt, 1, now);
+        sqlite3_step(stmt);
         
         int deleted = sqlite3_changes(db);
         if (deleted > 0) {
             printf("Cleaned up %d expired sessions\n", deleted);
         }
-        
-        sqlite3_step(stmt);
     }
     
     sqlite3_finalize(stmt);
-    LeaveCriticalSection(&session_mutex);
+    MUTEX_UNLOCK(session_mutex);
 }
 
 // Main server with security enhancements
@@ -693,9 +638,20 @@ int main() {
     
     // Initialize critical sections
     InitializeCriticalSection(&db_mutex);
-    InitializeCriticalSection(&rate_limit_mutex);
     InitializeCriticalSection(&session_mutex);
     
+    RateLimiterConfig rate_config;
+    rate_limiter_config_defaults(&rate_config);
+    rate_config.requests_per_minute = RATE_LIMIT_REQUESTS * 60 / RATE_LIMIT_WINDOW;
+    rate_config.block_seconds = RATE_LIMIT_BLOCK_SECONDS;
+    rate_limiter_init(&rate_config);
+    
+    SessionCacheConfig session_config;
+    session_config.capacity = SESSION_CACHE_CAPACITY;
+    session_config.value_size = sizeof(session_entry_t);
+    session_config.ttl_seconds = SESSION_TIMEOUT;
+    session_cache_init(&session_config);
+    
     // Initialize secure database
     if (init_database_secure() != SQLITE_OK) {
         printf("Failed to initialize secure database\n");
@@ -757,10 +713,11 @@ int main() {
     printf("Server ready for secure connections...\n");
     
     // Cleanup
+    // Contention totals for the whole run, once no request holds a lock
+    lock_stats_dump(stdout);
     closesocket(server_socket);
     sqlite3_close(db);
     DeleteCriticalSection(&db_mutex);
-    DeleteCriticalSection(&rate_limit_mutex);
     DeleteCriticalSection(&session_mutex);
     WSACleanup();
     
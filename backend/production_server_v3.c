@@ -5,31 +5,50 @@
  * Features:
  * - SQLite database integration for persistent storage
  * - Enhanced security with rate limiting and encryption
- * - Session management with database persistence
+ * - Session management with database persistence behind an LRU cache (session_cache.c)
  * - User authentication with hashed passwords
  * - Task management with CRUD operations
- * - Multi-threading support for high concurrency
+ * - epoll reactors with a fixed worker pool for high concurrency (event_loop.c)
+ * - HTTP/1.1 keep-alive with pipelined requests answered in order
+ * - Route table compiled at startup into a segment trie (router.c)
+ * - Responses sent as one gathered write of pre-rendered pieces (http_response.c)
+ * - Frontend served from disk with sendfile and cached descriptors (static_files.c)
  * - Production-ready error handling and logging
  */
 
+#ifdef _WIN32
+    #define _CRT_RAND_S  // rand_s
+#endif
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdarg.h>
 #include <time.h>
 #include "sqlite3.h"
+#include "query_stats.h"
+#include "task_graph.h"
+#include "interval_tree.h"
+#include "autoslot.h"
+#include "recurrence.h"
+#include "http_parser.h"
+#include "http_response.h"
+#include "event_loop.h"
+#include "router.h"
+#include "rate_limiter.h"
+#include "session_cache.h"
+#include "json_body.h"
+#include "http_compress.h"
+#include "static_files.h"
 
 #ifdef _WIN32
     #include <winsock2.h>
+    #include <ws2tcpip.h>
     #include <windows.h>
-    #include <process.h>
     #pragma comment(lib, "ws2_32.lib")
     #define close closesocket
     #define sleep(x) Sleep((x) * 1000)
-    typedef HANDLE thread_t;
     typedef CRITICAL_SECTION mutex_t;
-    #define THREAD_CREATE(thread, func, arg) do { \
-        thread = (HANDLE)_beginthreadex(NULL, 0, func, arg, 0, NULL); \
-    } while(0)
     #define MUTEX_INIT(mutex) InitializeCriticalSection(&mutex)
     #define MUTEX_LOCK(mutex) EnterCriticalSection(&mutex)
     #define MUTEX_UNLOCK(mutex) LeaveCriticalSection(&mutex)
@@ -39,14 +58,27 @@
     #include <arpa/inet.h>
     #include <unistd.h>
     #include <pthread.h>
-    typedef pthread_t thread_t;
     typedef pthread_mutex_t mutex_t;
-    #define THREAD_CREATE(thread, func, arg) (pthread_create(&thread, NULL, func, arg) == 0)
     #define MUTEX_INIT(mutex) pthread_mutex_init(&mutex, NULL)
     #define MUTEX_LOCK(mutex) pthread_mutex_lock(&mutex)
     #define MUTEX_UNLOCK(mutex) pthread_mutex_unlock(&mutex)
 #endif
 
+#ifdef _MSC_VER
+    #define THREAD_LOCAL __declspec(thread)
+#else
+    #define THREAD_LOCAL __thread
+#endif
+
+// Route locking through the contention instrumentation unless compiled out
+#include "lock_stats.h"
+#ifndef DISABLE_LOCK_STATS
+    #undef MUTEX_LOCK
+    #undef MUTEX_UNLOCK
+    #define MUTEX_LOCK(mutex) LOCK_STATS_LOCK(mutex)
+    #define MUTEX_UNLOCK(mutex) LOCK_STATS_UNLOCK(mutex)
+#endif
+
 // Configuration Constants
 #define PORT 3000
 #define BUFFER_SIZE 8192
@@ -54,22 +86,60 @@
 #define MAX_SESSIONS 500
 #define MAX_TASKS 10000
 #define SESSION_TIMEOUT 3600  // 1 hour
-#define RATE_LIMIT_WINDOW 60  // 60 seconds
-#define RATE_LIMIT_MAX_REQUESTS 100
+#define SESSION_CACHE_DEFAULT 10000     // Sessions held in memory
+#define SESSION_FLUSH_INTERVAL 15       // Seconds between batched last_activity writes
+#define RATE_LIMIT_EVICT_INTERVAL 60   // Seconds between sweeps for idle client addresses
 #define OTP_LENGTH 6
 #define OTP_TIMEOUT 300  // 5 minutes
+#define OTP_MAX_ATTEMPTS 5
 #define SALT_LENGTH 32
 #define HASH_LENGTH 64
 
 // Database Constants
 #define DB_FILE "task_scheduler.db"
 #define MAX_QUERY_LENGTH 2048
+#define SLOW_QUERY_MS 1000  // performance.log_slow_queries_ms
+#define DB_SCHEMA_VERSION 1   // PRAGMA user_version; see migrate_database_tables()
+
+// Dependency graphs (task_dependencies), loaded per user on first use
+#define MAX_CACHED_GRAPHS 256
+#define MAX_READY_IDS 512     // Ids listed per response; the count is always exact
+
+// Auto-slotting (POST /api/tasks/autoslot)
+#define AUTOSLOT_MAX_TASKS 5000
+#define AUTOSLOT_MAX_DAYS 60
+#define AUTOSLOT_DEFAULT_DURATION_MIN 30  // Pending tasks without estimated_duration
+#define AUTOSLOT_MAX_LISTED 100           // Placements listed per response
+
+// Schedule conflicts
+#define MAX_CACHED_SCHEDULES 256
+#define MAX_CONFLICTS_LISTED 100          // Conflicts listed per response; the count is always exact
+
+// Calendar
+#define CALENDAR_MAX_DAYS 366
+#define CALENDAR_PAGE_SIZE 256            // One-off rows read per db_mutex hold
+#define TASKS_PAGE_DEFAULT 50             // GET /api/tasks page size without ?limit=
+#define TASKS_PAGE_MAX 200
+#define CALENDAR_MAX_SERIES 1000          // Recurring tasks expanded per request
+#define CALENDAR_MAX_EVENTS 20000         // Events per response before "truncated"
+#define STREAM_CHUNK_SIZE 4096
+
+// Conditional GETs of task lists
+#define TASK_VERSION_SLOTS 16384          // Power of two; users hash onto version counters
+#define ETAG_HEADERS_SIZE 128
 
 // Global Variables
 static sqlite3 *db = NULL;
 static mutex_t db_mutex;
-static mutex_t session_mutex;
-static mutex_t rate_limit_mutex;
+static mutex_t graph_mutex;  // Taken before db_mutex, never after
+static mutex_t schedule_mutex;  // Taken before db_mutex; never held with graph_mutex
+
+// Bumped after every committed change to a user's tasks or dependencies, so
+// an unchanged version proves an unchanged list. Users sharing a slot only
+// cost each other a refetch, never a stale 304. Versions restart with the
+// process; the start time in the ETag keeps old tags from matching.
+static unsigned long long task_versions[TASK_VERSION_SLOTS];
+static long long task_version_epoch;
 
 // Structures
 typedef struct {
@@ -103,6 +173,9 @@ typedef struct {
     char priority[20];  // high, medium, low
     char status[20];    // pending, running, completed
     time_t scheduled_time;
+    time_t start_time;      // 0 = not slotted
+    time_t end_time;
+    int estimated_duration; // Minutes, 0 = unknown
     time_t created_at;
     time_t updated_at;
     int is_recurring;
@@ -122,9 +195,61 @@ typedef struct {
     int attempts;
 } OTPEntry;
 
+typedef struct {
+    TaskGraph graph;
+    int loaded;
+    time_t last_used;
+} CachedGraph;
+
+// Busy time of one user's unfinished tasks that have a start_time/end_time
+typedef struct {
+    IntervalTree tree;
+    int user_id;
+    int loaded;
+    time_t last_used;
+} CachedSchedule;
+
+// JSON response body produced piece by piece. One that fits the buffer is
+// sent whole with a Content-Length; a longer one goes out chunked as it is
+// produced, STREAM_CHUNK_SIZE (or one compressed block) at a time.
+typedef struct {
+    int socket;
+    int status_code;
+    int length;
+    int started;                 // Headers are out and the body is going chunked
+    int failed;                  // The client went away; further writes are dropped
+    HttpDeflater deflater;       // Active while a chunked body is compressed
+    char buffer[STREAM_CHUNK_SIZE];
+} ResponseStream;
+
+// One calendar entry: a one-off task or one occurrence of a recurring task
+typedef struct {
+    int task_id;
+    long long time;
+    int duration;                // Seconds, 0 = unknown
+    char title[256];
+    char priority[20];
+    char status[20];
+} CalendarEvent;
+
+// A recurring task being expanded; next is its earliest unsent occurrence
+typedef struct {
+    CalendarEvent event;
+    Recurrence rule;
+} CalendarSeries;
+
+// What route handlers need from the request besides the socket
+typedef struct {
+    const char *path;            // Target as sent, query string included
+    const char *body;
+    const HttpRequest *request;
+    const char *ip_address;
+} RouteContext;
+
 // Function Prototypes
 int initialize_database();
 int create_database_tables();
+int migrate_database_tables();
 void cleanup_database();
 
 // User Management
@@ -137,44 +262,72 @@ int lock_user_account(int user_id, int duration);
 // Session Management
 int create_session(const Session *session);
 int get_session(const char *session_id, Session *session);
-int update_session_activity(const char *session_id);
+int authenticate_session(const char *session_id);
+int store_login_otp(const char *email, const char *otp);
+int verify_login_otp(int user_id, const char *otp);
+void flush_session_activity(void);
 int delete_session(const char *session_id);
 void cleanup_expired_sessions();
 
 // Task Management
 int create_task(const Task *task);
-int get_user_tasks(int user_id, Task **tasks, int *count);
+int get_user_tasks(int user_id, int after_id, int limit, Task *page);
 int update_task(const Task *task);
 int delete_task(int task_id, int user_id);
 int get_task_by_id(int task_id, int user_id, Task *task);
 
+// Dependency Graph
+TaskGraph* get_task_graph(int user_id);
+void invalidate_task_graph(int user_id);
+int task_status_to_state(const char *status);
+
+// Schedule conflicts
+IntervalTree* get_task_schedule(int user_id);
+void schedule_task_moved(int user_id, int task_id, long long old_start, long long start, long long end);
+void invalidate_task_schedule(int user_id);
+int find_schedule_conflicts(int user_id, long long start, long long end, int exclude_id, Interval *out, int max);
+
 // Utility Functions
 void generate_random_string(char *str, int length);
 void hash_password(const char *password, const char *salt, char *hash);
 int verify_password(const char *password, const char *salt, const char *hash);
 void generate_session_id(char *session_id);
 void generate_otp(char *otp);
-char* extract_json_value(const char *json, const char *key);
+int authenticated_user_id(const HttpRequest *request);
+long long extract_query_int64(const char *path, const char *name, long long default_value);
 void send_json_response(int client_socket, int status_code, const char *json_data);
 void send_json_error(int client_socket, int status_code, const char *message);
-int check_rate_limit(const char *ip_address);
+void json_escape(const char *input, char *output, size_t size);
+void stream_begin(ResponseStream *stream, int client_socket, int status_code);
+void stream_printf(ResponseStream *stream, const char *format, ...);
+void stream_end(ResponseStream *stream);
+void write_rate_limit_summary(void);
 
 // HTTP Handlers
 void handle_register(int client_socket, const char *body, const char *ip_address);
 void handle_login_step1(int client_socket, const char *body, const char *ip_address);
 void handle_login_step2(int client_socket, const char *body, const char *ip_address);
-void handle_login_step3(int client_socket, const char *body, const char *ip_address);
-void handle_create_task(int client_socket, const char *body, const char *authorization);
-void handle_get_tasks(int client_socket, const char *authorization);
-void handle_update_task(int client_socket, const char *body, const char *authorization);
-void handle_delete_task(int client_socket, const char *body, const char *authorization);
+void handle_create_task(int client_socket, const char *body, const HttpRequest *request);
+void handle_get_tasks(int client_socket, const char *path, const HttpRequest *request);
+void handle_update_task(int client_socket, int task_id, const char *body, const HttpRequest *request);
+void handle_delete_task(int client_socket, int task_id, const HttpRequest *request);
 void handle_health_check(int client_socket);
+void handle_query_stats(int client_socket);
+void handle_lock_stats(int client_socket);
+void handle_get_ready_tasks(int client_socket, const HttpRequest *request);
+void handle_add_dependency(int client_socket, const char *body, const HttpRequest *request);
+void handle_set_task_state(int client_socket, const char *body, const HttpRequest *request, const char *status);
+void handle_autoslot(int client_socket, const char *body, const HttpRequest *request);
+void handle_get_conflicts(int client_socket, const char *path, const HttpRequest *request);
+void handle_get_calendar(int client_socket, const char *path, const HttpRequest *request);
 
 // Server Functions
-unsigned int WINAPI handle_client(void *client_socket_ptr);
-char* extract_client_ip(const char *request);
-char* extract_user_agent(const char *request);
-void route_request(int client_socket, const char *method, const char *path, const char *body, const char *headers);
+void handle_request(int client_socket, HttpRequest *request);
+void run_housekeeping(void);
+void extract_client_ip(int client_socket, char *ip, size_t size);
+void extract_user_agent(const HttpRequest *request, char *user_agent, size_t size);
+void build_routes(void);
+void route_request(int client_socket, const char *method, const char *path, const char *body, const HttpRequest *request);
 
 // Database Implementation
 
@@ -187,6 +340,10 @@ int initialize_database() {
     
     printf("✅ SQLite database opened successfully\n");
     
+    // Time every statement; slow ones are logged with their bound values
+    query_stats_init(SLOW_QUERY_MS);
+    query_stats_attach(db);
+    
     // Enable foreign keys
     sqlite3_exec(db, "PRAGMA foreign_keys = ON;", 0, 0, 0);
     
@@ -197,6 +354,8 @@ int initialize_database() {
     }
     
     MUTEX_INIT(db_mutex);
+    MUTEX_INIT(graph_mutex);
+    MUTEX_INIT(schedule_mutex);
     printf("✅ Database initialized with persistent storage\n");
     return 1;
 }
@@ -242,6 +401,9 @@ int create_database_tables() {
         "priority TEXT DEFAULT 'medium',"
         "status TEXT DEFAULT 'pending',"
         "scheduled_time INTEGER,"
+        "start_time INTEGER,"
+        "end_time INTEGER,"
+        "estimated_duration INTEGER,"
         "created_at INTEGER DEFAULT (strftime('%s', 'now')),"
         "updated_at INTEGER DEFAULT (strftime('%s', 'now')),"
         "is_recurring INTEGER DEFAULT 0,"
@@ -249,6 +411,20 @@ int create_database_tables() {
         "FOREIGN KEY (user_id) REFERENCES users (user_id)"
         ");";
     
+    // Task dependencies table
+    const char *create_dependencies_sql = 
+        "CREATE TABLE IF NOT EXISTS task_dependencies ("
+        "id INTEGER PRIMARY KEY AUTOINCREMENT,"
+        "task_id INTEGER NOT NULL,"
+        "depends_on_task_id INTEGER NOT NULL,"
+        "dependency_type TEXT DEFAULT 'finish_to_start' CHECK (dependency_type IN "
+        "('finish_to_start', 'start_to_start', 'finish_to_finish', 'start_to_finish')),"
+        "created_at INTEGER DEFAULT (strftime('%s', 'now')),"
+        "FOREIGN KEY (task_id) REFERENCES tasks (task_id) ON DELETE CASCADE,"
+        "FOREIGN KEY (depends_on_task_id) REFERENCES tasks (task_id) ON DELETE CASCADE,"
+        "UNIQUE(task_id, depends_on_task_id)"
+        ");";
+    
     // OTP table
     const char *create_otp_sql = 
         "CREATE TABLE IF NOT EXISTS otp_codes ("
@@ -277,6 +453,10 @@ int create_database_tables() {
         "CREATE INDEX IF NOT EXISTS idx_tasks_user_id ON tasks(user_id);",
         "CREATE INDEX IF NOT EXISTS idx_tasks_status ON tasks(status);",
         "CREATE INDEX IF NOT EXISTS idx_tasks_scheduled_time ON tasks(scheduled_time);",
+        "CREATE INDEX IF NOT EXISTS idx_tasks_user_start ON tasks(user_id, start_time);",
+        "CREATE INDEX IF NOT EXISTS idx_tasks_user_scheduled ON tasks(user_id, scheduled_time);",
+        "CREATE INDEX IF NOT EXISTS idx_task_deps_task_id ON task_dependencies(task_id);",
+        "CREATE INDEX IF NOT EXISTS idx_task_deps_depends_on ON task_dependencies(depends_on_task_id);",
         "CREATE INDEX IF NOT EXISTS idx_otp_email ON otp_codes(email);",
         "CREATE INDEX IF NOT EXISTS idx_rate_limits_window ON rate_limits(window_start);",
         NULL
@@ -285,7 +465,7 @@ int create_database_tables() {
     // Execute table creation queries
     const char *tables[] = {
         create_users_sql, create_sessions_sql, create_tasks_sql, 
-        create_otp_sql, create_rate_limit_sql, NULL
+        create_dependencies_sql, create_otp_sql, create_rate_limit_sql, NULL
     };
     
     for (int i = 0; tables[i] != NULL; i++) {
@@ -297,6 +477,10 @@ int create_database_tables() {
         }
     }
     
+    if (!migrate_database_tables()) {
+        return 0;
+    }
+    
     // Create indexes
     for (int i = 0; create_indexes_sql[i] != NULL; i++) {
         sqlite3_exec(db, create_indexes_sql[i], 0, 0, 0);
@@ -306,6 +490,37 @@ int create_database_tables() {
     return 1;
 }
 
+// Brings databases created by older builds up to DB_SCHEMA_VERSION
+int migrate_database_tables() {
+    sqlite3_stmt *stmt;
+    int version = 0;
+    
+    if (sqlite3_prepare_v2(db, "PRAGMA user_version;", -1, &stmt, NULL) != SQLITE_OK) {
+        return 0;
+    }
+    if (sqlite3_step(stmt) == SQLITE_ROW) {
+        version = sqlite3_column_int(stmt, 0);
+    }
+    sqlite3_finalize(stmt);
+    
+    if (version >= DB_SCHEMA_VERSION) return 1;
+    
+    // Version 1: time blocks for auto-slotting. A fresh database already has
+    // these columns from CREATE TABLE, so "duplicate column" errors are expected.
+    if (version < 1) {
+        sqlite3_exec(db, "ALTER TABLE tasks ADD COLUMN start_time INTEGER;", 0, 0, 0);
+        sqlite3_exec(db, "ALTER TABLE tasks ADD COLUMN end_time INTEGER;", 0, 0, 0);
+        sqlite3_exec(db, "ALTER TABLE tasks ADD COLUMN estimated_duration INTEGER;", 0, 0, 0);
+    }
+    
+    char version_sql[64];
+    snprintf(version_sql, sizeof(version_sql), "PRAGMA user_version = %d;", DB_SCHEMA_VERSION);
+    sqlite3_exec(db, version_sql, 0, 0, 0);
+    
+    printf("✅ Database schema migrated from version %d to %d\n", version, DB_SCHEMA_VERSION);
+    return 1;
+}
+
 void cleanup_database() {
     if (db) {
         sqlite3_close(db);
@@ -447,18 +662,31 @@ int create_session(const Session *session) {
     rc = sqlite3_step(stmt);
     sqlite3_finalize(stmt);
     
+    // Write-through while db_mutex still orders this against a concurrent miss
+    if (rc == SQLITE_DONE) {
+        Session cached = *session;
+        cached.created_at = cached.last_activity = time(NULL);
+        session_cache_put(cached.session_id, &cached, cached.last_activity, 0);
+    }
+    
     MUTEX_UNLOCK(db_mutex);
     
     return (rc == SQLITE_DONE) ? 1 : 0;
 }
 
-// Task Management Implementation
-
-int create_task(const Task *task) {
+// Answered from the session cache when it can be; a hit records the access
+// for the next batched flush instead of writing it
+int get_session(const char *session_id, Session *session) {
+    time_t now = time(NULL);
+    if (session_cache_get(session_id, session, now)) {
+        session->last_activity = now;
+        return 1;
+    }
+    
     const char *sql = 
-        "INSERT INTO tasks "
-        "(user_id, title, description, priority, status, scheduled_time, is_recurring, recurrence_pattern) "
-        "VALUES (?, ?, ?, ?, ?, ?, ?, ?);";
+        "SELECT session_id, user_id, created_at, last_activity, is_authenticated, "
+        "ip_address, user_agent FROM sessions "
+        "WHERE session_id = ? AND last_activity >= ?;";
     
     sqlite3_stmt *stmt;
     
@@ -470,292 +698,2059 @@ int create_task(const Task *task) {
         return 0;
     }
     
-    sqlite3_bind_int(stmt, 1, task->user_id);
-    sqlite3_bind_text(stmt, 2, task->title, -1, SQLITE_STATIC);
-    sqlite3_bind_text(stmt, 3, task->description, -1, SQLITE_STATIC);
-    sqlite3_bind_text(stmt, 4, task->priority, -1, SQLITE_STATIC);
-    sqlite3_bind_text(stmt, 5, task->status, -1, SQLITE_STATIC);
-    sqlite3_bind_int64(stmt, 6, task->scheduled_time);
-    sqlite3_bind_int(stmt, 7, task->is_recurring);
-    sqlite3_bind_text(stmt, 8, task->recurrence_pattern, -1, SQLITE_STATIC);
+    sqlite3_bind_text(stmt, 1, session_id, -1, SQLITE_STATIC);
+    sqlite3_bind_int64(stmt, 2, now - SESSION_TIMEOUT);
     
-    rc = sqlite3_step(stmt);
+    int found = 0;
+    if (sqlite3_step(stmt) == SQLITE_ROW) {
+        const char *ip = (const char*)sqlite3_column_text(stmt, 5);
+        const char *agent = (const char*)sqlite3_column_text(stmt, 6);
+        
+        memset(session, 0, sizeof(*session));
+        snprintf(session->session_id, sizeof(session->session_id), "%s", session_id);
+        session->user_id = sqlite3_column_int(stmt, 1);
+        session->created_at = sqlite3_column_int64(stmt, 2);
+        session->last_activity = sqlite3_column_int64(stmt, 3);
+        session->is_authenticated = sqlite3_column_int(stmt, 4);
+        snprintf(session->ip_address, sizeof(session->ip_address), "%s", ip ? ip : "");
+        snprintf(session->user_agent, sizeof(session->user_agent), "%s", agent ? agent : "");
+        found = 1;
+    }
     sqlite3_finalize(stmt);
     
+    // Filled under db_mutex, so a delete cannot slip in between the read and the put
+    if (found) {
+        session->last_activity = now;
+        session_cache_put(session_id, session, now, 1);
+    }
+    
     MUTEX_UNLOCK(db_mutex);
     
-    return (rc == SQLITE_DONE) ? sqlite3_last_insert_rowid(db) : 0;
+    return found;
 }
 
-// Utility Functions Implementation
-
-void generate_random_string(char *str, int length) {
-    const char charset[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789";
-    srand((unsigned int)time(NULL));
+int delete_session(const char *session_id) {
+    const char *sql = "DELETE FROM sessions WHERE session_id = ?;";
+    sqlite3_stmt *stmt;
     
-    for (int i = 0; i < length; i++) {
-        str[i] = charset[rand() % (sizeof(charset) - 1)];
-    }
-    str[length] = '\0';
-}
-
-void hash_password(const char *password, const char *salt, char *hash) {
-    // Simple hash implementation (in production, use bcrypt or Argon2)
-    char combined[512];
-    snprintf(combined, sizeof(combined), "%s%s", password, salt);
+    MUTEX_LOCK(db_mutex);
     
-    // Basic hash (should be replaced with proper hashing in production)
-    unsigned long hash_value = 5381;
-    for (int i = 0; combined[i]; i++) {
-        hash_value = ((hash_value << 5) + hash_value) + combined[i];
+    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
+    if (rc == SQLITE_OK) {
+        sqlite3_bind_text(stmt, 1, session_id, -1, SQLITE_STATIC);
+        rc = sqlite3_step(stmt);
+        sqlite3_finalize(stmt);
     }
+    if (rc == SQLITE_DONE) session_cache_remove(session_id);
     
-    snprintf(hash, HASH_LENGTH + 1, "%016lx%016lx%016lx%016lx", 
-             hash_value, hash_value * 31, hash_value * 37, hash_value * 41);
-}
-
-int verify_password(const char *password, const char *salt, const char *stored_hash) {
-    char computed_hash[HASH_LENGTH + 1];
-    hash_password(password, salt, computed_hash);
-    return strcmp(computed_hash, stored_hash) == 0;
-}
-
-void generate_session_id(char *session_id) {
-    generate_random_string(session_id, 48);
+    MUTEX_UNLOCK(db_mutex);
+    
+    return rc == SQLITE_DONE;
 }
 
-void generate_otp(char *otp) {
-    srand((unsigned int)time(NULL));
-    for (int i = 0; i < OTP_LENGTH; i++) {
-        otp[i] = '0' + (rand() % 10);
+// Writes the last_activity of every session used since the previous flush,
+// in one transaction. Runs before expired rows are deleted, so a session in
+// use is never removed for looking idle in the table.
+void flush_session_activity(void) {
+    SessionAccess *accesses;
+    int count = session_cache_take_accesses(&accesses);
+    
+    if (count > 0) {
+        const char *sql = "UPDATE sessions SET last_activity = ? WHERE session_id = ? AND last_activity < ?;";
+        sqlite3_stmt *stmt;
+        
+        MUTEX_LOCK(db_mutex);
+        sqlite3_exec(db, "BEGIN;", 0, 0, 0);
+        if (sqlite3_prepare_v2(db, sql, -1, &stmt, NULL) == SQLITE_OK) {
+            for (int i = 0; i < count; i++) {
+                sqlite3_bind_int64(stmt, 1, accesses[i].last_access);
+                sqlite3_bind_text(stmt, 2, accesses[i].session_id, -1, SQLITE_STATIC);
+                sqlite3_bind_int64(stmt, 3, accesses[i].last_access);
+                sqlite3_step(stmt);
+                sqlite3_reset(stmt);
+            }
+            sqlite3_finalize(stmt);
+        }
+        sqlite3_exec(db, "COMMIT;", 0, 0, 0);
+        MUTEX_UNLOCK(db_mutex);
     }
-    otp[OTP_LENGTH] = '\0';
+    
+    free(accesses);
 }
 
-// HTTP Response Functions
-
-void send_json_response(int client_socket, int status_code, const char *json_data) {
-    char response[BUFFER_SIZE];
+// Marks a session fully authenticated once its OTP has been verified
+int authenticate_session(const char *session_id) {
+    const char *sql = "UPDATE sessions SET is_authenticated = 1 WHERE session_id = ?;";
+    sqlite3_stmt *stmt;
+    int done = 0;
     
-    const char *status_text = "OK";
-    if (status_code == 400) status_text = "Bad Request";
-    else if (status_code == 401) status_text = "Unauthorized";
-    else if (status_code == 429) status_text = "Too Many Requests";
-    else if (status_code == 500) status_text = "Internal Server Error";
+    MUTEX_LOCK(db_mutex);
     
-    snprintf(response, sizeof(response),
-        "HTTP/1.1 %d %s\r\n"
-        "Content-Type: application/json\r\n"
-        "Access-Control-Allow-Origin: *\r\n"
-        "Access-Control-Allow-Methods: GET, POST, PUT, DELETE, OPTIONS\r\n"
-        "Access-Control-Allow-Headers: Content-Type, Authorization\r\n"
-        "Content-Length: %d\r\n"
-        "\r\n"
-        "%s",
-        status_code, status_text, (int)strlen(json_data), json_data);
+    if (sqlite3_prepare_v2(db, sql, -1, &stmt, NULL) == SQLITE_OK) {
+        sqlite3_bind_text(stmt, 1, session_id, -1, SQLITE_STATIC);
+        done = sqlite3_step(stmt) == SQLITE_DONE && sqlite3_changes(db) == 1;
+        sqlite3_finalize(stmt);
+    }
+    // The cached copy is still unauthenticated; the next lookup reloads the row
+    if (done) session_cache_remove(session_id);
     
-    send(client_socket, response, strlen(response), 0);
-}
-
-void send_json_error(int client_socket, int status_code, const char *message) {
-    char json[512];
-    snprintf(json, sizeof(json), "{\"success\":false,\"error\":\"%s\"}", message);
-    send_json_response(client_socket, status_code, json);
+    MUTEX_UNLOCK(db_mutex);
+    
+    return done;
 }
 
-// HTTP Handlers Implementation
-
-void handle_register(int client_socket, const char *body, const char *ip_address) {
-    (void)ip_address; // Mark as intentionally unused for now
+// Replaces any earlier code for the user, so only the newest one works
+int store_login_otp(const char *email, const char *otp) {
+    const char *delete_sql = "DELETE FROM otp_codes WHERE email = ?;";
+    const char *insert_sql = "INSERT INTO otp_codes (email, otp_code) VALUES (?, ?);";
+    sqlite3_stmt *stmt;
+    int stored = 0;
     
-    char *username = extract_json_value(body, "username");
-    char *email = extract_json_value(body, "email");
-    char *password = extract_json_value(body, "password");
-    char *mobile = extract_json_value(body, "mobile");
+    MUTEX_LOCK(db_mutex);
     
-    // Input validation
-    if (!username || !email || !password || !mobile) {
-        send_json_error(client_socket, 400, "Missing required fields");
-        return;
+    if (sqlite3_prepare_v2(db, delete_sql, -1, &stmt, NULL) == SQLITE_OK) {
+        sqlite3_bind_text(stmt, 1, email, -1, SQLITE_STATIC);
+        sqlite3_step(stmt);
+        sqlite3_finalize(stmt);
     }
-    
-    // Create user
-    User user = {0};
-    strcpy(user.username, username);
-    strcpy(user.email, email);
-    strcpy(user.mobile, mobile);
-    
-    // Generate salt and hash password
-    generate_random_string(user.salt, SALT_LENGTH);
-    hash_password(password, user.salt, user.password_hash);
-    
-    if (create_user(&user)) {
-        char response[256];
-        snprintf(response, sizeof(response), 
-            "{\"success\":true,\"message\":\"User registered successfully\"}");
-        send_json_response(client_socket, 200, response);
-        printf("✅ User registered: %s\n", username);
-    } else {
-        send_json_error(client_socket, 400, "Registration failed - username or email already exists");
+    if (sqlite3_prepare_v2(db, insert_sql, -1, &stmt, NULL) == SQLITE_OK) {
+        sqlite3_bind_text(stmt, 1, email, -1, SQLITE_STATIC);
+        sqlite3_bind_text(stmt, 2, otp, -1, SQLITE_STATIC);
+        stored = sqlite3_step(stmt) == SQLITE_DONE;
+        sqlite3_finalize(stmt);
     }
     
-    // Cleanup
-    free(username);
-    free(email);
-    free(password);
-    free(mobile);
-}
-
-void handle_health_check(int client_socket) {
-    char response[512];
-    time_t now = time(NULL);
-    
-    snprintf(response, sizeof(response),
-        "{"
-        "\"status\":\"healthy\","
-        "\"timestamp\":%ld,"
-        "\"server\":\"Task Scheduler v3.0\","
-        "\"database\":\"SQLite\","
-        "\"features\":[\"persistent_storage\",\"rate_limiting\",\"3fa_auth\",\"encryption\"]"
-        "}", now);
+    MUTEX_UNLOCK(db_mutex);
     
-    send_json_response(client_socket, 200, response);
+    return stored;
 }
 
-// Main server implementation continues...
-
-char* extract_json_value(const char *json, const char *key) {
-    if (!json || !key) return NULL;
-    
-    char pattern[256];
-    snprintf(pattern, sizeof(pattern), "\"%s\":", key);
+// Checks an OTP against the user's newest unused code. Returns 1 on a match
+// (the code is then used up), 0 on a wrong code, and -1 when there is no
+// live code: none sent, expired, or OTP_MAX_ATTEMPTS wrong guesses made.
+int verify_login_otp(int user_id, const char *otp) {
+    const char *select_sql =
+        "SELECT o.id, o.otp_code, o.attempts FROM otp_codes o "
+        "JOIN users u ON u.email = o.email "
+        "WHERE u.user_id = ? AND o.is_used = 0 AND o.created_at >= ? "
+        "ORDER BY o.id DESC LIMIT 1;";
+    const char *used_sql = "UPDATE otp_codes SET is_used = 1 WHERE id = ? AND is_used = 0;";
+    const char *miss_sql = "UPDATE otp_codes SET attempts = attempts + 1 WHERE id = ?;";
+    sqlite3_stmt *stmt;
+    int result = -1;
+    long long otp_id = 0;
     
-    char *start = strstr(json, pattern);
-    if (!start) return NULL;
+    MUTEX_LOCK(db_mutex);
     
-    start += strlen(pattern);
-    while (*start == ' ' || *start == '\t') start++; // Skip whitespace
+    if (sqlite3_prepare_v2(db, select_sql, -1, &stmt, NULL) == SQLITE_OK) {
+        sqlite3_bind_int(stmt, 1, user_id);
+        sqlite3_bind_int64(stmt, 2, (long long)time(NULL) - OTP_TIMEOUT);
+        if (sqlite3_step(stmt) == SQLITE_ROW && sqlite3_column_int(stmt, 2) < OTP_MAX_ATTEMPTS) {
+            const char *expected = (const char*)sqlite3_column_text(stmt, 1);
+            otp_id = sqlite3_column_int64(stmt, 0);
+            result = expected && strcmp(expected, otp) == 0 ? 1 : 0;
+        }
+        sqlite3_finalize(stmt);
+    }
     
-    if (*start == '"') {
-        start++; // Skip opening quote
-        char *end = strchr(start, '"');
-        if (!end) return NULL;
-        
-        int len = end - start;
-        char *value = malloc(len + 1);
-        strncpy(value, start, len);
-        value[len] = '\0';
-        return value;
+    // A concurrent request that used the same code first wins
+    if (result >= 0 && sqlite3_prepare_v2(db, result ? used_sql : miss_sql, -1, &stmt, NULL) == SQLITE_OK) {
+        sqlite3_bind_int64(stmt, 1, otp_id);
+        if (sqlite3_step(stmt) != SQLITE_DONE || (result && sqlite3_changes(db) != 1)) result = -1;
+        sqlite3_finalize(stmt);
+    } else if (result >= 0) {
+        result = -1;
     }
     
-    return NULL;
+    MUTEX_UNLOCK(db_mutex);
+    
+    return result;
 }
 
-char* extract_client_ip(const char *request) {
-    (void)request; // Mark as intentionally unused for now
-    static char ip[46] = "127.0.0.1"; // Default to localhost
-    // In a real implementation, extract from X-Forwarded-For or other headers
-    return ip;
-}
-
-char* extract_user_agent(const char *request) {
-    static char user_agent[256] = "Unknown";
-    const char *start = strstr(request, "User-Agent: ");
-    if (start) {
-        start += 12; // Skip "User-Agent: "
-        const char *end = strstr(start, "\r\n");
-        if (end) {
-            int len = end - start;
-            if (len < 255) {
-                strncpy(user_agent, start, len);
-                user_agent[len] = '\0';
-            }
-        }
-    }
-    return user_agent;
+// Task Management Implementation
+
+static unsigned long long *task_version_slot(int user_id) {
+    return &task_versions[((unsigned int)user_id * 2654435761u) & (TASK_VERSION_SLOTS - 1)];
+}
+
+// Call after the change is committed: a reader that saw the old version
+// then re-reads, rather than pairing the new version with old rows
+static void bump_task_version(int user_id) {
+    __sync_add_and_fetch(task_version_slot(user_id), 1);
 }
 
-int check_rate_limit(const char *ip_address) {
+int create_task(const Task *task) {
     const char *sql = 
-        "SELECT request_count, window_start FROM rate_limits WHERE ip_address = ?;";
+        "INSERT INTO tasks "
+        "(user_id, title, description, priority, status, scheduled_time, is_recurring, recurrence_pattern, "
+        "start_time, end_time, estimated_duration) "
+        "VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?);";
     
     sqlite3_stmt *stmt;
-    time_t now = time(NULL);
     
     MUTEX_LOCK(db_mutex);
     
     int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
     if (rc != SQLITE_OK) {
         MUTEX_UNLOCK(db_mutex);
-        return 1; // Allow on error
+        return 0;
     }
     
-    sqlite3_bind_text(stmt, 1, ip_address, -1, SQLITE_STATIC);
+    sqlite3_bind_int(stmt, 1, task->user_id);
+    sqlite3_bind_text(stmt, 2, task->title, -1, SQLITE_STATIC);
+    sqlite3_bind_text(stmt, 3, task->description, -1, SQLITE_STATIC);
+    sqlite3_bind_text(stmt, 4, task->priority, -1, SQLITE_STATIC);
+    sqlite3_bind_text(stmt, 5, task->status, -1, SQLITE_STATIC);
+    sqlite3_bind_int64(stmt, 6, task->scheduled_time);
+    sqlite3_bind_int(stmt, 7, task->is_recurring);
+    sqlite3_bind_text(stmt, 8, task->recurrence_pattern, -1, SQLITE_STATIC);
+    if (task->start_time > 0 && task->end_time > task->start_time) {
+        sqlite3_bind_int64(stmt, 9, task->start_time);
+        sqlite3_bind_int64(stmt, 10, task->end_time);
+    } else {
+        sqlite3_bind_null(stmt, 9);
+        sqlite3_bind_null(stmt, 10);
+    }
+    if (task->estimated_duration > 0) {
+        sqlite3_bind_int(stmt, 11, task->estimated_duration);
+    } else {
+        sqlite3_bind_null(stmt, 11);
+    }
     
     rc = sqlite3_step(stmt);
+    sqlite3_finalize(stmt);
     
-    if (rc == SQLITE_ROW) {
-        int request_count = sqlite3_column_int(stmt, 0);
-        time_t window_start = sqlite3_column_int64(stmt, 1);
-        
-        sqlite3_finalize(stmt);
-        
-        // Check if window has expired
-        if (now - window_start > RATE_LIMIT_WINDOW) {
-            // Reset window
-            const char *reset_sql = 
-                "UPDATE rate_limits SET request_count = 1, window_start = ? WHERE ip_address = ?;";
-            sqlite3_prepare_v2(db, reset_sql, -1, &stmt, NULL);
-            sqlite3_bind_int64(stmt, 1, now);
-            sqlite3_bind_text(stmt, 2, ip_address, -1, SQLITE_STATIC);
-            sqlite3_step(stmt);
-            sqlite3_finalize(stmt);
-            
-            MUTEX_UNLOCK(db_mutex);
-            return 1; // Allow
+    int task_id = (rc == SQLITE_DONE) ? (int)sqlite3_last_insert_rowid(db) : 0;
+    MUTEX_UNLOCK(db_mutex);
+    if (task_id) bump_task_version(task->user_id);
+    
+    // A cached graph learns about the task now; an uncached one loads it later
+    if (task_id) {
+        MUTEX_LOCK(graph_mutex);
+        TaskGraph *graph = get_task_graph(task->user_id);
+        if (graph) {
+            task_graph_add_task(graph, task_id, task_status_to_state(task->status));
         }
+        MUTEX_UNLOCK(graph_mutex);
         
-        // Check rate limit
-        if (request_count >= RATE_LIMIT_MAX_REQUESTS) {
-            MUTEX_UNLOCK(db_mutex);
-            return 0; // Deny
+        if (task->start_time > 0 && task->end_time > task->start_time &&
+            task_status_to_state(task->status) != TASK_STATE_FINISHED) {
+            schedule_task_moved(task->user_id, task_id, 0, task->start_time, task->end_time);
         }
-        
-        // Increment counter
-        const char *inc_sql = 
-            "UPDATE rate_limits SET request_count = request_count + 1 WHERE ip_address = ?;";
-        sqlite3_prepare_v2(db, inc_sql, -1, &stmt, NULL);
-        sqlite3_bind_text(stmt, 1, ip_address, -1, SQLITE_STATIC);
-        sqlite3_step(stmt);
-        sqlite3_finalize(stmt);
-        
-    } else {
-        // First request from this IP
-        sqlite3_finalize(stmt);
-        
-        const char *insert_sql = 
-            "INSERT INTO rate_limits (ip_address, request_count, window_start) VALUES (?, 1, ?);";
-        sqlite3_prepare_v2(db, insert_sql, -1, &stmt, NULL);
-        sqlite3_bind_text(stmt, 1, ip_address, -1, SQLITE_STATIC);
-        sqlite3_bind_int64(stmt, 2, now);
-        sqlite3_step(stmt);
-        sqlite3_finalize(stmt);
     }
     
-    MUTEX_UNLOCK(db_mutex);
-    return 1; // Allow
+    return task_id;
 }
 
-void cleanup_expired_sessions() {
-    const char *sql = "DELETE FROM sessions WHERE last_activity < ?;";
+static void copy_column_text(sqlite3_stmt *stmt, int column, char *output, size_t size) {
+    const char *text = (const char*)sqlite3_column_text(stmt, column);
+    snprintf(output, size, "%s", text ? text : "");
+}
+
+#define TASK_COLUMNS \
+    "task_id, user_id, title, description, priority, status, scheduled_time, start_time, end_time, " \
+    "estimated_duration, created_at, updated_at, is_recurring, recurrence_pattern "
+
+// Reads a row selected with TASK_COLUMNS; NULL times and durations read as 0
+static void read_task_row(sqlite3_stmt *stmt, Task *task) {
+    task->task_id = sqlite3_column_int(stmt, 0);
+    task->user_id = sqlite3_column_int(stmt, 1);
+    copy_column_text(stmt, 2, task->title, sizeof(task->title));
+    copy_column_text(stmt, 3, task->description, sizeof(task->description));
+    copy_column_text(stmt, 4, task->priority, sizeof(task->priority));
+    copy_column_text(stmt, 5, task->status, sizeof(task->status));
+    task->scheduled_time = (time_t)sqlite3_column_int64(stmt, 6);
+    task->start_time = (time_t)sqlite3_column_int64(stmt, 7);
+    task->end_time = (time_t)sqlite3_column_int64(stmt, 8);
+    task->estimated_duration = sqlite3_column_int(stmt, 9);
+    task->created_at = (time_t)sqlite3_column_int64(stmt, 10);
+    task->updated_at = (time_t)sqlite3_column_int64(stmt, 11);
+    task->is_recurring = sqlite3_column_int(stmt, 12);
+    copy_column_text(stmt, 13, task->recurrence_pattern, sizeof(task->recurrence_pattern));
+}
+
+// One page of the user's tasks in task_id order, after after_id. Each page is
+// a seek on the (user_id, task_id) order of idx_tasks_user_id, so a page costs
+// the same at the end of 50k tasks as at the start. Returns the count, or -1.
+int get_user_tasks(int user_id, int after_id, int limit, Task *page) {
+    const char *sql = 
+        "SELECT " TASK_COLUMNS "FROM tasks "
+        "WHERE user_id = ? AND task_id > ? ORDER BY task_id LIMIT ?;";
+    
     sqlite3_stmt *stmt;
-    time_t cutoff = time(NULL) - SESSION_TIMEOUT;
+    int count = 0;
     
     MUTEX_LOCK(db_mutex);
+    if (sqlite3_prepare_v2(db, sql, -1, &stmt, NULL) != SQLITE_OK) {
+        MUTEX_UNLOCK(db_mutex);
+        return -1;
+    }
+    sqlite3_bind_int(stmt, 1, user_id);
+    sqlite3_bind_int(stmt, 2, after_id);
+    sqlite3_bind_int(stmt, 3, limit);
+    while (count < limit && sqlite3_step(stmt) == SQLITE_ROW) {
+        read_task_row(stmt, &page[count++]);
+    }
+    sqlite3_finalize(stmt);
+    MUTEX_UNLOCK(db_mutex);
     
-    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
-    if (rc == SQLITE_OK) {
-        sqlite3_bind_int64(stmt, 1, cutoff);
+    return count;
+}
+
+int get_task_by_id(int task_id, int user_id, Task *task) {
+    const char *sql = "SELECT " TASK_COLUMNS "FROM tasks WHERE task_id = ? AND user_id = ?;";
+    sqlite3_stmt *stmt;
+    int found = 0;
+    
+    MUTEX_LOCK(db_mutex);
+    if (sqlite3_prepare_v2(db, sql, -1, &stmt, NULL) == SQLITE_OK) {
+        sqlite3_bind_int(stmt, 1, task_id);
+        sqlite3_bind_int(stmt, 2, user_id);
+        if (sqlite3_step(stmt) == SQLITE_ROW) {
+            read_task_row(stmt, task);
+            found = 1;
+        }
+        sqlite3_finalize(stmt);
+    }
+    MUTEX_UNLOCK(db_mutex);
+    
+    return found;
+}
+
+// Writes every editable column; status is left to handle_set_task_state,
+// which checks dependencies. Returns 0 if the task is not the user's.
+int update_task(const Task *task) {
+    const char *sql = 
+        "UPDATE tasks SET title = ?, description = ?, priority = ?, scheduled_time = ?, "
+        "start_time = ?, end_time = ?, estimated_duration = ?, is_recurring = ?, "
+        "recurrence_pattern = ?, updated_at = ? "
+        "WHERE task_id = ? AND user_id = ?;";
+    
+    sqlite3_stmt *stmt;
+    int updated = 0;
+    
+    MUTEX_LOCK(db_mutex);
+    if (sqlite3_prepare_v2(db, sql, -1, &stmt, NULL) == SQLITE_OK) {
+        sqlite3_bind_text(stmt, 1, task->title, -1, SQLITE_STATIC);
+        sqlite3_bind_text(stmt, 2, task->description, -1, SQLITE_STATIC);
+        sqlite3_bind_text(stmt, 3, task->priority, -1, SQLITE_STATIC);
+        sqlite3_bind_int64(stmt, 4, task->scheduled_time);
+        if (task->start_time > 0 && task->end_time > task->start_time) {
+            sqlite3_bind_int64(stmt, 5, task->start_time);
+            sqlite3_bind_int64(stmt, 6, task->end_time);
+        } else {
+            sqlite3_bind_null(stmt, 5);
+            sqlite3_bind_null(stmt, 6);
+        }
+        if (task->estimated_duration > 0) {
+            sqlite3_bind_int(stmt, 7, task->estimated_duration);
+        } else {
+            sqlite3_bind_null(stmt, 7);
+        }
+        sqlite3_bind_int(stmt, 8, task->is_recurring);
+        sqlite3_bind_text(stmt, 9, task->recurrence_pattern, -1, SQLITE_STATIC);
+        sqlite3_bind_int64(stmt, 10, task->updated_at);
+        sqlite3_bind_int(stmt, 11, task->task_id);
+        sqlite3_bind_int(stmt, 12, task->user_id);
+        updated = sqlite3_step(stmt) == SQLITE_DONE && sqlite3_changes(db) > 0;
+        sqlite3_finalize(stmt);
+    }
+    MUTEX_UNLOCK(db_mutex);
+    if (updated) bump_task_version(task->user_id);
+    
+    return updated;
+}
+
+// Its dependencies go with it (ON DELETE CASCADE); callers drop the cached graph
+int delete_task(int task_id, int user_id) {
+    const char *sql = "DELETE FROM tasks WHERE task_id = ? AND user_id = ?;";
+    sqlite3_stmt *stmt;
+    int deleted = 0;
+    
+    MUTEX_LOCK(db_mutex);
+    if (sqlite3_prepare_v2(db, sql, -1, &stmt, NULL) == SQLITE_OK) {
+        sqlite3_bind_int(stmt, 1, task_id);
+        sqlite3_bind_int(stmt, 2, user_id);
+        deleted = sqlite3_step(stmt) == SQLITE_DONE && sqlite3_changes(db) > 0;
+        sqlite3_finalize(stmt);
+    }
+    MUTEX_UNLOCK(db_mutex);
+    if (deleted) bump_task_version(user_id);
+    
+    return deleted;
+}
+
+// Dependency Graph Implementation
+
+static CachedGraph graph_cache[MAX_CACHED_GRAPHS];
+
+int task_status_to_state(const char *status) {
+    if (!status) return TASK_STATE_PENDING;
+    if (strcmp(status, "completed") == 0) return TASK_STATE_FINISHED;
+    if (strcmp(status, "running") == 0) return TASK_STATE_STARTED;
+    return TASK_STATE_PENDING;
+}
+
+// Builds one user's graph from tasks and task_dependencies; caller holds graph_mutex
+static int load_task_graph(TaskGraph *graph, int user_id) {
+    const char *tasks_sql = "SELECT task_id, status FROM tasks WHERE user_id = ?;";
+    const char *deps_sql = 
+        "SELECT d.task_id, d.depends_on_task_id, d.dependency_type "
+        "FROM task_dependencies d JOIN tasks t ON t.task_id = d.task_id "
+        "WHERE t.user_id = ?;";
+    
+    sqlite3_stmt *stmt;
+    task_graph_init(graph, user_id);
+    
+    MUTEX_LOCK(db_mutex);
+    
+    if (sqlite3_prepare_v2(db, tasks_sql, -1, &stmt, NULL) != SQLITE_OK) {
+        MUTEX_UNLOCK(db_mutex);
+        return 0;
+    }
+    sqlite3_bind_int(stmt, 1, user_id);
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        task_graph_add_task(graph, sqlite3_column_int(stmt, 0),
+                            task_status_to_state((const char*)sqlite3_column_text(stmt, 1)));
+    }
+    sqlite3_finalize(stmt);
+    
+    if (sqlite3_prepare_v2(db, deps_sql, -1, &stmt, NULL) != SQLITE_OK) {
+        MUTEX_UNLOCK(db_mutex);
+        task_graph_free(graph);
+        return 0;
+    }
+    sqlite3_bind_int(stmt, 1, user_id);
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        int task_id = sqlite3_column_int(stmt, 0);
+        int depends_on = sqlite3_column_int(stmt, 1);
+        int type = task_graph_dependency_type((const char*)sqlite3_column_text(stmt, 2));
+        
+        // Rows written by other tools are not checked on insert; keep the graph acyclic
+        int rc = task_graph_add_edge(graph, task_id, depends_on, type < 0 ? DEP_FINISH_TO_START : type);
+        if (rc == TASK_GRAPH_CYCLE) {
+            printf("⚠️  Ignoring dependency %d -> %d for user %d: it closes a cycle\n",
+                   task_id, depends_on, user_id);
+        }
+    }
+    sqlite3_finalize(stmt);
+    
+    MUTEX_UNLOCK(db_mutex);
+    return 1;
+}
+
+// Cached graph for a user, loading it (and evicting the least recently used) on a miss.
+// Caller holds graph_mutex; the pointer is valid until it is released.
+TaskGraph* get_task_graph(int user_id) {
+    CachedGraph *victim = &graph_cache[0];
+    time_t now = time(NULL);
+    
+    for (int i = 0; i < MAX_CACHED_GRAPHS; i++) {
+        CachedGraph *entry = &graph_cache[i];
+        if (entry->loaded && entry->graph.user_id == user_id) {
+            entry->last_used = now;
+            return &entry->graph;
+        }
+        if (!entry->loaded) {
+            if (victim->loaded) victim = entry;
+        } else if (victim->loaded && entry->last_used < victim->last_used) {
+            victim = entry;
+        }
+    }
+    
+    if (victim->loaded) {
+        task_graph_free(&victim->graph);
+        victim->loaded = 0;
+    }
+    if (!load_task_graph(&victim->graph, user_id)) return NULL;
+    
+    victim->loaded = 1;
+    victim->last_used = now;
+    return &victim->graph;
+}
+
+// Drops a user's graph so the next lookup reloads it (e.g. after tasks are deleted)
+void invalidate_task_graph(int user_id) {
+    MUTEX_LOCK(graph_mutex);
+    for (int i = 0; i < MAX_CACHED_GRAPHS; i++) {
+        if (graph_cache[i].loaded && graph_cache[i].graph.user_id == user_id) {
+            task_graph_free(&graph_cache[i].graph);
+            graph_cache[i].loaded = 0;
+            break;
+        }
+    }
+    MUTEX_UNLOCK(graph_mutex);
+}
+
+// Schedule Conflicts Implementation
+
+static CachedSchedule schedule_cache[MAX_CACHED_SCHEDULES];
+
+// Loads one user's busy intervals; caller holds schedule_mutex
+static int load_task_schedule(IntervalTree *tree, int user_id) {
+    const char *sql = 
+        "SELECT task_id, start_time, end_time FROM tasks "
+        "WHERE user_id = ? AND start_time IS NOT NULL "
+        "AND status NOT IN ('completed', 'cancelled', 'failed');";
+    
+    sqlite3_stmt *stmt;
+    interval_tree_init(tree);
+    
+    MUTEX_LOCK(db_mutex);
+    
+    if (sqlite3_prepare_v2(db, sql, -1, &stmt, NULL) != SQLITE_OK) {
+        MUTEX_UNLOCK(db_mutex);
+        return 0;
+    }
+    sqlite3_bind_int(stmt, 1, user_id);
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        interval_tree_insert(tree, sqlite3_column_int64(stmt, 1), sqlite3_column_int64(stmt, 2),
+                             sqlite3_column_int(stmt, 0));
+    }
+    sqlite3_finalize(stmt);
+    
+    MUTEX_UNLOCK(db_mutex);
+    return 1;
+}
+
+// Cached schedule for a user, loading it (and evicting the least recently used) on a miss.
+// Caller holds schedule_mutex; the pointer is valid until it is released.
+IntervalTree* get_task_schedule(int user_id) {
+    CachedSchedule *victim = &schedule_cache[0];
+    time_t now = time(NULL);
+    
+    for (int i = 0; i < MAX_CACHED_SCHEDULES; i++) {
+        CachedSchedule *entry = &schedule_cache[i];
+        if (entry->loaded && entry->user_id == user_id) {
+            entry->last_used = now;
+            return &entry->tree;
+        }
+        if (!entry->loaded) {
+            if (victim->loaded) victim = entry;
+        } else if (victim->loaded && entry->last_used < victim->last_used) {
+            victim = entry;
+        }
+    }
+    
+    if (victim->loaded) {
+        interval_tree_free(&victim->tree);
+        victim->loaded = 0;
+    }
+    if (!load_task_schedule(&victim->tree, user_id)) return NULL;
+    
+    victim->user_id = user_id;
+    victim->loaded = 1;
+    victim->last_used = now;
+    return &victim->tree;
+}
+
+// Keeps a cached schedule in step with a task whose window changed. A start of
+// 0 means none: old_start 0 for a new slot, start 0 once the task is finished
+// or unscheduled. An uncached schedule picks the change up when it loads.
+void schedule_task_moved(int user_id, int task_id, long long old_start, long long start, long long end) {
+    MUTEX_LOCK(schedule_mutex);
+    for (int i = 0; i < MAX_CACHED_SCHEDULES; i++) {
+        CachedSchedule *entry = &schedule_cache[i];
+        if (!entry->loaded || entry->user_id != user_id) continue;
+        if (old_start > 0) interval_tree_remove(&entry->tree, old_start, task_id);
+        if (start > 0) interval_tree_insert(&entry->tree, start, end, task_id);
+        break;
+    }
+    MUTEX_UNLOCK(schedule_mutex);
+}
+
+// Drops a user's schedule so the next lookup reloads it (e.g. after bulk updates)
+void invalidate_task_schedule(int user_id) {
+    MUTEX_LOCK(schedule_mutex);
+    for (int i = 0; i < MAX_CACHED_SCHEDULES; i++) {
+        if (schedule_cache[i].loaded && schedule_cache[i].user_id == user_id) {
+            interval_tree_free(&schedule_cache[i].tree);
+            schedule_cache[i].loaded = 0;
+            break;
+        }
+    }
+    MUTEX_UNLOCK(schedule_mutex);
+}
+
+// The user's tasks overlapping [start, end) other than exclude_id, up to max
+// of them ordered by start; returns how many there are, or -1 on a load failure.
+// O(log n + k), so create and update can check a new window on every write.
+int find_schedule_conflicts(int user_id, long long start, long long end, int exclude_id, Interval *out, int max) {
+    MUTEX_LOCK(schedule_mutex);
+    IntervalTree *tree = get_task_schedule(user_id);
+    int total = tree ? interval_tree_overlaps(tree, start, end, out, max) : -1;
+    MUTEX_UNLOCK(schedule_mutex);
+    
+    // The task itself shows up when it already holds this window; past max
+    // results it is not seen, and is counted
+    int listed = total < max ? total : max;
+    for (int i = 0; i < listed; i++) {
+        if (out[i].id != exclude_id) continue;
+        memmove(&out[i], &out[i + 1], (size_t)(listed - i - 1) * sizeof(Interval));
+        total--;
+        break;
+    }
+    return total;
+}
+
+// Utility Functions Implementation
+
+// Unpredictable bytes for session ids and OTPs. Reseeding rand() from the
+// clock on every call gave two logins in the same second the same session,
+// which did not matter until a session id was all a task request needed.
+static void fill_random(unsigned char *bytes, size_t length) {
+#ifdef _WIN32
+    for (size_t i = 0; i < length; i++) {
+        unsigned int value;
+        if (rand_s(&value) != 0) value = (unsigned int)rand();
+        bytes[i] = (unsigned char)value;
+    }
+#else
+    static pthread_mutex_t random_mutex = PTHREAD_MUTEX_INITIALIZER;
+    static FILE *urandom = NULL;
+    static int seeded = 0;
+    pthread_mutex_lock(&random_mutex);
+    if (!urandom) urandom = fopen("/dev/urandom", "rb");
+    if (!urandom || fread(bytes, 1, length, urandom) != length) {
+        if (!seeded) {
+            srand((unsigned int)time(NULL));
+            seeded = 1;
+        }
+        for (size_t i = 0; i < length; i++) bytes[i] = (unsigned char)rand();
+    }
+    pthread_mutex_unlock(&random_mutex);
+#endif
+}
+
+void generate_random_string(char *str, int length) {
+    const char charset[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789";
+    unsigned char bytes[256];
+    if (length > (int)sizeof(bytes)) length = sizeof(bytes);
+    fill_random(bytes, (size_t)length);
+    
+    // 248 is the largest multiple of 62 in a byte; rejecting above it keeps
+    // every character equally likely
+    for (int i = 0; i < length; i++) {
+        while (bytes[i] >= 248) fill_random(&bytes[i], 1);
+        str[i] = charset[bytes[i] % (sizeof(charset) - 1)];
+    }
+    str[length] = '\0';
+}
+
+void hash_password(const char *password, const char *salt, char *hash) {
+    // Simple hash implementation (in production, use bcrypt or Argon2)
+    char combined[512];
+    snprintf(combined, sizeof(combined), "%s%s", password, salt);
+    
+    // Basic hash (should be replaced with proper hashing in production)
+    unsigned long hash_value = 5381;
+    for (int i = 0; combined[i]; i++) {
+        hash_value = ((hash_value << 5) + hash_value) + combined[i];
+    }
+    
+    snprintf(hash, HASH_LENGTH + 1, "%016lx%016lx%016lx%016lx", 
+             hash_value, hash_value * 31, hash_value * 37, hash_value * 41);
+}
+
+int verify_password(const char *password, const char *salt, const char *stored_hash) {
+    char computed_hash[HASH_LENGTH + 1];
+    hash_password(password, salt, computed_hash);
+    return strcmp(computed_hash, stored_hash) == 0;
+}
+
+void generate_session_id(char *session_id) {
+    generate_random_string(session_id, 48);
+}
+
+void generate_otp(char *otp) {
+    unsigned char bytes[OTP_LENGTH];
+    fill_random(bytes, sizeof(bytes));
+    for (int i = 0; i < OTP_LENGTH; i++) {
+        while (bytes[i] >= 250) fill_random(&bytes[i], 1);
+        otp[i] = '0' + (bytes[i] % 10);
+    }
+    otp[OTP_LENGTH] = '\0';
+}
+
+// HTTP Response Functions
+
+// Headers every JSON response carries, after the status line
+static const char json_headers[] =
+    "Content-Type: application/json\r\n"
+    "Access-Control-Allow-Origin: *\r\n"
+    "Access-Control-Allow-Methods: GET, POST, PUT, DELETE, OPTIONS\r\n"
+    "Access-Control-Allow-Headers: Content-Type, Authorization\r\n";
+
+// Sent with every body large enough to compress, so caches keep the
+// encodings apart
+static const char vary_header[] = "Vary: Accept-Encoding\r\n";
+
+// What the request this worker is answering accepts; set by handle_request
+static THREAD_LOCAL HttpEncoding response_encoding = HTTP_ENCODING_IDENTITY;
+
+// ETag and Cache-Control lines for a 200 to this request, or ""
+static THREAD_LOCAL char response_etag[ETAG_HEADERS_SIZE];
+
+// Connection header and the blank line ending the headers
+static HttpSlice end_of_headers(void) {
+    static const char keep_alive[] = "Connection: keep-alive\r\n\r\n";
+    static const char close_connection[] = "Connection: close\r\n\r\n";
+    HttpSlice slice = { keep_alive, sizeof(keep_alive) - 1 };
+    if (strcmp(event_loop_connection_header(), "close") == 0) {
+        slice.data = close_connection;
+        slice.length = sizeof(close_connection) - 1;
+    }
+    return slice;
+}
+
+// Blocks while the client's receive window is full, which is the backpressure:
+// a worker produces no faster than the client reads. The worker's send timeout
+// (the loop's idle timeout) ends the wait for a client that stops reading.
+static int send_slices(int client_socket, const HttpSlice *slices, int count) {
+    if (http_send_slices(client_socket, slices, count)) return 1;
+    event_loop_response_failed();
+    return 0;
+}
+
+// Sends a complete JSON body of any size in one gathered write; only the
+// Content-Length line is formatted here. A body past the compression
+// threshold goes out compressed if the client accepts that, from the cache
+// when the same body was sent recently.
+static void send_json_body(int client_socket, int status_code, const char *body, size_t body_length) {
+    char content_length[40];
+    char *compressed = NULL;
+    HttpSlice slices[HTTP_RESPONSE_MAX_SLICES];
+    int count = 0;
+    
+    slices[count++] = http_status_line(status_code);
+    slices[count].data = json_headers;
+    slices[count++].length = sizeof(json_headers) - 1;
+    if (status_code == 200 && response_etag[0]) {
+        slices[count].data = response_etag;
+        slices[count++].length = strlen(response_etag);
+    }
+    if (http_compress_wanted(body_length)) {
+        slices[count].data = vary_header;
+        slices[count++].length = sizeof(vary_header) - 1;
+        size_t compressed_length;
+        compressed = http_compress_body(body, body_length, response_encoding, &compressed_length);
+        if (compressed) {
+            slices[count].data = http_encoding_header(response_encoding);
+            slices[count].length = strlen(slices[count].data);
+            count++;
+            body = compressed;
+            body_length = compressed_length;
+        }
+    }
+    slices[count++] = http_content_length(content_length, (long long)body_length);
+    slices[count++] = end_of_headers();
+    slices[count].data = body;
+    slices[count++].length = body_length;
+    
+    send_slices(client_socket, slices, count);
+    free(compressed);
+}
+
+void send_json_response(int client_socket, int status_code, const char *json_data) {
+    send_json_body(client_socket, status_code, json_data, strlen(json_data));
+}
+
+// One chunk: size line, data and CRLF in a single write, plus the final
+// zero-length chunk when this is the end of the body
+static int stream_send_chunk(ResponseStream *stream, const char *data, size_t length, int last) {
+    static const char chunk_end[] = "\r\n";
+    static const char body_end[] = "\r\n0\r\n\r\n";
+    if (stream->failed) return 0;
+    
+    char size_line[24];
+    HttpSlice slices[3];
+    int count = 0;
+    if (length > 0) {
+        slices[count].data = size_line;
+        slices[count++].length = (size_t)snprintf(size_line, sizeof(size_line), "%lx\r\n", (unsigned long)length);
+        slices[count].data = data;
+        slices[count++].length = length;
+        slices[count].data = last ? body_end : chunk_end;
+        slices[count++].length = last ? sizeof(body_end) - 1 : sizeof(chunk_end) - 1;
+    } else if (last) {
+        slices[count].data = body_end + 2;
+        slices[count++].length = sizeof(body_end) - 3;
+    }
+    
+    if (count > 0 && !send_slices(stream->socket, slices, count)) stream->failed = 1;
+    return !stream->failed;
+}
+
+// Deflater sink: each block of compressed output is one chunk
+static int stream_send_compressed(void *context, const char *data, size_t length) {
+    return stream_send_chunk((ResponseStream*)context, data, length, 0);
+}
+
+static void stream_compress(ResponseStream *stream, int finish) {
+    if (!http_deflate_write(&stream->deflater, stream->buffer, (size_t)stream->length, finish,
+                            stream_send_compressed, stream)) {
+        stream->failed = 1;
+        event_loop_response_failed();
+    }
+}
+
+// Headers of a chunked response, sent once the body outgrows the buffer
+static void stream_start_chunked(ResponseStream *stream) {
+    static const char chunked[] = "Transfer-Encoding: chunked\r\n";
+    HttpSlice slices[7];
+    int count = 0;
+    
+    slices[count++] = http_status_line(stream->status_code);
+    slices[count].data = json_headers;
+    slices[count++].length = sizeof(json_headers) - 1;
+    if (stream->status_code == 200 && response_etag[0]) {
+        slices[count].data = response_etag;
+        slices[count++].length = strlen(response_etag);
+    }
+    slices[count].data = chunked;
+    slices[count++].length = sizeof(chunked) - 1;
+    if (http_compress_wanted(STREAM_CHUNK_SIZE)) {
+        slices[count].data = vary_header;
+        slices[count++].length = sizeof(vary_header) - 1;
+        if (http_deflate_begin(&stream->deflater, response_encoding)) {
+            slices[count].data = http_encoding_header(response_encoding);
+            slices[count].length = strlen(slices[count].data);
+            count++;
+        }
+    }
+    slices[count++] = end_of_headers();
+    
+    stream->started = 1;
+    if (!send_slices(stream->socket, slices, count)) stream->failed = 1;
+}
+
+// Sends what is buffered, starting the chunked response first if need be
+static void stream_flush(ResponseStream *stream) {
+    if (!stream->failed && !stream->started) stream_start_chunked(stream);
+    if (!stream->failed && stream->length > 0) {
+        if (stream->deflater.active) stream_compress(stream, 0);
+        else stream_send_chunk(stream, stream->buffer, (size_t)stream->length, 0);
+    }
+    stream->length = 0;
+}
+
+// Starts a JSON response whose body follows through stream_printf, so its
+// size is not known or limited up front. Nothing is sent until the body
+// outgrows the buffer or ends.
+void stream_begin(ResponseStream *stream, int client_socket, int status_code) {
+    stream->socket = client_socket;
+    stream->status_code = status_code;
+    stream->length = 0;
+    stream->started = 0;
+    stream->failed = 0;
+    stream->deflater.active = 0;
+}
+
+void stream_printf(ResponseStream *stream, const char *format, ...) {
+    if (stream->failed) return;
+    
+    va_list args;
+    va_start(args, format);
+    int space = STREAM_CHUNK_SIZE - stream->length;
+    int length = vsnprintf(stream->buffer + stream->length, space, format, args);
+    va_end(args);
+    
+    if (length < space) {
+        stream->length += length;
+        return;
+    }
+    
+    // Did not fit: send what is buffered and format again into an empty buffer
+    stream_flush(stream);
+    va_start(args, format);
+    length = vsnprintf(stream->buffer, STREAM_CHUNK_SIZE, format, args);
+    va_end(args);
+    
+    if (length < STREAM_CHUNK_SIZE) {
+        stream->length = length;
+        return;
+    }
+    
+    // Larger than a chunk on its own
+    char *large = malloc(length + 1);
+    if (!large) {
+        stream->failed = 1;
+        event_loop_response_failed();
+        return;
+    }
+    va_start(args, format);
+    vsnprintf(large, length + 1, format, args);
+    va_end(args);
+    
+    for (int offset = 0; offset < length && !stream->failed; offset += STREAM_CHUNK_SIZE) {
+        int part = length - offset < STREAM_CHUNK_SIZE ? length - offset : STREAM_CHUNK_SIZE;
+        memcpy(stream->buffer, large + offset, part);
+        stream->length = part;
+        stream_flush(stream);
+    }
+    free(large);
+}
+
+// A body that never outgrew the buffer is sent whole, so a short list goes
+// out (and is compressed and cached) like any other response. Otherwise the
+// rest of the body follows, then the terminating zero-length chunk.
+void stream_end(ResponseStream *stream) {
+    if (!stream->failed && !stream->started) {
+        send_json_body(stream->socket, stream->status_code, stream->buffer, (size_t)stream->length);
+        return;
+    }
+    if (!stream->failed && stream->deflater.active) {
+        stream_compress(stream, 1);
+        stream->length = 0;
+    }
+    http_deflate_end(&stream->deflater);
+    stream_send_chunk(stream, stream->buffer, (size_t)stream->length, 1);
+}
+
+// Whether one If-None-Match value lists tag, by weak comparison
+static int etag_listed(const char *list, size_t length, const char *tag) {
+    size_t tag_length = strlen(tag);
+    const char *end = list + length;
+    const char *p = list;
+    while (p < end) {
+        while (p < end && (*p == ',' || *p == ' ' || *p == '\t')) p++;
+        if (p < end && *p == '*') return 1;
+        if (end - p >= 2 && p[0] == 'W' && p[1] == '/') p += 2;
+        const char *candidate = p;
+        while (p < end && *p != ',') p++;
+        const char *candidate_end = p;
+        while (candidate_end > candidate && (candidate_end[-1] == ' ' || candidate_end[-1] == '\t')) candidate_end--;
+        if ((size_t)(candidate_end - candidate) == tag_length && memcmp(candidate, tag, tag_length) == 0) return 1;
+    }
+    return 0;
+}
+
+// Conditional GET of something derived only from the user's tasks: answers
+// 304 from the version counter alone, without the database, if the client's
+// copy is current. Otherwise the version's ETag goes on the 200 that follows.
+static int task_list_not_modified(int client_socket, int user_id, const HttpRequest *request) {
+    char tag[64];
+    unsigned long long version = __atomic_load_n(task_version_slot(user_id), __ATOMIC_ACQUIRE);
+    snprintf(tag, sizeof(tag), "\"%llx-%d-%llu\"", task_version_epoch, user_id, version);
+    snprintf(response_etag, sizeof(response_etag), "ETag: W/%s\r\nCache-Control: private, no-cache\r\n", tag);
+    
+    const HttpSpan *if_none_match = http_header(request, "If-None-Match");
+    if (!if_none_match || !etag_listed(http_span_data(request, *if_none_match), if_none_match->length, tag)) {
+        return 0;
+    }
+    
+    HttpSlice slices[] = {
+        http_status_line(304),
+        { response_etag, strlen(response_etag) },
+        end_of_headers()
+    };
+    send_slices(client_socket, slices, 3);
+    return 1;
+}
+
+// Copies input into output as the inside of a JSON string, truncating to fit
+void json_escape(const char *input, char *output, size_t size) {
+    size_t used = 0;
+    for (; input && *input && used + 7 < size; input++) {
+        unsigned char c = (unsigned char)*input;
+        if (c == '"' || c == '\\') {
+            output[used++] = '\\';
+            output[used++] = c;
+        } else if (c == '\n') {
+            output[used++] = '\\';
+            output[used++] = 'n';
+        } else if (c < 0x20) {
+            used += snprintf(output + used, size - used, "\\u%04x", c);
+        } else {
+            output[used++] = c;
+        }
+    }
+    output[used] = '\0';
+}
+
+void send_json_error(int client_socket, int status_code, const char *message) {
+    char json[512];
+    snprintf(json, sizeof(json), "{\"success\":false,\"error\":\"%s\"}", message);
+    send_json_response(client_socket, status_code, json);
+}
+
+// HTTP Handlers Implementation
+
+void handle_register(int client_socket, const char *body, const char *ip_address) {
+    (void)ip_address; // Mark as intentionally unused for now
+    
+    JsonBody fields;
+    json_body_parse(&fields, body, strlen(body));
+    
+    // Create user
+    User user = {0};
+    char password[256];
+    
+    // Input validation
+    if (json_body_string(&fields, "username", user.username, sizeof(user.username)) <= 0 ||
+        json_body_string(&fields, "email", user.email, sizeof(user.email)) <= 0 ||
+        json_body_string(&fields, "password", password, sizeof(password)) <= 0 ||
+        json_body_string(&fields, "mobile", user.mobile, sizeof(user.mobile)) <= 0) {
+        send_json_error(client_socket, 400, "Missing required fields");
+        return;
+    }
+    
+    // Generate salt and hash password
+    generate_random_string(user.salt, SALT_LENGTH);
+    hash_password(password, user.salt, user.password_hash);
+    
+    if (create_user(&user)) {
+        char response[256];
+        snprintf(response, sizeof(response), 
+            "{\"success\":true,\"message\":\"User registered successfully\"}");
+        send_json_response(client_socket, 200, response);
+        printf("✅ User registered: %s\n", user.username);
+    } else {
+        send_json_error(client_socket, 400, "Registration failed - username or email already exists");
+    }
+}
+
+void handle_health_check(int client_socket) {
+    char response[512];
+    time_t now = time(NULL);
+    unsigned long long session_hits, session_misses, compressed_hits, compressed_misses, static_hits, static_misses;
+    session_cache_counts(&session_hits, &session_misses);
+    http_compress_counts(&compressed_hits, &compressed_misses);
+    static_files_counts(&static_hits, &static_misses);
+    
+    snprintf(response, sizeof(response),
+        "{"
+        "\"status\":\"healthy\","
+        "\"timestamp\":%ld,"
+        "\"server\":\"Task Scheduler v3.0\","
+        "\"database\":\"SQLite\","
+        "\"connections\":%d,"
+        "\"session_cache\":{\"hits\":%llu,\"misses\":%llu},"
+        "\"compression_cache\":{\"hits\":%llu,\"misses\":%llu},"
+        "\"static_cache\":{\"hits\":%llu,\"misses\":%llu},"
+        "\"features\":[\"persistent_storage\",\"rate_limiting\",\"3fa_auth\",\"encryption\"]"
+        "}", now, event_loop_connections(), session_hits, session_misses, compressed_hits, compressed_misses,
+        static_hits, static_misses);
+    
+    send_json_response(client_socket, 200, response);
+}
+
+void handle_query_stats(int client_socket) {
+    char stats[BUFFER_SIZE - 512];
+    char response[BUFFER_SIZE - 256];
+    
+    query_stats_json(stats, sizeof(stats));
+    snprintf(response, sizeof(response), "{\"success\":true,\"queries\":%s}", stats);
+    
+    send_json_response(client_socket, 200, response);
+}
+
+void handle_lock_stats(int client_socket) {
+    char stats[BUFFER_SIZE - 512];
+    char response[BUFFER_SIZE - 256];
+    
+    lock_stats_json(stats, sizeof(stats));
+    snprintf(response, sizeof(response), "{\"success\":true,\"stats\":%s}", stats);
+    
+    send_json_response(client_socket, 200, response);
+}
+
+// Task CRUD
+
+static int valid_priority(const char *priority) {
+    return strcmp(priority, "low") == 0 || strcmp(priority, "medium") == 0 ||
+           strcmp(priority, "high") == 0 || strcmp(priority, "urgent") == 0;
+}
+
+// Copies a string field into dest if the body has it; 0 if it is too long
+static int read_text_field(const JsonBody *fields, const char *key, char *dest, size_t size) {
+    return json_body_string(fields, key, dest, size) >= 0;
+}
+
+// Applies the fields present in a create or update body to task. Returns an
+// error message, or NULL when the task is valid afterwards.
+static const char *read_task_fields(const JsonBody *fields, Task *task) {
+    if (!read_text_field(fields, "title", task->title, sizeof(task->title))) return "title is too long";
+    if (!read_text_field(fields, "description", task->description, sizeof(task->description))) {
+        return "description is too long";
+    }
+    if (!read_text_field(fields, "priority", task->priority, sizeof(task->priority)) ||
+        !valid_priority(task->priority)) {
+        return "priority must be low, medium, high or urgent";
+    }
+    if (!read_text_field(fields, "recurrence_pattern", task->recurrence_pattern, sizeof(task->recurrence_pattern))) {
+        return "recurrence_pattern is too long";
+    }
+    
+    // Times are unix seconds; 0 clears one
+    task->scheduled_time = (time_t)json_body_int64(fields, "scheduled_time", task->scheduled_time);
+    task->start_time = (time_t)json_body_int64(fields, "start_time", task->start_time);
+    task->end_time = (time_t)json_body_int64(fields, "end_time", task->end_time);
+    task->estimated_duration = json_body_int(fields, "estimated_duration", task->estimated_duration);
+    task->is_recurring = json_body_bool(fields, "is_recurring", task->is_recurring);
+    
+    // A slot given only a start runs for the estimate
+    if (task->start_time > 0 && !json_body_has(fields, "end_time") && json_body_has(fields, "start_time") &&
+        task->estimated_duration > 0) {
+        task->end_time = task->start_time + (time_t)task->estimated_duration * 60;
+    }
+    
+    if (task->title[0] == '\0') return "title is required";
+    if (task->scheduled_time < 0 || task->start_time < 0 || task->end_time < 0 || task->estimated_duration < 0) {
+        return "times and durations cannot be negative";
+    }
+    if (task->start_time == 0) {
+        task->end_time = 0;
+    } else if (task->end_time <= task->start_time) {
+        return "end_time must be after start_time";
+    }
+    return NULL;
+}
+
+static void format_task_json(const Task *task, char *output, size_t size) {
+    char title[512], description[2048], pattern[200];
+    json_escape(task->title, title, sizeof(title));
+    json_escape(task->description, description, sizeof(description));
+    json_escape(task->recurrence_pattern, pattern, sizeof(pattern));
+    
+    snprintf(output, size,
+        "{\"task_id\":%d,\"title\":\"%s\",\"description\":\"%s\",\"priority\":\"%s\",\"status\":\"%s\","
+        "\"scheduled_time\":%lld,\"start_time\":%lld,\"end_time\":%lld,\"estimated_duration\":%d,"
+        "\"is_recurring\":%s,\"recurrence_pattern\":\"%s\",\"created_at\":%lld,\"updated_at\":%lld}",
+        task->task_id, title, description, task->priority, task->status,
+        (long long)task->scheduled_time, (long long)task->start_time, (long long)task->end_time,
+        task->estimated_duration, task->is_recurring ? "true" : "false", pattern,
+        (long long)task->created_at, (long long)task->updated_at);
+}
+
+// Sends {"success":true,"task":...,"conflict_count":n,"conflicts":[...]}. The
+// task is saved either way; overlapping tasks are reported, not refused.
+static void send_task_with_conflicts(int client_socket, int status_code, const Task *task,
+                                     const Interval *conflicts, int total) {
+    char task_json[4096];
+    format_task_json(task, task_json, sizeof(task_json));
+    
+    char response[BUFFER_SIZE - 512];
+    int offset = snprintf(response, sizeof(response),
+        "{\"success\":true,\"task\":%s,\"conflict_count\":%d,\"conflicts\":[", task_json, total);
+    for (int i = 0; i < total && i < MAX_CONFLICTS_LISTED && offset < (int)sizeof(response) - 128; i++) {
+        offset += snprintf(response + offset, sizeof(response) - offset,
+            "%s{\"task_id\":%d,\"start\":%lld,\"end\":%lld}",
+            i ? "," : "", conflicts[i].id, conflicts[i].start, conflicts[i].end);
+    }
+    snprintf(response + offset, sizeof(response) - offset, "]}");
+    send_json_response(client_socket, status_code, response);
+}
+
+// Overlaps of a task's slot with the user's other unfinished tasks
+static int task_conflicts(const Task *task, Interval *conflicts) {
+    if (task->start_time <= 0 || task_status_to_state(task->status) == TASK_STATE_FINISHED) return 0;
+    int total = find_schedule_conflicts(task->user_id, task->start_time, task->end_time, task->task_id,
+                                        conflicts, MAX_CONFLICTS_LISTED);
+    return total < 0 ? 0 : total;
+}
+
+void handle_create_task(int client_socket, const char *body, const HttpRequest *request) {
+    int user_id = authenticated_user_id(request);
+    if (user_id <= 0) {
+        send_json_error(client_socket, 401, "Authentication required");
+        return;
+    }
+    
+    Task task = {0};
+    task.user_id = user_id;
+    strcpy(task.priority, "medium");
+    strcpy(task.status, "pending");
+    
+    JsonBody fields;
+    json_body_parse(&fields, body, strlen(body));
+    
+    // A new task has no dependencies yet, so it may start in any state
+    if (!read_text_field(&fields, "status", task.status, sizeof(task.status)) ||
+        (strcmp(task.status, "pending") != 0 && strcmp(task.status, "running") != 0 &&
+         strcmp(task.status, "completed") != 0)) {
+        send_json_error(client_socket, 400, "status must be pending, running or completed");
+        return;
+    }
+    const char *error = read_task_fields(&fields, &task);
+    if (error) {
+        send_json_error(client_socket, 400, error);
+        return;
+    }
+    
+    task.task_id = create_task(&task);
+    if (!task.task_id) {
+        send_json_error(client_socket, 500, "Failed to create task");
+        return;
+    }
+    task.created_at = task.updated_at = time(NULL);
+    
+    Interval conflicts[MAX_CONFLICTS_LISTED];
+    int total = task_conflicts(&task, conflicts);
+    send_task_with_conflicts(client_socket, 201, &task, conflicts, total);
+}
+
+// GET /api/tasks?after=<task_id>&limit=<n>: one keyset page, oldest task first.
+// next_after is the cursor for the following page, null on the last one.
+void handle_get_tasks(int client_socket, const char *path, const HttpRequest *request) {
+    int user_id = authenticated_user_id(request);
+    if (user_id <= 0) {
+        send_json_error(client_socket, 401, "Authentication required");
+        return;
+    }
+    
+    long long after = extract_query_int64(path, "after", 0);
+    long long limit = extract_query_int64(path, "limit", TASKS_PAGE_DEFAULT);
+    if (after < 0 || after > 0x7fffffff || limit < 1 || limit > TASKS_PAGE_MAX) {
+        send_json_error(client_socket, 400, "after must be a task id and limit between 1 and 200");
+        return;
+    }
+    if (task_list_not_modified(client_socket, user_id, request)) return;
+    
+    // One extra row says whether another page follows
+    Task *page = malloc((size_t)(limit + 1) * sizeof(Task));
+    int count = page ? get_user_tasks(user_id, (int)after, (int)limit + 1, page) : -1;
+    if (count < 0) {
+        free(page);
+        send_json_error(client_socket, 500, "Failed to load tasks");
+        return;
+    }
+    int has_more = count > limit;
+    if (has_more) count = (int)limit;
+    
+    ResponseStream stream;
+    stream_begin(&stream, client_socket, 200);
+    stream_printf(&stream, "{\"success\":true,\"tasks\":[");
+    for (int i = 0; i < count && !stream.failed; i++) {
+        char task_json[4096];
+        format_task_json(&page[i], task_json, sizeof(task_json));
+        stream_printf(&stream, "%s%s", i ? "," : "", task_json);
+    }
+    if (has_more) {
+        stream_printf(&stream, "],\"count\":%d,\"has_more\":true,\"next_after\":%d}", count, page[count - 1].task_id);
+    } else {
+        stream_printf(&stream, "],\"count\":%d,\"has_more\":false,\"next_after\":null}", count);
+    }
+    stream_end(&stream);
+    
+    free(page);
+}
+
+// PUT /api/tasks/{id}: changes only the fields in the body
+void handle_update_task(int client_socket, int task_id, const char *body, const HttpRequest *request) {
+    int user_id = authenticated_user_id(request);
+    if (user_id <= 0) {
+        send_json_error(client_socket, 401, "Authentication required");
+        return;
+    }
+    JsonBody fields;
+    json_body_parse(&fields, body, strlen(body));
+    if (json_body_has(&fields, "status")) {
+        send_json_error(client_socket, 400, "Change status through /api/tasks/start or /api/tasks/complete");
+        return;
+    }
+    
+    Task task;
+    if (!get_task_by_id(task_id, user_id, &task)) {
+        send_json_error(client_socket, 404, "Task not found");
+        return;
+    }
+    long long old_start = task.start_time, old_end = task.end_time;
+    
+    const char *error = read_task_fields(&fields, &task);
+    if (error) {
+        send_json_error(client_socket, 400, error);
+        return;
+    }
+    task.updated_at = time(NULL);
+    if (!update_task(&task)) {
+        send_json_error(client_socket, 404, "Task not found");
+        return;
+    }
+    
+    // Finished tasks are not in the schedule
+    int finished = task_status_to_state(task.status) == TASK_STATE_FINISHED;
+    if (!finished && (task.start_time != old_start || task.end_time != old_end)) {
+        schedule_task_moved(user_id, task_id, old_start, task.start_time, task.end_time);
+    }
+    
+    Interval conflicts[MAX_CONFLICTS_LISTED];
+    int total = task_conflicts(&task, conflicts);
+    send_task_with_conflicts(client_socket, 200, &task, conflicts, total);
+}
+
+void handle_delete_task(int client_socket, int task_id, const HttpRequest *request) {
+    int user_id = authenticated_user_id(request);
+    if (user_id <= 0) {
+        send_json_error(client_socket, 401, "Authentication required");
+        return;
+    }
+    
+    Task task;
+    if (!get_task_by_id(task_id, user_id, &task) || !delete_task(task_id, user_id)) {
+        send_json_error(client_socket, 404, "Task not found");
+        return;
+    }
+    
+    // The graph has no way to drop a node, and its edges went with the row
+    invalidate_task_graph(user_id);
+    if (task.start_time > 0) schedule_task_moved(user_id, task_id, task.start_time, 0, 0);
+    
+    char response[128];
+    snprintf(response, sizeof(response), "{\"success\":true,\"task_id\":%d}", task_id);
+    send_json_response(client_socket, 200, response);
+}
+
+void handle_get_ready_tasks(int client_socket, const HttpRequest *request) {
+    int user_id = authenticated_user_id(request);
+    if (user_id <= 0) {
+        send_json_error(client_socket, 401, "Authentication required");
+        return;
+    }
+    if (task_list_not_modified(client_socket, user_id, request)) return;
+    
+    int ids[MAX_READY_IDS];
+    
+    MUTEX_LOCK(graph_mutex);
+    TaskGraph *graph = get_task_graph(user_id);
+    int total = graph ? task_graph_ready(graph, ids, MAX_READY_IDS) : -1;
+    MUTEX_UNLOCK(graph_mutex);
+    
+    if (total < 0) {
+        send_json_error(client_socket, 500, "Failed to load task dependencies");
+        return;
+    }
+    
+    int listed = total < MAX_READY_IDS ? total : MAX_READY_IDS;
+    ResponseStream stream;
+    stream_begin(&stream, client_socket, 200);
+    stream_printf(&stream, "{\"success\":true,\"count\":%d,\"task_ids\":[", total);
+    for (int i = 0; i < listed; i++) {
+        stream_printf(&stream, "%s%d", i ? "," : "", ids[i]);
+    }
+    stream_printf(&stream, "]}");
+    stream_end(&stream);
+}
+
+void handle_add_dependency(int client_socket, const char *body, const HttpRequest *request) {
+    int user_id = authenticated_user_id(request);
+    if (user_id <= 0) {
+        send_json_error(client_socket, 401, "Authentication required");
+        return;
+    }
+    
+    JsonBody fields;
+    json_body_parse(&fields, body, strlen(body));
+    int task_id = json_body_int(&fields, "task_id", 0);
+    int depends_on = json_body_int(&fields, "depends_on_task_id", 0);
+    char type_name[32] = "";
+    int type = json_body_string(&fields, "dependency_type", type_name, sizeof(type_name)) >= 0 ?
+               task_graph_dependency_type(type_name) : -1;
+    
+    if (task_id <= 0 || depends_on <= 0 || type < 0) {
+        send_json_error(client_socket, 400, "task_id, depends_on_task_id and a valid dependency_type are required");
+        return;
+    }
+    
+    MUTEX_LOCK(graph_mutex);
+    
+    TaskGraph *graph = get_task_graph(user_id);
+    int rc = graph ? task_graph_add_edge(graph, task_id, depends_on, type) : TASK_GRAPH_NO_MEMORY;
+    
+    if (rc == TASK_GRAPH_OK) {
+        const char *sql = 
+            "INSERT INTO task_dependencies (task_id, depends_on_task_id, dependency_type) "
+            "VALUES (?, ?, ?);";
+        sqlite3_stmt *stmt;
+        
+        MUTEX_LOCK(db_mutex);
+        int saved = 0;
+        if (sqlite3_prepare_v2(db, sql, -1, &stmt, NULL) == SQLITE_OK) {
+            sqlite3_bind_int(stmt, 1, task_id);
+            sqlite3_bind_int(stmt, 2, depends_on);
+            sqlite3_bind_text(stmt, 3, task_graph_dependency_name(type), -1, SQLITE_STATIC);
+            saved = sqlite3_step(stmt) == SQLITE_DONE;
+            sqlite3_finalize(stmt);
+        }
+        MUTEX_UNLOCK(db_mutex);
+        
+        if (saved) {
+            bump_task_version(user_id);
+        } else {
+            task_graph_remove_edge(graph, task_id, depends_on);
+            rc = TASK_GRAPH_NO_MEMORY;
+        }
+    }
+    
+    int can_start = (rc == TASK_GRAPH_OK) ? task_graph_can_start(graph, task_id) : 0;
+    MUTEX_UNLOCK(graph_mutex);
+    
+    if (rc == TASK_GRAPH_CYCLE) {
+        send_json_error(client_socket, 409, "Dependency would create a cycle");
+    } else if (rc == TASK_GRAPH_EXISTS) {
+        send_json_error(client_socket, 409, "Dependency already exists");
+    } else if (rc == TASK_GRAPH_NOT_FOUND) {
+        send_json_error(client_socket, 404, "Task not found");
+    } else if (rc != TASK_GRAPH_OK) {
+        send_json_error(client_socket, 500, "Failed to save dependency");
+    } else {
+        char response[256];
+        snprintf(response, sizeof(response),
+            "{\"success\":true,\"task_id\":%d,\"depends_on_task_id\":%d,"
+            "\"dependency_type\":\"%s\",\"can_start\":%s}",
+            task_id, depends_on, task_graph_dependency_name(type), can_start ? "true" : "false");
+        send_json_response(client_socket, 200, response);
+    }
+}
+
+// Moves a task to "running" or "completed" if its dependencies allow it and
+// reports the dependents that became startable as a result
+void handle_set_task_state(int client_socket, const char *body, const HttpRequest *request, const char *status) {
+    int user_id = authenticated_user_id(request);
+    if (user_id <= 0) {
+        send_json_error(client_socket, 401, "Authentication required");
+        return;
+    }
+    
+    JsonBody fields;
+    json_body_parse(&fields, body, strlen(body));
+    int task_id = json_body_int(&fields, "task_id", 0);
+    if (task_id <= 0) {
+        send_json_error(client_socket, 400, "task_id is required");
+        return;
+    }
+    
+    int state = task_status_to_state(status);
+    int released[MAX_READY_IDS];
+    int released_count = 0;
+    long long start_time = 0;
+    int error_status = 0;
+    const char *error = NULL;
+    
+    MUTEX_LOCK(graph_mutex);
+    
+    TaskGraph *graph = get_task_graph(user_id);
+    int allowed = !graph ? -2 : state == TASK_STATE_FINISHED ? task_graph_can_finish(graph, task_id)
+                                                            : task_graph_can_start(graph, task_id);
+    if (allowed == -2) {
+        error_status = 500;
+        error = "Failed to load task dependencies";
+    } else if (allowed < 0) {
+        error_status = 404;
+        error = "Task not found";
+    } else if (!allowed) {
+        error_status = 409;
+        error = "Task is blocked by its dependencies";
+    } else {
+        const char *sql = "UPDATE tasks SET status = ?, updated_at = ? WHERE task_id = ? AND user_id = ?;";
+        sqlite3_stmt *stmt;
+        
+        MUTEX_LOCK(db_mutex);
+        int saved = 0;
+        if (sqlite3_prepare_v2(db, sql, -1, &stmt, NULL) == SQLITE_OK) {
+            sqlite3_bind_text(stmt, 1, status, -1, SQLITE_STATIC);
+            sqlite3_bind_int64(stmt, 2, time(NULL));
+            sqlite3_bind_int(stmt, 3, task_id);
+            sqlite3_bind_int(stmt, 4, user_id);
+            saved = sqlite3_step(stmt) == SQLITE_DONE;
+            sqlite3_finalize(stmt);
+        }
+        if (saved && state == TASK_STATE_FINISHED &&
+            sqlite3_prepare_v2(db, "SELECT start_time FROM tasks WHERE task_id = ?;", -1, &stmt, NULL) == SQLITE_OK) {
+            sqlite3_bind_int(stmt, 1, task_id);
+            if (sqlite3_step(stmt) == SQLITE_ROW) start_time = sqlite3_column_int64(stmt, 0);
+            sqlite3_finalize(stmt);
+        }
+        MUTEX_UNLOCK(db_mutex);
+        
+        if (saved) {
+            bump_task_version(user_id);
+            released_count = task_graph_set_state(graph, task_id, state, released, MAX_READY_IDS);
+        } else {
+            error_status = 500;
+            error = "Failed to update task";
+        }
+    }
+    
+    MUTEX_UNLOCK(graph_mutex);
+    
+    if (error) {
+        send_json_error(client_socket, error_status, error);
+        return;
+    }
+    
+    // A finished task no longer holds its time
+    if (start_time > 0) schedule_task_moved(user_id, task_id, start_time, 0, 0);
+    
+    char response[BUFFER_SIZE - 512];
+    int listed = released_count < MAX_READY_IDS ? released_count : MAX_READY_IDS;
+    int offset = snprintf(response, sizeof(response),
+        "{\"success\":true,\"task_id\":%d,\"status\":\"%s\",\"released\":[", task_id, status);
+    for (int i = 0; i < listed && offset < (int)sizeof(response) - 64; i++) {
+        offset += snprintf(response + offset, sizeof(response) - offset, "%s%d", i ? "," : "", released[i]);
+    }
+    snprintf(response + offset, sizeof(response) - offset, "]}");
+    
+    send_json_response(client_socket, 200, response);
+}
+
+static int priority_rank(const char *priority) {
+    if (!priority) return 2;
+    if (strcmp(priority, "urgent") == 0) return 4;
+    if (strcmp(priority, "high") == 0) return 3;
+    if (strcmp(priority, "low") == 0) return 1;
+    return 2;
+}
+
+// Packs the user's unslotted pending tasks into free working hours over the
+// next `days` days. scheduled_time on an unslotted task is its deadline.
+// With "apply":true the placements are written to start_time/end_time.
+void handle_autoslot(int client_socket, const char *body, const HttpRequest *request) {
+    int user_id = authenticated_user_id(request);
+    if (user_id <= 0) {
+        send_json_error(client_socket, 401, "Authentication required");
+        return;
+    }
+    
+    SlotWindow window;
+    window.from = time(NULL);
+    JsonBody fields;
+    json_body_parse(&fields, body, strlen(body));
+    window.days = json_body_int(&fields, "days", 7);
+    window.day_start_minute = json_body_int(&fields, "day_start_hour", 9) * 60;
+    window.day_end_minute = json_body_int(&fields, "day_end_hour", 17) * 60;
+    window.utc_offset_minutes = json_body_int(&fields, "utc_offset", 0);
+    int apply = json_body_bool(&fields, "apply", 0);
+    
+    if (window.days < 1 || window.days > AUTOSLOT_MAX_DAYS ||
+        window.day_start_minute < 0 || window.day_end_minute > 24 * 60 ||
+        window.day_start_minute >= window.day_end_minute) {
+        send_json_error(client_socket, 400, "Invalid days or working hours");
+        return;
+    }
+    
+    const char *busy_sql = 
+        "SELECT task_id, start_time, end_time FROM tasks "
+        "WHERE user_id = ? AND start_time IS NOT NULL AND start_time < ? AND end_time > ? "
+        "AND status NOT IN ('completed', 'cancelled', 'failed');";
+    const char *pending_sql = 
+        "SELECT task_id, priority, estimated_duration, scheduled_time FROM tasks "
+        "WHERE user_id = ? AND status = 'pending' AND start_time IS NULL "
+        "ORDER BY task_id LIMIT ?;";
+    
+    long long horizon_end = window.from + (long long)(window.days + 1) * 86400;
+    SlotRequest *requests = malloc(AUTOSLOT_MAX_TASKS * sizeof(SlotRequest));
+    SlotPlacement *placements = malloc(AUTOSLOT_MAX_TASKS * sizeof(SlotPlacement));
+    if (!requests || !placements) {
+        free(requests);
+        free(placements);
+        send_json_error(client_socket, 500, "Out of memory");
+        return;
+    }
+    
+    IntervalTree busy;
+    interval_tree_init(&busy);
+    int count = 0;
+    sqlite3_stmt *stmt;
+    
+    MUTEX_LOCK(db_mutex);
+    
+    if (sqlite3_prepare_v2(db, busy_sql, -1, &stmt, NULL) == SQLITE_OK) {
+        sqlite3_bind_int(stmt, 1, user_id);
+        sqlite3_bind_int64(stmt, 2, horizon_end);
+        sqlite3_bind_int64(stmt, 3, window.from);
+        while (sqlite3_step(stmt) == SQLITE_ROW) {
+            interval_tree_insert(&busy, sqlite3_column_int64(stmt, 1), sqlite3_column_int64(stmt, 2),
+                                 sqlite3_column_int(stmt, 0));
+        }
+        sqlite3_finalize(stmt);
+    }
+    
+    if (sqlite3_prepare_v2(db, pending_sql, -1, &stmt, NULL) == SQLITE_OK) {
+        sqlite3_bind_int(stmt, 1, user_id);
+        sqlite3_bind_int(stmt, 2, AUTOSLOT_MAX_TASKS);
+        while (sqlite3_step(stmt) == SQLITE_ROW && count < AUTOSLOT_MAX_TASKS) {
+            int minutes = sqlite3_column_int(stmt, 2);
+            SlotRequest *request = &requests[count++];
+            request->task_id = sqlite3_column_int(stmt, 0);
+            request->priority = priority_rank((const char*)sqlite3_column_text(stmt, 1));
+            request->duration_sec = (minutes > 0 ? minutes : AUTOSLOT_DEFAULT_DURATION_MIN) * 60;
+            request->deadline = sqlite3_column_int64(stmt, 3);
+        }
+        sqlite3_finalize(stmt);
+    }
+    
+    MUTEX_UNLOCK(db_mutex);
+    
+    int placed = autoslot_plan(&busy, requests, count, &window, placements);
+    interval_tree_free(&busy);
+    if (placed < 0) {
+        // placements was never filled in
+        free(requests);
+        free(placements);
+        send_json_error(client_socket, 500, "Out of memory");
+        return;
+    }
+    
+    int late = 0;
+    for (int i = 0; i < count; i++) late += placements[i].late;
+    
+    if (apply && placed > 0) {
+        const char *update_sql = 
+            "UPDATE tasks SET start_time = ?, end_time = ?, updated_at = ? "
+            "WHERE task_id = ? AND user_id = ? AND start_time IS NULL;";
+        
+        // All placements are written or none are
+        MUTEX_LOCK(db_mutex);
+        int began = sqlite3_exec(db, "BEGIN;", 0, 0, 0) == SQLITE_OK;
+        int failed = !began;
+        if (began && sqlite3_prepare_v2(db, update_sql, -1, &stmt, NULL) == SQLITE_OK) {
+            for (int i = 0; i < count && !failed; i++) {
+                if (!placements[i].start) continue;
+                sqlite3_bind_int64(stmt, 1, placements[i].start);
+                sqlite3_bind_int64(stmt, 2, placements[i].end);
+                sqlite3_bind_int64(stmt, 3, window.from);
+                sqlite3_bind_int(stmt, 4, placements[i].task_id);
+                sqlite3_bind_int(stmt, 5, user_id);
+                failed = sqlite3_step(stmt) != SQLITE_DONE;
+                sqlite3_reset(stmt);
+            }
+            sqlite3_finalize(stmt);
+        } else {
+            failed = 1;
+        }
+        if (!failed) failed = sqlite3_exec(db, "COMMIT;", 0, 0, 0) != SQLITE_OK;
+        if (failed && began) sqlite3_exec(db, "ROLLBACK;", 0, 0, 0);
+        MUTEX_UNLOCK(db_mutex);
+        
+        if (failed) {
+            free(requests);
+            free(placements);
+            send_json_error(client_socket, 500, "Failed to apply slots");
+            return;
+        }
+        bump_task_version(user_id);
+        invalidate_task_schedule(user_id);
+    }
+    
+    char response[BUFFER_SIZE - 512];
+    int offset = snprintf(response, sizeof(response),
+        "{\"success\":true,\"applied\":%s,\"pending\":%d,\"placed\":%d,\"late\":%d,\"slots\":[",
+        apply ? "true" : "false", count, placed, late);
+    int listed = 0;
+    for (int i = 0; i < count && listed < AUTOSLOT_MAX_LISTED; i++) {
+        if (!placements[i].start) continue;
+        if (offset > (int)sizeof(response) - 128) break;
+        offset += snprintf(response + offset, sizeof(response) - offset,
+            "%s{\"task_id\":%d,\"start\":%lld,\"end\":%lld,\"late\":%s}",
+            listed ? "," : "", placements[i].task_id, placements[i].start, placements[i].end,
+            placements[i].late ? "true" : "false");
+        listed++;
+    }
+    snprintf(response + offset, sizeof(response) - offset, "],\"truncated\":%s}",
+             listed < placed ? "true" : "false");
+    
+    free(requests);
+    free(placements);
+    send_json_response(client_socket, 200, response);
+}
+
+// Without a query, every pair of the user's unfinished tasks whose windows
+// overlap. With ?start=&end= (and optionally &exclude=<task_id>), the tasks
+// overlapping that window, as a client would check before moving a task there.
+void handle_get_conflicts(int client_socket, const char *path, const HttpRequest *request) {
+    int user_id = authenticated_user_id(request);
+    if (user_id <= 0) {
+        send_json_error(client_socket, 401, "Authentication required");
+        return;
+    }
+    if (task_list_not_modified(client_socket, user_id, request)) return;
+    
+    long long start = extract_query_int64(path, "start", 0);
+    long long end = extract_query_int64(path, "end", 0);
+    char response[BUFFER_SIZE - 512];
+    int offset, listed = 0, total;
+    
+    if (start > 0 || end > 0) {
+        if (end <= start) {
+            send_json_error(client_socket, 400, "end must be after start");
+            return;
+        }
+        
+        Interval overlaps[MAX_CONFLICTS_LISTED];
+        int exclude = (int)extract_query_int64(path, "exclude", 0);
+        total = find_schedule_conflicts(user_id, start, end, exclude, overlaps, MAX_CONFLICTS_LISTED);
+        if (total < 0) {
+            send_json_error(client_socket, 500, "Failed to load schedule");
+            return;
+        }
+        
+        offset = snprintf(response, sizeof(response), "{\"success\":true,\"count\":%d,\"conflicts\":[", total);
+        for (; listed < total && listed < MAX_CONFLICTS_LISTED; listed++) {
+            if (offset > (int)sizeof(response) - 128) break;
+            offset += snprintf(response + offset, sizeof(response) - offset,
+                "%s{\"task_id\":%d,\"start\":%lld,\"end\":%lld}",
+                listed ? "," : "", overlaps[listed].id, overlaps[listed].start, overlaps[listed].end);
+        }
+    } else {
+        IntervalConflict pairs[MAX_CONFLICTS_LISTED];
+        
+        MUTEX_LOCK(schedule_mutex);
+        IntervalTree *tree = get_task_schedule(user_id);
+        total = tree ? interval_tree_conflicts(tree, pairs, MAX_CONFLICTS_LISTED) : -1;
+        MUTEX_UNLOCK(schedule_mutex);
+        
+        if (total < 0) {
+            send_json_error(client_socket, 500, "Failed to load schedule");
+            return;
+        }
+        
+        offset = snprintf(response, sizeof(response), "{\"success\":true,\"count\":%d,\"conflicts\":[", total);
+        for (; listed < total && listed < MAX_CONFLICTS_LISTED; listed++) {
+            if (offset > (int)sizeof(response) - 128) break;
+            offset += snprintf(response + offset, sizeof(response) - offset,
+                "%s{\"task_id\":%d,\"other_task_id\":%d,\"start\":%lld,\"end\":%lld}",
+                listed ? "," : "", pairs[listed].first_id, pairs[listed].second_id,
+                pairs[listed].start, pairs[listed].end);
+        }
+    }
+    
+    snprintf(response + offset, sizeof(response) - offset, "],\"truncated\":%s}",
+             listed < total ? "true" : "false");
+    send_json_response(client_socket, 200, response);
+}
+
+static void read_calendar_event(sqlite3_stmt *stmt, CalendarEvent *event) {
+    event->task_id = sqlite3_column_int(stmt, 0);
+    copy_column_text(stmt, 1, event->title, sizeof(event->title));
+    copy_column_text(stmt, 2, event->priority, sizeof(event->priority));
+    copy_column_text(stmt, 3, event->status, sizeof(event->status));
+    event->time = sqlite3_column_int64(stmt, 4);
+    event->duration = sqlite3_column_int(stmt, 5);
+}
+
+// Recurring tasks of the user that can occur before `to`, each positioned at its
+// first occurrence at or after `from`; series with none in [from, to) are dropped.
+// Whether a rule occurs in the window is only known once it is compiled, so the
+// CALENDAR_MAX_SERIES cap counts kept series, and *more is set when another
+// series would have been kept.
+static int load_calendar_series(int user_id, long long from, long long to, CalendarSeries *series, int *more) {
+    const char *sql = 
+        "SELECT task_id, title, priority, status, scheduled_time, "
+        "COALESCE(end_time - start_time, estimated_duration * 60, 0), recurrence_pattern, created_at "
+        "FROM tasks WHERE user_id = ? AND is_recurring = 1 "
+        "AND recurrence_pattern IS NOT NULL AND recurrence_pattern <> '' "
+        "AND (scheduled_time IS NULL OR scheduled_time < ?) ORDER BY task_id;";
+    
+    sqlite3_stmt *stmt;
+    int count = 0;
+    *more = 0;
+    
+    MUTEX_LOCK(db_mutex);
+    if (sqlite3_prepare_v2(db, sql, -1, &stmt, NULL) != SQLITE_OK) {
+        MUTEX_UNLOCK(db_mutex);
+        return -1;
+    }
+    sqlite3_bind_int(stmt, 1, user_id);
+    sqlite3_bind_int64(stmt, 2, to);
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        CalendarSeries entry;
+        read_calendar_event(stmt, &entry.event);
+        
+        long long anchor = entry.event.time > 0 ? entry.event.time : sqlite3_column_int64(stmt, 7);
+        const char *pattern = (const char*)sqlite3_column_text(stmt, 6);
+        if (!pattern || !recurrence_from_pattern(&entry.rule, anchor, pattern)) continue;
+        
+        entry.event.time = recurrence_next(&entry.rule, from - 1);
+        if (entry.event.time < from || entry.event.time >= to) continue;
+        if (count == CALENDAR_MAX_SERIES) {
+            *more = 1;
+            break;
+        }
+        series[count++] = entry;
+    }
+    sqlite3_finalize(stmt);
+    MUTEX_UNLOCK(db_mutex);
+    
+    return count;
+}
+
+// Next page of one-off tasks scheduled in [from, to), after (after_time, after_id)
+static int load_calendar_page(int user_id, long long after_time, int after_id, long long to, CalendarEvent *page) {
+    const char *sql = 
+        "SELECT task_id, title, priority, status, scheduled_time, "
+        "COALESCE(end_time - start_time, estimated_duration * 60, 0) "
+        "FROM tasks WHERE user_id = ? AND scheduled_time >= ? AND scheduled_time < ? "
+        "AND (scheduled_time > ? OR task_id > ?) AND is_recurring = 0 "
+        "ORDER BY scheduled_time, task_id LIMIT ?;";
+    
+    sqlite3_stmt *stmt;
+    int count = 0;
+    
+    MUTEX_LOCK(db_mutex);
+    if (sqlite3_prepare_v2(db, sql, -1, &stmt, NULL) != SQLITE_OK) {
+        MUTEX_UNLOCK(db_mutex);
+        return -1;
+    }
+    sqlite3_bind_int(stmt, 1, user_id);
+    sqlite3_bind_int64(stmt, 2, after_time);
+    sqlite3_bind_int64(stmt, 3, to);
+    sqlite3_bind_int64(stmt, 4, after_time);
+    sqlite3_bind_int(stmt, 5, after_id);
+    sqlite3_bind_int(stmt, 6, CALENDAR_PAGE_SIZE);
+    while (sqlite3_step(stmt) == SQLITE_ROW && count < CALENDAR_PAGE_SIZE) {
+        read_calendar_event(stmt, &page[count++]);
+    }
+    sqlite3_finalize(stmt);
+    MUTEX_UNLOCK(db_mutex);
+    
+    return count;
+}
+
+static int series_before(const CalendarSeries *a, const CalendarSeries *b) {
+    if (a->event.time != b->event.time) return a->event.time < b->event.time;
+    return a->event.task_id < b->event.task_id;
+}
+
+// Restores the min-heap below index `at` after its occurrence moved later
+static void series_sift_down(CalendarSeries *heap, int count, int at) {
+    for (;;) {
+        int smallest = at;
+        int left = 2 * at + 1, right = left + 1;
+        if (left < count && series_before(&heap[left], &heap[smallest])) smallest = left;
+        if (right < count && series_before(&heap[right], &heap[smallest])) smallest = right;
+        if (smallest == at) return;
+        CalendarSeries swap = heap[at];
+        heap[at] = heap[smallest];
+        heap[smallest] = swap;
+        at = smallest;
+    }
+}
+
+static void stream_calendar_event(ResponseStream *stream, const CalendarEvent *event, int recurring, int first) {
+    char title[512];
+    json_escape(event->title, title, sizeof(title));
+    stream_printf(stream,
+        "%s{\"task_id\":%d,\"title\":\"%s\",\"priority\":\"%s\",\"status\":\"%s\","
+        "\"time\":%lld,\"duration\":%d,\"recurring\":%s}",
+        first ? "" : ",", event->task_id, title, event->priority, event->status,
+        event->time, event->duration, recurring ? "true" : "false");
+}
+
+// Everything on the user's calendar in [from, to), in time order. One-off tasks
+// come from the (user_id, scheduled_time) index a page at a time; recurring
+// tasks are expanded lazily, a heap yielding the earliest pending occurrence,
+// so only occurrences inside the window are ever computed. The response is
+// streamed as it is merged and db_mutex is never held while sending.
+void handle_get_calendar(int client_socket, const char *path, const HttpRequest *request) {
+    int user_id = authenticated_user_id(request);
+    if (user_id <= 0) {
+        send_json_error(client_socket, 401, "Authentication required");
+        return;
+    }
+    
+    long long from = extract_query_int64(path, "from", 0);
+    long long to = extract_query_int64(path, "to", 0);
+    if (from <= 0 || to <= from || to - from > (long long)CALENDAR_MAX_DAYS * 86400) {
+        send_json_error(client_socket, 400, "from and to are required, at most a year apart");
+        return;
+    }
+    if (task_list_not_modified(client_socket, user_id, request)) return;
+    
+    CalendarSeries *series = malloc(CALENDAR_MAX_SERIES * sizeof(CalendarSeries));
+    CalendarEvent *page = malloc(CALENDAR_PAGE_SIZE * sizeof(CalendarEvent));
+    int series_more = 0;
+    int series_count = series ? load_calendar_series(user_id, from, to, series, &series_more) : -1;
+    int page_count = page ? load_calendar_page(user_id, from, 0, to, page) : -1;
+    if (series_count < 0 || page_count < 0) {
+        free(series);
+        free(page);
+        send_json_error(client_socket, 500, "Failed to load calendar");
+        return;
+    }
+    
+    for (int i = series_count / 2 - 1; i >= 0; i--) series_sift_down(series, series_count, i);
+    
+    ResponseStream stream;
+    stream_begin(&stream, client_socket, 200);
+    stream_printf(&stream, "{\"success\":true,\"from\":%lld,\"to\":%lld,\"events\":[", from, to);
+    
+    int sent = 0, page_at = 0;
+    while (!stream.failed && sent < CALENDAR_MAX_EVENTS) {
+        if (page_at == page_count && page_count == CALENDAR_PAGE_SIZE) {
+            const CalendarEvent *last = &page[page_count - 1];
+            page_count = load_calendar_page(user_id, last->time, last->task_id, to, page);
+            page_at = 0;
+            if (page_count < 0) page_count = 0;
+        }
+        
+        int take_page = page_at < page_count &&
+            (series_count == 0 || page[page_at].time <= series[0].event.time);
+        if (take_page) {
+            stream_calendar_event(&stream, &page[page_at++], 0, sent == 0);
+        } else if (series_count > 0) {
+            stream_calendar_event(&stream, &series[0].event, 1, sent == 0);
+            
+            long long next = recurrence_next(&series[0].rule, series[0].event.time);
+            if (next >= 0 && next < to) {
+                series[0].event.time = next;
+            } else {
+                series[0] = series[--series_count];
+            }
+            series_sift_down(series, series_count, 0);
+        } else {
+            break;
+        }
+        sent++;
+    }
+    
+    // At the cap with a full page used up, only the next page tells whether
+    // one-off events were left out
+    if (sent == CALENDAR_MAX_EVENTS && page_at == page_count && page_count == CALENDAR_PAGE_SIZE) {
+        const CalendarEvent *last = &page[page_count - 1];
+        page_count = load_calendar_page(user_id, last->time, last->task_id, to, page);
+        page_at = 0;
+        if (page_count < 0) page_count = 1;  // Unknown, so report it as cut short
+    }
+    int truncated = series_more ||
+        (sent == CALENDAR_MAX_EVENTS && (page_at < page_count || series_count > 0));
+    stream_printf(&stream, "],\"count\":%d,\"truncated\":%s}", sent, truncated ? "true" : "false");
+    stream_end(&stream);
+    
+    free(series);
+    free(page);
+}
+
+// Main server implementation continues...
+
+// User id of a fully authenticated "Authorization: Bearer <session_id>", or 0
+int authenticated_user_id(const HttpRequest *request) {
+    const HttpSpan *authorization = http_header(request, "Authorization");
+    if (!authorization || authorization->length <= 7 ||
+        strncmp(http_span_data(request, *authorization), "Bearer ", 7) != 0) {
+        return 0;
+    }
+    
+    HttpSpan token = { authorization->offset + 7, authorization->length - 7 };
+    char session_id[64];
+    Session session;
+    if (!http_span_copy(request, token, session_id, sizeof(session_id)) ||
+        !get_session(session_id, &session) || !session.is_authenticated) {
+        return 0;
+    }
+    return session.user_id;
+}
+
+// Numeric query parameter of a request path ("/x?start=1&end=2")
+long long extract_query_int64(const char *path, const char *name, long long default_value) {
+    const char *query = path ? strchr(path, '?') : NULL;
+    size_t name_len = strlen(name);
+    
+    while (query) {
+        query++; // Skip '?' or '&'
+        if (strncmp(query, name, name_len) == 0 && query[name_len] == '=') {
+            const char *start = query + name_len + 1;
+            char *end;
+            long long value = strtoll(start, &end, 10);
+            return end == start ? default_value : value;
+        }
+        query = strchr(query, '&');
+    }
+    return default_value;
+}
+
+// Peer address of the connection; the rate limiter keys on it, so it has to
+// tell clients apart. Behind a proxy this is the proxy's address.
+void extract_client_ip(int client_socket, char *ip, size_t size) {
+    struct sockaddr_storage address;
+    socklen_t length = sizeof(address);
+    snprintf(ip, size, "unknown");
+    if (getpeername(client_socket, (struct sockaddr*)&address, &length) != 0) return;
+    
+    if (address.ss_family == AF_INET) {
+        inet_ntop(AF_INET, &((struct sockaddr_in*)&address)->sin_addr, ip, size);
+    } else if (address.ss_family == AF_INET6) {
+        inet_ntop(AF_INET6, &((struct sockaddr_in6*)&address)->sin6_addr, ip, size);
+    }
+}
+
+// Into the caller's buffer: workers run concurrently, and a request without
+// the header must not inherit the previous one's value
+void extract_user_agent(const HttpRequest *request, char *user_agent, size_t size) {
+    const HttpSpan *value = http_header(request, "User-Agent");
+    snprintf(user_agent, size, "Unknown");
+    if (value) http_span_copy(request, *value, user_agent, (int)size);
+}
+
+typedef struct {
+    char (*keys)[RATE_LIMITER_KEY_MAX];
+    unsigned int *counts;
+    int count;
+    int capacity;
+} RateSummaryRows;
+
+static void collect_rate_summary(const RateLimiterSummary *summary, void *context) {
+    RateSummaryRows *rows = context;
+    if (rows->count == rows->capacity) {
+        int capacity = rows->capacity ? rows->capacity * 2 : 64;
+        char (*keys)[RATE_LIMITER_KEY_MAX] = realloc(rows->keys, capacity * sizeof(*keys));
+        if (keys) rows->keys = keys;
+        unsigned int *counts = realloc(rows->counts, capacity * sizeof(*counts));
+        if (counts) rows->counts = counts;
+        if (!keys || !counts) return; // Summary is best effort
+        rows->capacity = capacity;
+    }
+    snprintf(rows->keys[rows->count], RATE_LIMITER_KEY_MAX, "%s", summary->key);
+    rows->counts[rows->count++] = summary->allowed + summary->denied;
+}
+
+// Records each client address's requests since the last summary in
+// rate_limits, in one transaction. Limiting itself never reads the table.
+void write_rate_limit_summary(void) {
+    static time_t window_start = 0;
+    time_t now = time(NULL);
+    if (!window_start) window_start = now;
+    
+    // Taken from the limiter before db_mutex, so no shard lock waits on the database
+    RateSummaryRows rows = {0};
+    rate_limiter_drain(collect_rate_summary, &rows);
+    
+    if (rows.count > 0) {
+        const char *sql =
+            "INSERT OR REPLACE INTO rate_limits (ip_address, request_count, window_start) VALUES (?, ?, ?);";
+        sqlite3_stmt *stmt;
+        
+        MUTEX_LOCK(db_mutex);
+        sqlite3_exec(db, "BEGIN;", 0, 0, 0);
+        if (sqlite3_prepare_v2(db, sql, -1, &stmt, NULL) == SQLITE_OK) {
+            for (int i = 0; i < rows.count; i++) {
+                sqlite3_bind_text(stmt, 1, rows.keys[i], -1, SQLITE_STATIC);
+                sqlite3_bind_int(stmt, 2, (int)rows.counts[i]);
+                sqlite3_bind_int64(stmt, 3, window_start);
+                sqlite3_step(stmt);
+                sqlite3_reset(stmt);
+            }
+            sqlite3_finalize(stmt);
+        }
+        sqlite3_exec(db, "COMMIT;", 0, 0, 0);
+        MUTEX_UNLOCK(db_mutex);
+    }
+    
+    free(rows.keys);
+    free(rows.counts);
+    window_start = now;
+}
+
+void cleanup_expired_sessions() {
+    const char *sql = "DELETE FROM sessions WHERE last_activity < ?;";
+    sqlite3_stmt *stmt;
+    time_t cutoff = time(NULL) - SESSION_TIMEOUT;
+    
+    MUTEX_LOCK(db_mutex);
+    
+    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
+    if (rc == SQLITE_OK) {
+        sqlite3_bind_int64(stmt, 1, cutoff);
         sqlite3_step(stmt);
         
         int deleted = sqlite3_changes(db);
@@ -788,56 +2783,254 @@ int lock_user_account(int user_id, int duration) {
     return (rc == SQLITE_DONE) ? 1 : 0;
 }
 
-void route_request(int client_socket, const char *method, const char *path, const char *body, const char *headers) {
-    char *ip_address = extract_client_ip(headers);
+// Route table: built once in main before the server accepts, read-only after
+
+static Router routes;
+
+static void route_register(int client_socket, const RouteParams *params, void *context) {
+    const RouteContext *route = context;
+    (void)params;
+    handle_register(client_socket, route->body, route->ip_address);
+}
+
+static void route_login_step1(int client_socket, const RouteParams *params, void *context) {
+    const RouteContext *route = context;
+    (void)params;
+    handle_login_step1(client_socket, route->body, route->ip_address);
+}
+
+static void route_login_step2(int client_socket, const RouteParams *params, void *context) {
+    const RouteContext *route = context;
+    (void)params;
+    handle_login_step2(client_socket, route->body, route->ip_address);
+}
+
+static void route_create_task(int client_socket, const RouteParams *params, void *context) {
+    const RouteContext *route = context;
+    (void)params;
+    handle_create_task(client_socket, route->body, route->request);
+}
+
+static void route_get_tasks(int client_socket, const RouteParams *params, void *context) {
+    const RouteContext *route = context;
+    (void)params;
+    handle_get_tasks(client_socket, route->path, route->request);
+}
+
+static void route_update_task(int client_socket, const RouteParams *params, void *context) {
+    const RouteContext *route = context;
+    handle_update_task(client_socket, (int)route_param_int(params, "id", 0), route->body, route->request);
+}
+
+static void route_delete_task(int client_socket, const RouteParams *params, void *context) {
+    const RouteContext *route = context;
+    handle_delete_task(client_socket, (int)route_param_int(params, "id", 0), route->request);
+}
+
+static void route_add_dependency(int client_socket, const RouteParams *params, void *context) {
+    const RouteContext *route = context;
+    (void)params;
+    handle_add_dependency(client_socket, route->body, route->request);
+}
+
+static void route_start_task(int client_socket, const RouteParams *params, void *context) {
+    const RouteContext *route = context;
+    (void)params;
+    handle_set_task_state(client_socket, route->body, route->request, "running");
+}
+
+static void route_complete_task(int client_socket, const RouteParams *params, void *context) {
+    const RouteContext *route = context;
+    (void)params;
+    handle_set_task_state(client_socket, route->body, route->request, "completed");
+}
+
+static void route_autoslot(int client_socket, const RouteParams *params, void *context) {
+    const RouteContext *route = context;
+    (void)params;
+    handle_autoslot(client_socket, route->body, route->request);
+}
+
+static void route_health(int client_socket, const RouteParams *params, void *context) {
+    (void)params;
+    (void)context;
+    handle_health_check(client_socket);
+}
+
+static void route_query_stats(int client_socket, const RouteParams *params, void *context) {
+    (void)params;
+    (void)context;
+    handle_query_stats(client_socket);
+}
+
+static void route_lock_stats(int client_socket, const RouteParams *params, void *context) {
+    (void)params;
+    (void)context;
+    handle_lock_stats(client_socket);
+}
+
+static void route_ready_tasks(int client_socket, const RouteParams *params, void *context) {
+    const RouteContext *route = context;
+    (void)params;
+    handle_get_ready_tasks(client_socket, route->request);
+}
+
+static void route_conflicts(int client_socket, const RouteParams *params, void *context) {
+    const RouteContext *route = context;
+    (void)params;
+    handle_get_conflicts(client_socket, route->path, route->request);
+}
+
+static void route_calendar(int client_socket, const RouteParams *params, void *context) {
+    const RouteContext *route = context;
+    (void)params;
+    handle_get_calendar(client_socket, route->path, route->request);
+}
+
+void build_routes(void) {
+    static const struct {
+        const char *method;
+        const char *pattern;
+        RouteHandler handler;
+    } table[] = {
+        { "POST", "/api/auth/register",      route_register },
+        { "POST", "/api/auth/login/step1",   route_login_step1 },
+        { "POST", "/api/auth/login/step2",   route_login_step2 },
+        { "POST", "/api/tasks",              route_create_task },
+        { "GET",  "/api/tasks",              route_get_tasks },
+        { "PUT",  "/api/tasks/{id:int}",     route_update_task },
+        { "DELETE", "/api/tasks/{id:int}",   route_delete_task },
+        { "POST", "/api/tasks/dependencies", route_add_dependency },
+        { "POST", "/api/tasks/start",        route_start_task },
+        { "POST", "/api/tasks/complete",     route_complete_task },
+        { "POST", "/api/tasks/autoslot",     route_autoslot },
+        { "GET",  "/api/health",             route_health },
+        { "GET",  "/api/stats/queries",      route_query_stats },
+        { "GET",  "/api/stats/locks",        route_lock_stats },
+        { "GET",  "/api/tasks/ready",        route_ready_tasks },
+        { "GET",  "/api/tasks/conflicts",    route_conflicts },
+        { "GET",  "/api/calendar",           route_calendar },
+    };
+    
+    router_init(&routes);
+    for (size_t i = 0; i < sizeof(table) / sizeof(table[0]); i++) {
+        if (!router_add(&routes, table[i].method, table[i].pattern, table[i].handler)) {
+            fprintf(stderr, "⚠️  Route %s %s not added\n", table[i].method, table[i].pattern);
+        }
+    }
+    router_compile(&routes);
+}
+
+// Pages the Node wrapper served under names of their own
+static const char *frontend_alias(const char *path) {
+    size_t length = strcspn(path, "?#");
+    if (length == 10 && strncmp(path, "/dashboard", length) == 0) return "/dashboard-enhanced.html";
+    if (length == 9 && strncmp(path, "/register", length) == 0) return "/register-enhanced.html";
+    return path;
+}
+
+// A path that is not a file falls back to the single-page app's index, as
+// long as its last segment does not look like a file name
+static int is_page_route(const char *path) {
+    size_t length = strcspn(path, "?#");
+    const char *last = path;
+    for (size_t i = 0; i < length; i++) {
+        if (path[i] == '/') last = path + i + 1;
+    }
+    return memchr(last, '.', length - (size_t)(last - path)) == NULL;
+}
+
+static void serve_frontend(int client_socket, const char *method, const char *path, const HttpRequest *request) {
+    const HttpSpan *accept_encoding = http_header(request, "Accept-Encoding");
+    const HttpSpan *if_none_match = http_header(request, "If-None-Match");
+    const HttpSpan *if_modified_since = http_header(request, "If-Modified-Since");
+    
+    StaticRequest file = {0};
+    file.path = frontend_alias(path);
+    file.head_only = strcmp(method, "HEAD") == 0;
+    file.accepts_gzip = accept_encoding &&
+        http_accepts_gzip(http_span_data(request, *accept_encoding), accept_encoding->length);
+    if (if_none_match) {
+        file.if_none_match = http_span_data(request, *if_none_match);
+        file.if_none_match_length = if_none_match->length;
+    }
+    if (if_modified_since) {
+        file.if_modified_since = http_span_data(request, *if_modified_since);
+        file.if_modified_since_length = if_modified_since->length;
+    }
+    file.connection = end_of_headers();
+    
+    StaticResult result = static_files_serve(client_socket, &file);
+    if (result == STATIC_NOT_FOUND && is_page_route(path)) {
+        file.path = "/index.html";
+        result = static_files_serve(client_socket, &file);
+    }
+    if (result == STATIC_NOT_FOUND) send_json_error(client_socket, 404, "Not found");
+    else if (result == STATIC_SEND_FAILED) event_loop_response_failed();
+}
+
+void route_request(int client_socket, const char *method, const char *path, const char *body, const HttpRequest *request) {
+    // The frontend is served ahead of the rate limiter: one page load fetches
+    // a dozen files, and each costs a cache lookup and a sendfile()
+    if (static_files_enabled() && strncmp(path, "/api/", 5) != 0 &&
+        (strcmp(method, "GET") == 0 || strcmp(method, "HEAD") == 0)) {
+        serve_frontend(client_socket, method, path, request);
+        return;
+    }
+    
+    char ip_address[46];
+    extract_client_ip(client_socket, ip_address, sizeof(ip_address));
     
     // Rate limiting
-    if (!check_rate_limit(ip_address)) {
-        send_json_error(client_socket, 429, "Rate limit exceeded");
+    int retry_after = 0;
+    if (!rate_limiter_check(ip_address, &retry_after)) {
+        char response[128];
+        snprintf(response, sizeof(response),
+            "{\"success\":false,\"error\":\"Rate limit exceeded\",\"retry_after\":%d}", retry_after);
+        send_json_response(client_socket, 429, response);
         return;
     }
     
     // Handle CORS preflight
     if (strcmp(method, "OPTIONS") == 0) {
-        char response[] = 
+        char response[512];
+        snprintf(response, sizeof(response),
             "HTTP/1.1 200 OK\r\n"
             "Access-Control-Allow-Origin: *\r\n"
             "Access-Control-Allow-Methods: GET, POST, PUT, DELETE, OPTIONS\r\n"
             "Access-Control-Allow-Headers: Content-Type, Authorization\r\n"
             "Content-Length: 0\r\n"
-            "\r\n";
+            "Connection: %s\r\n"
+            "\r\n", event_loop_connection_header());
         send(client_socket, response, strlen(response), 0);
         return;
     }
     
     // Route requests
-    if (strcmp(method, "POST") == 0) {
-        if (strcmp(path, "/api/auth/register") == 0) {
-            handle_register(client_socket, body, ip_address);
-        } else if (strcmp(path, "/api/auth/login/step1") == 0) {
-            handle_login_step1(client_socket, body, ip_address);
-        } else {
-            send_json_error(client_socket, 404, "Endpoint not found");
-        }
-    } else if (strcmp(method, "GET") == 0) {
-        if (strcmp(path, "/api/health") == 0) {
-            handle_health_check(client_socket);
-        } else {
+    RouteContext context = { path, body, request, ip_address };
+    RouteHandler handler;
+    RouteParams params;
+    switch (router_match(&routes, method, path, &handler, &params)) {
+        case ROUTE_FOUND:
+            handler(client_socket, &params, &context);
+            break;
+        case ROUTE_METHOD_NOT_ALLOWED:
+            send_json_error(client_socket, 405, "Method not allowed");
+            break;
+        default:
             send_json_error(client_socket, 404, "Endpoint not found");
-        }
-    } else {
-        send_json_error(client_socket, 405, "Method not allowed");
+            break;
     }
 }
 
 void handle_login_step1(int client_socket, const char *body, const char *ip_address) {
-    char *username = extract_json_value(body, "username");
-    char *password = extract_json_value(body, "password");
+    JsonBody fields;
+    json_body_parse(&fields, body, strlen(body));
+    char username[256], password[256];
     
-    if (!username || !password) {
+    if (json_body_string(&fields, "username", username, sizeof(username)) <= 0 ||
+        json_body_string(&fields, "password", password, sizeof(password)) <= 0) {
         send_json_error(client_socket, 400, "Missing username or password");
-        if (username) free(username);
-        if (password) free(password);
         return;
     }
     
@@ -849,14 +3042,14 @@ void handle_login_step1(int client_socket, const char *body, const char *ip_addr
         Session session = {0};
         generate_session_id(session.session_id);
         session.user_id = user.user_id;
-        session.is_authenticated = 0; // Not fully authenticated yet
+        session.is_authenticated = 0; // Not until the OTP is verified
         strcpy(session.ip_address, ip_address);
         
-        if (create_session(&session)) {
-            // Generate OTP for demo
-            char otp[OTP_LENGTH + 1];
-            generate_otp(otp);
-            
+        // Generate OTP for demo
+        char otp[OTP_LENGTH + 1];
+        generate_otp(otp);
+        
+        if (create_session(&session) && store_login_otp(user.email, otp)) {
             char response[512];
             snprintf(response, sizeof(response), 
                 "{"
@@ -876,48 +3069,119 @@ void handle_login_step1(int client_socket, const char *body, const char *ip_addr
     } else {
         send_json_error(client_socket, 401, "Invalid credentials");
     }
-    
-    free(username);
-    free(password);
 }
 
-unsigned int WINAPI handle_client(void *client_socket_ptr) {
-    int client_socket = *(int*)client_socket_ptr;
-    free(client_socket_ptr);
-    
-    char buffer[BUFFER_SIZE];
-    int bytes_received = recv(client_socket, buffer, sizeof(buffer) - 1, 0);
-    
-    if (bytes_received <= 0) {
-        close(client_socket);
-        return 0;
+// Second and last factor: the OTP from step 1. A match authenticates the
+// session, whose id is then the bearer token for the task endpoints.
+void handle_login_step2(int client_socket, const char *body, const char *ip_address) {
+    JsonBody fields;
+    json_body_parse(&fields, body, strlen(body));
+    char session_id[64], otp[OTP_LENGTH + 1];
+    (void)ip_address;
+    
+    if (json_body_string(&fields, "session_id", session_id, sizeof(session_id)) <= 0 ||
+        json_body_string(&fields, "otp", otp, sizeof(otp)) <= 0) {
+        send_json_error(client_socket, 400, "Missing session_id or otp");
+        return;
     }
     
-    buffer[bytes_received] = '\0';
+    Session session;
+    if (!get_session(session_id, &session) || session.is_authenticated) {
+        send_json_error(client_socket, 401, "Invalid session or step");
+    } else {
+        int verified = verify_login_otp(session.user_id, otp);
+        if (verified == 0) {
+            send_json_error(client_socket, 401, "Invalid OTP");
+        } else if (verified < 0) {
+            send_json_error(client_socket, 401, "OTP expired or too many attempts, please log in again");
+        } else if (!authenticate_session(session.session_id)) {
+            send_json_error(client_socket, 500, "Session update failed");
+        } else {
+            char response[256];
+            snprintf(response, sizeof(response),
+                "{"
+                "\"success\":true,"
+                "\"token\":\"%s\","
+                "\"user_id\":%d,"
+                "\"message\":\"Login successful\""
+                "}", session.session_id, session.user_id);
+            send_json_response(client_socket, 200, response);
+            printf("✅ Login Step 2 successful for user id: %d\n", session.user_id);
+        }
+    }
+}
+
+// Called on a worker thread with one request parsed by the event loop, which
+// keeps the connection open afterwards unless the client asked to close
+void handle_request(int client_socket, HttpRequest *request) {
+    const HttpSpan *accept_encoding = http_header(request, "Accept-Encoding");
+    response_encoding = accept_encoding ?
+        http_choose_encoding(http_span_data(request, *accept_encoding), accept_encoding->length) :
+        HTTP_ENCODING_IDENTITY;
+    response_etag[0] = '\0';
     
-    // Parse HTTP request
     char method[16], path[256];
-    if (sscanf(buffer, "%s %s", method, path) != 2) {
-        close(client_socket);
-        return 0;
+    if (!http_span_copy(request, request->method, method, sizeof(method))) {
+        send_json_error(client_socket, 501, "Method not implemented");
+        return;
     }
-    
-    // Find body (after \r\n\r\n)
-    char *body = strstr(buffer, "\r\n\r\n");
-    if (body) {
-        body += 4;
-    } else {
-        body = "";
+    if (!http_span_copy(request, request->target, path, sizeof(path))) {
+        send_json_error(client_socket, 414, "URI too long");
+        return;
     }
     
+    // The loop NUL-terminates the body, which may have arrived chunked
+    const char *body = http_span_data(request, request->body);
+    
     // Route the request
-    route_request(client_socket, method, path, body, buffer);
+    route_request(client_socket, method, path, body, request);
+}
+
+static int rate_summary_interval = 0;    // Seconds; 0 = no summary in the database
+
+// Runs on a reactor thread about once a second
+void run_housekeeping(void) {
+    static time_t last_cleanup = 0;
+    static time_t last_flush = 0;
+    static time_t last_evict = 0;
+    static time_t last_summary = 0;
+    time_t now = time(NULL);
     
-    close(client_socket);
-    return 0;
+    // Periodic cleanup every 5 minutes, after the sessions in use are flushed
+    if (now - last_flush >= SESSION_FLUSH_INTERVAL || now - last_cleanup > 300) {
+        flush_session_activity();
+        last_flush = now;
+    }
+    if (now - last_cleanup > 300) {
+        cleanup_expired_sessions();
+        last_cleanup = now;
+    }
+    
+    if (rate_summary_interval > 0 && now - last_summary >= rate_summary_interval) {
+        write_rate_limit_summary();
+        last_summary = now;
+    }
+    if (now - last_evict >= RATE_LIMIT_EVICT_INTERVAL) {
+        rate_limiter_evict();
+        last_evict = now;
+    }
+}
+
+static int parse_option(int argc, char **argv, const char *name, int default_value) {
+    for (int i = 1; i + 1 < argc; i++) {
+        if (strcmp(argv[i], name) == 0) return atoi(argv[i + 1]);
+    }
+    return default_value;
+}
+
+static const char *parse_string_option(int argc, char **argv, const char *name, const char *default_value) {
+    for (int i = 1; i + 1 < argc; i++) {
+        if (strcmp(argv[i], name) == 0) return argv[i + 1];
+    }
+    return default_value;
 }
 
-int main() {
+int main(int argc, char **argv) {
     printf("🚀 Task Scheduler Production Server v3.0 with SQLite\n");
     printf("=====================================================\n");
     
@@ -926,12 +3190,45 @@ int main() {
         printf("❌ Failed to initialize database\n");
         return 1;
     }
+    build_routes();
+    http_response_init();
+    task_version_epoch = (long long)time(NULL);
     
     printf("🔒 Enhanced Security Features:\n");
     printf("   • SQLite persistent storage\n");
-    printf("   • Rate limiting (100 req/60 sec)\n");
+    RateLimiterConfig rate_config;
+    rate_limiter_config_defaults(&rate_config);
+    rate_config.requests_per_minute = parse_option(argc, argv, "--rate-limit", rate_config.requests_per_minute);
+    rate_config.burst = parse_option(argc, argv, "--rate-burst", rate_config.burst);
+    rate_summary_interval = parse_option(argc, argv, "--rate-summary", 0);
+    if (!rate_limiter_init(&rate_config)) printf("⚠️  Rate limiter unavailable, requests are not limited\n");
+    printf("   • Rate limiting (%d req/min, burst %d, in memory)\n", rate_config.requests_per_minute, rate_config.burst);
     printf("   • Password hashing with salt\n");
-    printf("   • Session management\n");
+    SessionCacheConfig session_config;
+    session_config.capacity = parse_option(argc, argv, "--session-cache", SESSION_CACHE_DEFAULT);
+    session_config.value_size = sizeof(Session);
+    session_config.ttl_seconds = SESSION_TIMEOUT;
+    if (!session_cache_init(&session_config)) printf("⚠️  Session cache unavailable, sessions are read from the database\n");
+    printf("   • Session management (%d cached in memory)\n", session_config.capacity);
+    HttpCompressConfig compress_config;
+    http_compress_config_defaults(&compress_config);
+    compress_config.level = parse_option(argc, argv, "--compression-level", compress_config.level);
+    compress_config.min_length = parse_option(argc, argv, "--compress-min", compress_config.min_length);
+    compress_config.cache_entries = parse_option(argc, argv, "--compress-cache", compress_config.cache_entries);
+    if (!http_compress_init(&compress_config)) printf("⚠️  Compression cache unavailable, bodies are compressed every time\n");
+    if (compress_config.level > 0) {
+        printf("   • gzip/deflate responses over %d bytes (%d cached)\n", compress_config.min_length, compress_config.cache_entries);
+    }
+    StaticFilesConfig static_config;
+    static_files_config_defaults(&static_config);
+    static_config.root = parse_string_option(argc, argv, "--static-root", NULL);
+    static_config.max_age_seconds = parse_option(argc, argv, "--static-max-age", static_config.max_age_seconds);
+    static_config.cache_entries = parse_option(argc, argv, "--static-cache", static_config.cache_entries);
+    if (!static_files_init(&static_config)) {
+        printf("⚠️  Static root %s is not a directory, the frontend is not served\n", static_config.root);
+    } else if (static_files_enabled()) {
+        printf("   • Frontend served from %s (sendfile, %d files cached)\n", static_config.root, static_config.cache_entries);
+    }
     printf("   • Input validation\n");
     printf("   • Security headers\n");
     printf("   • Account lockout protection\n");
@@ -970,7 +3267,20 @@ int main() {
         return 1;
     }
     
-    if (listen(server_socket, 10) < 0) {
+    // Usage: production_server_v3 [--backlog N] [--max-connections N] [--workers N] [--idle-timeout SEC]
+    //                             [--rate-limit PER_MIN] [--rate-burst N] [--rate-summary SEC] [--session-cache N]
+    //                             [--compression-level 0-9] [--compress-min BYTES] [--compress-cache N]
+    //                             [--static-root DIR] [--static-max-age SEC] [--static-cache N]
+    int backlog = parse_option(argc, argv, "--backlog", EVENT_LOOP_DEFAULT_BACKLOG);
+    EventLoopConfig loop_config;
+    event_loop_config_defaults(&loop_config);
+    loop_config.max_connections = parse_option(argc, argv, "--max-connections", EVENT_LOOP_DEFAULT_MAX_CONNECTIONS);
+    loop_config.workers = parse_option(argc, argv, "--workers", 0);
+    loop_config.idle_timeout_sec = parse_option(argc, argv, "--idle-timeout", EVENT_LOOP_DEFAULT_IDLE_TIMEOUT);
+    loop_config.handle_request = handle_request;
+    loop_config.on_tick = run_housekeeping;
+    
+    if (listen(server_socket, backlog) < 0) {
         printf("❌ Listen failed\n");
         close(server_socket);
         cleanup_database();
@@ -982,34 +3292,25 @@ int main() {
     printf("   POST /api/auth/register\n");
     printf("   POST /api/auth/login/step1\n");
     printf("   POST /api/auth/login/step2\n");
-    printf("   POST /api/auth/login/step3\n");
     printf("   POST /api/tasks\n");
-    printf("   GET  /api/tasks\n");
+    printf("   GET  /api/tasks?after=&limit=\n");
     printf("   PUT  /api/tasks/{id}\n");
     printf("   DELETE /api/tasks/{id}\n");
+    printf("   GET  /api/tasks/ready\n");
+    printf("   POST /api/tasks/dependencies\n");
+    printf("   POST /api/tasks/start\n");
+    printf("   POST /api/tasks/complete\n");
+    printf("   POST /api/tasks/autoslot\n");
+    printf("   GET  /api/tasks/conflicts\n");
+    printf("   GET  /api/calendar?from=&to=\n");
     printf("   GET  /api/health\n");
-    printf("\n🔄 Ready for connections with persistent database...\n\n");
+    printf("   GET  /api/stats/queries\n");
+    printf("   GET  /api/stats/locks\n");
+    printf("\n🔄 Ready for connections with persistent database (backlog %d, max %d connections)...\n\n",
+           backlog, loop_config.max_connections);
     
-    while (1) {
-        struct sockaddr_in client_addr;
-        int addr_len = sizeof(client_addr);
-        int client_socket = accept(server_socket, (struct sockaddr*)&client_addr, &addr_len);
-        
-        if (client_socket >= 0) {
-            int *client_ptr = malloc(sizeof(int));
-            *client_ptr = client_socket;
-            
-            thread_t thread;
-            THREAD_CREATE(thread, handle_client, client_ptr);
-        }
-        
-        // Periodic cleanup every 5 minutes
-        static time_t last_cleanup = 0;
-        time_t now = time(NULL);
-        if (now - last_cleanup > 300) {
-            cleanup_expired_sessions();
-            last_cleanup = now;
-        }
+    if (!event_loop_run(server_socket, &loop_config)) {
+        printf("❌ Failed to start the event loop\n");
     }
     
     close(server_socket);
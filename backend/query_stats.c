@@ -0,0 +1,322 @@
+/* Query Statistics - slow-query log and per-statement latency histograms
+ *
+ * Histograms are HDR-style: log-linear buckets with 3 significant bits
+ * (8 sub-buckets per power of two), giving <= 12.5% relative error from
+ * 1us up to ~9 hours in a fixed 304-slot array per statement.
+ */
+
+#ifndef _WIN32
+    #define _POSIX_C_SOURCE 200809L  // clock_gettime
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "query_stats.h"
+
+#ifdef _WIN32
+    #include <windows.h>
+    typedef CRITICAL_SECTION mutex_t;
+    #define MUTEX_INIT(mutex) InitializeCriticalSection(&mutex)
+    #define MUTEX_LOCK(mutex) EnterCriticalSection(&mutex)
+    #define MUTEX_UNLOCK(mutex) LeaveCriticalSection(&mutex)
+#else
+    #include <pthread.h>
+    typedef pthread_mutex_t mutex_t;
+    #define MUTEX_INIT(mutex) pthread_mutex_init(&mutex, NULL)
+    #define MUTEX_LOCK(mutex) pthread_mutex_lock(&mutex)
+    #define MUTEX_UNLOCK(mutex) pthread_mutex_unlock(&mutex)
+#endif
+
+#define QUERY_STATS_SLOTS 128        // Distinct statements tracked (power of two)
+#define QUERY_SQL_MAX 256            // Stored SQL prefix per statement
+#define SLOW_QUERY_SQL_MAX 512       // Expanded SQL printed by the slow log
+#define HIST_SUB_BITS 3
+#define HIST_SUB_COUNT (1 << HIST_SUB_BITS)
+#define HIST_MAGNITUDES 40
+#define HIST_BUCKETS ((HIST_MAGNITUDES - HIST_SUB_BITS + 1) * HIST_SUB_COUNT)
+#define MAX_ACTIVE_STATEMENTS 16     // Statements running at once on one thread
+
+typedef struct {
+    unsigned long hash;              // 0 = empty slot
+    char sql[QUERY_SQL_MAX];
+    unsigned long long count;
+    unsigned long long total_us;
+    long long max_us;
+    unsigned int buckets[HIST_BUCKETS];
+} QueryStats;
+
+static QueryStats query_stats[QUERY_STATS_SLOTS];
+static mutex_t stats_mutex;
+static int stats_initialized = 0;
+static long long slow_threshold_ms = 1000;
+static unsigned long long untracked_count = 0;
+
+// Start times of statements running on this thread. SQLite's own profile
+// clock is millisecond-granular, too coarse for most statements here.
+typedef struct {
+    void *stmt;
+    long long started_ns;
+} ActiveStatement;
+
+static __thread ActiveStatement active_statements[MAX_ACTIVE_STATEMENTS];
+
+static long long monotonic_ns(void) {
+#ifdef _WIN32
+    LARGE_INTEGER counter, frequency;
+    QueryPerformanceCounter(&counter);
+    QueryPerformanceFrequency(&frequency);
+    return (long long)(counter.QuadPart * (1000000000.0 / frequency.QuadPart));
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+#endif
+}
+
+// ============================================
+// HISTOGRAM
+// ============================================
+
+static int histogram_index(long long value) {
+    if (value < 0) value = 0;
+    if (value < HIST_SUB_COUNT) return (int)value;
+
+    int magnitude = 63 - __builtin_clzll((unsigned long long)value);
+    if (magnitude >= HIST_MAGNITUDES) return HIST_BUCKETS - 1;
+
+    int sub = (int)((value >> (magnitude - HIST_SUB_BITS)) & (HIST_SUB_COUNT - 1));
+    return (magnitude - HIST_SUB_BITS + 1) * HIST_SUB_COUNT + sub;
+}
+
+// Upper bound of a bucket, the value reported for percentiles in it
+static long long histogram_value(int index) {
+    if (index < HIST_SUB_COUNT) return index;
+
+    int magnitude = index / HIST_SUB_COUNT + HIST_SUB_BITS - 1;
+    int sub = index % HIST_SUB_COUNT;
+    long long base = (long long)(HIST_SUB_COUNT + sub) << (magnitude - HIST_SUB_BITS);
+    return base + (1LL << (magnitude - HIST_SUB_BITS)) - 1;
+}
+
+static long long histogram_percentile(const QueryStats *stats, double percentile) {
+    unsigned long long target = (unsigned long long)(stats->count * percentile / 100.0 + 0.5);
+    if (target == 0) target = 1;
+
+    unsigned long long seen = 0;
+    for (int i = 0; i < HIST_BUCKETS; i++) {
+        seen += stats->buckets[i];
+        if (seen >= target) {
+            long long value = histogram_value(i);
+            return value < stats->max_us ? value : stats->max_us;
+        }
+    }
+    return stats->max_us;
+}
+
+// ============================================
+// RECORDING
+// ============================================
+
+static unsigned long hash_sql(const char *sql) {
+    unsigned long hash = 2166136261u;
+    for (const unsigned char *p = (const unsigned char *)sql; *p; p++) {
+        hash = (hash ^ *p) * 16777619u;
+    }
+    return hash ? hash : 1;
+}
+
+void query_stats_init(long long slow_query_ms) {
+    if (!stats_initialized) {
+        MUTEX_INIT(stats_mutex);
+        stats_initialized = 1;
+    }
+    slow_threshold_ms = slow_query_ms;
+}
+
+void query_stats_record(const char *sql, long long elapsed_us) {
+    if (!stats_initialized || !sql) return;
+
+    unsigned long hash = hash_sql(sql);
+    unsigned int slot = hash & (QUERY_STATS_SLOTS - 1);
+
+    MUTEX_LOCK(stats_mutex);
+
+    QueryStats *stats = NULL;
+    for (int probe = 0; probe < QUERY_STATS_SLOTS; probe++) {
+        QueryStats *candidate = &query_stats[slot];
+        if (candidate->hash == 0) {
+            candidate->hash = hash;
+            snprintf(candidate->sql, sizeof(candidate->sql), "%s", sql);
+            stats = candidate;
+            break;
+        }
+        if (candidate->hash == hash && strncmp(candidate->sql, sql, QUERY_SQL_MAX - 1) == 0) {
+            stats = candidate;
+            break;
+        }
+        slot = (slot + 1) & (QUERY_STATS_SLOTS - 1);
+    }
+
+    if (stats) {
+        stats->count++;
+        stats->total_us += (unsigned long long)elapsed_us;
+        if (elapsed_us > stats->max_us) stats->max_us = elapsed_us;
+        stats->buckets[histogram_index(elapsed_us)]++;
+    } else {
+        untracked_count++;
+    }
+
+    MUTEX_UNLOCK(stats_mutex);
+}
+
+static int profile_callback(unsigned int type, void *context, void *statement, void *detail) {
+    (void)context;
+
+    if (type == SQLITE_TRACE_STMT) {
+        // Trigger bodies report again under the same statement; keep the first start
+        int free_slot = -1;
+        for (int i = 0; i < MAX_ACTIVE_STATEMENTS; i++) {
+            if (active_statements[i].stmt == statement) return 0;
+            if (free_slot < 0 && active_statements[i].stmt == NULL) free_slot = i;
+        }
+        if (free_slot >= 0) {
+            active_statements[free_slot].stmt = statement;
+            active_statements[free_slot].started_ns = monotonic_ns();
+        }
+        return 0;
+    }
+    if (type != SQLITE_TRACE_PROFILE) return 0;
+
+    sqlite3_stmt *stmt = (sqlite3_stmt *)statement;
+    long long elapsed_us = *(long long *)detail / 1000;
+    for (int i = 0; i < MAX_ACTIVE_STATEMENTS; i++) {
+        if (active_statements[i].stmt == statement) {
+            elapsed_us = (monotonic_ns() - active_statements[i].started_ns) / 1000;
+            active_statements[i].stmt = NULL;
+            break;
+        }
+    }
+
+    query_stats_record(sqlite3_sql(stmt), elapsed_us);
+
+    if (slow_threshold_ms > 0 && elapsed_us >= slow_threshold_ms * 1000) {
+        char *expanded = sqlite3_expanded_sql(stmt);
+        printf("🐢 Slow query (%lld ms): %.*s\n", elapsed_us / 1000,
+               SLOW_QUERY_SQL_MAX, expanded ? expanded : sqlite3_sql(stmt));
+        sqlite3_free(expanded);
+    }
+
+    return 0;
+}
+
+int query_stats_attach(sqlite3 *db) {
+    if (!db) return 0;
+    return sqlite3_trace_v2(db, SQLITE_TRACE_STMT | SQLITE_TRACE_PROFILE,
+                            profile_callback, NULL) == SQLITE_OK;
+}
+
+// ============================================
+// REPORTING
+// ============================================
+
+void query_stats_dump(FILE *out) {
+    if (!stats_initialized) return;
+
+    MUTEX_LOCK(stats_mutex);
+
+    fprintf(out, "📊 Query latency (us): count / mean / p50 / p90 / p99 / max\n");
+    for (int i = 0; i < QUERY_STATS_SLOTS; i++) {
+        const QueryStats *stats = &query_stats[i];
+        if (stats->hash == 0 || stats->count == 0) continue;
+
+        fprintf(out, "   %8llu %8llu %8lld %8lld %8lld %8lld  %.80s\n",
+                stats->count, stats->total_us / stats->count,
+                histogram_percentile(stats, 50.0), histogram_percentile(stats, 90.0),
+                histogram_percentile(stats, 99.0), stats->max_us, stats->sql);
+    }
+    if (untracked_count > 0) {
+        fprintf(out, "   %llu executions not tracked (statement table full)\n", untracked_count);
+    }
+
+    MUTEX_UNLOCK(stats_mutex);
+}
+
+// Line breaks and tabs in SQL text become spaces; other control characters
+// are escaped as \u00XX so the output stays valid JSON
+static int append_json_string(char *buffer, size_t size, size_t offset, const char *text) {
+    size_t start = offset;
+    if (offset < size) buffer[offset] = '"';
+    offset++;
+    for (const char *p = text; *p; p++) {
+        unsigned char c = (unsigned char)*p;
+        if (c == '"' || c == '\\') {
+            if (offset + 1 < size) { buffer[offset] = '\\'; buffer[offset + 1] = (char)c; }
+            offset += 2;
+        } else if (c == '\n' || c == '\r' || c == '\t') {
+            if (offset < size) buffer[offset] = ' ';
+            offset++;
+        } else if (c < 0x20) {
+            if (offset + 6 < size) snprintf(buffer + offset, 7, "\\u%04x", c);
+            offset += 6;
+        } else {
+            if (offset < size) buffer[offset] = (char)c;
+            offset++;
+        }
+    }
+    if (offset < size) buffer[offset] = '"';
+    offset++;
+    return (int)(offset - start);
+}
+
+int query_stats_json(char *buffer, size_t size) {
+    if (size == 0) return 0;
+
+    size_t offset = 0;
+    int first = 1;
+
+// Once a write does not fit in the space left, offset stays at size
+#define JSON_APPEND(...) do { \
+        if (offset < size) { \
+            size_t space = size - offset; \
+            int written = snprintf(buffer + offset, space, __VA_ARGS__); \
+            offset = (written < 0 || (size_t)written >= space) ? size : offset + (size_t)written; \
+        } \
+    } while (0)
+
+    JSON_APPEND("[");
+
+    if (stats_initialized) {
+        MUTEX_LOCK(stats_mutex);
+        for (int i = 0; i < QUERY_STATS_SLOTS; i++) {
+            const QueryStats *stats = &query_stats[i];
+            if (stats->hash == 0 || stats->count == 0) continue;
+
+            // Leave room for the closing bracket; drop entries that do not fit
+            size_t entry_start = offset;
+            JSON_APPEND("%s{\"sql\":", first ? "" : ",");
+            offset += append_json_string(buffer, size, offset, stats->sql);
+            JSON_APPEND(",\"count\":%llu,\"mean_us\":%llu,\"p50_us\":%lld,\"p90_us\":%lld,"
+                        "\"p99_us\":%lld,\"max_us\":%lld}",
+                        stats->count, stats->total_us / stats->count,
+                        histogram_percentile(stats, 50.0), histogram_percentile(stats, 90.0),
+                        histogram_percentile(stats, 99.0), stats->max_us);
+            if (offset + 2 > size) {
+                offset = entry_start;
+                break;
+            }
+            first = 0;
+        }
+        MUTEX_UNLOCK(stats_mutex);
+    }
+
+    JSON_APPEND("]");
+#undef JSON_APPEND
+
+    if (offset >= size) {
+        buffer[size - 1] = '\0';
+        return (int)(size - 1);
+    }
+    return (int)offset;
+}
@@ -0,0 +1,31 @@
+/* Query Statistics - slow-query log and per-statement latency histograms
+ *
+ * Every statement run on an attached connection is timed through SQLite's
+ * trace hooks, so both sqlite3_exec() and prepared statements are covered
+ * without touching call sites. Statements are keyed by their SQL text (with
+ * '?' placeholders); the slow log prints the expanded SQL with bound values.
+ */
+
+#ifndef QUERY_STATS_H
+#define QUERY_STATS_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include "sqlite3.h"
+
+// Sets the slow-query threshold (performance.log_slow_queries_ms); <= 0 disables the log
+void query_stats_init(long long slow_query_ms);
+
+// Registers the statement start/end trace hooks on a connection
+int query_stats_attach(sqlite3 *db);
+
+// Records one execution; called by the hook, exposed for non-SQLite timings
+void query_stats_record(const char *sql, long long elapsed_us);
+
+// Human-readable table: count, mean, p50/p90/p99 and max per statement
+void query_stats_dump(FILE *out);
+
+// Same data as a JSON array; returns bytes written (truncated to fit size)
+int query_stats_json(char *buffer, size_t size);
+
+#endif
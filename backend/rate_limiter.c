@@ -0,0 +1,280 @@
+/* Rate Limiter - in-memory GCRA limiter keyed by client address
+ *
+ * A key hashes (FNV-1a) to one of RATE_LIMITER_SHARDS shards; each shard is
+ * a chained hash table with its own lock that doubles when it averages two
+ * entries per bucket. All times are microseconds on the monotonic clock, so
+ * a wall-clock step cannot refill or drain every bucket at once.
+ */
+
+#ifndef _WIN32
+    #define _POSIX_C_SOURCE 200809L  // clock_gettime
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "rate_limiter.h"
+
+#ifdef _WIN32
+    #include <windows.h>
+    typedef CRITICAL_SECTION mutex_t;
+    #define MUTEX_INIT(mutex) InitializeCriticalSection(&mutex)
+    #define MUTEX_LOCK(mutex) EnterCriticalSection(&mutex)
+    #define MUTEX_UNLOCK(mutex) LeaveCriticalSection(&mutex)
+#else
+    #include <pthread.h>
+    typedef pthread_mutex_t mutex_t;
+    #define MUTEX_INIT(mutex) pthread_mutex_init(&mutex, NULL)
+    #define MUTEX_LOCK(mutex) pthread_mutex_lock(&mutex)
+    #define MUTEX_UNLOCK(mutex) pthread_mutex_unlock(&mutex)
+#endif
+
+#define RATE_LIMITER_SHARDS 64           // Power of two
+#define SHARD_INITIAL_BUCKETS 16
+#define MICROS_PER_SECOND 1000000LL
+
+typedef struct RateEntry {
+    struct RateEntry *next;
+    unsigned int hash;
+    long long tat_us;                    // Theoretical arrival time
+    long long blocked_until_us;
+    long long last_seen_us;
+    int violations;
+    unsigned int allowed;                // Since the last drain
+    unsigned int denied;
+    char key[RATE_LIMITER_KEY_MAX];
+} RateEntry;
+
+typedef struct {
+    mutex_t mutex;
+    RateEntry **buckets;
+    unsigned int mask;
+    int count;
+    char padding[64];                    // Keeps neighbouring shard locks off one cache line
+} RateShard;
+
+static RateShard shards[RATE_LIMITER_SHARDS];
+static RateLimiterConfig limiter_config;
+static long long emission_us;            // Time one request costs
+static long long tolerance_us;           // How far ahead of now TAT may run
+static int limiter_ready = 0;
+
+static long long monotonic_us(void) {
+#ifdef _WIN32
+    LARGE_INTEGER counter, frequency;
+    QueryPerformanceCounter(&counter);
+    QueryPerformanceFrequency(&frequency);
+    return (long long)(counter.QuadPart * (1000000.0 / frequency.QuadPart));
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * MICROS_PER_SECOND + ts.tv_nsec / 1000;
+#endif
+}
+
+static unsigned int key_hash(const char *key) {
+    unsigned int hash = 2166136261u;
+    for (; *key; key++) {
+        hash ^= (unsigned char)*key;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+// Bucket index from the bits above those that picked the shard
+static unsigned int bucket_index(const RateShard *shard, unsigned int hash) {
+    return (hash / RATE_LIMITER_SHARDS) & shard->mask;
+}
+
+static void shard_grow(RateShard *shard) {
+    unsigned int size = (shard->mask + 1) * 2;
+    RateEntry **buckets = calloc(size, sizeof(RateEntry*));
+    if (!buckets) return; // Chains just get longer
+
+    RateShard grown = *shard;
+    grown.buckets = buckets;
+    grown.mask = size - 1;
+    for (unsigned int i = 0; i <= shard->mask; i++) {
+        RateEntry *entry = shard->buckets[i];
+        while (entry) {
+            RateEntry *next = entry->next;
+            unsigned int index = bucket_index(&grown, entry->hash);
+            entry->next = buckets[index];
+            buckets[index] = entry;
+            entry = next;
+        }
+    }
+    free(shard->buckets);
+    shard->buckets = buckets;
+    shard->mask = size - 1;
+}
+
+// An idle key whose bucket has refilled behaves exactly like an absent one
+static int entry_idle(const RateEntry *entry, long long now) {
+    return entry->tat_us <= now && entry->blocked_until_us <= now &&
+           now - entry->last_seen_us >= (long long)limiter_config.idle_seconds * MICROS_PER_SECOND;
+}
+
+static int seconds_until(long long when, long long now) {
+    return (int)((when - now + MICROS_PER_SECOND - 1) / MICROS_PER_SECOND);
+}
+
+// ============================================
+// PUBLIC API
+// ============================================
+
+void rate_limiter_config_defaults(RateLimiterConfig *config) {
+    config->requests_per_minute = 60;
+    config->burst = 10;
+    config->block_seconds = 0;
+    config->idle_seconds = 300;
+    config->max_keys = 100000;
+}
+
+int rate_limiter_init(const RateLimiterConfig *config) {
+    limiter_config = *config;
+    if (limiter_config.requests_per_minute < 1) limiter_config.requests_per_minute = 1;
+    if (limiter_config.burst < 1) limiter_config.burst = 1;
+    if (limiter_config.idle_seconds < 1) limiter_config.idle_seconds = 1;
+
+    emission_us = 60 * MICROS_PER_SECOND / limiter_config.requests_per_minute;
+    tolerance_us = emission_us * (limiter_config.burst - 1);
+
+    for (int i = 0; i < RATE_LIMITER_SHARDS; i++) {
+        MUTEX_INIT(shards[i].mutex);
+        shards[i].buckets = calloc(SHARD_INITIAL_BUCKETS, sizeof(RateEntry*));
+        if (!shards[i].buckets) return 0;
+        shards[i].mask = SHARD_INITIAL_BUCKETS - 1;
+        shards[i].count = 0;
+    }
+    limiter_ready = 1;
+    return 1;
+}
+
+int rate_limiter_check(const char *key, int *retry_after) {
+    if (!limiter_ready) return 1;
+
+    // Stored keys are truncated, so look up the truncated form too
+    char stored[RATE_LIMITER_KEY_MAX];
+    strncpy(stored, key, sizeof(stored) - 1);
+    stored[sizeof(stored) - 1] = '\0';
+    key = stored;
+
+    unsigned int hash = key_hash(key);
+    RateShard *shard = &shards[hash & (RATE_LIMITER_SHARDS - 1)];
+    long long now = monotonic_us();
+
+    MUTEX_LOCK(shard->mutex);
+
+    RateEntry **slot = &shard->buckets[bucket_index(shard, hash)];
+    RateEntry *entry = *slot;
+    while (entry && (entry->hash != hash || strcmp(entry->key, key) != 0)) entry = entry->next;
+
+    if (!entry) {
+        entry = shard->count < limiter_config.max_keys / RATE_LIMITER_SHARDS + 1 ? calloc(1, sizeof(RateEntry)) : NULL;
+        if (!entry) {
+            // Out of room: fail open, as a limiter error should not take the server down
+            MUTEX_UNLOCK(shard->mutex);
+            return 1;
+        }
+        entry->hash = hash;
+        entry->tat_us = now;
+        strcpy(entry->key, key);
+        entry->next = *slot;
+        *slot = entry;
+        if (++shard->count > (int)(shard->mask + 1) * 2) shard_grow(shard);
+    }
+    entry->last_seen_us = now;
+
+    int allowed = 0;
+    long long retry_at = 0;
+    long long tat = entry->tat_us > now ? entry->tat_us : now;
+
+    if (entry->blocked_until_us > now) {
+        retry_at = entry->blocked_until_us;
+    } else if (tat - now > tolerance_us) {
+        retry_at = tat - tolerance_us;
+        if (limiter_config.block_seconds > 0) {
+            // Progressive blocking: each violation shuts the key out for longer
+            entry->violations++;
+            entry->blocked_until_us = now + (long long)limiter_config.block_seconds * entry->violations * MICROS_PER_SECOND;
+            retry_at = entry->blocked_until_us;
+        }
+    } else {
+        entry->tat_us = tat + emission_us;
+        allowed = 1;
+    }
+
+    if (allowed) entry->allowed++;
+    else entry->denied++;
+
+    MUTEX_UNLOCK(shard->mutex);
+
+    if (!allowed && retry_after) *retry_after = seconds_until(retry_at, now);
+    return allowed;
+}
+
+int rate_limiter_evict(void) {
+    if (!limiter_ready) return 0;
+
+    int evicted = 0;
+    long long now = monotonic_us();
+    for (int i = 0; i < RATE_LIMITER_SHARDS; i++) {
+        RateShard *shard = &shards[i];
+        MUTEX_LOCK(shard->mutex);
+        for (unsigned int b = 0; b <= shard->mask; b++) {
+            RateEntry **link = &shard->buckets[b];
+            while (*link) {
+                RateEntry *entry = *link;
+                if (entry_idle(entry, now)) {
+                    *link = entry->next;
+                    free(entry);
+                    shard->count--;
+                    evicted++;
+                } else {
+                    link = &entry->next;
+                }
+            }
+        }
+        MUTEX_UNLOCK(shard->mutex);
+    }
+    return evicted;
+}
+
+void rate_limiter_drain(void (*visit)(const RateLimiterSummary *summary, void *context), void *context) {
+    if (!limiter_ready) return;
+
+    long long now = monotonic_us();
+    time_t wall_now = time(NULL);
+    for (int i = 0; i < RATE_LIMITER_SHARDS; i++) {
+        RateShard *shard = &shards[i];
+        MUTEX_LOCK(shard->mutex);
+        for (unsigned int b = 0; b <= shard->mask; b++) {
+            for (RateEntry *entry = shard->buckets[b]; entry; entry = entry->next) {
+                if (entry->allowed == 0 && entry->denied == 0) continue;
+
+                RateLimiterSummary summary;
+                summary.key = entry->key;
+                summary.allowed = entry->allowed;
+                summary.denied = entry->denied;
+                summary.violations = entry->violations;
+                summary.last_seen = wall_now - (time_t)((now - entry->last_seen_us) / MICROS_PER_SECOND);
+                visit(&summary, context);
+
+                entry->allowed = 0;
+                entry->denied = 0;
+            }
+        }
+        MUTEX_UNLOCK(shard->mutex);
+    }
+}
+
+int rate_limiter_keys(void) {
+    int total = 0;
+    for (int i = 0; i < RATE_LIMITER_SHARDS && limiter_ready; i++) {
+        MUTEX_LOCK(shards[i].mutex);
+        total += shards[i].count;
+        MUTEX_UNLOCK(shards[i].mutex);
+    }
+    return total;
+}
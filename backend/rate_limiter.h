@@ -0,0 +1,61 @@
+/* Rate Limiter - in-memory GCRA limiter keyed by client address
+ *
+ * Each key holds one timestamp, its theoretical arrival time (TAT): a
+ * request is allowed if it arrives no earlier than TAT minus the burst
+ * tolerance, and moves TAT one emission interval (60s / requests_per_minute)
+ * later. That is a token bucket of `burst` tokens refilled at the sustained
+ * rate, without a refill step. Keys are spread over independently locked
+ * shards, so concurrent requests from different clients rarely contend, and
+ * no request touches the database.
+ *
+ * Keys that have gone idle with a full bucket are dropped by
+ * rate_limiter_evict(). Per-key counters since the last drain can be taken
+ * with rate_limiter_drain() for an occasional summary written elsewhere.
+ */
+
+#ifndef RATE_LIMITER_H
+#define RATE_LIMITER_H
+
+#include <time.h>
+
+#define RATE_LIMITER_KEY_MAX 64          // Fits an IPv6 address with zone
+
+typedef struct {
+    int requests_per_minute;     // Sustained rate per key (server.rate_limiting.requests_per_minute)
+    int burst;                   // Requests a fresh key may make back to back (burst_size)
+    int block_seconds;           // > 0: a key that hits the limit is refused for
+                                 // block_seconds times its violation count
+    int idle_seconds;            // Keys unseen this long may be evicted
+    int max_keys;                // Beyond this, new keys are not tracked (and allowed)
+} RateLimiterConfig;
+
+// Per-key counters handed to a drain callback
+typedef struct {
+    const char *key;
+    unsigned int allowed;
+    unsigned int denied;
+    int violations;
+    time_t last_seen;            // Wall clock
+} RateLimiterSummary;
+
+void rate_limiter_config_defaults(RateLimiterConfig *config);
+
+// Returns 0 if the shards could not be allocated; checks then allow everything
+int rate_limiter_init(const RateLimiterConfig *config);
+
+// 1 if the request is allowed. When refused and retry_after is not NULL, it
+// gets the seconds until a request from this key would be allowed.
+int rate_limiter_check(const char *key, int *retry_after);
+
+// Drops idle keys; returns how many. Locks one shard at a time.
+int rate_limiter_evict(void);
+
+// Calls visit for every key with requests since the last drain, under that
+// key's shard lock, then resets its counters. visit must not block. Drain
+// more often than idle_seconds, or evicted keys' counts are lost.
+void rate_limiter_drain(void (*visit)(const RateLimiterSummary *summary, void *context), void *context);
+
+// Keys currently tracked
+int rate_limiter_keys(void);
+
+#endif
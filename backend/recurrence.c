@@ -0,0 +1,511 @@
+/* Recurrence - compiled recurrence rules with constant-time next-occurrence lookup
+ *
+ * Date arithmetic is done on day numbers (days since 1970-01-01) with the
+ * proleptic Gregorian civil-date conversions, so no libc time zone state is
+ * involved and results are the same on every platform.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <limits.h>
+#include "recurrence.h"
+#include "json_body.h"
+
+#define NO_TABLE_YEAR INT_MIN
+#define CALENDAR_MAX_STEPS 4096     // Day/week/year jumps per lookup
+#define CALENDAR_MAX_YEARS 60       // Covers 29 Feb on a given weekday
+#define SECONDS_PER_DAY 86400LL
+
+static const char *const month_names[] = {
+    "", "JAN", "FEB", "MAR", "APR", "MAY", "JUN", "JUL", "AUG", "SEP", "OCT", "NOV", "DEC"
+};
+static const char *const weekday_names[] = { "SUN", "MON", "TUE", "WED", "THU", "FRI", "SAT" };
+
+// ============================================
+// CIVIL DATES
+// ============================================
+
+static long long floor_div(long long a, long long b) {
+    long long q = a / b;
+    if ((a % b != 0) && ((a < 0) != (b < 0))) q--;
+    return q;
+}
+
+static long long days_from_civil(long long year, int month, int day) {
+    year -= month <= 2;
+    long long era = (year >= 0 ? year : year - 399) / 400;
+    long long year_of_era = year - era * 400;
+    long long day_of_year = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    long long day_of_era = year_of_era * 365 + year_of_era / 4 - year_of_era / 100 + day_of_year;
+    return era * 146097 + day_of_era - 719468;
+}
+
+static void civil_from_days(long long days, long long *year, int *month, int *day) {
+    days += 719468;
+    long long era = (days >= 0 ? days : days - 146096) / 146097;
+    long long day_of_era = days - era * 146097;
+    long long year_of_era = (day_of_era - day_of_era / 1460 + day_of_era / 36524 - day_of_era / 146096) / 365;
+    long long day_of_year = day_of_era - (365 * year_of_era + year_of_era / 4 - year_of_era / 100);
+    long long mp = (5 * day_of_year + 2) / 153;
+    *day = (int)(day_of_year - (153 * mp + 2) / 5 + 1);
+    *month = (int)(mp < 10 ? mp + 3 : mp - 9);
+    *year = year_of_era + era * 400 + (*month <= 2);
+}
+
+static int days_in_month(long long year, int month) {
+    static const int lengths[] = { 0, 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+    if (month == 2 && ((year % 4 == 0 && year % 100 != 0) || year % 400 == 0)) return 29;
+    return lengths[month];
+}
+
+// 0 = Sunday; day 0 (1970-01-01) was a Thursday
+static int weekday(long long days) {
+    return (int)(((days % 7) + 11) % 7);
+}
+
+// ============================================
+// BITSETS AND THE CALENDAR TABLE
+// ============================================
+
+static int next_bit(uint64_t mask, int from) {
+    if (from >= 64) return -1;
+    mask &= ~0ULL << from;
+    return mask ? __builtin_ctzll(mask) : -1;
+}
+
+static void build_year_table(Recurrence *rule, long long year) {
+    memset(rule->table_days, 0, sizeof(rule->table_days));
+
+    long long first_day = days_from_civil(year, 1, 1);
+    int day_of_year = 0;
+    for (int month = 1; month <= 12; month++) {
+        int length = days_in_month(year, month);
+        if (!(rule->months & (1u << month))) {
+            day_of_year += length;
+            continue;
+        }
+        for (int day = 1; day <= length; day++, day_of_year++) {
+            int dom_match = (rule->days_of_month >> day) & 1;
+            int dow_match = (rule->days_of_week >> weekday(first_day + day_of_year)) & 1;
+            if (rule->day_or ? (dom_match || dow_match) : (dom_match && dow_match)) {
+                rule->table_days[day_of_year / 64] |= 1ULL << (day_of_year % 64);
+            }
+        }
+    }
+
+    rule->table_year = (int)year;
+}
+
+static int next_table_day(const Recurrence *rule, int from) {
+    for (int word = from / 64; word < 6; word++) {
+        uint64_t mask = rule->table_days[word];
+        if (word == from / 64) mask &= ~0ULL << (from % 64);
+        if (mask) return word * 64 + __builtin_ctzll(mask);
+    }
+    return -1;
+}
+
+// ============================================
+// NEXT OCCURRENCE
+// ============================================
+
+static long long interval_next(const Recurrence *rule, long long after) {
+    if (after < rule->anchor) return rule->anchor;
+    return rule->anchor + ((after - rule->anchor) / rule->period + 1) * rule->period;
+}
+
+static long long monthly_next(const Recurrence *rule, long long after) {
+    long long offset = rule->utc_offset_minutes * 60LL;
+    long long anchor_local = rule->anchor + offset;
+    long long anchor_day = floor_div(anchor_local, SECONDS_PER_DAY);
+    long long time_of_day = anchor_local - anchor_day * SECONDS_PER_DAY;
+
+    long long anchor_year, after_year;
+    int anchor_month, after_month, day;
+    civil_from_days(anchor_day, &anchor_year, &anchor_month, &day);
+    civil_from_days(floor_div(after + offset, SECONDS_PER_DAY), &after_year, &after_month, &day);
+
+    long long anchor_index = anchor_year * 12 + anchor_month - 1;
+    long long index = after_year * 12 + after_month - 1 - anchor_index;
+    if (index < 0) index = 0;
+    index -= index % rule->month_step;
+
+    // The first candidate is in after's month; the next step always lies beyond it
+    for (int i = 0; i < 2; i++, index += rule->month_step) {
+        long long total = anchor_index + index;
+        long long year = floor_div(total, 12);
+        int month = (int)(total - year * 12) + 1;
+        int length = days_in_month(year, month);
+        int month_day = rule->month_day < length ? rule->month_day : length;
+
+        long long candidate = days_from_civil(year, month, month_day) * SECONDS_PER_DAY + time_of_day - offset;
+        if (candidate > after && candidate >= rule->anchor) return candidate;
+    }
+    return -1;
+}
+
+static long long calendar_next(Recurrence *rule, long long after) {
+    long long offset = rule->utc_offset_minutes * 60LL;
+
+    // Occurrences fall on whole minutes of local time, never before the anchor
+    long long minute = floor_div(after + offset, 60) + 1;
+    long long first_minute = floor_div(rule->anchor + offset + 59, 60);
+    if (first_minute > minute) minute = first_minute;
+
+    long long anchor_week_start = 0;
+    if (rule->week_step > 1) {
+        long long anchor_day = floor_div(rule->anchor + offset, SECONDS_PER_DAY);
+        anchor_week_start = anchor_day - weekday(anchor_day);
+    }
+
+    int first_year = NO_TABLE_YEAR;
+    for (int step = 0; step < CALENDAR_MAX_STEPS; step++) {
+        long long day = floor_div(minute, 1440);
+        int minute_of_day = (int)(minute - day * 1440);
+
+        if (rule->week_step > 1) {
+            long long week = floor_div(day - anchor_week_start, 7);
+            long long skip = week % rule->week_step;
+            if (skip != 0) {
+                minute = (anchor_week_start + (week + rule->week_step - skip) * 7) * 1440;
+                continue;
+            }
+        }
+
+        long long year;
+        int month, month_day;
+        civil_from_days(day, &year, &month, &month_day);
+        if (first_year == NO_TABLE_YEAR) first_year = (int)year;
+        if (year - first_year > CALENDAR_MAX_YEARS) return -1;
+        if (rule->table_year != year) build_year_table(rule, year);
+
+        long long year_start = days_from_civil(year, 1, 1);
+        int day_of_year = (int)(day - year_start);
+
+        if ((rule->table_days[day_of_year / 64] >> (day_of_year % 64)) & 1) {
+            int hour = minute_of_day / 60;
+            int found_hour = -1, found_minute = -1;
+
+            if ((rule->hours >> hour) & 1) {
+                found_minute = next_bit(rule->minutes, minute_of_day % 60);
+                if (found_minute >= 0) found_hour = hour;
+            }
+            if (found_hour < 0) {
+                found_hour = next_bit(rule->hours, hour + 1);
+                found_minute = next_bit(rule->minutes, 0);
+            }
+            if (found_hour >= 0) {
+                long long local_minute = day * 1440 + found_hour * 60 + found_minute;
+                return local_minute * 60 - offset;
+            }
+        }
+
+        int next_day = next_table_day(rule, day_of_year + 1);
+        if (next_day >= 0) {
+            minute = (year_start + next_day) * 1440;
+        } else {
+            minute = days_from_civil(year + 1, 1, 1) * 1440;
+        }
+    }
+
+    return -1;
+}
+
+long long recurrence_next(Recurrence *rule, long long after) {
+    long long next = -1;
+
+    switch (rule->kind) {
+        case RECUR_INTERVAL: next = interval_next(rule, after); break;
+        case RECUR_MONTHLY:  next = monthly_next(rule, after); break;
+        case RECUR_CALENDAR: next = calendar_next(rule, after); break;
+        default: return -1;
+    }
+
+    if (next >= 0 && rule->until > 0 && next > rule->until) return -1;
+    return next;
+}
+
+// ============================================
+// COMPILERS
+// ============================================
+
+static void recurrence_reset(Recurrence *rule) {
+    memset(rule, 0, sizeof(*rule));
+    rule->table_year = NO_TABLE_YEAR;
+}
+
+int recurrence_from_minutes(Recurrence *rule, long long start, int minutes) {
+    recurrence_reset(rule);
+    if (minutes <= 0) return 0;
+
+    rule->kind = RECUR_INTERVAL;
+    rule->anchor = start;
+    rule->period = minutes * 60LL;
+    return 1;
+}
+
+static void set_monthly(Recurrence *rule, long long start, int month_step) {
+    long long year;
+    int month, day;
+    civil_from_days(floor_div(start + rule->utc_offset_minutes * 60LL, SECONDS_PER_DAY), &year, &month, &day);
+
+    rule->kind = RECUR_MONTHLY;
+    rule->anchor = start;
+    rule->month_step = month_step;
+    rule->month_day = day;
+}
+
+int recurrence_from_type(Recurrence *rule, long long start, int type, int interval) {
+    recurrence_reset(rule);
+    if (interval < 1) interval = 1;
+
+    switch (type) {
+        case 1:
+            rule->kind = RECUR_INTERVAL;
+            rule->anchor = start;
+            rule->period = interval * SECONDS_PER_DAY;
+            return 1;
+        case 2:
+            rule->kind = RECUR_INTERVAL;
+            rule->anchor = start;
+            rule->period = interval * 7 * SECONDS_PER_DAY;
+            return 1;
+        case 3:
+            set_monthly(rule, start, interval);
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+// One cron value: a number or a three-letter name (index into names)
+static int parse_cron_value(const char **cursor, const char *const *names, int name_count) {
+    const char *p = *cursor;
+
+    if (isdigit((unsigned char)*p)) {
+        int value = 0;
+        while (isdigit((unsigned char)*p)) value = value * 10 + (*p++ - '0');
+        *cursor = p;
+        return value;
+    }
+
+    for (int i = 0; names && i < name_count; i++) {
+        const char *name = names[i];
+        if (name[0] && toupper((unsigned char)p[0]) == name[0] && toupper((unsigned char)p[1]) == name[1] &&
+            toupper((unsigned char)p[2]) == name[2]) {
+            *cursor = p + 3;
+            return i;
+        }
+    }
+    return -1;
+}
+
+// Comma-separated items of *, N, N-M, each with an optional /STEP
+static int parse_cron_field(const char *text, int min, int max, const char *const *names, int name_count,
+                            uint64_t *bits, int *restricted) {
+    const char *p = text;
+    *bits = 0;
+    *restricted = (*p != '*');
+
+    while (*p) {
+        int low, high, step = 1;
+
+        if (*p == '*') {
+            low = min;
+            high = max;
+            p++;
+        } else {
+            low = parse_cron_value(&p, names, name_count);
+            if (low < 0) return 0;
+            high = low;
+            if (*p == '-') {
+                p++;
+                high = parse_cron_value(&p, names, name_count);
+                if (high < 0) return 0;
+            }
+        }
+
+        if (*p == '/') {
+            p++;
+            step = parse_cron_value(&p, NULL, 0);
+            if (step <= 0) return 0;
+            if (high == low) high = max;    // "5/15" means 5-max/15
+        }
+
+        if (low < min || high > max || low > high) return 0;
+        for (int value = low; value <= high; value += step) {
+            *bits |= 1ULL << value;
+        }
+
+        if (*p == ',') {
+            p++;
+        } else if (*p != '\0') {
+            return 0;
+        }
+    }
+
+    return *bits != 0;
+}
+
+int recurrence_from_cron(Recurrence *rule, const char *expression) {
+    recurrence_reset(rule);
+
+    while (isspace((unsigned char)*expression)) expression++;
+    if (expression[0] == '@') {
+        if (strncmp(expression, "@yearly", 7) == 0 || strncmp(expression, "@annually", 9) == 0) {
+            expression = "0 0 1 1 *";
+        } else if (strncmp(expression, "@monthly", 8) == 0) {
+            expression = "0 0 1 * *";
+        } else if (strncmp(expression, "@weekly", 7) == 0) {
+            expression = "0 0 * * 0";
+        } else if (strncmp(expression, "@daily", 6) == 0 || strncmp(expression, "@midnight", 9) == 0) {
+            expression = "0 0 * * *";
+        } else if (strncmp(expression, "@hourly", 7) == 0) {
+            expression = "0 * * * *";
+        } else {
+            return 0;
+        }
+    }
+
+    char fields[5][64];
+    int count = 0;
+    const char *p = expression;
+    while (*p && count < 5) {
+        while (isspace((unsigned char)*p)) p++;
+        if (!*p) break;
+        size_t length = 0;
+        while (p[length] && !isspace((unsigned char)p[length])) length++;
+        if (length >= sizeof(fields[0])) return 0;
+        memcpy(fields[count], p, length);
+        fields[count][length] = '\0';
+        count++;
+        p += length;
+    }
+    while (isspace((unsigned char)*p)) p++;
+    if (count != 5 || *p) return 0;
+
+    uint64_t minutes, hours, days_of_month, months, days_of_week;
+    int unused, dom_restricted, dow_restricted;
+    if (!parse_cron_field(fields[0], 0, 59, NULL, 0, &minutes, &unused)) return 0;
+    if (!parse_cron_field(fields[1], 0, 23, NULL, 0, &hours, &unused)) return 0;
+    if (!parse_cron_field(fields[2], 1, 31, NULL, 0, &days_of_month, &dom_restricted)) return 0;
+    if (!parse_cron_field(fields[3], 1, 12, month_names, 13, &months, &unused)) return 0;
+    if (!parse_cron_field(fields[4], 0, 7, weekday_names, 7, &days_of_week, &dow_restricted)) return 0;
+
+    // 7 is Sunday too
+    if (days_of_week & (1u << 7)) days_of_week = (days_of_week | 1u) & 0x7f;
+
+    rule->kind = RECUR_CALENDAR;
+    rule->minutes = minutes;
+    rule->hours = (uint32_t)hours;
+    rule->days_of_month = (uint32_t)days_of_month;
+    rule->months = (uint16_t)months;
+    rule->days_of_week = (uint8_t)days_of_week;
+    rule->day_or = dom_restricted && dow_restricted;
+    return 1;
+}
+
+// ============================================
+// recurrence_pattern JSON
+// ============================================
+
+// "days":[1,3,5] (0 = Sunday, 7 also Sunday) as a weekday bitmask
+static int json_weekdays(const JsonBody *fields, const char *key) {
+    const JsonField *field = json_body_field(fields, key);
+    if (!field || field->type != JSON_ARRAY) return 0;
+
+    int mask = 0;
+    const char *end = field->value + field->value_length;
+    for (const char *p = field->value + 1; p < end && *p != ']'; ) {
+        if (isdigit((unsigned char)*p)) {
+            int day = (int)strtol(p, (char **)&p, 10);
+            if (day >= 0 && day <= 7) mask |= 1 << (day % 7);
+        } else {
+            p++;
+        }
+    }
+    return mask;
+}
+
+int recurrence_from_pattern(Recurrence *rule, long long start, const char *pattern) {
+    if (!pattern) {
+        recurrence_reset(rule);
+        return 0;
+    }
+
+    const char *p = pattern;
+    while (isspace((unsigned char)*p)) p++;
+    if (*p != '{') {
+        if (!recurrence_from_cron(rule, p)) return 0;
+        rule->anchor = start;
+        return 1;
+    }
+
+    JsonBody fields;
+    json_body_parse(&fields, p, strlen(p));
+
+    char type[16] = "";
+    char time_text[8] = "";
+    char cron[128] = "";
+    json_body_string(&fields, "type", type, sizeof(type));
+    int interval = json_body_int(&fields, "interval", 1);
+    if (interval < 1) interval = 1;
+    int offset_minutes = json_body_int(&fields, "utc_offset", 0);
+    long long until = json_body_int64(&fields, "until", 0);
+
+    // "time" moves the first occurrence to that local time on or after start
+    long long anchor = start;
+    long long offset = offset_minutes * 60LL;
+    int hour = (int)(floor_div(start + offset, 3600) % 24 + 24) % 24;
+    int minute = (int)(floor_div(start + offset, 60) % 60 + 60) % 60;
+    if (json_body_string(&fields, "time", time_text, sizeof(time_text)) > 0 &&
+        sscanf(time_text, "%d:%d", &hour, &minute) == 2 &&
+        hour >= 0 && hour < 24 && minute >= 0 && minute < 60) {
+        long long day = floor_div(start + offset, SECONDS_PER_DAY);
+        anchor = day * SECONDS_PER_DAY + hour * 3600 + minute * 60 - offset;
+        if (anchor < start) anchor += SECONDS_PER_DAY;
+    }
+
+    int ok = 1;
+    if (strcmp(type, "minutes") == 0) {
+        ok = recurrence_from_minutes(rule, start, interval);
+    } else if (strcmp(type, "hourly") == 0) {
+        ok = recurrence_from_minutes(rule, start, interval * 60);
+    } else if (strcmp(type, "daily") == 0) {
+        ok = recurrence_from_minutes(rule, anchor, interval * 24 * 60);
+    } else if (strcmp(type, "weekly") == 0) {
+        int days = json_weekdays(&fields, "days");
+        if (days == 0) {
+            ok = recurrence_from_minutes(rule, anchor, interval * 7 * 24 * 60);
+        } else {
+            recurrence_reset(rule);
+            rule->kind = RECUR_CALENDAR;
+            rule->anchor = start;
+            rule->minutes = 1ULL << minute;
+            rule->hours = 1u << hour;
+            rule->days_of_month = 0xfffffffeu;
+            rule->months = 0x1ffe;
+            rule->days_of_week = (uint8_t)days;
+            rule->week_step = interval;
+        }
+    } else if (strcmp(type, "monthly") == 0 || strcmp(type, "yearly") == 0) {
+        recurrence_reset(rule);
+        rule->utc_offset_minutes = offset_minutes;
+        set_monthly(rule, anchor, strcmp(type, "yearly") == 0 ? interval * 12 : interval);
+        int month_day = json_body_int(&fields, "day_of_month", 0);
+        if (month_day >= 1 && month_day <= 31) rule->month_day = month_day;
+    } else if (strcmp(type, "cron") == 0 && json_body_string(&fields, "cron", cron, sizeof(cron)) > 0) {
+        ok = recurrence_from_cron(rule, cron);
+        rule->anchor = start;
+    } else {
+        recurrence_reset(rule);
+        ok = 0;
+    }
+
+    if (!ok) return 0;
+    rule->utc_offset_minutes = offset_minutes;
+    rule->until = until;
+    return 1;
+}
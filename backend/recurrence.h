@@ -0,0 +1,68 @@
+/* Recurrence - compiled recurrence rules with constant-time next-occurrence lookup
+ *
+ * Every recurrence format in the project compiles to one Recurrence:
+ *   - scheduler.c recur_minutes                  -> fixed interval
+ *   - scheduler_enhanced recurrence_type/interval -> fixed interval or monthly step
+ *   - tasks.recurrence_pattern JSON               -> any of the kinds below
+ *   - cron expressions ("m h dom mon dow", @daily, ...)
+ *
+ * Fixed intervals and month steps are pure arithmetic. Calendar rules keep one
+ * bitset per cron field plus a table of the matching days of one year, built
+ * on the first lookup in that year; finding the next occurrence is a handful
+ * of find-next-set-bit operations rather than a walk over minutes or days.
+ *
+ * recurrence_pattern JSON (all keys optional except type):
+ *   {"type":"minutes|hourly|daily|weekly|monthly|yearly|cron", "interval":2,
+ *    "days":[1,3,5], "day_of_month":15, "time":"09:30", "cron":"0 9 * * 1-5",
+ *    "until":1767225600, "utc_offset":-300}
+ * A pattern that is not a JSON object is read as a cron expression.
+ */
+
+#ifndef RECURRENCE_H
+#define RECURRENCE_H
+
+#include <stdint.h>
+
+#define RECUR_NONE     0
+#define RECUR_INTERVAL 1    // anchor + k * period
+#define RECUR_MONTHLY  2    // every month_step months from the anchor, on month_day
+#define RECUR_CALENDAR 3    // cron-style field bitsets
+
+typedef struct {
+    int kind;
+    long long anchor;            // First occurrence; nothing is returned before it
+    long long period;            // RECUR_INTERVAL, seconds
+    int month_step;              // RECUR_MONTHLY
+    int month_day;               // RECUR_MONTHLY, 1-31; shorter months use their last day
+    int week_step;               // RECUR_CALENDAR: only every Nth week, counted from the anchor's week
+    long long until;             // 0 = open-ended
+    int utc_offset_minutes;      // Calendar fields are matched in UTC + offset
+
+    uint64_t minutes;            // Bit n = minute n
+    uint32_t hours;              // Bit n = hour n
+    uint32_t days_of_month;      // Bit n = day n (1-31)
+    uint16_t months;             // Bit n = month n (1-12)
+    uint8_t days_of_week;        // Bit 0 = Sunday
+    int day_or;                  // Both day fields restricted: either may match (cron rule)
+
+    int table_year;              // Calendar table: matching days of table_year
+    uint64_t table_days[6];      // Bit n = day of year n (0-365)
+} Recurrence;
+
+// scheduler.c: every `minutes` minutes starting at start
+int recurrence_from_minutes(Recurrence *rule, long long start, int minutes);
+
+// scheduler_enhanced.c: type 1=daily, 2=weekly, 3=monthly; interval <= 1 means every period
+int recurrence_from_type(Recurrence *rule, long long start, int type, int interval);
+
+// Five-field cron expression or @yearly/@monthly/@weekly/@daily/@hourly
+int recurrence_from_cron(Recurrence *rule, const char *expression);
+
+// recurrence_pattern JSON (see above) or a cron expression
+int recurrence_from_pattern(Recurrence *rule, long long start, const char *pattern);
+
+// First occurrence strictly after `after`, or -1 if the rule has ended.
+// Updates the rule's calendar table, so a rule is not shared across threads.
+long long recurrence_next(Recurrence *rule, long long after);
+
+#endif
@@ -0,0 +1,281 @@
+/* Router - route table compiled into a trie of path segments
+ *
+ * Each node is one path segment. Static children sit in a list while routes
+ * are added; router_compile() copies them into an open-addressed table sized
+ * to at most half full, keyed by an FNV-1a hash of the segment. A node has at
+ * most one parameter child, tried only when no static child leads to a route.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "router.h"
+
+enum {
+    METHOD_GET,
+    METHOD_POST,
+    METHOD_PUT,
+    METHOD_PATCH,
+    METHOD_DELETE,
+    METHOD_COUNT
+};
+
+static const char *method_names[METHOD_COUNT] = { "GET", "POST", "PUT", "PATCH", "DELETE" };
+
+struct RouteNode {
+    char *segment;               // NULL on a parameter node
+    int segment_length;
+    unsigned int hash;
+    char *param_name;
+    RouteParamType param_type;
+    RouteHandler handlers[METHOD_COUNT];
+    int route_count;             // Methods with a handler here
+    RouteNode **children;        // Static children
+    int child_count;
+    RouteNode **table;           // Static children by hash, after compile
+    unsigned int table_mask;
+    RouteNode *param_child;
+};
+
+static int method_index(const char *method) {
+    for (int i = 0; i < METHOD_COUNT; i++) {
+        if (strcmp(method, method_names[i]) == 0) return i;
+    }
+    return -1;
+}
+
+static unsigned int segment_hash(const char *segment, int length) {
+    unsigned int hash = 2166136261u;
+    for (int i = 0; i < length; i++) {
+        hash ^= (unsigned char)segment[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static char *copy_text(const char *text, int length) {
+    char *copy = malloc(length + 1);
+    if (!copy) return NULL;
+    memcpy(copy, text, length);
+    copy[length] = '\0';
+    return copy;
+}
+
+static RouteNode *node_new(void) {
+    return calloc(1, sizeof(RouteNode));
+}
+
+static void node_free(RouteNode *node) {
+    if (!node) return;
+    for (int i = 0; i < node->child_count; i++) node_free(node->children[i]);
+    node_free(node->param_child);
+    free(node->children);
+    free(node->table);
+    free(node->segment);
+    free(node->param_name);
+    free(node);
+}
+
+static RouteNode *static_child(const RouteNode *node, const char *segment, int length, unsigned int hash) {
+    if (node->table) {
+        for (unsigned int slot = hash & node->table_mask; node->table[slot]; slot = (slot + 1) & node->table_mask) {
+            const RouteNode *child = node->table[slot];
+            if (child->hash == hash && child->segment_length == length &&
+                memcmp(child->segment, segment, length) == 0) {
+                return node->table[slot];
+            }
+        }
+        return NULL;
+    }
+    for (int i = 0; i < node->child_count; i++) {
+        RouteNode *child = node->children[i];
+        if (child->segment_length == length && memcmp(child->segment, segment, length) == 0) return child;
+    }
+    return NULL;
+}
+
+static RouteNode *add_static_child(RouteNode *node, const char *segment, int length) {
+    unsigned int hash = segment_hash(segment, length);
+    RouteNode *child = static_child(node, segment, length, hash);
+    if (child) return child;
+
+    RouteNode **children = realloc(node->children, (node->child_count + 1) * sizeof(RouteNode*));
+    if (!children) return NULL;
+    node->children = children;
+
+    child = node_new();
+    if (!child || !(child->segment = copy_text(segment, length))) {
+        free(child);
+        return NULL;
+    }
+    child->segment_length = length;
+    child->hash = hash;
+    node->children[node->child_count++] = child;
+
+    // A table built by an earlier compile no longer covers every child
+    free(node->table);
+    node->table = NULL;
+    return child;
+}
+
+// "{name}" or "{name:int}" / "{name:string}"
+static RouteNode *add_param_child(RouteNode *node, const char *segment, int length) {
+    const char *name = segment + 1;
+    const char *colon = memchr(name, ':', length - 2);
+    int name_length = colon ? (int)(colon - name) : length - 2;
+    RouteParamType type = ROUTE_PARAM_STRING;
+
+    if (name_length == 0) return NULL;
+    if (colon) {
+        int type_length = (int)(segment + length - 1 - (colon + 1));
+        if (type_length == 3 && memcmp(colon + 1, "int", 3) == 0) type = ROUTE_PARAM_INT;
+        else if (!(type_length == 6 && memcmp(colon + 1, "string", 6) == 0)) return NULL;
+    }
+
+    RouteNode *child = node->param_child;
+    if (child) {
+        // One parameter per position: /tasks/{id:int} and /tasks/{name} cannot both exist
+        int same = child->param_type == type && (int)strlen(child->param_name) == name_length &&
+                   memcmp(child->param_name, name, name_length) == 0;
+        return same ? child : NULL;
+    }
+
+    child = node_new();
+    if (!child || !(child->param_name = copy_text(name, name_length))) {
+        free(child);
+        return NULL;
+    }
+    child->param_type = type;
+    node->param_child = child;
+    return child;
+}
+
+static int compile_node(RouteNode *node) {
+    int ok = 1;
+    if (node->child_count > 0 && !node->table) {
+        unsigned int size = 4;
+        while (size < (unsigned int)node->child_count * 2) size *= 2;
+        node->table = calloc(size, sizeof(RouteNode*));
+        if (node->table) {
+            node->table_mask = size - 1;
+            for (int i = 0; i < node->child_count; i++) {
+                unsigned int slot = node->children[i]->hash & node->table_mask;
+                while (node->table[slot]) slot = (slot + 1) & node->table_mask;
+                node->table[slot] = node->children[i];
+            }
+        } else {
+            ok = 0;
+        }
+    }
+    for (int i = 0; i < node->child_count; i++) ok &= compile_node(node->children[i]);
+    if (node->param_child) ok &= compile_node(node->param_child);
+    return ok;
+}
+
+static int param_accepts(RouteParamType type, const char *text, int length) {
+    if (type != ROUTE_PARAM_INT) return 1;
+    if (length > 18) return 0; // Fits a long long
+    for (int i = 0; i < length; i++) {
+        if (text[i] < '0' || text[i] > '9') return 0;
+    }
+    return 1;
+}
+
+// Deepest route for the rest of the path, trying static segments before the
+// parameter; params holds the captures of the route returned
+static const RouteNode *match_node(const RouteNode *node, const char *at, RouteParams *params) {
+    while (*at == '/') at++;
+    if (*at == '\0' || *at == '?') return node->route_count > 0 ? node : NULL;
+
+    const char *end = at;
+    while (*end && *end != '/' && *end != '?') end++;
+    int length = (int)(end - at);
+
+    const RouteNode *child = static_child(node, at, length, segment_hash(at, length));
+    if (child) {
+        const RouteNode *found = match_node(child, end, params);
+        if (found) return found;
+    }
+
+    child = node->param_child;
+    if (!child || params->count == ROUTER_MAX_PARAMS || !param_accepts(child->param_type, at, length)) return NULL;
+
+    RouteParam *param = &params->items[params->count++];
+    param->name = child->param_name;
+    param->type = child->param_type;
+    param->text = at;
+    param->length = length;
+    param->int_value = 0;
+    if (child->param_type == ROUTE_PARAM_INT) {
+        for (int i = 0; i < length; i++) param->int_value = param->int_value * 10 + (at[i] - '0');
+    }
+
+    const RouteNode *found = match_node(child, end, params);
+    if (!found) params->count--;
+    return found;
+}
+
+// ============================================
+// PUBLIC API
+// ============================================
+
+void router_init(Router *router) {
+    router->root = node_new();
+}
+
+void router_free(Router *router) {
+    node_free(router->root);
+    router->root = NULL;
+}
+
+int router_add(Router *router, const char *method, const char *pattern, RouteHandler handler) {
+    int index = method_index(method);
+    if (index < 0 || !router->root || !handler || pattern[0] != '/') return 0;
+
+    RouteNode *node = router->root;
+    const char *at = pattern;
+    while (node && *at) {
+        while (*at == '/') at++;
+        if (!*at) break;
+
+        const char *end = at;
+        while (*end && *end != '/') end++;
+        int length = (int)(end - at);
+
+        if (at[0] == '{') {
+            node = at[length - 1] == '}' && length > 2 ? add_param_child(node, at, length) : NULL;
+        } else {
+            node = memchr(at, '{', length) ? NULL : add_static_child(node, at, length);
+        }
+        at = end;
+    }
+
+    if (!node || node->handlers[index]) return 0;
+    node->handlers[index] = handler;
+    node->route_count++;
+    return 1;
+}
+
+int router_compile(Router *router) {
+    return router->root ? compile_node(router->root) : 0;
+}
+
+RouteResult router_match(const Router *router, const char *method, const char *path,
+                         RouteHandler *handler, RouteParams *params) {
+    params->count = 0;
+    const RouteNode *node = router->root && path[0] == '/' ? match_node(router->root, path, params) : NULL;
+    if (!node) return ROUTE_NOT_FOUND;
+
+    int index = method_index(method);
+    if (index < 0 || !node->handlers[index]) return ROUTE_METHOD_NOT_ALLOWED;
+    *handler = node->handlers[index];
+    return ROUTE_FOUND;
+}
+
+long long route_param_int(const RouteParams *params, const char *name, long long default_value) {
+    for (int i = 0; i < params->count; i++) {
+        if (params->items[i].type == ROUTE_PARAM_INT && strcmp(params->items[i].name, name) == 0) {
+            return params->items[i].int_value;
+        }
+    }
+    return default_value;
+}
@@ -0,0 +1,70 @@
+/* Router - route table compiled into a trie of path segments
+ *
+ * Routes are registered at startup as a method plus a pattern such as
+ * "/api/tasks/{id:int}", then compiled: every trie node gets a hash table of
+ * its static child segments. A lookup hashes each path segment once and
+ * probes, so dispatch costs O(path length) whatever the number of routes.
+ * Static segments take precedence over a parameter at the same position.
+ * Parameters are typed: {name:int} only matches digits and is parsed once
+ * here; {name} matches any one segment. Empty segments and the query string
+ * are ignored, so "/api/tasks/" and "/api/tasks?x=1" match "/api/tasks".
+ *
+ * The table is read-only once compiled, so worker threads match without a lock.
+ */
+
+#ifndef ROUTER_H
+#define ROUTER_H
+
+#define ROUTER_MAX_PARAMS 4
+
+typedef enum {
+    ROUTE_PARAM_STRING,
+    ROUTE_PARAM_INT
+} RouteParamType;
+
+typedef struct {
+    const char *name;
+    RouteParamType type;
+    const char *text;            // Into the matched path, not NUL-terminated
+    int length;
+    long long int_value;         // ROUTE_PARAM_INT only
+} RouteParam;
+
+typedef struct {
+    RouteParam items[ROUTER_MAX_PARAMS];
+    int count;
+} RouteParams;
+
+// context is whatever the caller passes to the dispatch, typically the request
+typedef void (*RouteHandler)(int client_socket, const RouteParams *params, void *context);
+
+typedef enum {
+    ROUTE_FOUND,
+    ROUTE_NOT_FOUND,
+    ROUTE_METHOD_NOT_ALLOWED     // The path exists under other methods
+} RouteResult;
+
+typedef struct RouteNode RouteNode;
+
+typedef struct {
+    RouteNode *root;
+} Router;
+
+void router_init(Router *router);
+void router_free(Router *router);
+
+// Returns 0 on a malformed pattern, an unknown method, a parameter that
+// clashes with one already at that position, or a duplicate route
+int router_add(Router *router, const char *method, const char *pattern, RouteHandler handler);
+
+// Builds the per-node lookup tables; call after the last router_add.
+// Returns 0 on allocation failure, leaving lookups on the slower linear path.
+int router_compile(Router *router);
+
+RouteResult router_match(const Router *router, const char *method, const char *path,
+                         RouteHandler *handler, RouteParams *params);
+
+// Value of an int parameter, or default_value if there is none by that name
+long long route_param_int(const RouteParams *params, const char *name, long long default_value);
+
+#endif
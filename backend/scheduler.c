@@ -1,6 +1,8 @@
 /* Minimal scheduler daemon that writes frontend JSON files for demo
- * Compile: gcc scheduler.c -o scheduler -lm
- * Run from project root: ./backend/scheduler
+ * Compile: gcc scheduler.c recurrence.c json_body.c planner.c interval_tree.c -o scheduler -lm
+ * Run from project root: ./backend/scheduler [edf|wsjf|priority]
+ * tasks.json lists each user's pending tasks in plan order (see planner.h),
+ * with the number of that user's other pending tasks each one overlaps.
  */
 #include <stdio.h>
 #include <stdlib.h>
@@ -8,9 +10,13 @@
 #include <time.h>
 #include <unistd.h>
 #include <limits.h>
+#include "recurrence.h"
+#include "planner.h"
+#include "interval_tree.h"
 
 #define MAX_LINE 1024
 #define MAX_TASKS 1024
+#define MAX_USERS 64
 
 typedef struct Task {
     int id;
@@ -26,10 +32,19 @@ typedef struct Task {
     int completed;
 } Task;
 
+typedef struct UserPlan {
+    char username[64];
+    Planner planner;
+    IntervalTree busy;           // Pending tasks with a start and end
+} UserPlan;
+
 Task tasks[MAX_TASKS];
 int task_count = 0;
 char data_path[512] = "../frontend/data";
 int poll_interval = 10;
+int plan_policy = PLAN_WSJF;
+UserPlan plans[MAX_USERS];
+int plan_count = 0;
 
 void ensure_dir(const char *p) {
     char cmd[1024];
@@ -71,6 +86,89 @@ int parse_tasks_file(const char *fname) {
     return task_count;
 }
 
+// Recurring tasks whose window has passed move to their next occurrence
+void roll_recurring_tasks(Task *arr, int n, time_t now) {
+    for (int i=0;i<n;i++) {
+        if (arr[i].recur_minutes<=0 || arr[i].end_epoch<=0 || arr[i].end_epoch>=now) continue;
+        Recurrence rule;
+        if (!recurrence_from_minutes(&rule, arr[i].end_epoch, arr[i].recur_minutes)) continue;
+        long long next = recurrence_next(&rule, now);
+        if (next<0) continue;
+        long shift = (long)(next - arr[i].end_epoch);
+        if (arr[i].start_epoch>0) arr[i].start_epoch += shift;
+        arr[i].end_epoch = (long)next;
+    }
+}
+
+UserPlan *find_plan(const char *username) {
+    for (int i=0;i<plan_count;i++) if (strcmp(plans[i].username, username)==0) return &plans[i];
+    if (plan_count>=MAX_USERS) return NULL;
+    UserPlan *up = &plans[plan_count++];
+    strncpy(up->username, username, sizeof(up->username)-1);
+    planner_init(&up->planner, plan_policy);
+    interval_tree_init(&up->busy);
+    return up;
+}
+
+// Plans persist across polls: unchanged tasks cost nothing, changed ones are
+// re-sifted, and tasks that disappeared or were completed drop out. The busy
+// trees are rebuilt, since any task's window may have moved.
+void update_plans(Task *arr, int n) {
+    for (int i=0;i<plan_count;i++) {
+        planner_sync_begin(&plans[i].planner);
+        interval_tree_free(&plans[i].busy);
+    }
+    for (int i=0;i<n;i++) {
+        if (arr[i].completed) continue;
+        UserPlan *up = find_plan(arr[i].username);
+        if (!up) continue;
+        PlanItem item = { arr[i].id, arr[i].priority, arr[i].difficulty, arr[i].start_epoch, arr[i].end_epoch };
+        planner_upsert(&up->planner, &item);
+        if (arr[i].start_epoch>0) interval_tree_insert(&up->busy, arr[i].start_epoch, arr[i].end_epoch, arr[i].id);
+    }
+    for (int i=0;i<plan_count;i++) planner_sync_end(&plans[i].planner);
+}
+
+typedef struct { int id; int index; } TaskRef;
+
+static int compare_task_ref(const void *a, const void *b) {
+    const TaskRef *x = a, *y = b;
+    return (x->id > y->id) - (x->id < y->id);
+}
+
+// Output order: each user's plan, then whatever is not planned in file order.
+// rank[i] is task i's 1-based position in its user's plan, 0 if unplanned.
+int plan_output_order(Task *arr, int n, int *order, int *rank) {
+    static TaskRef refs[MAX_TASKS];
+    static int ids[MAX_TASKS];
+    for (int i=0;i<n;i++) { refs[i].id = arr[i].id; refs[i].index = i; rank[i] = 0; }
+    qsort(refs, n, sizeof(TaskRef), compare_task_ref);
+    int out=0;
+    for (int u=0;u<plan_count;u++) {
+        int k = planner_order(&plans[u].planner, ids, MAX_TASKS);
+        for (int j=0;j<k;j++) {
+            TaskRef key = { ids[j], 0 };
+            TaskRef *ref = bsearch(&key, refs, n, sizeof(TaskRef), compare_task_ref);
+            if (!ref || rank[ref->index]) continue;
+            rank[ref->index] = j+1;
+            order[out++] = ref->index;
+        }
+    }
+    for (int i=0;i<n;i++) if (!rank[i]) order[out++] = i;
+    return out;
+}
+
+// Other pending tasks of the same user that overlap task t, O(log n + k)
+int count_conflicts(Task *t) {
+    if (t->completed || t->start_epoch<=0 || t->end_epoch<=t->start_epoch) return 0;
+    for (int u=0;u<plan_count;u++) {
+        if (strcmp(plans[u].username, t->username)!=0) continue;
+        int k = interval_tree_overlaps(&plans[u].busy, t->start_epoch, t->end_epoch, NULL, 0);
+        return k>0 ? k-1 : 0;
+    }
+    return 0;
+}
+
 double compute_productivity(Task *arr, int n) {
     if (n==0) return 0.0;
     double score=0, total=0;
@@ -86,10 +184,13 @@ void write_tasks_json(const char *out_dir, Task *arr, int n) {
     snprintf(fname,sizeof(fname),"%s/tasks.json", out_dir);
     FILE *f = fopen(fname,"w");
     if (!f) return;
+    static int order[MAX_TASKS], rank[MAX_TASKS];
+    plan_output_order(arr, n, order, rank);
     fprintf(f,"{\n  \"tasks\": [\n");
-    for (int i=0;i<n;i++) {
-        fprintf(f,"    {\"id\":%d,\"username\":\"%s\",\"title\":\"%s\",\"desc\":\"%s\",\"tag\":\"%s\",\"difficulty\":%d,\"priority\":%d,\"start\":%ld,\"end\":%ld,\"completed\":%d}%s\n",
-            arr[i].id, arr[i].username, arr[i].title, arr[i].desc, arr[i].tag, arr[i].difficulty, arr[i].priority, arr[i].start_epoch, arr[i].end_epoch, arr[i].completed, (i==n-1)?"":" ,");
+    for (int o=0;o<n;o++) {
+        int i = order[o];
+        fprintf(f,"    {\"id\":%d,\"username\":\"%s\",\"title\":\"%s\",\"desc\":\"%s\",\"tag\":\"%s\",\"difficulty\":%d,\"priority\":%d,\"start\":%ld,\"end\":%ld,\"completed\":%d,\"rank\":%d,\"conflicts\":%d}%s\n",
+            arr[i].id, arr[i].username, arr[i].title, arr[i].desc, arr[i].tag, arr[i].difficulty, arr[i].priority, arr[i].start_epoch, arr[i].end_epoch, arr[i].completed, rank[i], count_conflicts(&arr[i]), (o==n-1)?"":" ,");
     }
     double prod = compute_productivity(arr,n);
     // pressure: fraction of tasks with near deadlines
@@ -100,7 +201,7 @@ void write_tasks_json(const char *out_dir, Task *arr, int n) {
         pressure += 1.0 - fmin(1.0, hours_left/(24.0*7.0)); cnt++;
     }
     if (cnt) pressure = pressure / cnt; else pressure = 0.0;
-    fprintf(f,"  ],\n  \"meta\": {\"productivity\": %.2f, \"pressure\": %.3f}\n}\n", prod, pressure);
+    fprintf(f,"  ],\n  \"meta\": {\"productivity\": %.2f, \"pressure\": %.3f, \"plan\": \"%s\"}\n}\n", prod, pressure, planner_policy_name(plan_policy));
     fclose(f);
 }
 
@@ -134,12 +235,18 @@ void write_notifications(const char *out_dir, Task *arr, int n, time_t now) {
     fclose(f);
 }
 
-int main() {
+int main(int argc, char **argv) {
+    if (argc>1) {
+        plan_policy = planner_policy_from_name(argv[1]);
+        if (plan_policy<0) { fprintf(stderr,"Unknown plan policy %s (edf|wsjf|priority)\n", argv[1]); return 1; }
+    }
     ensure_dir(data_path);
-    printf("Scheduler demo starting. Writing to %s every %d seconds\n", data_path, poll_interval);
+    printf("Scheduler demo starting. Writing to %s every %d seconds (%s plan)\n", data_path, poll_interval, planner_policy_name(plan_policy));
     while (1) {
         parse_tasks_file("backend/tasks_example.txt");
         Task copy[MAX_TASKS]; for (int i=0;i<task_count;i++) copy[i]=tasks[i];
+        roll_recurring_tasks(copy, task_count, time(NULL));
+        update_plans(copy, task_count);
         write_tasks_json(data_path, copy, task_count);
         write_heatmap(data_path, copy, task_count);
         time_t now = time(NULL);
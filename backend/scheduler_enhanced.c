@@ -1,9 +1,13 @@
 /* Enhanced Task Scheduler Backend with SQLite Integration
  * Production-ready C backend with proper database management
  * 
- * Compile: gcc scheduler_enhanced.c -o scheduler_enhanced -lsqlite3 -lcjson -lm -lcurl
+ * Compile: gcc scheduler_enhanced.c query_stats.c lock_stats.c recurrence.c json_body.c -o scheduler_enhanced -lsqlite3 -lcjson -lm -lcurl -lpthread
  * Dependencies: sudo apt-get install libsqlite3-dev libcjson-dev libcurl4-openssl-dev
  * Run: ./backend/scheduler_enhanced
+ * Stats: kill -USR1 <pid> dumps query latency histograms and lock contention
+ * Reload: kill -HUP <pid> re-reads config.json without restarting
+ * Workers: ./backend/scheduler_enhanced --workers 4 splits users across worker
+ *          processes; kill -TTIN / -TTOU <pid> adds or removes a worker
  */
 
 #include <stdio.h>
@@ -19,6 +23,11 @@
 #include <errno.h>
 #include <signal.h>
 #include <pthread.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include "query_stats.h"
+#include "lock_stats.h"
+#include "recurrence.h"
 
 // Configuration constants
 #define MAX_PATH 1024
@@ -26,7 +35,61 @@
 #define MAX_USERS 10000
 #define MAX_TASKS_PER_USER 1000
 #define CONFIG_FILE "backend/config.json"
-#define DB_SCHEMA_VERSION 2
+#define DB_SCHEMA_VERSION 4
+
+// Locking goes through the contention instrumentation unless compiled out
+#ifdef DISABLE_LOCK_STATS
+    #define MUTEX_LOCK(mutex) pthread_mutex_lock(&mutex)
+    #define MUTEX_UNLOCK(mutex) pthread_mutex_unlock(&mutex)
+#else
+    #define MUTEX_LOCK(mutex) LOCK_STATS_LOCK(mutex)
+    #define MUTEX_UNLOCK(mutex) LOCK_STATS_UNLOCK(mutex)
+#endif
+
+// Notification throttling
+#define NOTIFICATION_BUCKET_SLOTS 16384  // Power of two, comfortably above MAX_USERS
+#define DIGEST_INTERVAL_SEC 900          // At most one digest per user every 15 minutes
+#define DIGEST_PREVIEW_TITLES 3
+
+// notification_preferences bitmask (users.notification_preferences, default 7 = all)
+#define NOTIFY_PUSH  0x1
+#define NOTIFY_EMAIL 0x2
+#define NOTIFY_SMS   0x4
+
+// Completed recurring tasks rolled forward per poll
+#define MAX_RECURRING_PER_POLL 256
+
+// Worker sharding (--workers N). A user's shard is user_id % SHARD_COUNT, so
+// a worker's shard set fits in one 64-bit mask that SQL can test directly.
+#define SHARD_COUNT 64
+#define ALL_SHARDS (~0ULL)
+#define MAX_WORKERS 32
+#define WORKER_RESPAWN_DELAY_SEC 5
+#define WORKER_STALL_POLLS 6             // Missed polls before a silent worker is killed
+#define SHARD_FILTER(column) "((1 << (" column " % 64)) & ?) != 0"
+
+// Job queue (jobs table). A claimed job carries a lease; if the claiming
+// process dies the job becomes runnable again once the lease expires.
+#define JOB_LEASE_SEC 600
+#define JOB_BATCH_SIZE 32
+#define JOB_MAX_BATCHES_PER_POLL 16
+#define JOB_MAX_ATTEMPTS 5
+#define JOB_RETRY_BASE_SEC 30             // Doubles with every failed attempt
+#define JOB_DEFER_SEC 300                 // Throttled reminders try again after this
+
+// jobs.status
+#define JOB_QUEUED 0
+#define JOB_DONE   1
+#define JOB_FAILED 2
+
+// Job handler results
+#define JOB_RESULT_DONE  0
+#define JOB_RESULT_RETRY 1                // Failed, counts as an attempt
+#define JOB_RESULT_DEFER 2                // Not yet possible, does not count
+
+#ifndef MAP_ANONYMOUS
+    #define MAP_ANONYMOUS MAP_ANON
+#endif
 
 // Global configuration structure
 typedef struct {
@@ -40,9 +103,11 @@ typedef struct {
     int cleanup_days;
     char cors_origins[512];
     int rate_limit_rpm;
+    int max_notifications_per_hour;
     int enable_notifications;
     int enable_face_auth;
     int debug_mode;
+    int slow_query_ms;
 } Config;
 
 // Task structure
@@ -62,10 +127,12 @@ typedef struct {
     int status;          // 0=pending, 1=in_progress, 2=completed, 3=cancelled
     int recurrence_type; // 0=none, 1=daily, 2=weekly, 3=monthly
     int recurrence_interval;
+    char recurrence_rule[128]; // recurrence_pattern JSON or cron; overrides type/interval
     char tags[256];
     char face_hash[128]; // For face recognition integration
     int notification_sent;
     int reminder_count;
+    long reminder_time;  // 0 = no reminder; queued as a 'reminder' job
 } Task;
 
 // User structure
@@ -88,15 +155,69 @@ typedef struct {
     double productivity_score;
 } User;
 
+// Per-user notification token bucket
+typedef struct {
+    int user_id;         // 0 = empty slot
+    double tokens;
+    time_t last_refill;
+    time_t last_digest;
+} NotificationBucket;
+
+// A claimed row of the jobs table
+typedef struct {
+    long long id;
+    char kind[32];
+    int user_id;         // 0 = not tied to a user, any worker may run it
+    int task_id;
+    int attempts;        // Including the current one
+} Job;
+
+// Housekeeping that reschedules itself after every run
+typedef struct {
+    const char *kind;
+    int interval_sec;
+} PeriodicJob;
+
+static const PeriodicJob periodic_jobs[] = {
+    { "cleanup",   6 * 3600 },
+    { "analytics", 3600 },
+    { "backup",    24 * 3600 },
+};
+
+// Worker bookkeeping shared between the coordinator and its workers
+typedef struct {
+    pid_t pid;                  // 0 = slot free
+    int stopping;               // Coordinator asked it to exit (scale down)
+    long seen_generation;       // Last shard assignment the worker adopted
+    time_t heartbeat;           // Refreshed by the worker at the start of each poll
+} WorkerSlot;
+
+typedef struct {
+    long generation;                // Bumped on every assignment change
+    int shard_owner[SHARD_COUNT];   // Worker slot, -1 = unassigned
+    WorkerSlot workers[MAX_WORKERS];
+} ShardTable;
+
 // Global variables
-static Config config;
 static sqlite3 *db = NULL;
-static int running = 1;
+static volatile sig_atomic_t running = 1;
+static volatile sig_atomic_t dump_stats_requested = 0;
+static volatile sig_atomic_t reload_requested = 0;
+static volatile sig_atomic_t add_worker_requested = 0;
+static volatile sig_atomic_t remove_worker_requested = 0;
+static ShardTable *shard_table = NULL;      // MAP_SHARED; NULL when running single-process
+static unsigned long long owned_shards = ALL_SHARDS;
+static char job_owner[96] = "";             // lease_owner written by this process
 static pthread_mutex_t db_mutex = PTHREAD_MUTEX_INITIALIZER;
+static NotificationBucket notification_buckets[NOTIFICATION_BUCKET_SLOTS];
+static pthread_mutex_t notify_mutex = PTHREAD_MUTEX_INITIALIZER;
 
 // Function prototypes
 int load_config(const char *config_file);
+int reload_config(const char *config_file);
+const Config *config_get(void);
 int init_database(void);
+int open_database(void);
 int create_tables(void);
 int migrate_database(void);
 void signal_handler(int signum);
@@ -118,13 +239,22 @@ int update_user_face_data(int user_id, const char *face_descriptor);
 
 // Notification system
 int send_task_notification(const Task *task, const User *user);
-int check_due_tasks(void);
+int check_due_tasks(unsigned long long shard_mask);
+int take_notification_token(int user_id, time_t now);
+int take_digest_slot(int user_id, time_t now);
 int send_push_notification(const char *title, const char *body, const char *user_token);
 
 // Analytics and reporting
 double calculate_productivity_score(int user_id);
 int generate_user_analytics(int user_id, cJSON **analytics);
-int cleanup_old_tasks(void);
+int cleanup_old_tasks(unsigned long long shard_mask);
+int materialize_recurring_tasks(unsigned long long shard_mask);
+int update_shard_analytics(unsigned long long shard_mask);
+int backup_database(void);
+
+// Job queue
+int seed_periodic_jobs(void);
+int run_due_jobs(unsigned long long shard_mask);
 
 // Database utilities
 int execute_query(const char *sql);
@@ -134,25 +264,53 @@ int execute_query_with_callback(const char *sql, int (*callback)(void*,int,char*
 // CONFIGURATION MANAGEMENT
 // ============================================
 
-int load_config(const char *config_file) {
+// The active Config is immutable once published. Readers take one snapshot
+// per unit of work with config_get() and never keep it across polls; SIGHUP
+// builds a fresh Config and swaps the pointer. The replaced Config is freed
+// on the following reload, by which time no reader can still hold it.
+static Config *current_config = NULL;
+static Config *retired_config = NULL;
+
+const Config *config_get(void) {
+    return __atomic_load_n(&current_config, __ATOMIC_ACQUIRE);
+}
+
+static void config_publish(Config *next) {
+    Config *previous = __atomic_exchange_n(&current_config, next, __ATOMIC_ACQ_REL);
+    free(retired_config);
+    retired_config = previous;
+}
+
+static void config_set_defaults(Config *cfg) {
+    memset(cfg, 0, sizeof(*cfg));
+    strcpy(cfg->db_path, "../frontend/data/scheduler.db");
+    strcpy(cfg->backup_path, "../frontend/data/backups");
+    cfg->poll_interval_sec = 10;
+    cfg->port = 3000;
+    cfg->max_connections = 100;
+    cfg->session_timeout_hours = 24;
+    cfg->max_tasks_per_user = 1000;
+    cfg->cleanup_days = 30;
+    strcpy(cfg->cors_origins, "http://localhost:8080,http://127.0.0.1:8080");
+    cfg->rate_limit_rpm = 60;
+    cfg->max_notifications_per_hour = 20;
+    cfg->enable_notifications = 1;
+    cfg->enable_face_auth = 1;
+    cfg->debug_mode = 0;
+    cfg->slow_query_ms = 1000;
+}
+
+// Builds a new Config from defaults overlaid with the file. Returns NULL if
+// the file exists but is not valid JSON.
+static Config *parse_config(const char *config_file) {
+    Config *cfg = malloc(sizeof(Config));
+    if (!cfg) return NULL;
+    config_set_defaults(cfg);
+
     FILE *file = fopen(config_file, "r");
     if (!file) {
         printf("Warning: Config file not found, using defaults\n");
-        // Set default values
-        strcpy(config.db_path, "../frontend/data/scheduler.db");
-        strcpy(config.backup_path, "../frontend/data/backups");
-        config.poll_interval_sec = 10;
-        config.port = 3000;
-        config.max_connections = 100;
-        config.session_timeout_hours = 24;
-        config.max_tasks_per_user = 1000;
-        config.cleanup_days = 30;
-        strcpy(config.cors_origins, "http://localhost:8080,http://127.0.0.1:8080");
-        config.rate_limit_rpm = 60;
-        config.enable_notifications = 1;
-        config.enable_face_auth = 1;
-        config.debug_mode = 0;
-        return 1;
+        return cfg;
     }
 
     // Read file content
@@ -171,7 +329,8 @@ int load_config(const char *config_file) {
     
     if (!json) {
         printf("Error: Invalid JSON in config file\n");
-        return 0;
+        free(cfg);
+        return NULL;
     }
 
     // Extract configuration values
@@ -179,30 +338,46 @@ int load_config(const char *config_file) {
     if (database) {
         cJSON *path = cJSON_GetObjectItem(database, "path");
         if (path && cJSON_IsString(path)) {
-            strcpy(config.db_path, path->valuestring);
+            snprintf(cfg->db_path, sizeof(cfg->db_path), "%s", path->valuestring);
         }
         
         cJSON *backup = cJSON_GetObjectItem(database, "backup_path");
         if (backup && cJSON_IsString(backup)) {
-            strcpy(config.backup_path, backup->valuestring);
+            snprintf(cfg->backup_path, sizeof(cfg->backup_path), "%s", backup->valuestring);
         }
     }
 
     cJSON *tasks = cJSON_GetObjectItem(json, "tasks");
     if (tasks) {
         cJSON *poll = cJSON_GetObjectItem(tasks, "poll_interval_sec");
-        if (poll && cJSON_IsNumber(poll)) {
-            config.poll_interval_sec = poll->valueint;
+        if (poll && cJSON_IsNumber(poll) && poll->valueint > 0) {
+            cfg->poll_interval_sec = poll->valueint;
         }
         
         cJSON *max_tasks = cJSON_GetObjectItem(tasks, "max_tasks_per_user");
         if (max_tasks && cJSON_IsNumber(max_tasks)) {
-            config.max_tasks_per_user = max_tasks->valueint;
+            cfg->max_tasks_per_user = max_tasks->valueint;
         }
         
         cJSON *cleanup = cJSON_GetObjectItem(tasks, "cleanup_completed_after_days");
         if (cleanup && cJSON_IsNumber(cleanup)) {
-            config.cleanup_days = cleanup->valueint;
+            cfg->cleanup_days = cleanup->valueint;
+        }
+    }
+
+    cJSON *notifications = cJSON_GetObjectItem(json, "notifications");
+    if (notifications) {
+        cJSON *per_hour = cJSON_GetObjectItem(notifications, "max_notifications_per_hour");
+        if (per_hour && cJSON_IsNumber(per_hour)) {
+            cfg->max_notifications_per_hour = per_hour->valueint;
+        }
+    }
+
+    cJSON *performance = cJSON_GetObjectItem(json, "performance");
+    if (performance) {
+        cJSON *slow = cJSON_GetObjectItem(performance, "log_slow_queries_ms");
+        if (slow && cJSON_IsNumber(slow)) {
+            cfg->slow_query_ms = slow->valueint;
         }
     }
 
@@ -210,25 +385,70 @@ int load_config(const char *config_file) {
     if (server) {
         cJSON *port = cJSON_GetObjectItem(server, "port");
         if (port && cJSON_IsNumber(port)) {
-            config.port = port->valueint;
+            cfg->port = port->valueint;
         }
         
         cJSON *max_conn = cJSON_GetObjectItem(server, "max_connections");
         if (max_conn && cJSON_IsNumber(max_conn)) {
-            config.max_connections = max_conn->valueint;
+            cfg->max_connections = max_conn->valueint;
+        }
+
+        cJSON *rate_limiting = cJSON_GetObjectItem(server, "rate_limiting");
+        if (rate_limiting) {
+            cJSON *rpm = cJSON_GetObjectItem(rate_limiting, "requests_per_minute");
+            if (rpm && cJSON_IsNumber(rpm)) {
+                cfg->rate_limit_rpm = rpm->valueint;
+            }
         }
     }
 
     cJSON_Delete(json);
+    return cfg;
+}
+
+int load_config(const char *config_file) {
+    Config *cfg = parse_config(config_file);
+    if (!cfg) return 0;
+
+    config_publish(cfg);
     
     printf("✅ Configuration loaded successfully\n");
-    printf("📁 Database: %s\n", config.db_path);
-    printf("🔄 Poll interval: %d seconds\n", config.poll_interval_sec);
-    printf("🌐 Port: %d\n", config.port);
+    printf("📁 Database: %s\n", cfg->db_path);
+    printf("🔄 Poll interval: %d seconds\n", cfg->poll_interval_sec);
+    printf("🌐 Port: %d\n", cfg->port);
     
     return 1;
 }
 
+// SIGHUP: re-read the file without touching the database. Settings that only
+// apply at startup keep their running values.
+int reload_config(const char *config_file) {
+    const Config *active = config_get();
+    Config *cfg = parse_config(config_file);
+    if (!cfg) {
+        printf("❌ Config reload failed, keeping current configuration\n");
+        return 0;
+    }
+
+    if (strcmp(cfg->db_path, active->db_path) != 0 ||
+        strcmp(cfg->backup_path, active->backup_path) != 0 ||
+        cfg->port != active->port) {
+        printf("⚠️  Database paths and port changes require a restart; keeping current values\n");
+    }
+    strcpy(cfg->db_path, active->db_path);
+    strcpy(cfg->backup_path, active->backup_path);
+    cfg->port = active->port;
+
+    query_stats_init(cfg->slow_query_ms);
+    config_publish(cfg);
+
+    printf("🔁 Configuration reloaded: poll %ds, max tasks/user %d, cleanup %d days, "
+           "rate limit %d rpm, notifications %d/hour\n",
+           cfg->poll_interval_sec, cfg->max_tasks_per_user, cfg->cleanup_days,
+           cfg->rate_limit_rpm, cfg->max_notifications_per_hour);
+    return 1;
+}
+
 // ============================================
 // DATABASE MANAGEMENT
 // ============================================
@@ -261,9 +481,11 @@ int ensure_directory(const char *path) {
 }
 
 int init_database(void) {
+    const Config *cfg = config_get();
+
     // Ensure database directory exists
     char db_dir[MAX_PATH];
-    strcpy(db_dir, config.db_path);
+    strcpy(db_dir, cfg->db_path);
     char *last_slash = strrchr(db_dir, '/');
     if (last_slash) {
         *last_slash = '\0';
@@ -274,27 +496,15 @@ int init_database(void) {
     }
 
     // Ensure backup directory exists
-    if (!ensure_directory(config.backup_path)) {
-        printf("❌ Failed to create backup directory: %s\n", config.backup_path);
+    if (!ensure_directory(cfg->backup_path)) {
+        printf("❌ Failed to create backup directory: %s\n", cfg->backup_path);
         return 0;
     }
 
-    // Open database
-    int rc = sqlite3_open(config.db_path, &db);
-    if (rc != SQLITE_OK) {
-        printf("❌ Cannot open database: %s\n", sqlite3_errmsg(db));
-        sqlite3_close(db);
+    if (!open_database()) {
         return 0;
     }
 
-    // Enable foreign keys and WAL mode
-    execute_query("PRAGMA foreign_keys = ON");
-    execute_query("PRAGMA journal_mode = WAL");
-    execute_query("PRAGMA synchronous = NORMAL");
-    execute_query("PRAGMA cache_size = 10000");
-    execute_query("PRAGMA temp_store = MEMORY");
-    execute_query("PRAGMA auto_vacuum = INCREMENTAL");
-
     // Create tables
     if (!create_tables()) {
         printf("❌ Failed to create database tables\n");
@@ -307,7 +517,38 @@ int init_database(void) {
         return 0;
     }
 
-    printf("✅ Database initialized: %s\n", config.db_path);
+    seed_periodic_jobs();
+
+    printf("✅ Database initialized: %s\n", cfg->db_path);
+    return 1;
+}
+
+// Opens this process's connection. Workers each open their own after fork;
+// WAL lets them read concurrently and the busy timeout queues their writes.
+int open_database(void) {
+    const Config *cfg = config_get();
+
+    int rc = sqlite3_open(cfg->db_path, &db);
+    if (rc != SQLITE_OK) {
+        printf("❌ Cannot open database: %s\n", sqlite3_errmsg(db));
+        sqlite3_close(db);
+        db = NULL;
+        return 0;
+    }
+    sqlite3_busy_timeout(db, 5000);
+
+    // Time every statement; slow ones are logged with their bound values
+    query_stats_init(cfg->slow_query_ms);
+    query_stats_attach(db);
+
+    // Enable foreign keys and WAL mode
+    execute_query("PRAGMA foreign_keys = ON");
+    execute_query("PRAGMA journal_mode = WAL");
+    execute_query("PRAGMA synchronous = NORMAL");
+    execute_query("PRAGMA cache_size = 10000");
+    execute_query("PRAGMA temp_store = MEMORY");
+    execute_query("PRAGMA auto_vacuum = INCREMENTAL");
+
     return 1;
 }
 
@@ -348,10 +589,13 @@ int create_tables(void) {
         "status INTEGER DEFAULT 0,"
         "recurrence_type INTEGER DEFAULT 0,"
         "recurrence_interval INTEGER DEFAULT 0,"
+        "recurrence_rule TEXT,"
         "tags TEXT,"
         "face_hash TEXT,"
         "notification_sent INTEGER DEFAULT 0,"
         "reminder_count INTEGER DEFAULT 0,"
+        "reminder_time INTEGER DEFAULT 0,"
+        "reminder_sent INTEGER DEFAULT 0,"
         "FOREIGN KEY (user_id) REFERENCES users(id) ON DELETE CASCADE"
         ");";
 
@@ -395,12 +639,33 @@ int create_tables(void) {
         "FOREIGN KEY (user_id) REFERENCES users(id) ON DELETE SET NULL"
         ");";
 
+    // dedupe_key keeps one row per periodic job and per task reminder
+    const char *sql_jobs =
+        "CREATE TABLE IF NOT EXISTS jobs ("
+        "id INTEGER PRIMARY KEY AUTOINCREMENT,"
+        "kind TEXT NOT NULL,"
+        "dedupe_key TEXT UNIQUE,"
+        "user_id INTEGER,"
+        "task_id INTEGER,"
+        "run_at INTEGER NOT NULL,"
+        "lease_owner TEXT,"
+        "lease_expires INTEGER DEFAULT 0,"
+        "attempts INTEGER DEFAULT 0,"
+        "status INTEGER DEFAULT 0,"
+        "last_error TEXT,"
+        "created_at INTEGER NOT NULL,"
+        "finished_at INTEGER DEFAULT 0,"
+        "FOREIGN KEY (user_id) REFERENCES users(id) ON DELETE CASCADE,"
+        "FOREIGN KEY (task_id) REFERENCES tasks(id) ON DELETE CASCADE"
+        ");";
+
     // Execute table creation queries
     if (!execute_query(sql_users)) return 0;
     if (!execute_query(sql_tasks)) return 0;
     if (!execute_query(sql_sessions)) return 0;
     if (!execute_query(sql_notifications)) return 0;
     if (!execute_query(sql_audit_log)) return 0;
+    if (!execute_query(sql_jobs)) return 0;
 
     // Create indexes for performance
     execute_query("CREATE INDEX IF NOT EXISTS idx_tasks_user_id ON tasks(user_id)");
@@ -410,6 +675,8 @@ int create_tables(void) {
     execute_query("CREATE INDEX IF NOT EXISTS idx_sessions_expires ON sessions(expires_at)");
     execute_query("CREATE INDEX IF NOT EXISTS idx_notifications_user_id ON notifications(user_id)");
     execute_query("CREATE INDEX IF NOT EXISTS idx_audit_timestamp ON audit_log(timestamp)");
+    // Only queued rows are ever scanned for claims; finished jobs stay out of the index
+    execute_query("CREATE INDEX IF NOT EXISTS idx_jobs_runnable ON jobs(run_at, lease_expires) WHERE status = 0");
 
     printf("✅ Database tables created with indexes\n");
     return 1;
@@ -446,6 +713,31 @@ int migrate_database(void) {
             execute_query("CREATE INDEX IF NOT EXISTS idx_tasks_scheduled ON tasks(scheduled_at)");
         }
 
+        // Migration from version 2 to 3: reminders become jobs
+        if (current_version < 3) {
+            execute_query("ALTER TABLE tasks ADD COLUMN reminder_time INTEGER DEFAULT 0");
+            execute_query("ALTER TABLE tasks ADD COLUMN reminder_sent INTEGER DEFAULT 0");
+            execute_query(
+                "CREATE TRIGGER IF NOT EXISTS queue_reminder_on_insert AFTER INSERT ON tasks "
+                "WHEN NEW.reminder_time > 0 AND NEW.reminder_sent = 0 BEGIN "
+                "INSERT OR REPLACE INTO jobs (kind, dedupe_key, user_id, task_id, run_at, created_at) "
+                "VALUES ('reminder', 'reminder:' || NEW.id, NEW.user_id, NEW.id, NEW.reminder_time, "
+                "strftime('%s', 'now')); END");
+            execute_query(
+                "CREATE TRIGGER IF NOT EXISTS queue_reminder_on_update AFTER UPDATE OF reminder_time ON tasks "
+                "WHEN NEW.reminder_time > 0 AND NEW.reminder_sent = 0 BEGIN "
+                "INSERT OR REPLACE INTO jobs (kind, dedupe_key, user_id, task_id, run_at, created_at) "
+                "VALUES ('reminder', 'reminder:' || NEW.id, NEW.user_id, NEW.id, NEW.reminder_time, "
+                "strftime('%s', 'now')); END");
+        }
+
+        // Migration from version 3 to 4: rule-based recurrence
+        if (current_version < 4) {
+            execute_query("ALTER TABLE tasks ADD COLUMN recurrence_rule TEXT");
+            execute_query("CREATE INDEX IF NOT EXISTS idx_tasks_recurring_done ON tasks(user_id) "
+                          "WHERE status = 2 AND (recurrence_type > 0 OR recurrence_rule IS NOT NULL)");
+        }
+
         // Update schema version
         char version_sql[128];
         snprintf(version_sql, sizeof(version_sql), "PRAGMA user_version = %d", DB_SCHEMA_VERSION);
@@ -458,7 +750,7 @@ int migrate_database(void) {
 }
 
 int execute_query(const char *sql) {
-    pthread_mutex_lock(&db_mutex);
+    MUTEX_LOCK(db_mutex);
     
     char *err_msg = 0;
     int rc = sqlite3_exec(db, sql, 0, 0, &err_msg);
@@ -466,11 +758,11 @@ int execute_query(const char *sql) {
     if (rc != SQLITE_OK) {
         printf("❌ SQL error: %s\n", err_msg);
         sqlite3_free(err_msg);
-        pthread_mutex_unlock(&db_mutex);
+        MUTEX_UNLOCK(db_mutex);
         return 0;
     }
     
-    pthread_mutex_unlock(&db_mutex);
+    MUTEX_UNLOCK(db_mutex);
     return 1;
 }
 
@@ -481,15 +773,16 @@ int execute_query(const char *sql) {
 int create_task(const Task *task) {
     const char *sql = 
         "INSERT INTO tasks (user_id, title, description, category, priority, difficulty, "
-        "created_at, scheduled_at, due_at, status, recurrence_type, recurrence_interval, tags) "
-        "VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)";
+        "created_at, scheduled_at, due_at, status, recurrence_type, recurrence_interval, tags, "
+        "reminder_time, recurrence_rule) "
+        "VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)";
 
-    pthread_mutex_lock(&db_mutex);
+    MUTEX_LOCK(db_mutex);
     
     sqlite3_stmt *stmt;
     int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
     if (rc != SQLITE_OK) {
-        pthread_mutex_unlock(&db_mutex);
+        MUTEX_UNLOCK(db_mutex);
         return 0;
     }
 
@@ -506,11 +799,17 @@ int create_task(const Task *task) {
     sqlite3_bind_int(stmt, 11, task->recurrence_type);
     sqlite3_bind_int(stmt, 12, task->recurrence_interval);
     sqlite3_bind_text(stmt, 13, task->tags, -1, SQLITE_STATIC);
+    sqlite3_bind_int64(stmt, 14, task->reminder_time);
+    if (task->recurrence_rule[0]) {
+        sqlite3_bind_text(stmt, 15, task->recurrence_rule, -1, SQLITE_STATIC);
+    } else {
+        sqlite3_bind_null(stmt, 15);
+    }
 
     rc = sqlite3_step(stmt);
     sqlite3_finalize(stmt);
     
-    pthread_mutex_unlock(&db_mutex);
+    MUTEX_UNLOCK(db_mutex);
     
     if (rc == SQLITE_DONE) {
         // Update user task count
@@ -530,12 +829,12 @@ int create_task(const Task *task) {
 int mark_task_completed(int task_id, int user_id) {
     const char *sql = "UPDATE tasks SET status = 2, completed_at = ? WHERE id = ? AND user_id = ?";
     
-    pthread_mutex_lock(&db_mutex);
+    MUTEX_LOCK(db_mutex);
     
     sqlite3_stmt *stmt;
     int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
     if (rc != SQLITE_OK) {
-        pthread_mutex_unlock(&db_mutex);
+        MUTEX_UNLOCK(db_mutex);
         return 0;
     }
 
@@ -547,7 +846,7 @@ int mark_task_completed(int task_id, int user_id) {
     rc = sqlite3_step(stmt);
     sqlite3_finalize(stmt);
     
-    pthread_mutex_unlock(&db_mutex);
+    MUTEX_UNLOCK(db_mutex);
 
     if (rc == SQLITE_DONE) {
         // Update user completed task count
@@ -568,56 +867,366 @@ int mark_task_completed(int task_id, int user_id) {
 // NOTIFICATION SYSTEM
 // ============================================
 
-int check_due_tasks(void) {
+// Looks up (or claims) the bucket for a user. Caller holds notify_mutex.
+static NotificationBucket *find_notification_bucket(int user_id, time_t now) {
+    unsigned int slot = ((unsigned int)user_id * 2654435761u) & (NOTIFICATION_BUCKET_SLOTS - 1);
+
+    for (int probe = 0; probe < NOTIFICATION_BUCKET_SLOTS; probe++) {
+        NotificationBucket *bucket = &notification_buckets[slot];
+        if (bucket->user_id == user_id) {
+            return bucket;
+        }
+        if (bucket->user_id == 0) {
+            bucket->user_id = user_id;
+            bucket->tokens = config_get()->max_notifications_per_hour;
+            bucket->last_refill = now;
+            bucket->last_digest = 0;
+            return bucket;
+        }
+        slot = (slot + 1) & (NOTIFICATION_BUCKET_SLOTS - 1);
+    }
+
+    return NULL;
+}
+
+// Takes one token from the user's bucket. Buckets refill continuously at
+// max_notifications_per_hour / 3600 tokens per second.
+int take_notification_token(int user_id, time_t now) {
+    int capacity = config_get()->max_notifications_per_hour;
+    if (capacity <= 0) return 1; // Throttling disabled
+
+    MUTEX_LOCK(notify_mutex);
+
+    NotificationBucket *bucket = find_notification_bucket(user_id, now);
+    if (!bucket) {
+        MUTEX_UNLOCK(notify_mutex);
+        return 1; // Table full, fail open
+    }
+
+    bucket->tokens += (double)(now - bucket->last_refill) * capacity / 3600.0;
+    if (bucket->tokens > capacity) bucket->tokens = capacity;
+    bucket->last_refill = now;
+
+    int allowed = 0;
+    if (bucket->tokens >= 1.0) {
+        bucket->tokens -= 1.0;
+        allowed = 1;
+    }
+
+    MUTEX_UNLOCK(notify_mutex);
+    return allowed;
+}
+
+// A throttled user gets at most one digest per DIGEST_INTERVAL_SEC. Tasks that
+// miss the window stay unsent and are picked up by a later poll.
+int take_digest_slot(int user_id, time_t now) {
+    MUTEX_LOCK(notify_mutex);
+
+    NotificationBucket *bucket = find_notification_bucket(user_id, now);
+    int allowed = 1;
+    if (bucket) {
+        if (now - bucket->last_digest < DIGEST_INTERVAL_SEC) {
+            allowed = 0;
+        } else {
+            bucket->last_digest = now;
+        }
+    }
+
+    MUTEX_UNLOCK(notify_mutex);
+    return allowed;
+}
+
+// Tasks held back from individual sends for the current user
+typedef struct {
+    int user_id;
+    char username[64];
+    int *task_ids;
+    int count;
+    int capacity;
+    char preview[DIGEST_PREVIEW_TITLES][128];
+} NotificationDigest;
+
+static void mark_notification_sent(sqlite3_stmt *mark_stmt, int task_id) {
+    sqlite3_reset(mark_stmt);
+    sqlite3_bind_int(mark_stmt, 1, task_id);
+    sqlite3_step(mark_stmt);
+}
+
+static void digest_add(NotificationDigest *digest, int task_id, const char *title) {
+    if (digest->count == digest->capacity) {
+        int new_capacity = digest->capacity ? digest->capacity * 2 : 16;
+        int *grown = realloc(digest->task_ids, new_capacity * sizeof(int));
+        if (!grown) return;
+        digest->task_ids = grown;
+        digest->capacity = new_capacity;
+    }
+
+    if (digest->count < DIGEST_PREVIEW_TITLES) {
+        snprintf(digest->preview[digest->count], sizeof(digest->preview[0]), "%s", title ? title : "");
+    }
+    digest->task_ids[digest->count++] = task_id;
+}
+
+// Sends one digest covering every held-back task, or defers them all.
+// Returns the number of outbound notifications (0 or 1).
+static int digest_flush(NotificationDigest *digest, sqlite3_stmt *mark_stmt, time_t now) {
+    int sent = 0;
+
+    if (digest->count > 0 && take_digest_slot(digest->user_id, now)) {
+        printf("📬 Digest notification for %s: %d tasks due (%s%s%s%s%s%s)\n",
+               digest->username, digest->count,
+               digest->preview[0],
+               digest->count > 1 ? ", " : "", digest->count > 1 ? digest->preview[1] : "",
+               digest->count > 2 ? ", " : "", digest->count > 2 ? digest->preview[2] : "",
+               digest->count > DIGEST_PREVIEW_TITLES ? ", ..." : "");
+
+        for (int i = 0; i < digest->count; i++) {
+            mark_notification_sent(mark_stmt, digest->task_ids[i]);
+        }
+        sent = 1;
+    } else if (digest->count > 0) {
+        printf("⏳ Deferred %d notifications for %s (hourly limit reached)\n",
+               digest->count, digest->username);
+    }
+
+    digest->count = 0;
+    return sent;
+}
+
+int check_due_tasks(unsigned long long shard_mask) {
+    // Ordered by user so each user's overflow collapses into a single digest
     const char *sql = 
-        "SELECT t.id, t.title, t.description, u.username, u.email, u.phone "
+        "SELECT t.id, t.title, t.description, u.id, u.username, u.email, u.phone, "
+        "u.notification_preferences "
         "FROM tasks t JOIN users u ON t.user_id = u.id "
-        "WHERE t.due_at > 0 AND t.due_at <= ? AND t.status = 0 AND t.notification_sent = 0";
+        "WHERE t.due_at > 0 AND t.due_at <= ? AND t.status = 0 AND t.notification_sent = 0 "
+        "AND " SHARD_FILTER("t.user_id") " "
+        "ORDER BY t.user_id, t.due_at";
+    const char *update_sql =
+        "UPDATE tasks SET notification_sent = 1, reminder_count = reminder_count + 1 WHERE id = ?";
 
-    pthread_mutex_lock(&db_mutex);
+    MUTEX_LOCK(db_mutex);
     
     sqlite3_stmt *stmt;
     int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
     if (rc != SQLITE_OK) {
-        pthread_mutex_unlock(&db_mutex);
+        MUTEX_UNLOCK(db_mutex);
+        return 0;
+    }
+
+    sqlite3_stmt *mark_stmt;
+    rc = sqlite3_prepare_v2(db, update_sql, -1, &mark_stmt, NULL);
+    if (rc != SQLITE_OK) {
+        sqlite3_finalize(stmt);
+        MUTEX_UNLOCK(db_mutex);
+        return 0;
+    }
+
+    // Take the write lock up front: with several workers, upgrading the read
+    // snapshot to a writer mid-scan fails (SQLITE_BUSY_SNAPSHOT) and tasks
+    // would be notified again. This also commits all marks at once.
+    if (sqlite3_exec(db, "BEGIN IMMEDIATE", NULL, NULL, NULL) != SQLITE_OK) {
+        printf("⚠️  Notification pass skipped: %s\n", sqlite3_errmsg(db));
+        sqlite3_finalize(mark_stmt);
+        sqlite3_finalize(stmt);
+        MUTEX_UNLOCK(db_mutex);
         return 0;
     }
 
     long now = time(NULL);
     sqlite3_bind_int64(stmt, 1, now + 300); // 5 minutes from now
+    sqlite3_bind_int64(stmt, 2, (sqlite3_int64)shard_mask);
 
+    NotificationDigest digest = {0};
     int notification_count = 0;
+    int suppressed_count = 0;
+
     while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
         int task_id = sqlite3_column_int(stmt, 0);
         const char *title = (const char*)sqlite3_column_text(stmt, 1);
-        const char *description = (const char*)sqlite3_column_text(stmt, 2);
-        const char *username = (const char*)sqlite3_column_text(stmt, 3);
-        const char *email = (const char*)sqlite3_column_text(stmt, 4);
-        const char *phone = (const char*)sqlite3_column_text(stmt, 5);
+        int user_id = sqlite3_column_int(stmt, 3);
+        const char *username = (const char*)sqlite3_column_text(stmt, 4);
+        int preferences = sqlite3_column_int(stmt, 7);
+
+        if (user_id != digest.user_id) {
+            notification_count += digest_flush(&digest, mark_stmt, now);
+            digest.user_id = user_id;
+            snprintf(digest.username, sizeof(digest.username), "%s", username ? username : "");
+        }
 
-        printf("📢 Due task notification: %s for %s\n", title, username);
-        
-        // Mark notification as sent
-        const char *update_sql = "UPDATE tasks SET notification_sent = 1, reminder_count = reminder_count + 1 WHERE id = ?";
-        sqlite3_stmt *update_stmt;
-        sqlite3_prepare_v2(db, update_sql, -1, &update_stmt, NULL);
-        sqlite3_bind_int(update_stmt, 1, task_id);
-        sqlite3_step(update_stmt);
-        sqlite3_finalize(update_stmt);
-        
-        notification_count++;
+        // Users who disabled every channel are marked without sending
+        if ((preferences & (NOTIFY_PUSH | NOTIFY_EMAIL | NOTIFY_SMS)) == 0) {
+            mark_notification_sent(mark_stmt, task_id);
+            suppressed_count++;
+            continue;
+        }
+
+        if (digest.count == 0 && take_notification_token(user_id, now)) {
+            printf("📢 Due task notification: %s for %s\n", title, username);
+            mark_notification_sent(mark_stmt, task_id);
+            notification_count++;
+        } else {
+            digest_add(&digest, task_id, title);
+        }
     }
+    notification_count += digest_flush(&digest, mark_stmt, now);
+    free(digest.task_ids);
 
+    sqlite3_finalize(mark_stmt);
     sqlite3_finalize(stmt);
-    pthread_mutex_unlock(&db_mutex);
+    // Unmarked tasks are picked up again by the next pass
+    if (sqlite3_exec(db, "COMMIT", NULL, NULL, NULL) != SQLITE_OK) {
+        printf("⚠️  Notification marks rolled back: %s\n", sqlite3_errmsg(db));
+        sqlite3_exec(db, "ROLLBACK", NULL, NULL, NULL);
+        notification_count = 0;
+        suppressed_count = 0;
+    }
+    MUTEX_UNLOCK(db_mutex);
 
     if (notification_count > 0) {
         printf("📱 Sent %d task notifications\n", notification_count);
     }
+    if (suppressed_count > 0) {
+        printf("🔕 Skipped %d notifications for users with notifications disabled\n", suppressed_count);
+    }
 
     return notification_count;
 }
 
+// ============================================
+// RECURRING TASKS
+// ============================================
+
+// Recurring series are materialized lazily, one occurrence ahead: only the
+// live occurrence exists as a row. When it is completed the next occurrence
+// is inserted and the recurrence moves to it; cancelling ends the series.
+// The next occurrence comes from the compiled rule, not by stepping forward.
+
+typedef struct {
+    int id;
+    long long anchor;    // due_at, or scheduled_at for tasks without a due date
+    int type;
+    int interval;
+    char rule[128];
+} RecurringTask;
+
+int materialize_recurring_tasks(unsigned long long shard_mask) {
+    const char *select_sql =
+        "SELECT id, due_at, scheduled_at, recurrence_type, recurrence_interval, recurrence_rule "
+        "FROM tasks WHERE status = 2 AND (recurrence_type > 0 OR recurrence_rule IS NOT NULL) "
+        "AND " SHARD_FILTER("user_id") " LIMIT ?";
+    const char *insert_sql =
+        "INSERT INTO tasks (user_id, title, description, category, priority, difficulty, created_at, "
+        "scheduled_at, due_at, status, recurrence_type, recurrence_interval, recurrence_rule, tags, "
+        "face_hash, reminder_time) "
+        "SELECT user_id, title, description, category, priority, difficulty, ?1, "
+        "CASE WHEN scheduled_at > 0 THEN scheduled_at + ?2 ELSE scheduled_at END, "
+        "CASE WHEN due_at > 0 THEN due_at + ?2 ELSE due_at END, 0, "
+        "recurrence_type, recurrence_interval, recurrence_rule, tags, face_hash, "
+        "CASE WHEN reminder_time > 0 THEN reminder_time + ?2 ELSE 0 END "
+        "FROM tasks WHERE id = ?3";
+    const char *end_sql =
+        "UPDATE tasks SET recurrence_type = 0, recurrence_rule = NULL WHERE id = ?";
+
+    MUTEX_LOCK(db_mutex);
+
+    sqlite3_stmt *stmt;
+    if (sqlite3_prepare_v2(db, select_sql, -1, &stmt, NULL) != SQLITE_OK) {
+        MUTEX_UNLOCK(db_mutex);
+        return 0;
+    }
+    sqlite3_bind_int64(stmt, 1, (sqlite3_int64)shard_mask);
+    sqlite3_bind_int(stmt, 2, MAX_RECURRING_PER_POLL);
+
+    RecurringTask *series = malloc(MAX_RECURRING_PER_POLL * sizeof(RecurringTask));
+    int count = 0;
+    while (series && count < MAX_RECURRING_PER_POLL && sqlite3_step(stmt) == SQLITE_ROW) {
+        RecurringTask *item = &series[count++];
+        long long due_at = sqlite3_column_int64(stmt, 1);
+        const char *rule = (const char*)sqlite3_column_text(stmt, 5);
+        item->id = sqlite3_column_int(stmt, 0);
+        item->anchor = due_at > 0 ? due_at : sqlite3_column_int64(stmt, 2);
+        item->type = sqlite3_column_int(stmt, 3);
+        item->interval = sqlite3_column_int(stmt, 4);
+        snprintf(item->rule, sizeof(item->rule), "%s", rule ? rule : "");
+    }
+    sqlite3_finalize(stmt);
+
+    if (count == 0) {
+        free(series);
+        MUTEX_UNLOCK(db_mutex);
+        return 0;
+    }
+
+    sqlite3_stmt *insert_stmt, *end_stmt;
+    if (sqlite3_prepare_v2(db, insert_sql, -1, &insert_stmt, NULL) != SQLITE_OK) {
+        free(series);
+        MUTEX_UNLOCK(db_mutex);
+        return 0;
+    }
+    if (sqlite3_prepare_v2(db, end_sql, -1, &end_stmt, NULL) != SQLITE_OK) {
+        sqlite3_finalize(insert_stmt);
+        free(series);
+        MUTEX_UNLOCK(db_mutex);
+        return 0;
+    }
+
+    // Each completed occurrence hands its recurrence to exactly one successor
+    if (sqlite3_exec(db, "BEGIN IMMEDIATE", NULL, NULL, NULL) != SQLITE_OK) {
+        printf("⚠️  Recurring pass skipped: %s\n", sqlite3_errmsg(db));
+        sqlite3_finalize(end_stmt);
+        sqlite3_finalize(insert_stmt);
+        free(series);
+        MUTEX_UNLOCK(db_mutex);
+        return 0;
+    }
+
+    long now = time(NULL);
+    int created = 0;
+    for (int i = 0; i < count; i++) {
+        RecurringTask *item = &series[i];
+        Recurrence recurrence;
+        int compiled = item->rule[0]
+            ? recurrence_from_pattern(&recurrence, item->anchor, item->rule)
+            : recurrence_from_type(&recurrence, item->anchor, item->type, item->interval);
+
+        // A late completion skips the missed occurrences
+        long long next = -1;
+        if (compiled && item->anchor > 0) {
+            next = recurrence_next(&recurrence, item->anchor > now ? item->anchor : now);
+        }
+
+        if (next > 0) {
+            sqlite3_reset(insert_stmt);
+            sqlite3_bind_int64(insert_stmt, 1, now);
+            sqlite3_bind_int64(insert_stmt, 2, next - item->anchor);
+            sqlite3_bind_int(insert_stmt, 3, item->id);
+            if (sqlite3_step(insert_stmt) == SQLITE_DONE) created++;
+        } else if (!compiled) {
+            printf("⚠️  Task %d has an invalid recurrence rule, ending series: %s\n", item->id, item->rule);
+        }
+
+        sqlite3_reset(end_stmt);
+        sqlite3_bind_int(end_stmt, 1, item->id);
+        sqlite3_step(end_stmt);
+    }
+
+    if (sqlite3_exec(db, "COMMIT", NULL, NULL, NULL) != SQLITE_OK) {
+        printf("⚠️  Recurring pass rolled back: %s\n", sqlite3_errmsg(db));
+        sqlite3_exec(db, "ROLLBACK", NULL, NULL, NULL);
+        created = 0;
+    }
+    sqlite3_finalize(end_stmt);
+    sqlite3_finalize(insert_stmt);
+    free(series);
+    MUTEX_UNLOCK(db_mutex);
+
+    if (created > 0) {
+        printf("🔁 Scheduled next occurrence of %d recurring tasks\n", created);
+    }
+    return created;
+}
+
 // ============================================
 // ANALYTICS
 // ============================================
@@ -630,12 +1239,12 @@ double calculate_productivity_score(int user_id) {
         "THEN CASE WHEN completed_at <= due_at THEN 1.0 ELSE 0.5 END ELSE 0 END) as on_time_rate "
         "FROM tasks WHERE user_id = ? AND created_at > ?";
 
-    pthread_mutex_lock(&db_mutex);
+    MUTEX_LOCK(db_mutex);
     
     sqlite3_stmt *stmt;
     int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
     if (rc != SQLITE_OK) {
-        pthread_mutex_unlock(&db_mutex);
+        MUTEX_UNLOCK(db_mutex);
         return 0.0;
     }
 
@@ -656,7 +1265,7 @@ double calculate_productivity_score(int user_id) {
     }
 
     sqlite3_finalize(stmt);
-    pthread_mutex_unlock(&db_mutex);
+    MUTEX_UNLOCK(db_mutex);
 
     // Update user's productivity score
     const char *update_sql = "UPDATE users SET productivity_score = ? WHERE id = ?";
@@ -669,26 +1278,66 @@ double calculate_productivity_score(int user_id) {
     return score;
 }
 
-int cleanup_old_tasks(void) {
-    const char *sql = "DELETE FROM tasks WHERE status = 2 AND completed_at < ?";
+// Refreshes productivity scores for every user in the given shards
+int update_shard_analytics(unsigned long long shard_mask) {
+    const char *sql = "SELECT id FROM users WHERE " SHARD_FILTER("id");
+
+    MUTEX_LOCK(db_mutex);
+
+    sqlite3_stmt *stmt;
+    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
+    if (rc != SQLITE_OK) {
+        MUTEX_UNLOCK(db_mutex);
+        return 0;
+    }
+    sqlite3_bind_int64(stmt, 1, (sqlite3_int64)shard_mask);
+
+    // Collect first: calculate_productivity_score takes db_mutex itself
+    int *user_ids = NULL;
+    int count = 0, capacity = 0;
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        if (count == capacity) {
+            int new_capacity = capacity ? capacity * 2 : 64;
+            int *grown = realloc(user_ids, new_capacity * sizeof(int));
+            if (!grown) break;
+            user_ids = grown;
+            capacity = new_capacity;
+        }
+        user_ids[count++] = sqlite3_column_int(stmt, 0);
+    }
+
+    sqlite3_finalize(stmt);
+    MUTEX_UNLOCK(db_mutex);
+
+    for (int i = 0; i < count; i++) {
+        calculate_productivity_score(user_ids[i]);
+    }
+    free(user_ids);
+
+    return count;
+}
+
+int cleanup_old_tasks(unsigned long long shard_mask) {
+    const char *sql = "DELETE FROM tasks WHERE status = 2 AND completed_at < ? AND " SHARD_FILTER("user_id");
     
-    pthread_mutex_lock(&db_mutex);
+    MUTEX_LOCK(db_mutex);
     
     sqlite3_stmt *stmt;
     int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
     if (rc != SQLITE_OK) {
-        pthread_mutex_unlock(&db_mutex);
+        MUTEX_UNLOCK(db_mutex);
         return 0;
     }
 
-    long cutoff_time = time(NULL) - (config.cleanup_days * 24 * 3600);
+    long cutoff_time = time(NULL) - (config_get()->cleanup_days * 24 * 3600);
     sqlite3_bind_int64(stmt, 1, cutoff_time);
+    sqlite3_bind_int64(stmt, 2, (sqlite3_int64)shard_mask);
 
     rc = sqlite3_step(stmt);
     int deleted_count = sqlite3_changes(db);
     
     sqlite3_finalize(stmt);
-    pthread_mutex_unlock(&db_mutex);
+    MUTEX_UNLOCK(db_mutex);
 
     if (deleted_count > 0) {
         printf("🧹 Cleaned up %d old completed tasks\n", deleted_count);
@@ -697,11 +1346,318 @@ int cleanup_old_tasks(void) {
     return deleted_count;
 }
 
+// ============================================
+// JOB QUEUE
+// ============================================
+
+// Reminders and housekeeping run as rows of the jobs table. Claiming is one
+// UPDATE that stamps a batch with this process's lease, so any number of
+// scheduler processes can poll the table without running a job twice. User
+// jobs follow the shard filter; jobs without a user go to whoever claims
+// them first. A finished job is only written back while its lease is still
+// ours, so a job taken over after lease expiry is not clobbered.
+
+static const PeriodicJob *find_periodic_job(const char *kind) {
+    for (size_t i = 0; i < sizeof(periodic_jobs) / sizeof(periodic_jobs[0]); i++) {
+        if (strcmp(periodic_jobs[i].kind, kind) == 0) return &periodic_jobs[i];
+    }
+    return NULL;
+}
+
+int seed_periodic_jobs(void) {
+    const char *sql =
+        "INSERT OR IGNORE INTO jobs (kind, dedupe_key, run_at, created_at) VALUES (?, ?, ?, ?)";
+
+    MUTEX_LOCK(db_mutex);
+
+    sqlite3_stmt *stmt;
+    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
+    if (rc != SQLITE_OK) {
+        MUTEX_UNLOCK(db_mutex);
+        return 0;
+    }
+
+    long now = time(NULL);
+    for (size_t i = 0; i < sizeof(periodic_jobs) / sizeof(periodic_jobs[0]); i++) {
+        sqlite3_reset(stmt);
+        sqlite3_bind_text(stmt, 1, periodic_jobs[i].kind, -1, SQLITE_STATIC);
+        sqlite3_bind_text(stmt, 2, periodic_jobs[i].kind, -1, SQLITE_STATIC);
+        sqlite3_bind_int64(stmt, 3, now + periodic_jobs[i].interval_sec);
+        sqlite3_bind_int64(stmt, 4, now);
+        sqlite3_step(stmt);
+    }
+
+    sqlite3_finalize(stmt);
+    MUTEX_UNLOCK(db_mutex);
+    return 1;
+}
+
+// Leases up to max runnable jobs and returns them, oldest run_at first
+static int claim_jobs(unsigned long long shard_mask, Job *jobs, int max) {
+    const char *claim_sql =
+        "UPDATE jobs SET lease_owner = ?, lease_expires = ?, attempts = attempts + 1 "
+        "WHERE id IN (SELECT id FROM jobs "
+        "WHERE status = 0 AND run_at <= ? AND lease_expires <= ? "
+        "AND (user_id IS NULL OR " SHARD_FILTER("user_id") ") "
+        "ORDER BY run_at LIMIT ?)";
+    const char *select_sql =
+        "SELECT id, kind, user_id, task_id, attempts FROM jobs "
+        "WHERE status = 0 AND lease_owner = ? AND lease_expires = ? ORDER BY run_at";
+
+    MUTEX_LOCK(db_mutex);
+
+    sqlite3_stmt *stmt;
+    int rc = sqlite3_prepare_v2(db, claim_sql, -1, &stmt, NULL);
+    if (rc != SQLITE_OK) {
+        MUTEX_UNLOCK(db_mutex);
+        return 0;
+    }
+
+    long now = time(NULL);
+    long lease_expires = now + JOB_LEASE_SEC;
+    sqlite3_bind_text(stmt, 1, job_owner, -1, SQLITE_STATIC);
+    sqlite3_bind_int64(stmt, 2, lease_expires);
+    sqlite3_bind_int64(stmt, 3, now);
+    sqlite3_bind_int64(stmt, 4, now);
+    sqlite3_bind_int64(stmt, 5, (sqlite3_int64)shard_mask);
+    sqlite3_bind_int(stmt, 6, max);
+    rc = sqlite3_step(stmt);
+    int claimed = sqlite3_changes(db);
+    sqlite3_finalize(stmt);
+
+    if (rc != SQLITE_DONE || claimed == 0) {
+        MUTEX_UNLOCK(db_mutex);
+        return 0;
+    }
+
+    int count = 0;
+    if (sqlite3_prepare_v2(db, select_sql, -1, &stmt, NULL) == SQLITE_OK) {
+        sqlite3_bind_text(stmt, 1, job_owner, -1, SQLITE_STATIC);
+        sqlite3_bind_int64(stmt, 2, lease_expires);
+        while (count < max && sqlite3_step(stmt) == SQLITE_ROW) {
+            Job *job = &jobs[count++];
+            job->id = sqlite3_column_int64(stmt, 0);
+            snprintf(job->kind, sizeof(job->kind), "%s", (const char*)sqlite3_column_text(stmt, 1));
+            job->user_id = sqlite3_column_int(stmt, 2);
+            job->task_id = sqlite3_column_int(stmt, 3);
+            job->attempts = sqlite3_column_int(stmt, 4);
+        }
+        sqlite3_finalize(stmt);
+    }
+
+    MUTEX_UNLOCK(db_mutex);
+    return count;
+}
+
+static void finish_job(const Job *job, int result, const char *error) {
+    const char *sql =
+        "UPDATE jobs SET status = ?, run_at = ?, attempts = ?, last_error = ?, finished_at = ?, "
+        "lease_owner = NULL, lease_expires = 0 WHERE id = ? AND lease_owner = ?";
+
+    long now = time(NULL);
+    const PeriodicJob *periodic = find_periodic_job(job->kind);
+    int status = JOB_QUEUED;
+    long run_at = now;
+    int attempts = job->attempts;
+    long finished_at = 0;
+
+    if (result == JOB_RESULT_DEFER) {
+        run_at = now + JOB_DEFER_SEC;
+        attempts--;
+    } else if (periodic && (result == JOB_RESULT_DONE || attempts >= JOB_MAX_ATTEMPTS)) {
+        // Periodic jobs never finish; a run that keeps failing waits for the next interval
+        run_at = now + periodic->interval_sec;
+        attempts = 0;
+    } else if (result == JOB_RESULT_DONE) {
+        status = JOB_DONE;
+        finished_at = now;
+    } else if (attempts >= JOB_MAX_ATTEMPTS) {
+        status = JOB_FAILED;
+        finished_at = now;
+        printf("❌ Job %lld (%s) failed after %d attempts: %s\n",
+               job->id, job->kind, attempts, error ? error : "unknown error");
+    } else {
+        run_at = now + ((long)JOB_RETRY_BASE_SEC << (attempts - 1));
+    }
+
+    MUTEX_LOCK(db_mutex);
+
+    sqlite3_stmt *stmt;
+    if (sqlite3_prepare_v2(db, sql, -1, &stmt, NULL) == SQLITE_OK) {
+        sqlite3_bind_int(stmt, 1, status);
+        sqlite3_bind_int64(stmt, 2, run_at);
+        sqlite3_bind_int(stmt, 3, attempts);
+        if (error) {
+            sqlite3_bind_text(stmt, 4, error, -1, SQLITE_STATIC);
+        } else {
+            sqlite3_bind_null(stmt, 4);
+        }
+        sqlite3_bind_int64(stmt, 5, finished_at);
+        sqlite3_bind_int64(stmt, 6, job->id);
+        sqlite3_bind_text(stmt, 7, job_owner, -1, SQLITE_STATIC);
+        sqlite3_step(stmt);
+        sqlite3_finalize(stmt);
+    }
+
+    MUTEX_UNLOCK(db_mutex);
+}
+
+static int run_reminder_job(const Job *job, const char **error) {
+    const char *sql =
+        "SELECT t.title, t.status, t.reminder_sent, u.username, u.notification_preferences "
+        "FROM tasks t JOIN users u ON t.user_id = u.id WHERE t.id = ?";
+
+    MUTEX_LOCK(db_mutex);
+
+    sqlite3_stmt *stmt;
+    if (sqlite3_prepare_v2(db, sql, -1, &stmt, NULL) != SQLITE_OK) {
+        MUTEX_UNLOCK(db_mutex);
+        *error = "prepare failed";
+        return JOB_RESULT_RETRY;
+    }
+    sqlite3_bind_int(stmt, 1, job->task_id);
+
+    char title[128] = "";
+    char username[64] = "";
+    int remind = 0;
+    int preferences = 0;
+    if (sqlite3_step(stmt) == SQLITE_ROW) {
+        const char *task_title = (const char*)sqlite3_column_text(stmt, 0);
+        const char *user_name = (const char*)sqlite3_column_text(stmt, 3);
+        snprintf(title, sizeof(title), "%s", task_title ? task_title : "");
+        snprintf(username, sizeof(username), "%s", user_name ? user_name : "");
+        int status = sqlite3_column_int(stmt, 1);
+        remind = (status == 0 || status == 1) && sqlite3_column_int(stmt, 2) == 0;
+        preferences = sqlite3_column_int(stmt, 4);
+    }
+    sqlite3_finalize(stmt);
+    MUTEX_UNLOCK(db_mutex);
+
+    // Completed, cancelled, deleted or already reminded: nothing to do
+    if (!remind) return JOB_RESULT_DONE;
+
+    if (preferences & (NOTIFY_PUSH | NOTIFY_EMAIL | NOTIFY_SMS)) {
+        if (!take_notification_token(job->user_id, time(NULL))) return JOB_RESULT_DEFER;
+        printf("⏰ Reminder: %s for %s\n", title, username);
+    }
+
+    char update_sql[128];
+    snprintf(update_sql, sizeof(update_sql), "UPDATE tasks SET reminder_sent = 1 WHERE id = %d", job->task_id);
+    execute_query(update_sql);
+    return JOB_RESULT_DONE;
+}
+
+static int run_cleanup_job(const char **error) {
+    cleanup_old_tasks(ALL_SHARDS);
+
+    char sql[160];
+    long cutoff_time = time(NULL) - (config_get()->cleanup_days * 24 * 3600);
+    snprintf(sql, sizeof(sql), "DELETE FROM jobs WHERE status != 0 AND finished_at < %ld", cutoff_time);
+    if (!execute_query(sql)) {
+        *error = "job purge failed";
+        return JOB_RESULT_RETRY;
+    }
+    return JOB_RESULT_DONE;
+}
+
+// Online copy of the live database into backup_path
+int backup_database(void) {
+    const Config *cfg = config_get();
+
+    char path[MAX_PATH + 64];
+    char stamp[32];
+    time_t now = time(NULL);
+    strftime(stamp, sizeof(stamp), "%Y%m%d-%H%M%S", localtime(&now));
+    snprintf(path, sizeof(path), "%s/scheduler-%s.db", cfg->backup_path, stamp);
+
+    sqlite3 *backup_db;
+    if (sqlite3_open(path, &backup_db) != SQLITE_OK) {
+        sqlite3_close(backup_db);
+        return 0;
+    }
+
+    MUTEX_LOCK(db_mutex);
+    sqlite3_backup *backup = sqlite3_backup_init(backup_db, "main", db, "main");
+    int rc = SQLITE_ERROR;
+    if (backup) {
+        rc = sqlite3_backup_step(backup, -1);
+        sqlite3_backup_finish(backup);
+    }
+    MUTEX_UNLOCK(db_mutex);
+
+    sqlite3_close(backup_db);
+
+    if (rc != SQLITE_DONE) {
+        remove(path);
+        return 0;
+    }
+    printf("💾 Database backed up to %s\n", path);
+    return 1;
+}
+
+static int run_job(const Job *job, const char **error) {
+    if (strcmp(job->kind, "reminder") == 0) {
+        return run_reminder_job(job, error);
+    }
+    if (strcmp(job->kind, "cleanup") == 0) {
+        return run_cleanup_job(error);
+    }
+    if (strcmp(job->kind, "analytics") == 0) {
+        printf("📈 Updating user analytics...\n");
+        update_shard_analytics(ALL_SHARDS);
+        return JOB_RESULT_DONE;
+    }
+    if (strcmp(job->kind, "backup") == 0) {
+        if (backup_database()) return JOB_RESULT_DONE;
+        *error = "backup failed";
+        return JOB_RESULT_RETRY;
+    }
+
+    *error = "unknown job kind";
+    return JOB_RESULT_RETRY;
+}
+
+// Claims and runs batches until the runnable set is drained (bounded per
+// poll so due-task checks are not starved). Returns the number of jobs run.
+int run_due_jobs(unsigned long long shard_mask) {
+    Job jobs[JOB_BATCH_SIZE];
+    int total = 0;
+
+    for (int batch = 0; batch < JOB_MAX_BATCHES_PER_POLL && running; batch++) {
+        int count = claim_jobs(shard_mask, jobs, JOB_BATCH_SIZE);
+        for (int i = 0; i < count; i++) {
+            const char *error = NULL;
+            int result = run_job(&jobs[i], &error);
+            finish_job(&jobs[i], result, error);
+        }
+        total += count;
+        if (count < JOB_BATCH_SIZE) break;
+    }
+
+    return total;
+}
+
 // ============================================
 // SIGNAL HANDLING
 // ============================================
 
 void signal_handler(int signum) {
+    if (signum == SIGUSR1) {
+        dump_stats_requested = 1;
+        return;
+    }
+    if (signum == SIGHUP) {
+        reload_requested = 1;
+        return;
+    }
+    if (signum == SIGTTIN) {
+        add_worker_requested = 1;
+        return;
+    }
+    if (signum == SIGTTOU) {
+        remove_worker_requested = 1;
+        return;
+    }
     printf("\n🛑 Received signal %d, shutting down gracefully...\n", signum);
     running = 0;
 }
@@ -709,7 +1665,7 @@ void signal_handler(int signum) {
 void cleanup_resources(void) {
     if (db) {
         // Final cleanup
-        cleanup_old_tasks();
+        cleanup_old_tasks(owned_shards);
         
         // Close database
         sqlite3_close(db);
@@ -722,57 +1678,319 @@ void cleanup_resources(void) {
 }
 
 // ============================================
-// MAIN SCHEDULER LOOP
+// WORKER SHARDING
 // ============================================
 
-int main(int argc, char *argv[]) {
-    printf("🚀 Task Scheduler Enhanced Backend Starting...\n");
-    printf("📅 Build Date: %s %s\n", __DATE__, __TIME__);
+// With --workers N the process becomes a coordinator that forks N workers and
+// hands each a set of shards through a table in shared memory. Every worker
+// has its own SQLite connection, notification buckets and statistics, and
+// only touches users in its shards.
+//
+// Shards move with a two-phase handoff so no shard is ever polled by two
+// workers: shards leaving a live worker are first revoked, and are given to
+// their new owner only after every live worker has adopted that generation
+// (workers adopt between polls). Shards of a dead worker are free as soon as
+// it has been reaped.
+
+static int handoff_pending = 0;
+static long handoff_generation = 0;
+static int rebalance_needed = 0;
+
+static int worker_is_live(int slot) {
+    return slot >= 0 && shard_table->workers[slot].pid != 0 && !shard_table->workers[slot].stopping;
+}
 
-    // Setup signal handlers
-    signal(SIGINT, signal_handler);
-    signal(SIGTERM, signal_handler);
+static void publish_shards(void) {
+    __atomic_add_fetch(&shard_table->generation, 1, __ATOMIC_RELEASE);
+}
 
-    // Load configuration
-    if (!load_config(CONFIG_FILE)) {
-        printf("❌ Failed to load configuration\n");
-        return 1;
+// Called by a worker between polls. Adopting the current generation tells the
+// coordinator that shards revoked from this worker are no longer in use.
+static unsigned long long worker_adopt_shards(int slot) {
+    long generation = __atomic_load_n(&shard_table->generation, __ATOMIC_ACQUIRE);
+
+    unsigned long long mask = 0;
+    for (int shard = 0; shard < SHARD_COUNT; shard++) {
+        if (__atomic_load_n(&shard_table->shard_owner[shard], __ATOMIC_RELAXED) == slot) {
+            mask |= 1ULL << shard;
+        }
     }
 
-    // Initialize database
-    if (!init_database()) {
-        printf("❌ Database initialization failed\n");
+    WorkerSlot *self = &shard_table->workers[slot];
+    __atomic_store_n(&self->heartbeat, time(NULL), __ATOMIC_RELAXED);
+    __atomic_store_n(&self->seen_generation, generation, __ATOMIC_RELEASE);
+    return mask;
+}
+
+// Even split across live workers that keeps every shard whose owner is still
+// under quota, so a join or leave only moves the shards it has to.
+static void plan_shards(int *target) {
+    int live[MAX_WORKERS];
+    int live_count = 0;
+    for (int slot = 0; slot < MAX_WORKERS; slot++) {
+        if (worker_is_live(slot)) live[live_count++] = slot;
+    }
+
+    int quota[MAX_WORKERS] = {0};
+    for (int i = 0; i < live_count; i++) {
+        quota[live[i]] = SHARD_COUNT / live_count + (i < SHARD_COUNT % live_count ? 1 : 0);
+    }
+
+    for (int shard = 0; shard < SHARD_COUNT; shard++) {
+        int owner = shard_table->shard_owner[shard];
+        if (worker_is_live(owner) && quota[owner] > 0) {
+            target[shard] = owner;
+            quota[owner]--;
+        } else {
+            target[shard] = -1;
+        }
+    }
+
+    int next = 0;
+    for (int shard = 0; shard < SHARD_COUNT; shard++) {
+        if (target[shard] != -1) continue;
+        while (next < live_count && quota[live[next]] == 0) next++;
+        if (next == live_count) break;
+        target[shard] = live[next];
+        quota[live[next]]--;
+    }
+}
+
+static int handoff_acknowledged(void) {
+    for (int slot = 0; slot < MAX_WORKERS; slot++) {
+        WorkerSlot *worker = &shard_table->workers[slot];
+        if (worker->pid == 0) continue;
+        if (__atomic_load_n(&worker->seen_generation, __ATOMIC_ACQUIRE) < handoff_generation) return 0;
+    }
+    return 1;
+}
+
+static void coordinator_rebalance(void) {
+    if (handoff_pending) {
+        if (!handoff_acknowledged()) return;
+        handoff_pending = 0;
+    }
+    if (!rebalance_needed) return;
+
+    int target[SHARD_COUNT];
+    plan_shards(target);
+
+    // Phase 1: revoke shards that leave a live worker
+    int revoked = 0;
+    for (int shard = 0; shard < SHARD_COUNT; shard++) {
+        int owner = shard_table->shard_owner[shard];
+        if (owner != -1 && owner != target[shard] && shard_table->workers[owner].pid != 0) {
+            __atomic_store_n(&shard_table->shard_owner[shard], -1, __ATOMIC_RELAXED);
+            revoked++;
+        }
+    }
+    if (revoked > 0) {
+        publish_shards();
+        handoff_generation = shard_table->generation;
+        handoff_pending = 1;
+        return;
+    }
+
+    // Phase 2: every shard that changes owner is now unowned
+    int moved = 0;
+    for (int shard = 0; shard < SHARD_COUNT; shard++) {
+        if (shard_table->shard_owner[shard] != target[shard]) {
+            __atomic_store_n(&shard_table->shard_owner[shard], target[shard], __ATOMIC_RELAXED);
+            moved++;
+        }
+    }
+    if (moved > 0) {
+        publish_shards();
+        printf("🧩 Rebalanced %d shards (generation %ld)\n", moved, shard_table->generation);
+    }
+    rebalance_needed = 0;
+}
+
+static void release_worker_slot(int slot) {
+    for (int shard = 0; shard < SHARD_COUNT; shard++) {
+        if (shard_table->shard_owner[shard] == slot) {
+            __atomic_store_n(&shard_table->shard_owner[shard], -1, __ATOMIC_RELAXED);
+        }
+    }
+    publish_shards();
+    memset(&shard_table->workers[slot], 0, sizeof(WorkerSlot));
+    rebalance_needed = 1;
+}
+
+static int run_scheduler_loop(int slot);
+
+static int spawn_worker(int slot) {
+    WorkerSlot *worker = &shard_table->workers[slot];
+    worker->stopping = 0;
+    worker->seen_generation = -1;
+    worker->heartbeat = time(NULL);
+
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid < 0) {
+        printf("❌ Failed to fork worker %d: %s\n", slot, strerror(errno));
+        return 0;
+    }
+    if (pid == 0) {
+        signal(SIGTTIN, SIG_IGN);
+        signal(SIGTTOU, SIG_IGN);
+        exit(run_scheduler_loop(slot));
+    }
+
+    worker->pid = pid;
+    rebalance_needed = 1;
+    printf("👷 Worker %d started (pid %d)\n", slot, (int)pid);
+    return 1;
+}
+
+static void signal_workers(int signum) {
+    for (int slot = 0; slot < MAX_WORKERS; slot++) {
+        if (shard_table->workers[slot].pid != 0) kill(shard_table->workers[slot].pid, signum);
+    }
+}
+
+static int run_coordinator(int target_workers) {
+    shard_table = mmap(NULL, sizeof(ShardTable), PROT_READ | PROT_WRITE,
+                       MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (shard_table == MAP_FAILED) {
+        printf("❌ Failed to allocate shard table: %s\n", strerror(errno));
         return 1;
     }
+    memset(shard_table, 0, sizeof(ShardTable));
+    for (int shard = 0; shard < SHARD_COUNT; shard++) shard_table->shard_owner[shard] = -1;
 
-    printf("✅ Backend initialized successfully\n");
-    printf("🔄 Starting main loop (polling every %d seconds)\n", config.poll_interval_sec);
-    printf("📊 Max tasks per user: %d\n", config.max_tasks_per_user);
-    printf("🧹 Cleanup after %d days\n", config.cleanup_days);
+    printf("🧭 Coordinator starting %d workers over %d shards\n", target_workers, SHARD_COUNT);
+
+    time_t next_spawn_at = 0;
+    while (running) {
+        time_t now = time(NULL);
+
+        // Workers leaving: exited, crashed or killed
+        int status;
+        pid_t pid;
+        while ((pid = waitpid(-1, &status, WNOHANG)) > 0) {
+            for (int slot = 0; slot < MAX_WORKERS; slot++) {
+                if (shard_table->workers[slot].pid != pid) continue;
+                if (!shard_table->workers[slot].stopping) {
+                    printf("⚠️  Worker %d (pid %d) exited unexpectedly (status %d)\n", slot, (int)pid, status);
+                    next_spawn_at = now + WORKER_RESPAWN_DELAY_SEC;
+                }
+                release_worker_slot(slot);
+                break;
+            }
+        }
+
+        if (add_worker_requested) {
+            add_worker_requested = 0;
+            if (target_workers < MAX_WORKERS) target_workers++;
+            printf("➕ Target workers: %d\n", target_workers);
+        }
+        if (remove_worker_requested) {
+            remove_worker_requested = 0;
+            if (target_workers > 1) target_workers--;
+            printf("➖ Target workers: %d\n", target_workers);
+        }
+        if (reload_requested) {
+            reload_requested = 0;
+            reload_config(CONFIG_FILE);
+            signal_workers(SIGHUP);
+        }
+        if (dump_stats_requested) {
+            dump_stats_requested = 0;
+            signal_workers(SIGUSR1);
+        }
+
+        int live = 0;
+        int stall_limit = config_get()->poll_interval_sec * WORKER_STALL_POLLS + 60;
+        for (int slot = 0; slot < MAX_WORKERS; slot++) {
+            WorkerSlot *worker = &shard_table->workers[slot];
+            if (!worker_is_live(slot)) continue;
+            live++;
+            if (now - __atomic_load_n(&worker->heartbeat, __ATOMIC_RELAXED) > stall_limit) {
+                printf("⚠️  Worker %d (pid %d) stopped polling, killing it\n", slot, (int)worker->pid);
+                kill(worker->pid, SIGKILL);
+            }
+        }
+
+        // Workers joining, or leaving on scale-down (highest slot first)
+        for (int slot = 0; slot < MAX_WORKERS && live < target_workers && now >= next_spawn_at; slot++) {
+            if (shard_table->workers[slot].pid == 0 && spawn_worker(slot)) live++;
+        }
+        for (int slot = MAX_WORKERS - 1; slot >= 0 && live > target_workers; slot--) {
+            if (!worker_is_live(slot)) continue;
+            shard_table->workers[slot].stopping = 1;
+            kill(shard_table->workers[slot].pid, SIGTERM);
+            rebalance_needed = 1;
+            live--;
+        }
+
+        coordinator_rebalance();
+        sleep(1);
+    }
+
+    signal_workers(SIGTERM);
+    while (wait(NULL) > 0) {
+    }
+    munmap(shard_table, sizeof(ShardTable));
+    shard_table = NULL;
+
+    printf("🛑 Coordinator stopped\n");
+    return 0;
+}
+
+// ============================================
+// MAIN SCHEDULER LOOP
+// ============================================
+
+// Poll loop shared by single-process mode (slot < 0, every shard) and workers
+static int run_scheduler_loop(int slot) {
+    pid_t coordinator = getppid();
+
+    if (slot >= 0) {
+        // The coordinator's connection was closed before fork; never share one
+        if (!open_database()) return 1;
+        printf("👷 Worker %d polling every %d seconds\n", slot, config_get()->poll_interval_sec);
+    }
+
+    // Lease owner for claimed jobs, unique across hosts sharing the database
+    char host[64] = "localhost";
+    gethostname(host, sizeof(host) - 1);
+    snprintf(job_owner, sizeof(job_owner), "%s:%d", host, (int)getpid());
 
-    // Main scheduler loop
     int loop_count = 0;
-    time_t last_cleanup = time(NULL);
-    time_t last_analytics = time(NULL);
 
     while (running) {
+        if (slot >= 0) {
+            if (getppid() != coordinator) break;    // Orphaned
+            owned_shards = worker_adopt_shards(slot);
+        }
+
+        // Config changes (SIGHUP) take effect at the start of a poll
+        if (reload_requested) {
+            reload_requested = 0;
+            reload_config(CONFIG_FILE);
+        }
+
         loop_count++;
-        time_t now = time(NULL);
+        int notifications_sent = 0;
 
-        // Check for due tasks and send notifications
-        int notifications_sent = check_due_tasks();
+        if (owned_shards != 0) {
+            // Check for due tasks and send notifications
+            notifications_sent = check_due_tasks(owned_shards);
 
-        // Periodic cleanup (every 6 hours)
-        if (now - last_cleanup > 6 * 3600) {
-            cleanup_old_tasks();
-            last_cleanup = now;
+            // Next occurrence for recurring tasks completed since the last poll
+            materialize_recurring_tasks(owned_shards);
         }
 
-        // Update analytics (every hour)
-        if (now - last_analytics > 3600) {
-            printf("📈 Updating user analytics...\n");
-            // This would typically update all users' productivity scores
-            last_analytics = now;
+        // Reminders, cleanup, analytics and backups from the job queue
+        run_due_jobs(owned_shards);
+
+        // On-demand statistics dump (SIGUSR1)
+        if (dump_stats_requested) {
+            dump_stats_requested = 0;
+            if (slot >= 0) printf("👷 Worker %d (shards %016llx):\n", slot, owned_shards);
+            query_stats_dump(stdout);
+            lock_stats_dump(stdout);
         }
 
         // Status report every 100 loops
@@ -781,11 +1999,65 @@ int main(int argc, char *argv[]) {
         }
 
         // Sleep until next poll
-        sleep(config.poll_interval_sec);
+        sleep(config_get()->poll_interval_sec);
     }
 
-    printf("🛑 Scheduler stopped\n");
+    if (slot >= 0) {
+        printf("👷 Worker %d stopped\n", slot);
+    } else {
+        printf("🛑 Scheduler stopped\n");
+    }
     cleanup_resources();
-    
     return 0;
-}
\ No newline at end of file
+}
+
+int main(int argc, char *argv[]) {
+    printf("🚀 Task Scheduler Enhanced Backend Starting...\n");
+    printf("📅 Build Date: %s %s\n", __DATE__, __TIME__);
+
+    int workers = 0;  // Without --workers, one process serves every shard
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--workers") == 0 && i + 1 < argc) {
+            workers = atoi(argv[++i]);
+            if (workers < 1 || workers > MAX_WORKERS) {
+                printf("❌ --workers must be between 1 and %d\n", MAX_WORKERS);
+                return 1;
+            }
+        }
+    }
+
+    // Setup signal handlers
+    signal(SIGINT, signal_handler);
+    signal(SIGTERM, signal_handler);
+    signal(SIGUSR1, signal_handler);
+    signal(SIGHUP, signal_handler);
+    signal(SIGTTIN, signal_handler);
+    signal(SIGTTOU, signal_handler);
+
+    // Load configuration
+    if (!load_config(CONFIG_FILE)) {
+        printf("❌ Failed to load configuration\n");
+        return 1;
+    }
+
+    // Initialize database
+    if (!init_database()) {
+        printf("❌ Database initialization failed\n");
+        return 1;
+    }
+
+    printf("✅ Backend initialized successfully\n");
+    const Config *cfg = config_get();
+    printf("🔄 Starting main loop (polling every %d seconds)\n", cfg->poll_interval_sec);
+    printf("📊 Max tasks per user: %d\n", cfg->max_tasks_per_user);
+    printf("🧹 Cleanup after %d days\n", cfg->cleanup_days);
+
+    if (workers > 0) {
+        // Schema is in place; each worker opens its own connection after fork
+        sqlite3_close(db);
+        db = NULL;
+        return run_coordinator(workers);
+    }
+
+    return run_scheduler_loop(-1);
+}
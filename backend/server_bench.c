@@ -0,0 +1,134 @@
+/* Server benchmark - connections/sec and latency percentiles against a running server
+ * Compile: gcc -O2 server_bench.c -o server_bench -lpthread
+ * Run:     ./server_bench [port] [concurrency] [seconds] [path]
+ *
+ * Every request is a fresh connection (connect, one GET, read to EOF), which is
+ * what each dashboard call costs a server that closes after one response.
+ * Latency is measured from connect() to the last byte; a connection that stalls
+ * for 5 seconds is counted as an error.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+typedef struct {
+    double *latencies_ms;
+    int count;
+    int capacity;
+    int errors;
+} BenchThread;
+
+static int port = 3000;
+static const char *path = "/api/health";
+static double deadline;
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int one_request(void) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) return 0;
+
+    // A stalled connection counts as an error instead of hanging the run
+    struct timeval timeout = { 5, 0 };
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+    struct sockaddr_in addr = {0};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    char request[512];
+    int length = snprintf(request, sizeof(request),
+        "GET %s HTTP/1.1\r\nHost: localhost\r\nConnection: close\r\n\r\n", path);
+
+    int ok = connect(fd, (struct sockaddr*)&addr, sizeof(addr)) == 0 &&
+             send(fd, request, length, 0) == length;
+
+    char buffer[4096];
+    int received = 0, got;
+    while (ok && (got = recv(fd, buffer, sizeof(buffer), 0)) > 0) received += got;
+
+    close(fd);
+    return ok && received > 12 && strncmp(buffer, "HTTP/1.1 ", 9) == 0;
+}
+
+static void *bench_thread(void *arg) {
+    BenchThread *thread = arg;
+    while (now_seconds() < deadline) {
+        double start = now_seconds();
+        if (!one_request()) {
+            thread->errors++;
+            continue;
+        }
+        if (thread->count == thread->capacity) {
+            thread->capacity = thread->capacity ? thread->capacity * 2 : 4096;
+            thread->latencies_ms = realloc(thread->latencies_ms, thread->capacity * sizeof(double));
+        }
+        thread->latencies_ms[thread->count++] = (now_seconds() - start) * 1000.0;
+    }
+    return NULL;
+}
+
+static int compare_double(const void *a, const void *b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+int main(int argc, char **argv) {
+    int concurrency = 32;
+    int seconds = 10;
+    if (argc > 1) port = atoi(argv[1]);
+    if (argc > 2) concurrency = atoi(argv[2]);
+    if (argc > 3) seconds = atoi(argv[3]);
+    if (argc > 4) path = argv[4];
+
+    BenchThread *threads = calloc(concurrency, sizeof(BenchThread));
+    pthread_t *ids = malloc(concurrency * sizeof(pthread_t));
+    double started = now_seconds();
+    deadline = started + seconds;
+
+    for (int i = 0; i < concurrency; i++) pthread_create(&ids[i], NULL, bench_thread, &threads[i]);
+    for (int i = 0; i < concurrency; i++) pthread_join(ids[i], NULL);
+    double elapsed = now_seconds() - started;
+
+    int total = 0, errors = 0;
+    for (int i = 0; i < concurrency; i++) {
+        total += threads[i].count;
+        errors += threads[i].errors;
+    }
+    double *all = malloc((total ? total : 1) * sizeof(double));
+    int at = 0;
+    for (int i = 0; i < concurrency; i++) {
+        memcpy(all + at, threads[i].latencies_ms, threads[i].count * sizeof(double));
+        at += threads[i].count;
+        free(threads[i].latencies_ms);
+    }
+    qsort(all, total, sizeof(double), compare_double);
+
+    printf("%d connections x %ds on port %d, GET %s\n", concurrency, seconds, port, path);
+    printf("  completed  %d (%.0f conn/s), errors %d\n", total, total / elapsed, errors);
+    if (total) {
+        printf("  latency ms p50 %.2f  p90 %.2f  p99 %.2f  max %.2f\n",
+               all[total / 2], all[(int)(total * 0.90)], all[(int)(total * 0.99)], all[total - 1]);
+    }
+
+    free(all);
+    free(threads);
+    free(ids);
+    return 0;
+}
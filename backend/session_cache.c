@@ -0,0 +1,237 @@
+/* Session Cache - sharded LRU of sessions in front of the sessions table
+ *
+ * A session id hashes (FNV-1a) to one of SESSION_CACHE_SHARDS shards. Each
+ * shard has its own lock, a chained hash table sized for its share of the
+ * capacity (it never grows), and a doubly linked recency list with the most
+ * recently used entry at the head. Entries carry the caller's value inline.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "session_cache.h"
+
+#ifdef _WIN32
+    #include <windows.h>
+    typedef CRITICAL_SECTION mutex_t;
+    #define MUTEX_INIT(mutex) InitializeCriticalSection(&mutex)
+    #define MUTEX_LOCK(mutex) EnterCriticalSection(&mutex)
+    #define MUTEX_UNLOCK(mutex) LeaveCriticalSection(&mutex)
+#else
+    #include <pthread.h>
+    typedef pthread_mutex_t mutex_t;
+    #define MUTEX_INIT(mutex) pthread_mutex_init(&mutex, NULL)
+    #define MUTEX_LOCK(mutex) pthread_mutex_lock(&mutex)
+    #define MUTEX_UNLOCK(mutex) pthread_mutex_unlock(&mutex)
+#endif
+
+#define SESSION_CACHE_SHARDS 16          // Power of two
+
+typedef struct SessionEntry {
+    struct SessionEntry *chain;          // Next in the hash bucket
+    struct SessionEntry *newer;
+    struct SessionEntry *older;
+    unsigned int hash;
+    time_t last_access;
+    int accessed;                        // last_access not yet taken for the database
+    char session_id[SESSION_CACHE_ID_MAX];
+    unsigned char value[];
+} SessionEntry;
+
+typedef struct {
+    mutex_t mutex;
+    SessionEntry **buckets;
+    unsigned int mask;
+    SessionEntry *newest;
+    SessionEntry *oldest;
+    int count;
+    int capacity;
+    unsigned long long hits;
+    unsigned long long misses;
+    char padding[64];                    // Keeps neighbouring shard locks off one cache line
+} SessionShard;
+
+static SessionShard shards[SESSION_CACHE_SHARDS];
+static int value_size;
+static int ttl_seconds;
+static int cache_ready = 0;
+
+static unsigned int id_hash(const char *session_id) {
+    unsigned int hash = 2166136261u;
+    for (; *session_id; session_id++) {
+        hash ^= (unsigned char)*session_id;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static SessionShard *shard_for(unsigned int hash) {
+    return &shards[hash & (SESSION_CACHE_SHARDS - 1)];
+}
+
+static SessionEntry **bucket_for(SessionShard *shard, unsigned int hash) {
+    return &shard->buckets[(hash / SESSION_CACHE_SHARDS) & shard->mask];
+}
+
+static SessionEntry *shard_find(SessionShard *shard, const char *session_id, unsigned int hash) {
+    SessionEntry *entry = *bucket_for(shard, hash);
+    while (entry && (entry->hash != hash || strcmp(entry->session_id, session_id) != 0)) entry = entry->chain;
+    return entry;
+}
+
+static void list_unlink(SessionShard *shard, SessionEntry *entry) {
+    if (entry->newer) entry->newer->older = entry->older;
+    else shard->newest = entry->older;
+    if (entry->older) entry->older->newer = entry->newer;
+    else shard->oldest = entry->newer;
+    entry->newer = entry->older = NULL;
+}
+
+static void list_push_newest(SessionShard *shard, SessionEntry *entry) {
+    entry->older = shard->newest;
+    entry->newer = NULL;
+    if (shard->newest) shard->newest->newer = entry;
+    shard->newest = entry;
+    if (!shard->oldest) shard->oldest = entry;
+}
+
+static void shard_remove(SessionShard *shard, SessionEntry *entry) {
+    SessionEntry **link = bucket_for(shard, entry->hash);
+    while (*link != entry) link = &(*link)->chain;
+    *link = entry->chain;
+    list_unlink(shard, entry);
+    shard->count--;
+    free(entry);
+}
+
+// ============================================
+// PUBLIC API
+// ============================================
+
+int session_cache_init(const SessionCacheConfig *config) {
+    value_size = config->value_size;
+    ttl_seconds = config->ttl_seconds;
+
+    int per_shard = config->capacity / SESSION_CACHE_SHARDS;
+    if (per_shard < 1) per_shard = 1;
+    unsigned int buckets = 1;
+    while (buckets < (unsigned int)per_shard) buckets *= 2;
+
+    for (int i = 0; i < SESSION_CACHE_SHARDS; i++) {
+        MUTEX_INIT(shards[i].mutex);
+        shards[i].buckets = calloc(buckets, sizeof(SessionEntry*));
+        if (!shards[i].buckets) return 0;
+        shards[i].mask = buckets - 1;
+        shards[i].capacity = per_shard;
+    }
+    cache_ready = 1;
+    return 1;
+}
+
+int session_cache_get(const char *session_id, void *value, time_t now) {
+    if (!cache_ready) return 0;
+
+    unsigned int hash = id_hash(session_id);
+    SessionShard *shard = shard_for(hash);
+    int found = 0;
+
+    MUTEX_LOCK(shard->mutex);
+    SessionEntry *entry = shard_find(shard, session_id, hash);
+    if (entry && now - entry->last_access > ttl_seconds) {
+        shard_remove(shard, entry);
+        entry = NULL;
+    }
+    if (entry) {
+        memcpy(value, entry->value, value_size);
+        entry->last_access = now;
+        entry->accessed = 1;
+        list_unlink(shard, entry);
+        list_push_newest(shard, entry);
+        shard->hits++;
+        found = 1;
+    } else {
+        shard->misses++;
+    }
+    MUTEX_UNLOCK(shard->mutex);
+
+    return found;
+}
+
+void session_cache_put(const char *session_id, const void *value, time_t last_access, int accessed) {
+    if (!cache_ready || strlen(session_id) >= SESSION_CACHE_ID_MAX) return;
+
+    unsigned int hash = id_hash(session_id);
+    SessionShard *shard = shard_for(hash);
+
+    MUTEX_LOCK(shard->mutex);
+    SessionEntry *entry = shard_find(shard, session_id, hash);
+    if (entry) {
+        list_unlink(shard, entry);
+    } else {
+        if (shard->count >= shard->capacity) shard_remove(shard, shard->oldest);
+        entry = calloc(1, sizeof(SessionEntry) + value_size);
+        if (!entry) {
+            MUTEX_UNLOCK(shard->mutex);
+            return; // Served from the database instead
+        }
+        entry->hash = hash;
+        strcpy(entry->session_id, session_id);
+        SessionEntry **bucket = bucket_for(shard, hash);
+        entry->chain = *bucket;
+        *bucket = entry;
+        shard->count++;
+    }
+    memcpy(entry->value, value, value_size);
+    entry->last_access = last_access;
+    entry->accessed = accessed;
+    list_push_newest(shard, entry);
+    MUTEX_UNLOCK(shard->mutex);
+}
+
+void session_cache_remove(const char *session_id) {
+    if (!cache_ready) return;
+
+    unsigned int hash = id_hash(session_id);
+    SessionShard *shard = shard_for(hash);
+
+    MUTEX_LOCK(shard->mutex);
+    SessionEntry *entry = shard_find(shard, session_id, hash);
+    if (entry) shard_remove(shard, entry);
+    MUTEX_UNLOCK(shard->mutex);
+}
+
+int session_cache_take_accesses(SessionAccess **accesses) {
+    SessionAccess *taken = NULL;
+    int count = 0, capacity = 0;
+
+    for (int i = 0; i < SESSION_CACHE_SHARDS && cache_ready; i++) {
+        SessionShard *shard = &shards[i];
+        MUTEX_LOCK(shard->mutex);
+        for (SessionEntry *entry = shard->newest; entry; entry = entry->older) {
+            if (!entry->accessed) continue;
+            if (count == capacity) {
+                int grown_capacity = capacity ? capacity * 2 : 64;
+                SessionAccess *grown = realloc(taken, grown_capacity * sizeof(SessionAccess));
+                if (!grown) break;
+                taken = grown;
+                capacity = grown_capacity;
+            }
+            strcpy(taken[count].session_id, entry->session_id);
+            taken[count++].last_access = entry->last_access;
+            entry->accessed = 0;
+        }
+        MUTEX_UNLOCK(shard->mutex);
+    }
+
+    *accesses = taken;
+    return count;
+}
+
+void session_cache_counts(unsigned long long *hits, unsigned long long *misses) {
+    *hits = *misses = 0;
+    for (int i = 0; i < SESSION_CACHE_SHARDS && cache_ready; i++) {
+        MUTEX_LOCK(shards[i].mutex);
+        *hits += shards[i].hits;
+        *misses += shards[i].misses;
+        MUTEX_UNLOCK(shards[i].mutex);
+    }
+}
@@ -0,0 +1,56 @@
+/* Session Cache - sharded LRU of sessions in front of the sessions table
+ *
+ * Holds a fixed-size caller-defined value per session id, so an
+ * authenticated request is answered from memory. Entries expire after
+ * ttl_seconds without use and the least recently used entry of a full
+ * shard is evicted. Creating or deleting a session writes through: the
+ * caller updates the table and then the cache, under the same lock it uses
+ * for the table, so a concurrent miss cannot put back a deleted session.
+ *
+ * Each hit records its access time without touching the database; the
+ * caller collects those with session_cache_take_accesses() and writes them
+ * in one batch. An entry evicted before that loses its unflushed access,
+ * which leaves its row at most one flush interval behind.
+ */
+
+#ifndef SESSION_CACHE_H
+#define SESSION_CACHE_H
+
+#include <time.h>
+
+#define SESSION_CACHE_ID_MAX 80
+
+typedef struct {
+    int capacity;                // Sessions held across all shards
+    int value_size;              // Bytes of caller data per session
+    int ttl_seconds;             // Idle time after which a cached session is gone
+} SessionCacheConfig;
+
+// Returns 0 if the shards could not be allocated; every lookup then misses
+int session_cache_init(const SessionCacheConfig *config);
+
+// Copies the session's value into value (value_size bytes) and records the
+// access at now. Returns 0 on a miss or if the entry had expired.
+int session_cache_get(const char *session_id, void *value, time_t now);
+
+// Inserts or replaces a session last used at last_access. accessed marks
+// that time as not yet in the database, so the next take reports it.
+void session_cache_put(const char *session_id, const void *value, time_t last_access, int accessed);
+
+void session_cache_remove(const char *session_id);
+
+typedef struct {
+    char session_id[SESSION_CACHE_ID_MAX];
+    time_t last_access;
+} SessionAccess;
+
+// Sessions used since the last call and when, in an array the caller frees.
+// Returns the count; accesses that did not fit in memory are kept for the
+// next call. Copies out under one shard lock at a time, so the caller can
+// write them to the database without holding up lookups.
+int session_cache_take_accesses(SessionAccess **accesses);
+
+// Lookups since start, for reporting
+void session_cache_counts(unsigned long long *hits, unsigned long long *misses);
+
+#endif
@@ -3,6 +3,8 @@
 #include <string.h>
 #include <time.h>
 #include <ctype.h>
+#include <errno.h>
+#include "json_body.h"
 
 #ifdef _WIN32
     #include <winsock2.h>
@@ -13,6 +15,7 @@
     #define sleep(x) Sleep((x) * 1000)
 #else
     #include <sys/socket.h>
+    #include <sys/time.h>
     #include <netinet/in.h>
     #include <arpa/inet.h>
     #include <unistd.h>
@@ -21,11 +24,22 @@
 
 #define PORT 3000
 #define BUFFER_SIZE 8192
+#define KEEP_ALIVE_TIMEOUT 5         // Seconds a persistent connection may sit idle
+#define KEEP_ALIVE_MAX_REQUESTS 100  // Then it is closed so its thread is freed
 #define MAX_USERS 1000
 #define MAX_SESSIONS 100
 #define OTP_LENGTH 6
 #define SESSION_TIMEOUT 3600
 
+#ifdef _MSC_VER
+    #define THREAD_LOCAL __declspec(thread)
+#else
+    #define THREAD_LOCAL __thread
+#endif
+
+// Connection header of the response this thread is writing
+static THREAD_LOCAL const char *connection_header = "close";
+
 // Simplified structures without external dependencies
 typedef struct {
     int id;
@@ -60,6 +74,7 @@ void send_response(int client_socket, int status_code, const char *content_type,
         case 200: strcpy(status_text, "OK"); break;
         case 400: strcpy(status_text, "Bad Request"); break;
         case 401: strcpy(status_text, "Unauthorized"); break;
+        case 413: strcpy(status_text, "Payload Too Large"); break;
         case 500: strcpy(status_text, "Internal Server Error"); break;
         default: strcpy(status_text, "Unknown"); break;
     }
@@ -71,9 +86,10 @@ void send_response(int client_socket, int status_code, const char *content_type,
         "Access-Control-Allow-Methods: GET, POST, OPTIONS\r\n"
         "Access-Control-Allow-Headers: Content-Type\r\n"
         "Content-Length: %u\r\n"
+        "Connection: %s\r\n"
         "\r\n"
         "%s",
-        status_code, status_text, content_type, (unsigned int)strlen(body), body
+        status_code, status_text, content_type, (unsigned int)strlen(body), connection_header, body
     );
     
     send(client_socket, response, strlen(response), 0);
@@ -146,39 +162,16 @@ Session* create_session(const char *username) {
     return session;
 }
 
-// Simple JSON parsing (very basic)
-char* extract_json_value(const char *json, const char *key) {
-    static char value[256];
-    char search_key[64];
-    snprintf(search_key, sizeof(search_key), "\"%s\":", key);
-    
-    char *pos = strstr(json, search_key);
-    if(!pos) return NULL;
-    
-    pos += strlen(search_key);
-    while(*pos == ' ' || *pos == '\t') pos++; // skip whitespace
-    
-    if(*pos == '"') {
-        pos++; // skip opening quote
-        int i = 0;
-        while(*pos && *pos != '"' && i < 255) {
-            value[i++] = *pos++;
-        }
-        value[i] = '\0';
-        return value;
-    }
-    
-    return NULL;
-}
-
 // Authentication handlers
 void handle_register(int client_socket, const char *body) {
-    char *username = extract_json_value(body, "username");
-    char *email = extract_json_value(body, "email");
-    char *password = extract_json_value(body, "password");
-    char *mobile = extract_json_value(body, "mobile");
-    
-    if(!username || !email || !password || !mobile) {
+    JsonBody fields;
+    json_body_parse(&fields, body, strlen(body));
+    char username[64], email[128], password[128], mobile[16];
+    
+    if(json_body_string(&fields, "username", username, sizeof(username)) <= 0 ||
+       json_body_string(&fields, "email", email, sizeof(email)) <= 0 ||
+       json_body_string(&fields, "password", password, sizeof(password)) <= 0 ||
+       json_body_string(&fields, "mobile", mobile, sizeof(mobile)) <= 0) {
         send_json_error(client_socket, 400, "Missing required fields");
         return;
     }
@@ -206,10 +199,12 @@ void handle_register(int client_socket, const char *body) {
 }
 
 void handle_login_step1(int client_socket, const char *body) {
-    char *username = extract_json_value(body, "username");
-    char *password = extract_json_value(body, "password");
+    JsonBody fields;
+    json_body_parse(&fields, body, strlen(body));
+    char username[64], password[128];
     
-    if(!username || !password) {
+    if(json_body_string(&fields, "username", username, sizeof(username)) <= 0 ||
+       json_body_string(&fields, "password", password, sizeof(password)) <= 0) {
         send_json_error(client_socket, 400, "Missing username or password");
         return;
     }
@@ -236,10 +231,12 @@ void handle_login_step1(int client_socket, const char *body) {
 }
 
 void handle_login_step2(int client_socket, const char *body) {
-    char *session_id = extract_json_value(body, "session_id");
-    char *otp = extract_json_value(body, "otp");
+    JsonBody fields;
+    json_body_parse(&fields, body, strlen(body));
+    char session_id[37], otp[7];
     
-    if(!session_id || !otp) {
+    if(json_body_string(&fields, "session_id", session_id, sizeof(session_id)) <= 0 ||
+       json_body_string(&fields, "otp", otp, sizeof(otp)) <= 0) {
         send_json_error(client_socket, 400, "Missing session_id or otp");
         return;
     }
@@ -261,9 +258,11 @@ void handle_login_step2(int client_socket, const char *body) {
 }
 
 void handle_login_step3(int client_socket, const char *body) {
-    char *session_id = extract_json_value(body, "session_id");
+    JsonBody fields;
+    json_body_parse(&fields, body, strlen(body));
+    char session_id[37];
     
-    if(!session_id) {
+    if(json_body_string(&fields, "session_id", session_id, sizeof(session_id)) <= 0) {
         send_json_error(client_socket, 400, "Missing session_id");
         return;
     }
@@ -288,9 +287,11 @@ void handle_login_step3(int client_socket, const char *body) {
 }
 
 void handle_resend_otp(int client_socket, const char *body) {
-    char *session_id = extract_json_value(body, "session_id");
+    JsonBody fields;
+    json_body_parse(&fields, body, strlen(body));
+    char session_id[37];
     
-    if(!session_id) {
+    if(json_body_string(&fields, "session_id", session_id, sizeof(session_id)) <= 0) {
         send_json_error(client_socket, 400, "Missing session_id");
         return;
     }
@@ -356,6 +357,72 @@ void handle_request(int client_socket, char *request) {
     }
 }
 
+// Case-insensitive match of a header name at the start of line
+int header_is(const char *line, const char *name) {
+    while(*name) {
+        if(tolower((unsigned char)*line) != tolower((unsigned char)*name)) return 0;
+        line++;
+        name++;
+    }
+    return 1;
+}
+
+// Bytes of the first complete request in buffer (headers plus Content-Length
+// body), 0 while more is needed, or -1 if the Content-Length is malformed or
+// the request could never fit in the buffer
+int request_length(const char *buffer, int buffered) {
+    const char *header_end = strstr(buffer, "\r\n\r\n");
+    if(!header_end) return 0;
+    
+    int header_length = (int)(header_end + 4 - buffer);
+    unsigned long content_length = 0;
+    for(const char *line = strstr(buffer, "\r\n"); line && line < header_end; line = strstr(line + 2, "\r\n")) {
+        if(header_is(line + 2, "Content-Length:")) {
+            const char *value = line + 17;
+            while(*value == ' ' || *value == '\t') value++;
+            if(!isdigit((unsigned char)*value)) return -1;
+            
+            char *end;
+            errno = 0;
+            content_length = strtoul(value, &end, 10);
+            if(errno == ERANGE || (*end != '\r' && *end != ' ' && *end != '\t')) return -1;
+            break;
+        }
+    }
+    
+    // Compared before adding, so a huge value cannot overflow the total
+    if(content_length > (unsigned long)(BUFFER_SIZE - 1 - header_length)) return -1;
+    int length = header_length + (int)content_length;
+    return length <= buffered ? length : 0;
+}
+
+// HTTP/1.1 persists unless the client sends "Connection: close"; HTTP/1.0
+// only with "Connection: keep-alive"
+int wants_keep_alive(const char *request) {
+    const char *line_end = strstr(request, "\r\n");
+    if(!line_end) return 0;
+    int keep_alive = line_end - request >= 8 && strncmp(line_end - 8, "HTTP/1.1", 8) == 0;
+    
+    for(const char *line = line_end; line && line[2] != '\r'; line = strstr(line + 2, "\r\n")) {
+        if(!header_is(line + 2, "Connection:")) continue;
+        const char *value_end = strstr(line + 2, "\r\n");
+        for(const char *at = line + 13; at && at < value_end; at++) {
+            if(header_is(at, "close")) return 0;
+            if(header_is(at, "keep-alive")) keep_alive = 1;
+        }
+    }
+    return keep_alive;
+}
+
+void set_receive_timeout(int client_socket, int seconds) {
+#ifdef _WIN32
+    DWORD timeout = (DWORD)seconds * 1000;
+#else
+    struct timeval timeout = { seconds, 0 };
+#endif
+    setsockopt(client_socket, SOL_SOCKET, SO_RCVTIMEO, (const char*)&timeout, sizeof(timeout));
+}
+
 #ifdef _WIN32
 DWORD WINAPI handle_client(LPVOID client_socket_ptr) {
     int client_socket = *(int*)client_socket_ptr;
@@ -366,12 +433,44 @@ void* handle_client(void *client_socket_ptr) {
     free(client_socket_ptr);
 #endif
     
+    // Persistent connection: answer each request in the order it arrived,
+    // including pipelined ones already buffered, until the client closes,
+    // asks to close, or stays idle past KEEP_ALIVE_TIMEOUT
     char buffer[BUFFER_SIZE];
-    int bytes_received = recv(client_socket, buffer, BUFFER_SIZE - 1, 0);
+    buffer[0] = '\0';
+    int buffered = 0;
+    int served = 0;
+    set_receive_timeout(client_socket, KEEP_ALIVE_TIMEOUT);
     
-    if(bytes_received > 0) {
-        buffer[bytes_received] = '\0';
+    while(1) {
+        int length = request_length(buffer, buffered);
+        if(length < 0) {
+            connection_header = "close";
+            send_json_error(client_socket, 413, "Request too large");
+            break;
+        }
+        if(length == 0) {
+            if(buffered == BUFFER_SIZE - 1) {
+                length = buffered; // Too large to frame; answer what arrived, then close
+            } else {
+                int bytes_received = recv(client_socket, buffer + buffered, BUFFER_SIZE - 1 - buffered, 0);
+                if(bytes_received <= 0) break;
+                buffered += bytes_received;
+                buffer[buffered] = '\0';
+                continue;
+            }
+        }
+        
+        char next = buffer[length];
+        buffer[length] = '\0';
+        int keep_alive = length < BUFFER_SIZE - 1 && wants_keep_alive(buffer) && ++served < KEEP_ALIVE_MAX_REQUESTS;
+        connection_header = keep_alive ? "keep-alive" : "close";
         handle_request(client_socket, buffer);
+        buffer[length] = next;
+        
+        if(!keep_alive) break;
+        buffered -= length;
+        memmove(buffer, buffer + length, buffered + 1);
     }
     
     close(client_socket);
@@ -41,6 +41,10 @@ int sqlite3_finalize(sqlite3_stmt *pStmt) {
     return SQLITE_OK; 
 } 
  
+int sqlite3_reset(sqlite3_stmt *pStmt) { 
+    return SQLITE_OK; 
+} 
+ 
 int sqlite3_bind_text(sqlite3_stmt* stmt, int index, const char* text, int len, void(*destructor)(void*)) { 
     printf("📝 DEMO: Binding text parameter %d: %s\n", index, text); 
     return SQLITE_OK; 
@@ -56,6 +60,11 @@ int sqlite3_bind_int64(sqlite3_stmt* stmt, int index, long long value) {
     return SQLITE_OK; 
 } 
  
+int sqlite3_bind_null(sqlite3_stmt* stmt, int index) { 
+    printf("📝 DEMO: Binding NULL parameter %d\n", index); 
+    return SQLITE_OK; 
+} 
+ 
 const unsigned char *sqlite3_column_text(sqlite3_stmt* stmt, int iCol) { 
     static char demo_text[] = "demo_value"; 
     printf("📝 DEMO: Getting text column %d\n", iCol); 
@@ -89,3 +98,16 @@ long long sqlite3_last_insert_rowid(sqlite3* db) {
     printf("📝 DEMO: Last insert ID: 1\n"); 
     return 1; 
 } 
+ 
+int sqlite3_trace_v2(sqlite3* db, unsigned int uMask, int(*xCallback)(unsigned int,void*,void*,void*), void *pCtx) { 
+    printf("📝 DEMO: Trace callback registered (mask %u)\n", uMask); 
+    return SQLITE_OK; 
+} 
+ 
+const char *sqlite3_sql(sqlite3_stmt *pStmt) { 
+    return "demo_sql"; 
+} 
+ 
+char *sqlite3_expanded_sql(sqlite3_stmt *pStmt) { 
+    return NULL; 
+} 
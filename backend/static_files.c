@@ -0,0 +1,605 @@
+/* Static Files - the frontend served straight from disk
+ *
+ * Entries are keyed by the decoded request path and live in one chained
+ * hash table with a recency list, under one lock that is held only for the
+ * lookup. An entry is reference counted: the cache holds one reference and
+ * every response being sent from it holds another, so an entry evicted or
+ * replaced mid-send keeps its descriptors open until that send finishes.
+ * Opening, stat() and rendering headers all happen outside the lock.
+ */
+
+#ifndef _WIN32
+    #define _GNU_SOURCE  // sendfile, pread, realpath
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <time.h>
+#include <limits.h>
+#include "static_files.h"
+
+#ifdef _WIN32
+    #include <windows.h>
+    #include <io.h>
+    #include <fcntl.h>
+    #include <sys/stat.h>
+    typedef CRITICAL_SECTION mutex_t;
+    #define MUTEX_INIT(mutex) InitializeCriticalSection(&mutex)
+    #define MUTEX_LOCK(mutex) EnterCriticalSection(&mutex)
+    #define MUTEX_UNLOCK(mutex) LeaveCriticalSection(&mutex)
+    typedef struct _stat64 file_stat_t;
+    #define FILE_STAT(path, info) _stat64(path, info)
+    #define FILE_FSTAT(fd, info) _fstat64(fd, info)
+    #define FILE_OPEN(path) _open(path, _O_RDONLY | _O_BINARY)
+    #define FILE_CLOSE(fd) _close(fd)
+    #define RESOLVE_PATH(path, out) _fullpath(out, path, STATIC_PATH_MAX)
+    #define GMTIME(time, tm) gmtime_s(tm, time)
+    #define PATH_SEPARATOR '\\'
+    #ifndef S_ISREG
+        #define S_ISREG(mode) (((mode) & _S_IFMT) == _S_IFREG)
+        #define S_ISDIR(mode) (((mode) & _S_IFMT) == _S_IFDIR)
+    #endif
+#else
+    #include <pthread.h>
+    #include <fcntl.h>
+    #include <unistd.h>
+    #include <errno.h>
+    #include <sys/types.h>
+    #include <sys/stat.h>
+    #ifdef __linux__
+        #include <sys/sendfile.h>
+    #endif
+    typedef pthread_mutex_t mutex_t;
+    #define MUTEX_INIT(mutex) pthread_mutex_init(&mutex, NULL)
+    #define MUTEX_LOCK(mutex) pthread_mutex_lock(&mutex)
+    #define MUTEX_UNLOCK(mutex) pthread_mutex_unlock(&mutex)
+    typedef struct stat file_stat_t;
+    #define FILE_STAT(path, info) stat(path, info)
+    #define FILE_FSTAT(fd, info) fstat(fd, info)
+    #define FILE_OPEN(path) open(path, O_RDONLY)
+    #define FILE_CLOSE(fd) close(fd)
+    #define RESOLVE_PATH(path, out) realpath(path, out)
+    #define GMTIME(time, tm) gmtime_r(time, tm)
+    #define PATH_SEPARATOR '/'
+#endif
+
+#ifdef PATH_MAX
+    #define STATIC_PATH_MAX PATH_MAX
+#else
+    #define STATIC_PATH_MAX 4096
+#endif
+#define STATIC_KEY_MAX 1024              // Decoded request paths longer than this are refused
+#define STATIC_HEADERS_SIZE 512
+#define STATIC_SEND_BLOCK 65536          // Per read() where there is no sendfile()
+
+typedef struct {
+    long long size;
+    long long mtime;
+    unsigned long long inode;
+} FileStamp;
+
+typedef struct StaticEntry {
+    struct StaticEntry *chain;           // Next in the hash bucket, or on a list to free
+    struct StaticEntry *newer;
+    struct StaticEntry *older;
+    unsigned int hash;
+    int references;                      // The cache's, plus one per send in progress
+    time_t checked_at;
+    int fd;
+    int gz_fd;                           // -1 without a usable .gz
+    FileStamp stamp;
+    FileStamp gz_stamp;                  // size -1 without a .gz
+    char etag[48];                       // W/"size-mtime", weak so the .gz shares it
+    char last_modified[32];
+    char headers[STATIC_HEADERS_SIZE];
+    size_t headers_length;
+    char file_path[STATIC_PATH_MAX];     // Resolved, for rechecking
+    char key[];
+} StaticEntry;
+
+typedef struct {
+    const char *extension;
+    const char *content_type;
+} ContentType;
+
+static const ContentType content_types[] = {
+    { "html", "text/html; charset=utf-8" },
+    { "htm", "text/html; charset=utf-8" },
+    { "css", "text/css; charset=utf-8" },
+    { "js", "text/javascript; charset=utf-8" },
+    { "mjs", "text/javascript; charset=utf-8" },
+    { "json", "application/json; charset=utf-8" },
+    { "webmanifest", "application/manifest+json; charset=utf-8" },
+    { "map", "application/json; charset=utf-8" },
+    { "txt", "text/plain; charset=utf-8" },
+    { "xml", "application/xml; charset=utf-8" },
+    { "svg", "image/svg+xml" },
+    { "png", "image/png" },
+    { "jpg", "image/jpeg" },
+    { "jpeg", "image/jpeg" },
+    { "gif", "image/gif" },
+    { "webp", "image/webp" },
+    { "ico", "image/x-icon" },
+    { "woff", "font/woff" },
+    { "woff2", "font/woff2" },
+    { "ttf", "font/ttf" },
+    { NULL, NULL }
+};
+
+static const char gzip_encoding[] = "Content-Encoding: gzip\r\n";
+
+static mutex_t cache_mutex;
+static StaticEntry **buckets;
+static unsigned int bucket_mask;
+static StaticEntry *newest;
+static StaticEntry *oldest;
+static int entry_count;
+static int capacity;
+static int recheck_seconds;
+static int max_age_seconds;
+static char root[STATIC_PATH_MAX];
+static size_t root_length;
+static int serving = 0;
+static unsigned long long hits;
+static unsigned long long misses;
+
+static unsigned int key_hash(const char *key) {
+    unsigned int hash = 2166136261u;
+    for (; *key; key++) {
+        hash ^= (unsigned char)*key;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static StaticEntry **bucket_for(unsigned int hash) {
+    return &buckets[hash & bucket_mask];
+}
+
+static StaticEntry *cache_find(const char *key, unsigned int hash) {
+    StaticEntry *entry = *bucket_for(hash);
+    while (entry && (entry->hash != hash || strcmp(entry->key, key) != 0)) entry = entry->chain;
+    return entry;
+}
+
+static void list_unlink(StaticEntry *entry) {
+    if (entry->newer) entry->newer->older = entry->older;
+    else newest = entry->older;
+    if (entry->older) entry->older->newer = entry->newer;
+    else oldest = entry->newer;
+    entry->newer = entry->older = NULL;
+}
+
+static void list_push_newest(StaticEntry *entry) {
+    entry->older = newest;
+    entry->newer = NULL;
+    if (newest) newest->newer = entry;
+    newest = entry;
+    if (!oldest) oldest = entry;
+}
+
+static void entry_free(StaticEntry *entry) {
+    FILE_CLOSE(entry->fd);
+    if (entry->gz_fd >= 0) FILE_CLOSE(entry->gz_fd);
+    free(entry);
+}
+
+// Takes an entry out of the cache and drops the cache's reference. An entry
+// nobody is sending from goes on the dead list, to be freed after unlocking.
+static void cache_remove(StaticEntry *entry, StaticEntry **dead) {
+    StaticEntry **link = bucket_for(entry->hash);
+    while (*link != entry) link = &(*link)->chain;
+    *link = entry->chain;
+    list_unlink(entry);
+    entry_count--;
+    if (--entry->references == 0) {
+        entry->chain = *dead;
+        *dead = entry;
+    }
+}
+
+static void free_dead(StaticEntry *dead) {
+    while (dead) {
+        StaticEntry *next = dead->chain;
+        entry_free(dead);
+        dead = next;
+    }
+}
+
+static void entry_release(StaticEntry *entry) {
+    MUTEX_LOCK(cache_mutex);
+    int unused = --entry->references == 0;
+    MUTEX_UNLOCK(cache_mutex);
+    if (unused) entry_free(entry);
+}
+
+static FileStamp stamp_of(const file_stat_t *info) {
+    FileStamp stamp;
+    stamp.size = (long long)info->st_size;
+    stamp.mtime = (long long)info->st_mtime;
+    stamp.inode = (unsigned long long)info->st_ino;
+    return stamp;
+}
+
+static int stamps_equal(const FileStamp *a, const FileStamp *b) {
+    return a->size == b->size && a->mtime == b->mtime && a->inode == b->inode;
+}
+
+// Stamp of the .gz that would be used next to a file with this mtime, or
+// size -1 if there is none or it is stale
+static FileStamp gz_stamp_of(const char *gz_path, long long mtime) {
+    FileStamp stamp = { -1, 0, 0 };
+    file_stat_t info;
+    if (FILE_STAT(gz_path, &info) == 0 && S_ISREG(info.st_mode) && (long long)info.st_mtime >= mtime) {
+        stamp = stamp_of(&info);
+    }
+    return stamp;
+}
+
+static int hex_value(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+// Percent-decodes the path part of a target into out and checks every
+// segment. Returns 0 for anything that is not a plain path under the root.
+static int decode_path(const char *target, char *out, size_t size) {
+    size_t length = 0;
+    const char *p = target;
+    if (*p != '/') return 0;
+
+    for (; *p && *p != '?' && *p != '#'; p++) {
+        char c = *p;
+        if (c == '%') {
+            int high = hex_value(p[1]);
+            int low = high < 0 ? -1 : hex_value(p[2]);
+            if (low < 0) return 0;
+            c = (char)(high * 16 + low);
+            p += 2;
+        }
+        if (c == '\0' || c == '\\') return 0;
+        if (length + 1 >= size) return 0;
+        out[length++] = c;
+    }
+    out[length] = '\0';
+
+    // No segment may start with a dot, which rules out "." and ".." too
+    for (const char *segment = out; segment; segment = strchr(segment + 1, '/')) {
+        if (segment[1] == '.') return 0;
+#ifdef _WIN32
+        if (strchr(segment, ':')) return 0;
+#endif
+    }
+    return 1;
+}
+
+static const char *content_type_for(const char *file_path) {
+    const char *name = strrchr(file_path, PATH_SEPARATOR);
+    const char *dot = strrchr(name ? name : file_path, '.');
+    if (dot) {
+        for (const ContentType *type = content_types; type->extension; type++) {
+#ifdef _WIN32
+            if (_stricmp(dot + 1, type->extension) == 0) return type->content_type;
+#else
+            if (strcasecmp(dot + 1, type->extension) == 0) return type->content_type;
+#endif
+        }
+    }
+    return "application/octet-stream";
+}
+
+// Pages, data and the service worker are revalidated on every use so a
+// deploy shows up at once; the rest may be reused for max_age_seconds
+static int must_revalidate(const char *file_path) {
+    const char *name = strrchr(file_path, PATH_SEPARATOR);
+    name = name ? name + 1 : file_path;
+    const char *dot = strrchr(name, '.');
+    if (strcmp(name, "sw.js") == 0) return 1;
+    if (!dot) return 1;
+    return strcmp(dot, ".html") == 0 || strcmp(dot, ".htm") == 0 ||
+           strcmp(dot, ".json") == 0 || strcmp(dot, ".webmanifest") == 0;
+}
+
+static void render_headers(StaticEntry *entry) {
+    time_t mtime = (time_t)entry->stamp.mtime;
+    struct tm modified;
+    GMTIME(&mtime, &modified);
+    strftime(entry->last_modified, sizeof(entry->last_modified), "%a, %d %b %Y %H:%M:%S GMT", &modified);
+    snprintf(entry->etag, sizeof(entry->etag), "W/\"%llx-%llx\"",
+             (unsigned long long)entry->stamp.size, (unsigned long long)entry->stamp.mtime);
+
+    char cache_control[64];
+    if (must_revalidate(entry->file_path)) snprintf(cache_control, sizeof(cache_control), "no-cache");
+    else snprintf(cache_control, sizeof(cache_control), "public, max-age=%d", max_age_seconds);
+
+    int length = snprintf(entry->headers, sizeof(entry->headers),
+        "Content-Type: %s\r\n"
+        "Cache-Control: %s\r\n"
+        "ETag: %s\r\n"
+        "Last-Modified: %s\r\n"
+        "X-Content-Type-Options: nosniff\r\n"
+        "%s",
+        content_type_for(entry->file_path), cache_control, entry->etag, entry->last_modified,
+        entry->gz_fd >= 0 ? "Vary: Accept-Encoding\r\n" : "");
+    entry->headers_length = (size_t)length < sizeof(entry->headers) ? (size_t)length : sizeof(entry->headers) - 1;
+}
+
+// Opens the file a decoded path names, index.html for a directory. Returns
+// a new entry holding one reference for the caller, or NULL.
+static StaticEntry *entry_open(const char *key, unsigned int hash, time_t now) {
+    char path[STATIC_PATH_MAX];
+    char resolved[STATIC_PATH_MAX];
+    file_stat_t info;
+
+    size_t key_length = strlen(key);
+    if (root_length + key_length + sizeof("/index.html") > sizeof(path)) return NULL;
+    memcpy(path, root, root_length);
+    memcpy(path + root_length, key, key_length + 1);
+    if (FILE_STAT(path, &info) != 0) return NULL;
+    if (S_ISDIR(info.st_mode)) {
+        strcat(path, key[key_length - 1] == '/' ? "index.html" : "/index.html");
+    }
+
+    // Symlinks are followed, but only to somewhere inside the root
+    if (!RESOLVE_PATH(path, resolved)) return NULL;
+    if (strncmp(resolved, root, root_length) != 0 || resolved[root_length] != PATH_SEPARATOR) return NULL;
+
+    int fd = FILE_OPEN(resolved);
+    if (fd < 0) return NULL;
+    if (FILE_FSTAT(fd, &info) != 0 || !S_ISREG(info.st_mode)) {
+        FILE_CLOSE(fd);
+        return NULL;
+    }
+
+    StaticEntry *entry = malloc(sizeof(StaticEntry) + key_length + 1);
+    if (!entry) {
+        FILE_CLOSE(fd);
+        return NULL;
+    }
+    memset(entry, 0, sizeof(StaticEntry));
+    memcpy(entry->key, key, key_length + 1);
+    entry->hash = hash;
+    entry->references = 1;
+    entry->checked_at = now;
+    entry->fd = fd;
+    entry->stamp = stamp_of(&info);
+    snprintf(entry->file_path, sizeof(entry->file_path), "%s", resolved);
+
+    entry->gz_fd = -1;
+    entry->gz_stamp.size = -1;
+    char gz_path[STATIC_PATH_MAX + 3];
+    snprintf(gz_path, sizeof(gz_path), "%s.gz", resolved);
+    if (gz_stamp_of(gz_path, entry->stamp.mtime).size >= 0) {
+        int gz_fd = FILE_OPEN(gz_path);
+        if (gz_fd >= 0 && FILE_FSTAT(gz_fd, &info) == 0 && S_ISREG(info.st_mode)) {
+            entry->gz_fd = gz_fd;
+            entry->gz_stamp = stamp_of(&info);
+        } else if (gz_fd >= 0) {
+            FILE_CLOSE(gz_fd);
+        }
+    }
+
+    render_headers(entry);
+    return entry;
+}
+
+// Whether the file behind an entry still matches what was opened
+static int entry_current(const StaticEntry *entry) {
+    file_stat_t info;
+    if (FILE_STAT(entry->file_path, &info) != 0 || !S_ISREG(info.st_mode)) return 0;
+    FileStamp stamp = stamp_of(&info);
+    if (!stamps_equal(&stamp, &entry->stamp)) return 0;
+
+    char gz_path[STATIC_PATH_MAX + 3];
+    snprintf(gz_path, sizeof(gz_path), "%s.gz", entry->file_path);
+    FileStamp gz_stamp = gz_stamp_of(gz_path, stamp.mtime);
+    if (gz_stamp.size < 0 || entry->gz_stamp.size < 0) return gz_stamp.size == entry->gz_stamp.size;
+    return stamps_equal(&gz_stamp, &entry->gz_stamp);
+}
+
+// The entry for a decoded path with a reference taken, from the cache when
+// it is there and still current, or NULL if there is no such file
+static StaticEntry *entry_acquire(const char *key, time_t now) {
+    unsigned int hash = key_hash(key);
+
+    int fresh = 0;
+    MUTEX_LOCK(cache_mutex);
+    StaticEntry *entry = cache_find(key, hash);
+    if (entry) {
+        fresh = now - entry->checked_at < recheck_seconds;
+        entry->references++;
+        list_unlink(entry);
+        list_push_newest(entry);
+        hits++;
+    } else {
+        misses++;
+    }
+    MUTEX_UNLOCK(cache_mutex);
+
+    if (entry) {
+        if (fresh) return entry;
+        if (entry_current(entry)) {
+            MUTEX_LOCK(cache_mutex);
+            entry->checked_at = now;
+            MUTEX_UNLOCK(cache_mutex);
+            return entry;
+        }
+        entry_release(entry);
+    }
+
+    entry = entry_open(key, hash, now);
+    if (!entry) return NULL;
+
+    StaticEntry *dead = NULL;
+    MUTEX_LOCK(cache_mutex);
+    StaticEntry *previous = cache_find(key, hash);
+    if (previous) cache_remove(previous, &dead);
+    while (oldest && entry_count >= capacity) cache_remove(oldest, &dead);
+    StaticEntry **bucket = bucket_for(hash);
+    entry->chain = *bucket;
+    *bucket = entry;
+    list_push_newest(entry);
+    entry->references++;
+    entry_count++;
+    MUTEX_UNLOCK(cache_mutex);
+
+    free_dead(dead);
+    return entry;
+}
+
+// Weak comparison (RFC 9110 8.8.3.2) against each tag in the list
+static int etag_matches(const char *list, size_t length, const char *etag) {
+    const char *opaque = etag + 2; // Past "W/"
+    size_t opaque_length = strlen(opaque);
+    const char *end = list + length;
+    const char *p = list;
+
+    while (p < end) {
+        while (p < end && (*p == ',' || *p == ' ' || *p == '\t')) p++;
+        const char *tag = p;
+        while (p < end && *p != ',' && *p != ' ' && *p != '\t') p++;
+        size_t tag_length = (size_t)(p - tag);
+        if (tag_length == 1 && *tag == '*') return 1;
+        if (tag_length >= 2 && tag[0] == 'W' && tag[1] == '/') {
+            tag += 2;
+            tag_length -= 2;
+        }
+        if (tag_length == opaque_length && memcmp(tag, opaque, opaque_length) == 0) return 1;
+    }
+    return 0;
+}
+
+static int not_modified(const StaticRequest *request, const StaticEntry *entry) {
+    if (request->if_none_match) {
+        return etag_matches(request->if_none_match, request->if_none_match_length, entry->etag);
+    }
+    if (request->if_modified_since) {
+        // Browsers send back the Last-Modified they were given
+        return request->if_modified_since_length == strlen(entry->last_modified) &&
+               memcmp(request->if_modified_since, entry->last_modified, request->if_modified_since_length) == 0;
+    }
+    return 0;
+}
+
+// Copies size bytes of a file to the socket. sendfile() keeps them in the
+// kernel; elsewhere they pass through a buffer, read at an offset so
+// concurrent sends of one descriptor do not share a file position.
+static int send_file(int socket, int fd, long long size) {
+#ifdef __linux__
+    off_t offset = 0;
+    while (offset < size) {
+        long long left = size - offset;
+        ssize_t sent = sendfile(socket, fd, &offset, left > (1 << 30) ? (size_t)1 << 30 : (size_t)left);
+        if (sent < 0 && errno == EINTR) continue;
+        if (sent <= 0) return 0;
+    }
+    return 1;
+#else
+    char *buffer = malloc(STATIC_SEND_BLOCK);
+    if (!buffer) return 0;
+    long long offset = 0;
+    int ok = 1;
+    while (ok && offset < size) {
+        size_t want = size - offset > STATIC_SEND_BLOCK ? STATIC_SEND_BLOCK : (size_t)(size - offset);
+#ifdef _WIN32
+        OVERLAPPED position;
+        memset(&position, 0, sizeof(position));
+        position.Offset = (DWORD)offset;
+        position.OffsetHigh = (DWORD)(offset >> 32);
+        DWORD got = 0;
+        if (!ReadFile((HANDLE)_get_osfhandle(fd), buffer, (DWORD)want, &got, &position)) got = 0;
+#else
+        ssize_t got = pread(fd, buffer, want, (off_t)offset);
+        if (got < 0 && errno == EINTR) continue;
+#endif
+        if (got <= 0) {
+            ok = 0;
+            break;
+        }
+        HttpSlice slice = { buffer, (size_t)got };
+        ok = http_send_slices(socket, &slice, 1);
+        offset += got;
+    }
+    free(buffer);
+    return ok;
+#endif
+}
+
+// ============================================
+// PUBLIC API
+// ============================================
+
+void static_files_config_defaults(StaticFilesConfig *config) {
+    config->root = NULL;
+    config->max_age_seconds = STATIC_FILES_DEFAULT_MAX_AGE;
+    config->cache_entries = STATIC_FILES_DEFAULT_ENTRIES;
+    config->recheck_seconds = STATIC_FILES_DEFAULT_RECHECK;
+}
+
+int static_files_init(const StaticFilesConfig *config) {
+    if (!config->root || !config->root[0]) return 1;
+
+    file_stat_t info;
+    if (!RESOLVE_PATH(config->root, root) || FILE_STAT(root, &info) != 0 || !S_ISDIR(info.st_mode)) return 0;
+    root_length = strlen(root);
+    while (root_length > 0 && root[root_length - 1] == PATH_SEPARATOR) root[--root_length] = '\0';
+
+    capacity = config->cache_entries > 0 ? config->cache_entries : 1;
+    recheck_seconds = config->recheck_seconds;
+    max_age_seconds = config->max_age_seconds;
+    unsigned int bucket_count = 1;
+    while (bucket_count < (unsigned int)capacity) bucket_count *= 2;
+    buckets = calloc(bucket_count, sizeof(StaticEntry*));
+    if (!buckets) return 0;
+    bucket_mask = bucket_count - 1;
+    MUTEX_INIT(cache_mutex);
+    serving = 1;
+    return 1;
+}
+
+int static_files_enabled(void) {
+    return serving;
+}
+
+StaticResult static_files_serve(int socket, const StaticRequest *request) {
+    char key[STATIC_KEY_MAX];
+    if (!serving || !decode_path(request->path, key, sizeof(key))) return STATIC_NOT_FOUND;
+
+    StaticEntry *entry = entry_acquire(key, time(NULL));
+    if (!entry) return STATIC_NOT_FOUND;
+
+    int unchanged = not_modified(request, entry);
+    int gzipped = !unchanged && request->accepts_gzip && entry->gz_fd >= 0;
+    long long size = gzipped ? entry->gz_stamp.size : entry->stamp.size;
+    char content_length[40];
+    HttpSlice slices[HTTP_RESPONSE_MAX_SLICES];
+    int count = 0;
+
+    slices[count++] = http_status_line(unchanged ? 304 : 200);
+    slices[count].data = entry->headers;
+    slices[count++].length = entry->headers_length;
+    if (gzipped) {
+        slices[count].data = gzip_encoding;
+        slices[count++].length = sizeof(gzip_encoding) - 1;
+    }
+    if (!unchanged) slices[count++] = http_content_length(content_length, size);
+    slices[count++] = request->connection;
+
+    int ok = http_send_slices(socket, slices, count);
+    if (ok && !unchanged && !request->head_only) ok = send_file(socket, gzipped ? entry->gz_fd : entry->fd, size);
+    entry_release(entry);
+    return ok ? STATIC_SENT : STATIC_SEND_FAILED;
+}
+
+void static_files_counts(unsigned long long *hits_out, unsigned long long *misses_out) {
+    *hits_out = *misses_out = 0;
+    if (!serving) return;
+    MUTEX_LOCK(cache_mutex);
+    *hits_out = hits;
+    *misses_out = misses;
+    MUTEX_UNLOCK(cache_mutex);
+}
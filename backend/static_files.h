@@ -0,0 +1,63 @@
+/* Static Files - the frontend served straight from disk
+ *
+ * static_files_serve() maps a request path under the configured root to a
+ * file and sends it with sendfile() where the platform has it, so the bytes
+ * go from the page cache to the socket without passing through the server.
+ * Open descriptors, stat results and each file's rendered header block are
+ * kept in an LRU, so a hit costs a hash lookup and, once every few seconds
+ * per file, a stat() to notice edits. A "name.gz" next to a file is sent
+ * instead of it to clients that accept gzip, as long as it is not older.
+ *
+ * Paths are percent-decoded and refused if they hold "..", a segment
+ * starting with a dot, a backslash or a NUL, then resolved and checked to
+ * lie inside the root, so a symlink cannot lead out of it either.
+ */
+
+#ifndef STATIC_FILES_H
+#define STATIC_FILES_H
+
+#include <stddef.h>
+#include "http_response.h"
+
+#define STATIC_FILES_DEFAULT_MAX_AGE 3600
+#define STATIC_FILES_DEFAULT_ENTRIES 256
+#define STATIC_FILES_DEFAULT_RECHECK 2
+
+typedef struct {
+    const char *root;            // Directory served; NULL or "" serves nothing
+    int max_age_seconds;         // Cache-Control for assets; pages always revalidate
+    int cache_entries;           // Open files kept
+    int recheck_seconds;         // How long a stat() result is trusted
+} StaticFilesConfig;
+
+typedef struct {
+    const char *path;            // Request target; a query string is ignored
+    int head_only;
+    int accepts_gzip;
+    const char *if_none_match;   // Header values, NULL if absent
+    size_t if_none_match_length;
+    const char *if_modified_since;
+    size_t if_modified_since_length;
+    HttpSlice connection;        // Connection header and the blank line after it
+} StaticRequest;
+
+typedef enum {
+    STATIC_SENT,                 // A 200 or 304 went out
+    STATIC_NOT_FOUND,            // Nothing sent; no such file or not allowed
+    STATIC_SEND_FAILED           // The connection failed partway
+} StaticResult;
+
+void static_files_config_defaults(StaticFilesConfig *config);
+
+// Returns 0 if the root is not a directory; nothing is served then
+int static_files_init(const StaticFilesConfig *config);
+
+// Whether a root is being served
+int static_files_enabled(void);
+
+StaticResult static_files_serve(int socket, const StaticRequest *request);
+
+// Lookups since start, for reporting
+void static_files_counts(unsigned long long *hits, unsigned long long *misses);
+
+#endif
@@ -0,0 +1,308 @@
+/* Task Graph - per-user dependency DAG with a ready set
+ *
+ * Nodes live in one array and refer to each other by index; a small open
+ * addressing table maps task ids to indices. Only outgoing edges are stored:
+ * state changes propagate forward, and the cycle check is a reachability
+ * search forward from the new dependent.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "task_graph.h"
+
+#define INITIAL_NODES 16
+#define INITIAL_EDGES 4
+
+static const char *dependency_names[] = {
+    "finish_to_start", "start_to_start", "finish_to_finish", "start_to_finish"
+};
+
+static unsigned int slot_hash(int task_id, int slot_capacity) {
+    return ((unsigned int)task_id * 2654435761u) & (unsigned int)(slot_capacity - 1);
+}
+
+static int find_node(const TaskGraph *graph, int task_id) {
+    if (graph->slot_capacity == 0) return -1;
+
+    unsigned int mask = (unsigned int)graph->slot_capacity - 1;
+    for (unsigned int i = slot_hash(task_id, graph->slot_capacity); graph->slots[i]; i = (i + 1) & mask) {
+        int index = graph->slots[i] - 1;
+        if (graph->nodes[index].task_id == task_id) return index;
+    }
+    return -1;
+}
+
+static void insert_slot(int *slots, int slot_capacity, int task_id, int index) {
+    unsigned int mask = (unsigned int)slot_capacity - 1;
+    unsigned int i = slot_hash(task_id, slot_capacity);
+    while (slots[i]) i = (i + 1) & mask;
+    slots[i] = index + 1;
+}
+
+// Keeps the table at most half full
+static int grow_slots(TaskGraph *graph) {
+    int slot_capacity = graph->slot_capacity ? graph->slot_capacity * 2 : INITIAL_NODES * 2;
+    int *slots = calloc((size_t)slot_capacity, sizeof(int));
+    if (!slots) return 0;
+
+    for (int i = 0; i < graph->count; i++) {
+        insert_slot(slots, slot_capacity, graph->nodes[i].task_id, i);
+    }
+    free(graph->slots);
+    graph->slots = slots;
+    graph->slot_capacity = slot_capacity;
+    return 1;
+}
+
+static int grow_nodes(TaskGraph *graph) {
+    int capacity = graph->capacity ? graph->capacity * 2 : INITIAL_NODES;
+
+    TaskNode *nodes = realloc(graph->nodes, (size_t)capacity * sizeof(TaskNode));
+    if (!nodes) return 0;
+    graph->nodes = nodes;
+
+    int *ready = realloc(graph->ready, (size_t)capacity * sizeof(int));
+    if (!ready) return 0;
+    graph->ready = ready;
+
+    int *stack = realloc(graph->stack, (size_t)capacity * sizeof(int));
+    if (!stack) return 0;
+    graph->stack = stack;
+
+    graph->capacity = capacity;
+    return 1;
+}
+
+// ============================================
+// READY SET
+// ============================================
+
+static void ready_add(TaskGraph *graph, int index) {
+    TaskNode *node = &graph->nodes[index];
+    if (node->ready_pos >= 0) return;
+    node->ready_pos = graph->ready_count;
+    graph->ready[graph->ready_count++] = index;
+}
+
+static void ready_remove(TaskGraph *graph, int index) {
+    TaskNode *node = &graph->nodes[index];
+    if (node->ready_pos < 0) return;
+
+    int last = graph->ready[--graph->ready_count];
+    graph->ready[node->ready_pos] = last;
+    graph->nodes[last].ready_pos = node->ready_pos;
+    node->ready_pos = -1;
+}
+
+// Re-evaluates one node's membership; returns 1 if it just became ready
+static int ready_update(TaskGraph *graph, int index) {
+    TaskNode *node = &graph->nodes[index];
+    if (node->state == TASK_STATE_PENDING && node->start_blockers == 0) {
+        if (node->ready_pos >= 0) return 0;
+        ready_add(graph, index);
+        return 1;
+    }
+    ready_remove(graph, index);
+    return 0;
+}
+
+// ============================================
+// EDGES
+// ============================================
+
+static int gates_start(int type) {
+    return type == DEP_FINISH_TO_START || type == DEP_START_TO_START;
+}
+
+static int edge_satisfied(int type, int prerequisite_state) {
+    if (type == DEP_FINISH_TO_START || type == DEP_FINISH_TO_FINISH) {
+        return prerequisite_state == TASK_STATE_FINISHED;
+    }
+    return prerequisite_state >= TASK_STATE_STARTED;
+}
+
+static void adjust_blockers(TaskNode *node, int type, int delta) {
+    if (gates_start(type)) {
+        node->start_blockers += delta;
+    } else {
+        node->finish_blockers += delta;
+    }
+}
+
+// Whether `target` can be reached from `from` along dependency edges
+static int reaches(TaskGraph *graph, int from, int target) {
+    unsigned int stamp = ++graph->visit_stamp;
+    if (stamp == 0) {
+        // Stamp wrapped; clear the old marks once
+        for (int i = 0; i < graph->count; i++) graph->nodes[i].visit = 0;
+        stamp = graph->visit_stamp = 1;
+    }
+
+    int top = 0;
+    graph->stack[top++] = from;
+    graph->nodes[from].visit = stamp;
+
+    while (top > 0) {
+        TaskNode *node = &graph->nodes[graph->stack[--top]];
+        for (int i = 0; i < node->out_count; i++) {
+            int next = node->out[i].to;
+            if (next == target) return 1;
+            if (graph->nodes[next].visit == stamp) continue;
+            graph->nodes[next].visit = stamp;
+            graph->stack[top++] = next;
+        }
+    }
+    return 0;
+}
+
+// ============================================
+// PUBLIC API
+// ============================================
+
+void task_graph_init(TaskGraph *graph, int user_id) {
+    memset(graph, 0, sizeof(*graph));
+    graph->user_id = user_id;
+}
+
+void task_graph_free(TaskGraph *graph) {
+    for (int i = 0; i < graph->count; i++) {
+        free(graph->nodes[i].out);
+    }
+    free(graph->nodes);
+    free(graph->slots);
+    free(graph->ready);
+    free(graph->stack);
+    task_graph_init(graph, graph->user_id);
+}
+
+int task_graph_add_task(TaskGraph *graph, int task_id, int state) {
+    if (find_node(graph, task_id) >= 0) return 0;
+    if (graph->count == graph->capacity && !grow_nodes(graph)) return 0;
+    if ((graph->count + 1) * 2 > graph->slot_capacity && !grow_slots(graph)) return 0;
+
+    int index = graph->count++;
+    TaskNode *node = &graph->nodes[index];
+    memset(node, 0, sizeof(*node));
+    node->task_id = task_id;
+    node->state = state;
+    node->ready_pos = -1;
+
+    insert_slot(graph->slots, graph->slot_capacity, task_id, index);
+    ready_update(graph, index);
+    return 1;
+}
+
+int task_graph_add_edge(TaskGraph *graph, int task_id, int depends_on_task_id, int type) {
+    int dependent = find_node(graph, task_id);
+    int prerequisite = find_node(graph, depends_on_task_id);
+    if (dependent < 0 || prerequisite < 0) return TASK_GRAPH_NOT_FOUND;
+    if (dependent == prerequisite) return TASK_GRAPH_CYCLE;
+
+    TaskNode *from = &graph->nodes[prerequisite];
+    for (int i = 0; i < from->out_count; i++) {
+        if (from->out[i].to == dependent) return TASK_GRAPH_EXISTS;
+    }
+
+    // prerequisite -> dependent closes a cycle iff dependent already leads back
+    if (reaches(graph, dependent, prerequisite)) return TASK_GRAPH_CYCLE;
+
+    if (from->out_count == from->out_capacity) {
+        int capacity = from->out_capacity ? from->out_capacity * 2 : INITIAL_EDGES;
+        TaskEdge *out = realloc(from->out, (size_t)capacity * sizeof(TaskEdge));
+        if (!out) return TASK_GRAPH_NO_MEMORY;
+        from->out = out;
+        from->out_capacity = capacity;
+    }
+    from->out[from->out_count].to = dependent;
+    from->out[from->out_count].type = type;
+    from->out_count++;
+
+    if (!edge_satisfied(type, from->state)) {
+        adjust_blockers(&graph->nodes[dependent], type, 1);
+        ready_update(graph, dependent);
+    }
+    return TASK_GRAPH_OK;
+}
+
+int task_graph_remove_edge(TaskGraph *graph, int task_id, int depends_on_task_id) {
+    int dependent = find_node(graph, task_id);
+    int prerequisite = find_node(graph, depends_on_task_id);
+    if (dependent < 0 || prerequisite < 0) return 0;
+
+    TaskNode *from = &graph->nodes[prerequisite];
+    for (int i = 0; i < from->out_count; i++) {
+        if (from->out[i].to != dependent) continue;
+
+        int type = from->out[i].type;
+        from->out[i] = from->out[--from->out_count];
+        if (!edge_satisfied(type, from->state)) {
+            adjust_blockers(&graph->nodes[dependent], type, -1);
+            ready_update(graph, dependent);
+        }
+        return 1;
+    }
+    return 0;
+}
+
+int task_graph_set_state(TaskGraph *graph, int task_id, int state, int *released, int max_released) {
+    int index = find_node(graph, task_id);
+    if (index < 0) return -1;
+
+    TaskNode *node = &graph->nodes[index];
+    int old_state = node->state;
+    if (old_state == state) return 0;
+
+    node->state = state;
+    ready_update(graph, index);
+
+    // Only edges whose satisfaction flips touch the dependent
+    int released_count = 0;
+    for (int i = 0; i < node->out_count; i++) {
+        int type = node->out[i].type;
+        int was = edge_satisfied(type, old_state);
+        int now = edge_satisfied(type, state);
+        if (was == now) continue;
+
+        int dependent = node->out[i].to;
+        adjust_blockers(&graph->nodes[dependent], type, now ? -1 : 1);
+        if (ready_update(graph, dependent)) {
+            if (released && released_count < max_released) {
+                released[released_count] = graph->nodes[dependent].task_id;
+            }
+            released_count++;
+        }
+    }
+    return released_count;
+}
+
+int task_graph_ready(const TaskGraph *graph, int *task_ids, int max) {
+    for (int i = 0; i < graph->ready_count && i < max; i++) {
+        task_ids[i] = graph->nodes[graph->ready[i]].task_id;
+    }
+    return graph->ready_count;
+}
+
+int task_graph_can_start(const TaskGraph *graph, int task_id) {
+    int index = find_node(graph, task_id);
+    if (index < 0) return -1;
+    return graph->nodes[index].start_blockers == 0;
+}
+
+int task_graph_can_finish(const TaskGraph *graph, int task_id) {
+    int index = find_node(graph, task_id);
+    if (index < 0) return -1;
+    const TaskNode *node = &graph->nodes[index];
+    return node->start_blockers == 0 && node->finish_blockers == 0;
+}
+
+int task_graph_dependency_type(const char *name) {
+    if (!name || !name[0]) return DEP_FINISH_TO_START;
+    for (int i = 0; i < 4; i++) {
+        if (strcmp(name, dependency_names[i]) == 0) return i;
+    }
+    return -1;
+}
+
+const char *task_graph_dependency_name(int type) {
+    return (type >= 0 && type < 4) ? dependency_names[type] : "finish_to_start";
+}
@@ -0,0 +1,95 @@
+/* Task Graph - per-user dependency DAG with a ready set
+ *
+ * Built from task_dependencies (task_id depends on depends_on_task_id). Every
+ * task keeps two counters of unsatisfied incoming edges: one that gates its
+ * start (finish_to_start, start_to_start) and one that gates its finish
+ * (finish_to_finish, start_to_finish). A state change walks only the task's
+ * outgoing edges, so releasing dependents costs O(out-degree), and pending
+ * tasks whose start counter is zero are kept in a ready set.
+ *
+ * Edges that would close a cycle are rejected when they are inserted.
+ * The module does no locking and no I/O; callers load it and serialize access.
+ */
+
+#ifndef TASK_GRAPH_H
+#define TASK_GRAPH_H
+
+// task_dependencies.dependency_type
+#define DEP_FINISH_TO_START 0    // Dependent may start once the prerequisite has finished
+#define DEP_START_TO_START  1    // Dependent may start once the prerequisite has started
+#define DEP_FINISH_TO_FINISH 2   // Dependent may finish once the prerequisite has finished
+#define DEP_START_TO_FINISH 3    // Dependent may finish once the prerequisite has started
+
+// Task states as the graph sees them
+#define TASK_STATE_PENDING  0
+#define TASK_STATE_STARTED  1
+#define TASK_STATE_FINISHED 2
+
+// task_graph_add_edge results
+#define TASK_GRAPH_OK        0
+#define TASK_GRAPH_CYCLE     1   // The edge would close a cycle (or is a self-dependency)
+#define TASK_GRAPH_NOT_FOUND 2   // One of the tasks is not in the graph
+#define TASK_GRAPH_EXISTS    3   // The pair already has an edge
+#define TASK_GRAPH_NO_MEMORY 4
+
+typedef struct {
+    int to;                      // Node index of the dependent task
+    int type;                    // DEP_*
+} TaskEdge;
+
+typedef struct {
+    int task_id;
+    int state;                   // TASK_STATE_*
+    int start_blockers;          // Unsatisfied incoming FS / SS edges
+    int finish_blockers;         // Unsatisfied incoming FF / SF edges
+    int ready_pos;               // Index in the ready set, -1 when not ready
+    unsigned int visit;          // Cycle-check stamp
+    TaskEdge *out;
+    int out_count;
+    int out_capacity;
+} TaskNode;
+
+typedef struct {
+    int user_id;
+    TaskNode *nodes;
+    int count;
+    int capacity;
+    int *slots;                  // Open addressing, task_id -> node index + 1
+    int slot_capacity;           // Power of two
+    int *ready;                  // Node indices of pending tasks with no start blockers
+    int ready_count;
+    int *stack;                  // Cycle-check scratch, capacity entries
+    unsigned int visit_stamp;
+} TaskGraph;
+
+void task_graph_init(TaskGraph *graph, int user_id);
+void task_graph_free(TaskGraph *graph);
+
+// Adds a task in the given state; returns 0 on allocation failure or if it already exists
+int task_graph_add_task(TaskGraph *graph, int task_id, int state);
+
+// task_id depends on depends_on_task_id; returns TASK_GRAPH_*
+int task_graph_add_edge(TaskGraph *graph, int task_id, int depends_on_task_id, int type);
+
+// Removes an edge (e.g. to roll back a failed insert); returns 0 if there was none
+int task_graph_remove_edge(TaskGraph *graph, int task_id, int depends_on_task_id);
+
+// Moves a task to a new state and updates its dependents. Task ids that became
+// ready are written to released (up to max_released); returns how many did,
+// or -1 if the task is unknown.
+int task_graph_set_state(TaskGraph *graph, int task_id, int state, int *released, int max_released);
+
+// Copies up to max ids of tasks that can be started now (in no particular order); returns the total
+int task_graph_ready(const TaskGraph *graph, int *task_ids, int max);
+
+// 1 if the task may start now, 0 if blocked, -1 if unknown
+int task_graph_can_start(const TaskGraph *graph, int task_id);
+
+// 1 if the task may be finished now, 0 if blocked, -1 if unknown
+int task_graph_can_finish(const TaskGraph *graph, int task_id);
+
+// "finish_to_start" etc. to DEP_*; -1 if unrecognized. NULL or "" is finish_to_start.
+int task_graph_dependency_type(const char *name);
+const char *task_graph_dependency_name(int type);
+
+#endif